@@ -14,6 +14,7 @@
 #ifndef LLVM_ANALYSIS_BASICALIASANALYSIS_H
 #define LLVM_ANALYSIS_BASICALIASANALYSIS_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/AssumptionCache.h"
@@ -24,6 +25,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/PassManager.h"
+#include "llvm/IR/ValueHandle.h"
 #include "llvm/Support/ErrorHandling.h"
 
 namespace llvm {
@@ -32,11 +34,13 @@ class DominatorTree;
 class LoopInfo;
 
 /// This is the AA result object for the basic, local, and stateless alias
-/// analysis. It implements the AA query interface in an entirely stateless
+/// analysis. It implements the AA query interface in an essentially stateless
 /// manner. As one consequence, it is never invalidated due to IR changes.
-/// While it does retain some storage, that is used as an optimization and not
-/// to preserve information from query to query. However it does retain handles
-/// to various other analyses and must be recomputed when those analyses are.
+/// The only information it keeps from query to query is a cache of GEP
+/// decompositions, which tracks the values it depends on through value
+/// handles and is dropped whenever this analysis is not preserved. It also
+/// retains handles to various other analyses and must be recomputed when
+/// those analyses are.
 class BasicAAResult : public AAResultBase<BasicAAResult> {
   friend AAResultBase<BasicAAResult>;
 
@@ -52,6 +56,8 @@ public:
                 LoopInfo *LI = nullptr)
       : AAResultBase(), DL(DL), TLI(TLI), AC(AC), DT(DT), LI(LI) {}
 
+  // The caches are not carried over: their value handles point back to the
+  // result that created them.
   BasicAAResult(const BasicAAResult &Arg)
       : AAResultBase(Arg), DL(Arg.DL), TLI(Arg.TLI), AC(Arg.AC), DT(Arg.DT),
         LI(Arg.LI) {}
@@ -147,6 +153,43 @@ private:
   /// Tracks instructions visited by pointsToConstantMemory.
   SmallPtrSet<const Value *, 16> Visited;
 
+  /// A value that cached GEP decompositions depend on. The decompositions are
+  /// dropped when the value is deleted or replaced.
+  class DecomposedGEPCallbackVH final : public CallbackVH {
+    BasicAAResult *AAR;
+    void deleted() override;
+    void allUsesReplacedWith(Value *New) override;
+
+  public:
+    DecomposedGEPCallbackVH(Value *V, BasicAAResult *AAR = nullptr)
+        : CallbackVH(V), AAR(AAR) {}
+  };
+  friend class DecomposedGEPCallbackVH;
+
+  struct CachedDecomposedGEP {
+    DecomposedGEP Decomposed;
+    bool MaxLookupReached;
+  };
+
+  /// The decompositions of the pointers that earlier queries looked at. A
+  /// decomposition only depends on the chain of values that
+  /// DecomposeGEPExpression walks through, which DecomposedGEPUsers tracks, so
+  /// it stays valid across queries and across passes that preserve this
+  /// analysis.
+  DenseMap<const Value *, CachedDecomposedGEP> DecomposedGEPs;
+
+  /// Maps each value that a cached decomposition depends on to the pointers
+  /// whose decompositions depend on it.
+  DenseMap<DecomposedGEPCallbackVH, SmallVector<const Value *, 2>,
+           DenseMapInfo<Value *>>
+      DecomposedGEPUsers;
+
+  /// Decompose \p V like DecomposeGEPExpression, using the cache.
+  bool decomposeGEP(const Value *V, DecomposedGEP &Decomposed);
+
+  /// Drop the cached decompositions that depend on \p V.
+  void forgetDecomposedGEPs(Value *V);
+
   static const Value *
   GetLinearExpression(const Value *V, APInt &Scale, APInt &Offset,
                       unsigned &ZExtBits, unsigned &SExtBits,
@@ -154,7 +197,8 @@ private:
                       DominatorTree *DT, bool &NSW, bool &NUW);
 
   static bool DecomposeGEPExpression(const Value *V, DecomposedGEP &Decomposed,
-      const DataLayout &DL, AssumptionCache *AC, DominatorTree *DT);
+      const DataLayout &DL, AssumptionCache *AC, DominatorTree *DT,
+      SmallVectorImpl<const Value *> *Walked = nullptr);
 
   static bool isGEPBaseAtNegativeOffset(const GEPOperator *GEPOp,
       const DecomposedGEP &DecompGEP, const DecomposedGEP &DecompObject,
@@ -286,6 +286,15 @@ struct CGSCCUpdateResult {
 /// \c CGSCCAnalysisManagerModuleProxy analysis prior to running the CGSCC
 /// pass over the module to enable a \c FunctionAnalysisManager to be used
 /// within this run safely.
+///
+/// The walk is strictly sequential, even though RefSCCs with no path between
+/// them are independent in the call graph DAG. The passes are not: they
+/// create constants, types and metadata in the module's shared
+/// \c LLVMContext, they update the use lists of globals, and they refine the
+/// \c LazyCallGraph and the analysis managers in place. None of these are
+/// thread safe. Parallelism across independent parts of a program is
+/// available one level up, by splitting it into modules with their own
+/// contexts, as the ThinLTO backends and parallel code generation do.
 template <typename CGSCCPassT>
 class ModuleToPostOrderCGSCCPassAdaptor
     : public PassInfoMixin<ModuleToPostOrderCGSCCPassAdaptor<CGSCCPassT>> {
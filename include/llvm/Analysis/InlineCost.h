@@ -14,8 +14,12 @@
 #ifndef LLVM_ANALYSIS_INLINECOST_H
 #define LLVM_ANALYSIS_INLINECOST_H
 
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/CallGraphSCCPass.h"
 #include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/IR/Attributes.h"
 #include <cassert>
 #include <climits>
 
@@ -160,6 +164,86 @@ InlineParams getInlineParams(int Threshold);
 /// the -Oz flag.
 InlineParams getInlineParams(unsigned OptLevel, unsigned SizeOptLevel);
 
+/// \brief Memoizes the simulations of callee bodies done by \c getInlineCost.
+///
+/// Most of the cost of a call site comes from walking the callee body, which
+/// only depends on the call site through the constants, pointers and
+/// attributes it passes to the callee. When a call site passes no constant
+/// arguments, the result of the walk is recorded along with everything it
+/// depended on, and reused for later call sites that match.
+///
+/// The cache does not observe the IR: its owner must call \c invalidate on
+/// any function whose body changes, such as a caller that something was
+/// inlined into, and must only use it with one set of \c InlineParams.
+class InlineCostCache {
+public:
+  /// A pointer argument of the call site, described by its constant offset
+  /// from its base pointer. Bases are only identified by their position among
+  /// the distinct bases of the call site's arguments.
+  struct PointerArg {
+    unsigned ArgNo;
+    unsigned BaseIndex;
+    bool IsAlloca;
+    APInt Offset;
+
+    bool operator==(const PointerArg &RHS) const {
+      return ArgNo == RHS.ArgNo && BaseIndex == RHS.BaseIndex &&
+             IsAlloca == RHS.IsAlloca &&
+             Offset.getBitWidth() == RHS.Offset.getBitWidth() &&
+             Offset == RHS.Offset;
+    }
+  };
+
+  /// The state of the analysis before the walk of the callee body, and its
+  /// outcome.
+  struct Entry {
+    int Threshold;
+    int Cost;
+    bool IsCallerRecursive;
+    bool OnlyOneCallAndLocalLinkage;
+    AttributeList CallSiteAttrs;
+    SmallVector<PointerArg, 4> PointerArgs;
+
+    bool ShouldInline;
+    int FinalCost;
+    int FinalThreshold;
+
+    /// Returns true if the walk that produced \p RHS started from the same
+    /// state as this one.
+    bool matches(const Entry &RHS) const {
+      return Threshold == RHS.Threshold && Cost == RHS.Cost &&
+             IsCallerRecursive == RHS.IsCallerRecursive &&
+             OnlyOneCallAndLocalLinkage == RHS.OnlyOneCallAndLocalLinkage &&
+             CallSiteAttrs == RHS.CallSiteAttrs &&
+             PointerArgs == RHS.PointerArgs;
+    }
+  };
+
+  /// Returns the recorded walk of \p Callee that matches \p E, if any.
+  const Entry *lookup(Function &Callee, const Entry &E) const {
+    auto I = Entries.find(&Callee);
+    if (I == Entries.end())
+      return nullptr;
+    for (const Entry &Cached : I->second)
+      if (Cached.matches(E))
+        return &Cached;
+    return nullptr;
+  }
+
+  /// Records a walk of \p Callee.
+  void insert(Function &Callee, Entry E) {
+    Entries[&Callee].push_back(std::move(E));
+  }
+
+  /// Forgets the walks of \p F, whose body has changed or is going away.
+  void invalidate(Function &F) { Entries.erase(&F); }
+
+  void clear() { Entries.clear(); }
+
+private:
+  DenseMap<Function *, SmallVector<Entry, 1>> Entries;
+};
+
 /// \brief Get an InlineCost object representing the cost of inlining this
 /// callsite.
 ///
@@ -170,13 +254,15 @@ InlineParams getInlineParams(unsigned OptLevel, unsigned SizeOptLevel);
 /// sufficiently low to warrant inlining.
 ///
 /// Also note that calling this function *dynamically* computes the cost of
-/// inlining the callsite. It is an expensive, heavyweight call.
+/// inlining the callsite. It is an expensive, heavyweight call. Passing a
+/// \p Cache lets it reuse the work done for earlier call sites to the same
+/// callee.
 InlineCost
 getInlineCost(CallSite CS, const InlineParams &Params,
               TargetTransformInfo &CalleeTTI,
               std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
               Optional<function_ref<BlockFrequencyInfo &(Function &)>> GetBFI,
-              ProfileSummaryInfo *PSI);
+              ProfileSummaryInfo *PSI, InlineCostCache *Cache = nullptr);
 
 /// \brief Get an InlineCost with the callee explicitly specified.
 /// This allows you to calculate the cost of inlining a function via a
@@ -188,7 +274,7 @@ getInlineCost(CallSite CS, Function *Callee, const InlineParams &Params,
               TargetTransformInfo &CalleeTTI,
               std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
               Optional<function_ref<BlockFrequencyInfo &(Function &)>> GetBFI,
-              ProfileSummaryInfo *PSI);
+              ProfileSummaryInfo *PSI, InlineCostCache *Cache = nullptr);
 
 /// \brief Minimal filter to detect invalid constructs for inlining.
 bool isInlineViable(Function &Callee);
@@ -26,6 +26,7 @@
 namespace llvm {
   class LLVMContext;
   class Module;
+  struct BitcodeFileContents;
 
   // These functions are for converting Expected/Error values to
   // ErrorOr/std::error_code for compatibility with legacy clients. FIXME:
@@ -58,8 +59,8 @@ namespace llvm {
           IdentificationBit(IdentificationBit), ModuleBit(ModuleBit) {}
 
     // Calls the ctor.
-    friend Expected<std::vector<BitcodeModule>>
-    getBitcodeModuleList(MemoryBufferRef Buffer);
+    friend Expected<BitcodeFileContents>
+    getBitcodeFileContents(MemoryBufferRef Buffer);
 
     Expected<std::unique_ptr<Module>> getModuleImpl(LLVMContext &Context,
                                                     bool MaterializeAll,
@@ -91,6 +92,18 @@ namespace llvm {
     Expected<std::unique_ptr<ModuleSummaryIndex>> getSummary();
   };
 
+  /// The contents of a bitcode file: its modules, and the IR symbol table
+  /// (see llvm/Object/IRSymtab.h) with its string table if the file has one.
+  /// Both tables point into the buffer.
+  struct BitcodeFileContents {
+    std::vector<BitcodeModule> Mods;
+    StringRef Symtab, StrtabForSymtab;
+  };
+
+  /// Returns the contents of the specified bitcode buffer. Only the block
+  /// headers of the modules are read.
+  Expected<BitcodeFileContents> getBitcodeFileContents(MemoryBufferRef Buffer);
+
   /// Returns a list of modules in the specified bitcode buffer.
   Expected<std::vector<BitcodeModule>>
   getBitcodeModuleList(MemoryBufferRef Buffer);
@@ -16,6 +16,7 @@
 
 #include "llvm/IR/ModuleSummaryIndex.h"
 #include <string>
+#include <vector>
 
 namespace llvm {
   class BitstreamWriter;
@@ -26,6 +27,9 @@ namespace llvm {
     SmallVectorImpl<char> &Buffer;
     std::unique_ptr<BitstreamWriter> Stream;
 
+    // The modules written so far, for the symbol table.
+    std::vector<Module *> Mods;
+
    public:
     /// Create a BitcodeWriter that writes to Buffer.
     BitcodeWriter(SmallVectorImpl<char> &Buffer);
@@ -53,6 +57,12 @@ namespace llvm {
     void writeModule(const Module *M, bool ShouldPreserveUseListOrder = false,
                      const ModuleSummaryIndex *Index = nullptr,
                      bool GenerateHash = false, ModuleHash *ModHash = nullptr);
+
+    /// Write the IR symbol table (see llvm/Object/IRSymtab.h) of the modules
+    /// written so far, so that linkers and archivers can read the symbols of
+    /// the file without parsing its modules. The modules must still be alive,
+    /// and no module may be written after this.
+    void writeSymtab();
   };
 
   /// \brief Write the specified module to the specified raw output stream.
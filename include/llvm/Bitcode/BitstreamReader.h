@@ -304,6 +304,43 @@ struct BitstreamEntry {
   }
 };
 
+class BitstreamCursor;
+
+/// The entries of a block, and of the blocks nested in it, decoded ahead of
+/// time.
+///
+/// Decoding the records of a block doesn't depend on their meaning, so blocks
+/// can be recorded on other threads, each with a cursor of its own, and then
+/// be replayed by the cursor that interprets them (see
+/// BitstreamCursor::replayBlock). Abbreviation definitions are processed while
+/// recording and don't appear in the recording.
+class BitstreamBlockRecording {
+  friend class BitstreamCursor;
+
+  struct Entry {
+    /// The entry as returned by advance().
+    BitstreamEntry Header;
+    /// The record code, or the size in words of a block.
+    unsigned CodeOrNumWords;
+    /// The operands of a record, in Ops. For a block, End is the index of its
+    /// EndBlock entry.
+    size_t Begin, End;
+    /// The blob operand of a record, if it has one.
+    StringRef Blob;
+  };
+
+  std::vector<Entry> Entries;
+  std::vector<uint64_t> Ops;
+  /// The position right after the recorded block.
+  uint64_t EndBit = 0;
+
+public:
+  /// Decode the block with ID \p BlockID whose ENTER_SUBBLOCK abbrev ID and
+  /// block ID end at \p BitNo, reading it with \p Cursor. Return true if the
+  /// block is malformed.
+  bool record(BitstreamCursor &Cursor, uint64_t BitNo, unsigned BlockID);
+};
+
 /// This represents a position within a bitcode file, implemented on top of a
 /// SimpleBitstreamCursor.
 ///
@@ -329,6 +366,12 @@ class BitstreamCursor : SimpleBitstreamCursor {
 
   BitstreamBlockInfo *BlockInfo = nullptr;
 
+  /// The block being replayed instead of being read, if any, the index of the
+  /// next entry to return, and the number of blocks entered in the recording.
+  const BitstreamBlockRecording *Replay = nullptr;
+  size_t ReplayIndex = 0;
+  unsigned ReplayDepth = 0;
+
 public:
   static const size_t MaxChunkSize = sizeof(word_t) * 8;
 
@@ -368,6 +411,9 @@ public:
 
   /// Advance the current bitstream, returning the next entry in the stream.
   BitstreamEntry advance(unsigned Flags = 0) {
+    if (Replay)
+      return advanceReplay(Flags);
+
     while (true) {
       if (AtEndOfStream())
         return BitstreamEntry::getError();
@@ -411,6 +457,13 @@ public:
   }
 
   unsigned ReadCode() {
+    if (Replay) {
+      const BitstreamBlockRecording::Entry &E =
+          Replay->Entries[ReplayIndex++];
+      assert(E.Header.Kind == BitstreamEntry::Record &&
+             "Only record codes can be read from a replayed block");
+      return E.Header.ID;
+    }
     return Read(CurCodeSize);
   }
 
@@ -425,6 +478,13 @@ public:
   /// Having read the ENTER_SUBBLOCK abbrevid and a BlockID, skip over the body
   /// of this block. If the block record is malformed, return true.
   bool SkipBlock() {
+    if (Replay) {
+      ReplayIndex = Replay->Entries[ReplayIndex - 1].End + 1;
+      if (ReplayDepth == 0)
+        endReplay();
+      return false;
+    }
+
     // Read and ignore the codelen value.  Since we are skipping this block, we
     // don't care what code widths are used inside of it.
     ReadVBR(bitc::CodeLenWidth);
@@ -446,6 +506,14 @@ public:
   bool EnterSubBlock(unsigned BlockID, unsigned *NumWordsP = nullptr);
 
   bool ReadBlockEnd() {
+    if (Replay) {
+      if (ReplayDepth == 0)
+        return true;
+      if (--ReplayDepth == 0)
+        endReplay();
+      return false;
+    }
+
     if (BlockScope.empty()) return true;
 
     // Block tail:
@@ -456,7 +524,29 @@ public:
     return false;
   }
 
+  /// Having read the ENTER_SUBBLOCK abbrev ID and the block ID of the block
+  /// that \p Recording was made from, return the recorded entries instead of
+  /// reading them, up to the end of the block. The cursor then continues
+  /// right after the block, in the state it was in before entering it.
+  ///
+  /// Only advance(), entering, skipping and ending blocks, reading codes and
+  /// reading records are supported while replaying.
+  void replayBlock(const BitstreamBlockRecording &Recording) {
+    assert(!Replay && "Already replaying a block");
+    Replay = &Recording;
+    ReplayIndex = 1;
+    ReplayDepth = 0;
+  }
+
 private:
+  BitstreamEntry advanceReplay(unsigned Flags);
+  unsigned readReplayedRecord(SmallVectorImpl<uint64_t> &Vals,
+                              StringRef *Blob);
+  void endReplay() {
+    JumpToBit(Replay->EndBit);
+    Replay = nullptr;
+  }
+
   void popBlockScope() {
     CurCodeSize = BlockScope.back().PrevCodeSize;
 
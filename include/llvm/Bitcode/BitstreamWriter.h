@@ -248,6 +248,36 @@ public:
     BlockScope.pop_back();
   }
 
+  /// Prepares this stream, which must be empty, to encode blocks that will
+  /// be spliced into \p Parent at its current position with SpliceBlock(). It
+  /// gets the BLOCKINFO abbreviations and the abbrev ID width of \p Parent.
+  void InheritBlockInfo(const BitstreamWriter &Parent) {
+    assert(GetCurrentBitNo() == 0 && BlockScope.empty() &&
+           "Can only inherit block info into an empty stream");
+    CurCodeSize = Parent.CurCodeSize;
+    BlockInfoRecords = Parent.BlockInfoRecords;
+  }
+
+  /// Emits a whole block that was encoded, with the given \p BlockID and
+  /// \p CodeLen, as the only content of a stream set up with
+  /// InheritBlockInfo(*this). The result is the same as if the block had been
+  /// written to this stream directly.
+  void SpliceBlock(unsigned BlockID, unsigned CodeLen, ArrayRef<char> Block) {
+    // The block header only depends on the current abbrev ID width, but its
+    // padding depends on the position in the stream; re-emit it here, then
+    // copy the size word and the contents.
+    EmitCode(bitc::ENTER_SUBBLOCK);
+    EmitVBR(BlockID, bitc::BlockIDWidth);
+    EmitVBR(CodeLen, bitc::CodeLenWidth);
+    FlushToWord();
+
+    assert(Block.size() % 4 == 0 && Block.size() >= 8 && "Not a whole block");
+    assert(support::endian::read32le(Block.data() + 4) ==
+               Block.size() / 4 - 2 &&
+           "Block header expected to fit in a single word");
+    Out.append(Block.begin() + 4, Block.end());
+  }
+
   //===--------------------------------------------------------------------===//
   // Record Emission
   //===--------------------------------------------------------------------===//
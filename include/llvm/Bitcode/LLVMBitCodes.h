@@ -52,7 +52,12 @@ enum BlockIDs {
 
   OPERAND_BUNDLE_TAGS_BLOCK_ID,
 
-  METADATA_KIND_BLOCK_ID
+  METADATA_KIND_BLOCK_ID,
+
+  // Top-level blocks that follow the modules, holding the IR symbol table of
+  // the file (see llvm/Object/IRSymtab.h) and the string table it refers to.
+  STRTAB_BLOCK_ID,
+  SYMTAB_BLOCK_ID
 };
 
 /// Identification block contains a string that describes the producer details,
@@ -110,6 +115,9 @@ enum ModuleCodes {
 
   // IFUNC: [ifunc value type, addrspace, resolver val#, linkage, visibility]
   MODULE_CODE_IFUNC = 18,
+
+  // SUMMARYOFFSET: [offset]
+  MODULE_CODE_SUMMARYOFFSET = 19,
 };
 
 /// PARAMATTR blocks have code for defining a parameter attribute set.
@@ -550,6 +558,14 @@ enum ComdatSelectionKindCodes {
   COMDAT_SELECTION_KIND_SAME_SIZE = 5,
 };
 
+enum StrtabCodes {
+  STRTAB_BLOB = 1, // STRTAB_BLOB: [blob]
+};
+
+enum SymtabCodes {
+  SYMTAB_BLOB = 1, // SYMTAB_BLOB: [blob]
+};
+
 } // End bitc namespace
 } // End llvm namespace
 
@@ -36,6 +36,11 @@ class raw_pwrite_stream;
 /// BCOSs is not empty.
 ///
 /// \returns M if OSs.size() == 1, otherwise returns std::unique_ptr<Module>().
+///
+/// FIXME: Code generation of the functions of a single module is not run
+/// concurrently. MachineFunctionPasses share the MachineModuleInfo, the
+/// MCContext and the AsmPrinter's streamer, and they update the use lists of
+/// globals and constants, none of which is synchronized.
 std::unique_ptr<Module>
 splitCodeGen(std::unique_ptr<Module> M, ArrayRef<raw_pwrite_stream *> OSs,
              ArrayRef<llvm::raw_pwrite_stream *> BCOSs,
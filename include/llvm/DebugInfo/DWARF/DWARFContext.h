@@ -73,6 +73,12 @@ class DWARFContext : public DIContext {
   std::unique_ptr<DWARFDebugAbbrev> AbbrevDWO;
   std::unique_ptr<DWARFDebugLocDWO> LocDWO;
 
+  /// The maximum number of compile units whose DIEs are kept extracted by the
+  /// address lookup APIs, or 0 if there is no limit.
+  unsigned MaxParsedUnits = 0;
+  /// Compile units touched by address lookups, least recently used first.
+  SmallVector<DWARFCompileUnit *, 8> RecentUnits;
+
   /// Read compile units from the debug_info section (if necessary)
   /// and store them in CUs.
   void parseCompileUnits();
@@ -181,6 +187,12 @@ public:
   /// Get a pointer to the parsed DebugLoc object.
   const DWARFDebugLocDWO *getDebugLocDWO();
 
+  /// Bound the number of compile units whose DIEs stay extracted while
+  /// answering getLineInfoForAddress() and friends. Once more units have been
+  /// touched, the least recently used one has its DIEs released; DWARFDie
+  /// objects taken from it are invalidated. 0, the default, means no limit.
+  void setMaxParsedUnitsForAddressQueries(unsigned Max);
+
   /// Get a pointer to the parsed DebugAranges object.
   const DWARFDebugAranges *getDebugAranges();
 
@@ -252,6 +264,10 @@ private:
   /// Return the compile unit which contains instruction with provided
   /// address.
   DWARFCompileUnit *getCompileUnitForAddress(uint64_t Address);
+
+  /// Mark CU as the most recently used unit and release the DIEs of the
+  /// least recently used ones past MaxParsedUnits.
+  void touchParsedUnit(DWARFCompileUnit *CU);
 };
 
 /// DWARFContextInMemory is the simplest possible implementation of a
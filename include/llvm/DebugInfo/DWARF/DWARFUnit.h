@@ -151,6 +151,22 @@ class DWARFUnit {
 
   const DWARFUnitIndex::Entry *IndexEntry;
 
+  /// An address range covered by a subprogram DIE of this unit.
+  struct SubprogramRange {
+    uint64_t LowPC;
+    uint64_t HighPC;
+    uint32_t DIEIndex;
+
+    SubprogramRange(uint64_t LowPC, uint64_t HighPC, uint32_t DIEIndex)
+        : LowPC(LowPC), HighPC(HighPC), DIEIndex(DIEIndex) {}
+  };
+  /// Sorted, non-overlapping address ranges mapped to the first subprogram
+  /// DIE (in DIE order) that covers them. Built on the first address lookup.
+  /// DIE indices are stable across re-extraction, so this survives
+  /// clearDIEs().
+  std::vector<SubprogramRange> SubprogramRanges;
+  bool SubprogramRangesBuilt = false;
+
   uint32_t getDIEIndex(const DWARFDebugInfoEntry *Die) {
     auto First = DieArray.data();
     assert(Die >= First && Die < First + DieArray.size());
@@ -262,6 +278,12 @@ public:
   void getInlinedChainForAddress(uint64_t Address,
                                  SmallVectorImpl<DWARFDie> &InlinedChain);
 
+  /// releaseDIEs - Drops all parsed DIEs except the unit DIE, along with any
+  /// loaded .dwo unit. They are extracted again on the next access. Every
+  /// DWARFDie previously obtained from this unit (other than the unit DIE)
+  /// is invalidated.
+  void releaseDIEs();
+
   /// getUnitSection - Return the DWARFUnitSection containing this unit.
   const DWARFUnitSectionBase &getUnitSection() const { return UnitSection; }
 
@@ -272,6 +294,10 @@ public:
     return DieArray.size();
   }
 
+  /// \brief Returns the number of DIEs of the unit that are currently parsed,
+  /// without parsing any.
+  size_t getNumParsedDIEs() const { return DieArray.size(); }
+
   /// \brief Return the index of a DIE inside the unit's DIE vector.
   ///
   /// It is illegal to call this method with a DIE that hasn't be
@@ -339,6 +365,9 @@ private:
   /// it was actually constructed.
   bool parseDWO();
 
+  /// buildSubprogramRanges - Fills SubprogramRanges from the parsed DIEs.
+  void buildSubprogramRanges();
+
   /// getSubprogramForAddress - Returns subprogram DIE with address range
   /// encompassing the provided address. The pointer is alive as long as parsed
   /// compile unit DIEs are not cleared.
@@ -13,6 +13,7 @@
 #ifndef LLVM_DEBUGINFO_SYMBOLIZE_SYMBOLIZE_H
 #define LLVM_DEBUGINFO_SYMBOLIZE_SYMBOLIZE_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/DebugInfo/Symbolize/SymbolizableModule.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/ErrorOr.h"
@@ -20,10 +21,13 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace llvm {
 namespace symbolize {
 
+class CachedSymbolizableModule;
+
 using namespace object;
 using FunctionNameKind = DILineInfoSpecifier::FunctionNameKind;
 
@@ -36,6 +40,12 @@ public:
     bool RelativeAddresses : 1;
     std::string DefaultArch;
     std::vector<std::string> DsymHints;
+    /// If not empty, code symbolization results are memoized in files in
+    /// this directory and reused by later symbolizer instances.
+    std::string CacheDir;
+    /// If not zero, only the DIEs of this many DWARF units per module are
+    /// kept parsed, the least recently looked up ones are released.
+    unsigned MaxParsedUnits = 0;
     Options(FunctionNameKind PrintFunctions = FunctionNameKind::LinkageName,
             bool UseSymbolTable = true, bool Demangle = true,
             bool RelativeAddresses = false, std::string DefaultArch = "")
@@ -55,6 +65,22 @@ public:
                                                 uint64_t ModuleOffset);
   Expected<DIGlobal> symbolizeData(const std::string &ModuleName,
                                    uint64_t ModuleOffset);
+
+  /// A (module name, module offset) pair to symbolize.
+  typedef std::pair<std::string, uint64_t> BatchRequest;
+
+  /// Symbolize many code addresses at once. Modules are loaded up front,
+  /// then the addresses of each module are resolved in ascending order by a
+  /// single task, with up to \p ThreadCount modules in flight (0 means one per
+  /// hardware thread). The results are in the order of \p Requests and are
+  /// the same as calling symbolizeCode() on each request in turn.
+  std::vector<Expected<DILineInfo>>
+  symbolizeCodeBatch(ArrayRef<BatchRequest> Requests,
+                     unsigned ThreadCount = 0);
+  /// Like symbolizeCodeBatch(), for symbolizeInlinedCode().
+  std::vector<Expected<DIInliningInfo>>
+  symbolizeInlinedCodeBatch(ArrayRef<BatchRequest> Requests,
+                            unsigned ThreadCount = 0);
   void flush();
   static std::string DemangleName(const std::string &Name,
                                   const SymbolizableModule *ModInfo);
@@ -64,6 +90,16 @@ private:
   // corresponding debug info. These objects can be the same.
   typedef std::pair<ObjectFile*, ObjectFile*> ObjectPair;
 
+  DILineInfo symbolizeCodeInModule(SymbolizableModule &Info,
+                                   uint64_t ModuleOffset) const;
+  DIInliningInfo symbolizeInlinedCodeInModule(SymbolizableModule &Info,
+                                              uint64_t ModuleOffset) const;
+
+  template <typename ResultTy, typename SymbolizeFnTy>
+  std::vector<Expected<ResultTy>> symbolizeBatch(ArrayRef<BatchRequest> Requests,
+                                                 unsigned ThreadCount,
+                                                 SymbolizeFnTy Symbolize);
+
   /// Returns a SymbolizableModule or an error if loading debug info failed.
   /// Only one attempt is made to load a module, and errors during loading are
   /// only reported once. Subsequent calls to get module info for a module that
@@ -71,6 +107,11 @@ private:
   Expected<SymbolizableModule *>
   getOrCreateModuleInfo(const std::string &ModuleName);
 
+  /// Returns the error that loading the debug info of \p Info failed with,
+  /// if \p Info is backed by a cache and the last query missed it. As with
+  /// getOrCreateModuleInfo(), the error is only reported once.
+  Error takeModuleError(SymbolizableModule &Info) const;
+
   ObjectFile *lookUpDsymFile(const std::string &Path,
                              const MachOObjectFile *ExeObj,
                              const std::string &ArchName);
@@ -78,6 +119,10 @@ private:
                                     const ObjectFile *Obj,
                                     const std::string &ArchName);
 
+  /// Creates a SymbolizableModule that reads debug info from \p Objects.
+  Expected<std::unique_ptr<SymbolizableModule>>
+  createModuleInfo(ObjectPair Objects);
+
   /// \brief Returns pair of pointers to object and debug object.
   Expected<ObjectPair> getOrCreateObjectPair(const std::string &Path,
                                             const std::string &ArchName);
@@ -90,6 +135,10 @@ private:
 
   std::map<std::string, std::unique_ptr<SymbolizableModule>> Modules;
 
+  /// The modules of Modules that are backed by a cache, which only load the
+  /// debug info on the first query that misses it.
+  std::map<SymbolizableModule *, CachedSymbolizableModule *> CachedModules;
+
   /// \brief Contains cached results of getOrCreateObjectPair().
   std::map<std::pair<std::string, std::string>, ObjectPair>
       ObjectPairForPathArch;
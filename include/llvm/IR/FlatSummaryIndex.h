@@ -0,0 +1,204 @@
+//===-- llvm/FlatSummaryIndex.h - Flat Module Summary Index -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+/// @file
+/// FlatSummaryIndex.h This file contains the declaration of a compact,
+///  read-only form of the combined module summary index, which the thin-link
+///  analyses run on.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_FLATSUMMARYINDEX_H
+#define LLVM_IR_FLATSUMMARYINDEX_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Sequence.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/ModuleSummaryIndex.h"
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+/// A read-only copy of a combined ModuleSummaryIndex, laid out in flat arrays.
+///
+/// The values are sorted by GUID, the summaries are grouped by value, and the
+/// call and reference edges of all summaries are stored in two arrays that
+/// each summary indexes into. Edges refer to values by their index, and values
+/// that are only referenced have an entry without summaries.
+class FlatSummaryIndex {
+public:
+  typedef uint32_t ModuleIndex;
+  typedef uint32_t ValueIndex;
+  typedef uint32_t SummaryIndex;
+
+  /// Returned by the lookups that don't find anything.
+  static const uint32_t NotFound = ~0u;
+
+  /// Flatten \p Index. Its ValueInfos can be GUIDs or GlobalValues. When
+  /// \p OnlyValues is given, only the summaries of these values are copied,
+  /// and the other values get an entry without summaries if they are
+  /// referenced.
+  explicit FlatSummaryIndex(
+      const ModuleSummaryIndex &Index,
+      const DenseSet<GlobalValue::GUID> *OnlyValues = nullptr);
+
+  /// \name Modules
+  /// @{
+  unsigned getNumModules() const { return Modules.size(); }
+  StringRef getModulePath(ModuleIndex M) const {
+    return getString(Modules[M].PathOffset, Modules[M].PathSize);
+  }
+  uint64_t getModuleId(ModuleIndex M) const { return Modules[M].ModuleId; }
+  const ModuleHash &getModuleHash(ModuleIndex M) const {
+    return Modules[M].Hash;
+  }
+
+  /// Return the summaries defined by module \p M, sorted by value and with a
+  /// single summary per value, like ModuleSummaryIndex::
+  /// collectDefinedGVSummariesPerModule.
+  ArrayRef<SummaryIndex> getDefinedSummaries(ModuleIndex M) const {
+    return range(ModuleDefs, Modules, M, &ModuleEntry::FirstDef);
+  }
+
+  /// Return the summary of value \p V that module \p M defines, or NotFound.
+  SummaryIndex findDefinedSummary(ModuleIndex M, ValueIndex V) const;
+  /// @}
+
+  /// \name Values
+  /// @{
+  unsigned getNumValues() const { return Values.size(); }
+  GlobalValue::GUID getGUID(ValueIndex V) const { return Values[V].GUID; }
+
+  /// Return true if the value has an entry in the original index, even if it
+  /// has no summary, rather than only being referenced.
+  bool isInIndex(ValueIndex V) const { return Values[V].Flags & VF_InIndex; }
+
+  /// Return the index of the value \p GUID, or NotFound.
+  ValueIndex findValue(GlobalValue::GUID GUID) const;
+
+  /// Return the GUID for \p OriginalID, as in the ModuleSummaryIndex.
+  GlobalValue::GUID getGUIDFromOriginalID(GlobalValue::GUID OriginalID) const;
+
+  iterator_range<detail::value_sequence_iterator<SummaryIndex>>
+  summaries(ValueIndex V) const {
+    return seq<SummaryIndex>(Values[V].FirstSummary,
+                             V + 1 == Values.size()
+                                 ? SummaryIndex(Summaries.size())
+                                 : SummaryIndex(Values[V + 1].FirstSummary));
+  }
+  /// @}
+
+  /// \name Summaries
+  /// @{
+  unsigned getNumSummaries() const { return Summaries.size(); }
+  ValueIndex getValue(SummaryIndex S) const { return Summaries[S].Value; }
+  ModuleIndex getModule(SummaryIndex S) const { return Summaries[S].Module; }
+  StringRef getModulePathOf(SummaryIndex S) const {
+    return getModulePath(getModule(S));
+  }
+  GlobalValueSummary::SummaryKind getKind(SummaryIndex S) const {
+    return GlobalValueSummary::SummaryKind(Summaries[S].Kind);
+  }
+  GlobalValue::LinkageTypes getLinkage(SummaryIndex S) const {
+    return GlobalValue::LinkageTypes(Summaries[S].Linkage);
+  }
+  bool notEligibleToImport(SummaryIndex S) const {
+    return Summaries[S].Flags & SF_NotEligibleToImport;
+  }
+  bool liveRoot(SummaryIndex S) const {
+    return Summaries[S].Flags & SF_LiveRoot;
+  }
+  GlobalValue::GUID getOriginalName(SummaryIndex S) const {
+    return Summaries[S].OriginalName;
+  }
+  /// Return the instruction count of a function summary.
+  unsigned instCount(SummaryIndex S) const { return Summaries[S].InstCount; }
+  /// Return the summary of the aliasee of an alias summary.
+  SummaryIndex getAliasee(SummaryIndex S) const {
+    return Summaries[S].Aliasee;
+  }
+
+  struct CallEdge {
+    ValueIndex Callee;
+    uint8_t Hotness;
+
+    ValueIndex callee() const { return Callee; }
+    CalleeInfo::HotnessType hotness() const {
+      return CalleeInfo::HotnessType(Hotness);
+    }
+  };
+
+  /// Return the call edges of a function summary.
+  ArrayRef<CallEdge> calls(SummaryIndex S) const {
+    return range(Calls, Summaries, S, &SummaryEntry::FirstCall);
+  }
+  /// Return the values referenced by a summary.
+  ArrayRef<ValueIndex> refs(SummaryIndex S) const {
+    return range(Refs, Summaries, S, &SummaryEntry::FirstRef);
+  }
+  /// @}
+
+private:
+  enum ValueFlags : uint8_t { VF_InIndex = 1 };
+  enum SummaryFlags : uint8_t { SF_NotEligibleToImport = 1, SF_LiveRoot = 2 };
+
+  struct ModuleEntry {
+    uint64_t ModuleId;
+    ModuleHash Hash;
+    uint32_t PathOffset, PathSize;
+    uint32_t FirstDef;
+  };
+  struct ValueEntry {
+    GlobalValue::GUID GUID;
+    SummaryIndex FirstSummary;
+    uint8_t Flags;
+  };
+  struct SummaryEntry {
+    GlobalValue::GUID OriginalName;
+    ValueIndex Value;
+    ModuleIndex Module;
+    uint8_t Kind, Linkage, Flags;
+    uint32_t InstCount;
+    SummaryIndex Aliasee;
+    uint32_t FirstCall, FirstRef;
+  };
+  struct OriginalNameEntry {
+    GlobalValue::GUID OriginalName, GUID;
+  };
+
+  StringRef getString(uint32_t Offset, uint32_t Size) const {
+    return StringRef(Strings.data() + Offset, Size);
+  }
+
+  /// Return the elements of \p Array that belong to \p Owners[I], given that
+  /// each owner stores the position of its first element in \p First.
+  template <typename T, typename OwnerT>
+  static ArrayRef<T> range(const std::vector<T> &Array,
+                           const std::vector<OwnerT> &Owners, uint32_t I,
+                           uint32_t OwnerT::*First) {
+    uint32_t Begin = Owners[I].*First;
+    uint32_t End = I + 1 == Owners.size() ? Array.size() : Owners[I + 1].*First;
+    return makeArrayRef(Array).slice(Begin, End - Begin);
+  }
+
+  std::vector<ModuleEntry> Modules;
+  std::vector<ValueEntry> Values;
+  std::vector<SummaryEntry> Summaries;
+  std::vector<CallEdge> Calls;
+  std::vector<ValueIndex> Refs;
+  std::vector<SummaryIndex> ModuleDefs;
+  std::vector<OriginalNameEntry> OriginalNames;
+  std::string Strings;
+};
+
+} // End llvm namespace
+
+#endif
@@ -41,6 +41,12 @@ public:
   ///
   virtual Error materializeModule() = 0;
 
+  /// Make sure the entire Module has been completely read, using up to
+  /// \p NumThreads threads for the parts of the work that can be done
+  /// concurrently.
+  ///
+  virtual Error materializeModuleParallel(unsigned NumThreads);
+
   virtual Error materializeMetadata() = 0;
   virtual void setStripDebugInfo() = 0;
 
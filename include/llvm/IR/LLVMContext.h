@@ -128,6 +128,22 @@ public:
   /// especially in release mode.
   void setDiscardValueNames(bool Discard);
 
+  /// Return true if the Context guards its uniquing tables with locks.
+  bool hasThreadSafeUniquing() const;
+
+  /// Set the Context runtime configuration to guard the uniquing tables of
+  /// constants, constant expressions, types and metadata nodes with locks, so
+  /// that several threads can create and look up these entities concurrently.
+  /// This must be set before the Context is shared between threads.
+  ///
+  /// All the constants that have operands share a single lock, which also
+  /// guards the use lists their creation and destruction update; the metadata
+  /// tables are locked separately. This does not make the IR itself thread
+  /// safe: instructions referring to shared constants and globals update their
+  /// use lists without synchronization, so this mode cannot be used to run
+  /// function passes concurrently.
+  void setThreadSafeUniquing(bool Enable);
+
   /// Whether there is a string map for uniquing debug info
   /// identifiers across the context.  Off by default.
   bool isODRUniquingDebugTypes() const;
@@ -473,6 +473,10 @@ public:
   /// Materializer.
   llvm::Error materializeAll();
 
+  /// Like materializeAll, but lets the Materializer use up to \p NumThreads
+  /// threads.
+  llvm::Error materializeAllParallel(unsigned NumThreads);
+
   llvm::Error materializeMetadata();
 
 /// @}
@@ -1135,6 +1135,11 @@ typedef OuterAnalysisManagerProxy<ModuleAnalysisManager, Function>
 /// Note that although function passes can access module analyses, module
 /// analyses are not invalidated while the function passes are running, so they
 /// may be stale.  Function analyses will not be stale.
+///
+/// FIXME: Functions are visited one at a time. Running them concurrently
+/// needs a FunctionAnalysisManager per thread and, more importantly, updates
+/// to the use lists of globals and constants that are safe across threads:
+/// LLVMContext::setThreadSafeUniquing only covers the uniquing tables.
 template <typename FunctionPassT>
 class ModuleToFunctionPassAdaptor
     : public PassInfoMixin<ModuleToFunctionPassAdaptor<FunctionPassT>> {
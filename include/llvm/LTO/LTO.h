@@ -91,7 +91,9 @@ private:
   InputFile() = default;
 
   std::vector<BitcodeModule> Mods;
-  SmallVector<char, 0> Strtab;
+  // The symbol and string tables, if they had to be rebuilt rather than read
+  // in place from the input file.
+  SmallVector<char, 0> OwnedSymtab, OwnedStrtab;
   std::vector<Symbol> Symbols;
 
   // [begin, end) for each module
@@ -19,6 +19,7 @@
 #include "llvm-c/lto.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/Triple.h"
+#include "llvm/IR/FlatSummaryIndex.h"
 #include "llvm/IR/ModuleSummaryIndex.h"
 #include "llvm/Support/CachePruning.h"
 #include "llvm/Support/CodeGen.h"
@@ -180,6 +181,14 @@ public:
       CacheOptions.Policy.PercentageOfAvailableSpace = Percentage;
   }
 
+  /// Cache policy: the maximum size of the cache in bytes. The least recently
+  /// used entries are removed until the cache fits. A value of 0 will be
+  /// ignored.
+  void setCacheMaxSizeBytes(uint64_t MaxSizeBytes) {
+    if (MaxSizeBytes)
+      CacheOptions.Policy.MaxSizeBytes = MaxSizeBytes;
+  }
+
   /**@}*/
 
   /// Set the path to a directory where to save temporaries at various stages of
@@ -288,6 +297,13 @@ public:
   /**@}*/
 
 private:
+  /// Return the flat form of \p Index that the analyses of promote(),
+  /// crossModuleImport() and internalize() run on. It is built by the first
+  /// call for this index and reused by the next ones, which are expected to
+  /// pass the same combined index; the linkage changes these methods make to
+  /// the index don't affect the import and export lists.
+  const FlatSummaryIndex &getFlatIndex(const ModuleSummaryIndex &Index);
+
   /// Helper factory to build a TargetMachine
   TargetMachineBuilder TMBuilder;
 
@@ -332,6 +348,10 @@ private:
 
   /// IR Optimization Level [0-3].
   unsigned OptLevel = 3;
+
+  /// The index last flattened by getFlatIndex(), and its flat form.
+  const ModuleSummaryIndex *FlatIndexSource = nullptr;
+  std::unique_ptr<FlatSummaryIndex> CachedFlatIndex;
 };
 }
 #endif
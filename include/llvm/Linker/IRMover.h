@@ -11,7 +11,9 @@
 #define LLVM_LINKER_IRMOVER_H
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/TinyPtrVector.h"
 #include <functional>
 
 namespace llvm {
@@ -24,23 +26,6 @@ class TrackingMDRef;
 class Type;
 
 class IRMover {
-  struct StructTypeKeyInfo {
-    struct KeyTy {
-      ArrayRef<Type *> ETypes;
-      bool IsPacked;
-      KeyTy(ArrayRef<Type *> E, bool P);
-      KeyTy(const StructType *ST);
-      bool operator==(const KeyTy &that) const;
-      bool operator!=(const KeyTy &that) const;
-    };
-    static StructType *getEmptyKey();
-    static StructType *getTombstoneKey();
-    static unsigned getHashValue(const KeyTy &Key);
-    static unsigned getHashValue(const StructType *ST);
-    static bool isEqual(const KeyTy &LHS, const StructType *RHS);
-    static bool isEqual(const StructType *LHS, const StructType *RHS);
-  };
-
   /// Type of the Metadata map in \a ValueToValueMapTy.
   typedef DenseMap<const Metadata *, TrackingMDRef> MDMapT;
 
@@ -49,8 +34,14 @@ public:
     // The set of opaque types is the composite module.
     DenseSet<StructType *> OpaqueStructTypes;
 
-    // The set of identified but non opaque structures in the composite module.
-    DenseSet<StructType *, StructTypeKeyInfo> NonOpaqueStructTypes;
+    // The set of identified but non opaque structures in the composite module,
+    // with a single structure for each body.
+    DenseSet<StructType *> NonOpaqueStructTypes;
+
+    // The structures of NonOpaqueStructTypes by the hash of their body. The
+    // body of a structure is hashed once when it is added, rather than on
+    // every lookup of the structure and every rehash of the set.
+    DenseMap<unsigned, TinyPtrVector<StructType *>> NonOpaqueStructTypesByHash;
 
   public:
     void addNonOpaque(StructType *Ty);
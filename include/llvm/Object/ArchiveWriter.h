@@ -36,10 +36,16 @@ struct NewArchiveMember {
                                             bool Deterministic);
 };
 
+/// Writes an archive of \p NewMembers to \p ArcName. \p OldArchiveBuf is kept
+/// alive until the archive is written, for the members that point into it. If
+/// \p ReuseOldSymtab is set, the members kept from that old archive take their
+/// symbols from its symbol table instead of being read again, so the caller
+/// must trust that table to be up to date.
 std::pair<StringRef, std::error_code>
 writeArchive(StringRef ArcName, std::vector<NewArchiveMember> &NewMembers,
              bool WriteSymtab, object::Archive::Kind Kind, bool Deterministic,
-             bool Thin, std::unique_ptr<MemoryBuffer> OldArchiveBuf = nullptr);
+             bool Thin, std::unique_ptr<MemoryBuffer> OldArchiveBuf = nullptr,
+             bool ReuseOldSymtab = false);
 }
 
 #endif
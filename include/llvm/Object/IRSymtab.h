@@ -25,6 +25,7 @@
 #define LLVM_OBJECT_IRSYMTAB_H
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/IR/GlobalValue.h"
 #include "llvm/Object/SymbolicFile.h"
 #include "llvm/Support/Endian.h"
@@ -111,6 +112,14 @@ struct Uncommon {
 };
 
 struct Header {
+  /// The version of the format, which is incremented when the format changes.
+  Word Version;
+  enum { kCurrentVersion = 0 };
+
+  /// The version of LLVM that built the table. Readers rebuild tables built by
+  /// other versions, which may enumerate or flag symbols differently.
+  Str Producer;
+
   Range<Module> Modules;
   Range<Comdat> Comdats;
   Range<Symbol> Symbols;
@@ -295,6 +304,23 @@ inline Reader::symbol_range Reader::module_symbols(unsigned I) const {
   return {SymbolRef(MBegin, MEnd, this), SymbolRef(MEnd, MEnd, this)};
 }
 
+/// The contents of the irsymtab in a bitcode file.
+struct FileContents {
+  /// The symbol and string tables, which point into the bitcode buffer if the
+  /// file has a usable symbol table, and into OwnedSymtab and OwnedStrtab if
+  /// it had to be rebuilt. Moving a FileContents keeps them valid.
+  StringRef Symtab, Strtab;
+  SmallVector<char, 0> OwnedSymtab, OwnedStrtab;
+
+  std::vector<BitcodeModule> Mods;
+
+  Reader getReader() const { return Reader(Symtab, Strtab); }
+};
+
+/// Return the irsymtab of the bitcode file \p BFC. The symbol table stored in
+/// the file is used in place if it was built for all of the file's modules by
+/// this version of LLVM; otherwise the modules are loaded to rebuild it.
+Expected<FileContents> readBitcode(const BitcodeFileContents &BFC);
 }
 
 }
@@ -16,6 +16,7 @@
 #define LLVM_SUPPORT_CACHE_PRUNING_H
 
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Chrono.h"
 #include <chrono>
 
 namespace llvm {
@@ -41,23 +42,46 @@ struct CachePruningPolicy {
   /// space. A value over 100 will be reduced to 100. A value of 0 disables the
   /// size-based pruning.
   unsigned PercentageOfAvailableSpace = 75;
+
+  /// The maximum size for the cache directory in bytes. A value of 0 disables
+  /// this limit. When both this and PercentageOfAvailableSpace are set, the
+  /// smaller of the two limits applies.
+  uint64_t MaxSizeBytes = 0;
 };
 
 /// Parse the given string as a cache pruning policy. Defaults are taken from a
 /// default constructed CachePruningPolicy object.
 /// For example: "prune_interval=30s:prune_after=24h:cache_size=50%"
 /// which means a pruning interval of 30 seconds, expiration time of 24 hours
-/// and maximum cache size of 50% of available disk space.
+/// and maximum cache size of 50% of available disk space. An absolute size
+/// is given as "cache_size_bytes=<n>", where <n> may end with 'k', 'm' or 'g'.
 Expected<CachePruningPolicy> parseCachePruningPolicy(StringRef PolicyStr);
 
 /// Peform pruning using the supplied policy, returns true if pruning
 /// occured, i.e. if Policy.Interval was expired.
 ///
+/// Files are removed when they expire, and then in least recently used order
+/// until the cache fits in the size limits. The size and last access time of a
+/// file are taken from the cache index (see recordCacheAccess()), so that only
+/// the files missing from the index need to be stat()ed. The index is then
+/// rewritten with the remaining files and the accesses recorded meanwhile.
+///
 /// As a safeguard against data loss if the user specifies the wrong directory
 /// as their cache directory, this function will ignore files not matching the
 /// pattern "llvmcache-*".
 bool pruneCache(StringRef Path, CachePruningPolicy Policy);
 
+/// Record in the index of its cache directory that the cache file at
+/// \p EntryPath, of \p Size bytes, was created or used at \p Time.
+///
+/// The record is appended to the index with a single write, so that any
+/// number of processes can share the cache without locking. Failures are
+/// ignored: a file missing from the index is stat()ed by pruneCache(). The
+/// index is rewritten with one line per file once in a while if it has grown
+/// to several lines per file, even if the cache is never pruned.
+void recordCacheAccess(StringRef EntryPath, uint64_t Size,
+                       sys::TimePoint<> Time = std::chrono::system_clock::now());
+
 } // namespace llvm
 
 #endif
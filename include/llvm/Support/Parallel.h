@@ -0,0 +1,228 @@
+//===- llvm/Support/Parallel.h - Parallel algorithms ------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines parallel versions of a few common algorithms. They all run
+// on a process-wide ThreadPool, split their input in tasks of a given grain
+// size, and degrade to the plain serial algorithm when only one thread is
+// available.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_PARALLEL_H
+#define LLVM_SUPPORT_PARALLEL_H
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/ThreadPool.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+namespace llvm {
+
+namespace parallel {
+
+/// Return the number of threads used by the parallel algorithms. This is 1
+/// when LLVM is built without thread support.
+unsigned getThreadCount();
+
+/// Set the number of threads used by the parallel algorithms. This has no
+/// effect once the first parallel algorithm has started; tools are expected
+/// to call it while processing their command line. A value of 0 selects the
+/// hardware concurrency.
+void setThreadCount(unsigned ThreadCount);
+
+/// A set of tasks running on the global executor. Tasks can be spawned from
+/// any thread, including from tasks of the group itself. The destructor waits
+/// for all the tasks of the group to complete.
+class TaskGroup {
+  std::mutex Lock;
+  std::vector<std::shared_future<ThreadPool::VoidTy>> Futures;
+
+public:
+  ~TaskGroup() { sync(); }
+
+  /// Run \p F asynchronously, or right away if there is a single thread.
+  void spawn(std::function<void()> F);
+
+  /// Wait for all the tasks spawned so far, as well as the ones they spawn.
+  void sync();
+};
+
+namespace detail {
+
+/// Inputs smaller than this are sorted serially.
+const ptrdiff_t MinParallelSortSize = 1024;
+
+/// Number of items handled by a single task when the caller did not provide
+/// a grain size: aim for a few tasks per thread to balance the load.
+inline size_t getDefaultGrainSize(size_t NumItems) {
+  return std::max<size_t>(1, NumItems / (getThreadCount() * 16));
+}
+
+template <class RandomAccessIterator, class Comparator>
+RandomAccessIterator medianOf3(RandomAccessIterator Start,
+                               RandomAccessIterator End,
+                               const Comparator &Comp) {
+  // Jump to the end by -1 to avoid dereferencing past end.
+  auto Mid = Start + (std::distance(Start, End) / 2);
+  return Comp(*Start, *(End - 1))
+             ? (Comp(*Mid, *(End - 1)) ? (Comp(*Start, *Mid) ? Mid : Start)
+                                       : End - 1)
+             : (Comp(*Mid, *Start) ? (Comp(*(End - 1), *Mid) ? Mid : End - 1)
+                                   : Start);
+}
+
+template <class RandomAccessIterator, class Comparator>
+void parallelQuickSort(RandomAccessIterator Start, RandomAccessIterator End,
+                       const Comparator &Comp, TaskGroup &TG, size_t Depth) {
+  // Do a sequential sort for small inputs, or when the partitioning went bad
+  // enough that we risk recursing too deep.
+  if (std::distance(Start, End) < MinParallelSortSize || Depth == 0) {
+    std::sort(Start, End, Comp);
+    return;
+  }
+
+  // Partition around the median of three, parked at the end meanwhile.
+  auto Pivot = medianOf3(Start, End, Comp);
+  std::swap(*(End - 1), *Pivot);
+  Pivot = std::partition(Start, End - 1, [&Comp, End](decltype(*Start) V) {
+    return Comp(V, *(End - 1));
+  });
+  std::swap(*Pivot, *(End - 1));
+
+  // Sort the lower half asynchronously and the upper half in this thread.
+  TG.spawn([=, &Comp, &TG] {
+    parallelQuickSort(Start, Pivot, Comp, TG, Depth - 1);
+  });
+  parallelQuickSort(Pivot + 1, End, Comp, TG, Depth - 1);
+}
+
+} // end namespace detail
+
+} // end namespace parallel
+
+/// Call \p Fn on every index in [\p Begin, \p End). Each task processes
+/// \p GrainSize consecutive indices; a grain size of 0 picks a default based
+/// on the number of threads.
+template <class IndexTy, class FuncTy>
+void parallel_for(IndexTy Begin, IndexTy End, FuncTy Fn,
+                  size_t GrainSize = 0) {
+  if (Begin >= End)
+    return;
+  size_t NumItems = End - Begin;
+  if (!GrainSize)
+    GrainSize = parallel::detail::getDefaultGrainSize(NumItems);
+  if (parallel::getThreadCount() == 1 || NumItems <= GrainSize) {
+    for (IndexTy I = Begin; I != End; ++I)
+      Fn(I);
+    return;
+  }
+
+  parallel::TaskGroup TG;
+  for (; NumItems > GrainSize; NumItems -= GrainSize) {
+    IndexTy ChunkEnd = Begin + GrainSize;
+    TG.spawn([=, &Fn] {
+      for (IndexTy I = Begin; I != ChunkEnd; ++I)
+        Fn(I);
+    });
+    Begin = ChunkEnd;
+  }
+  // The calling thread takes care of the last chunk.
+  for (IndexTy I = Begin; I != End; ++I)
+    Fn(I);
+}
+
+/// Call \p Fn on every element of [\p Begin, \p End), in no particular order.
+template <class IterTy, class FuncTy>
+void parallel_for_each(IterTy Begin, IterTy End, FuncTy Fn,
+                       size_t GrainSize = 0) {
+  size_t NumItems = std::distance(Begin, End);
+  if (!GrainSize)
+    GrainSize = parallel::detail::getDefaultGrainSize(NumItems);
+  if (parallel::getThreadCount() == 1 || NumItems <= GrainSize) {
+    std::for_each(Begin, End, Fn);
+    return;
+  }
+
+  parallel::TaskGroup TG;
+  for (; NumItems > GrainSize; NumItems -= GrainSize) {
+    IterTy ChunkEnd = std::next(Begin, GrainSize);
+    TG.spawn([=, &Fn] { std::for_each(Begin, ChunkEnd, Fn); });
+    Begin = ChunkEnd;
+  }
+  std::for_each(Begin, End, Fn);
+}
+
+/// Sort [\p Start, \p End) according to \p Comp. Like std::sort, the order of
+/// equivalent elements is not preserved.
+template <class RandomAccessIterator,
+          class Comparator = std::less<
+              typename std::iterator_traits<RandomAccessIterator>::value_type>>
+void parallel_sort(RandomAccessIterator Start, RandomAccessIterator End,
+                   const Comparator &Comp = Comparator()) {
+  if (parallel::getThreadCount() == 1) {
+    std::sort(Start, End, Comp);
+    return;
+  }
+  parallel::TaskGroup TG;
+  parallel::detail::parallelQuickSort(
+      Start, End, Comp, TG, llvm::Log2_64(std::distance(Start, End)) + 1);
+}
+
+/// Apply \p Transform to every element of [\p Begin, \p End) and combine the
+/// results with \p Reduce, starting from \p Init. Each task starts its partial
+/// result from \p Init, which therefore has to be an identity of \p Reduce.
+/// The partial results are combined in the order of the input, so that the
+/// result is deterministic even if \p Reduce is not commutative.
+template <class IterTy, class ResultTy, class ReduceFuncTy,
+          class TransformFuncTy>
+ResultTy parallel_transform_reduce(IterTy Begin, IterTy End, ResultTy Init,
+                                   ReduceFuncTy Reduce,
+                                   TransformFuncTy Transform,
+                                   size_t GrainSize = 0) {
+  size_t NumItems = std::distance(Begin, End);
+  if (!GrainSize)
+    GrainSize = parallel::detail::getDefaultGrainSize(NumItems);
+  if (parallel::getThreadCount() == 1 || NumItems <= GrainSize) {
+    for (; Begin != End; ++Begin)
+      Init = Reduce(std::move(Init), Transform(*Begin));
+    return Init;
+  }
+
+  size_t NumTasks = (NumItems + GrainSize - 1) / GrainSize;
+  std::vector<ResultTy> Results(NumTasks, Init);
+  {
+    parallel::TaskGroup TG;
+    for (size_t TaskIndex = 0; TaskIndex < NumTasks; ++TaskIndex) {
+      size_t ChunkSize = std::min(GrainSize, NumItems);
+      IterTy ChunkEnd = std::next(Begin, ChunkSize);
+      TG.spawn([=, &Results, &Reduce, &Transform] {
+        ResultTy R = Results[TaskIndex];
+        for (IterTy I = Begin; I != ChunkEnd; ++I)
+          R = Reduce(std::move(R), Transform(*I));
+        Results[TaskIndex] = std::move(R);
+      });
+      Begin = ChunkEnd;
+      NumItems -= ChunkSize;
+    }
+  }
+
+  ResultTy FinalResult = std::move(Results.front());
+  for (size_t I = 1; I < NumTasks; ++I)
+    FinalResult = Reduce(std::move(FinalResult), std::move(Results[I]));
+  return FinalResult;
+}
+
+} // end namespace llvm
+
+#endif // LLVM_SUPPORT_PARALLEL_H
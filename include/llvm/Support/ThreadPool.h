@@ -20,11 +20,12 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <utility>
+#include <vector>
 
 namespace llvm {
 
@@ -33,6 +34,13 @@ namespace llvm {
 ///
 /// The pool keeps a vector of threads alive, waiting on a condition variable
 /// for some work to become available.
+///
+/// Work is distributed with a work-stealing scheme: every worker owns a deque
+/// of tasks. Tasks submitted from inside a task of this pool are pushed on the
+/// submitting worker's deque, which the owner pops in LIFO order; idle workers
+/// steal from the other end of their siblings' deques. Tasks submitted from
+/// outside the pool go through a shared FIFO injection queue, so that the
+/// submission order is preserved for independent top-level tasks.
 class ThreadPool {
 public:
 #ifndef _MSC_VER
@@ -87,21 +95,50 @@ public:
   }
 
   /// Blocking wait for all the threads to complete and the queue to be empty.
-  /// It is an error to try to add new tasks while blocking on this call.
+  /// It is an error to try to add new tasks while blocking on this call, and
+  /// to call it from a task running on this pool.
   void wait();
 
+  /// Blocking wait for the task associated with \p Future to complete. When
+  /// called from a task running on this pool, the calling worker keeps
+  /// executing pending tasks while waiting, so that a task can spawn subtasks
+  /// and wait on them without deadlocking the pool.
+  void wait(const std::shared_future<VoidTy> &Future);
+
 private:
+  /// Tasks owned by a single worker thread.
+  struct WorkerQueue {
+    std::mutex Lock;
+    std::deque<PackagedTaskTy> Tasks;
+  };
+
   /// Asynchronous submission of a task to the pool. The returned future can be
   /// used to wait for the task to finish and is *non-blocking* on destruction.
   std::shared_future<VoidTy> asyncImpl(TaskTy F);
 
+  /// Main loop of the worker thread \p Index.
+  void workerLoop(unsigned Index);
+
+  /// Try to grab a task for worker \p Index: first from its own deque, then
+  /// from the injection queue, then by stealing from the other workers.
+  bool popTask(unsigned Index, PackagedTaskTy &Task);
+
+  /// Run \p Task and signal its completion to wait().
+  void runTask(PackagedTaskTy &Task);
+
   /// Threads in flight
   std::vector<llvm::thread> Threads;
 
-  /// Tasks waiting for execution in the pool.
-  std::queue<PackagedTaskTy> Tasks;
+  /// Per-worker task deques, indexed like Threads.
+  std::vector<std::unique_ptr<WorkerQueue>> WorkerQueues;
+
+  /// Tasks submitted from outside the pool, waiting for execution.
+  std::deque<PackagedTaskTy> Tasks;
+
+  /// Locking for accessing the Tasks injection queue.
+  std::mutex InjectionLock;
 
-  /// Locking and signaling for accessing the Tasks queue.
+  /// Locking and signaling for idle workers waiting for new tasks.
   std::mutex QueueLock;
   std::condition_variable QueueCondition;
 
@@ -109,8 +146,14 @@ private:
   std::mutex CompletionLock;
   std::condition_variable CompletionCondition;
 
-  /// Keep track of the number of thread actually busy
-  std::atomic<unsigned> ActiveThreads;
+  /// Number of tasks queued in any of the deques and not yet picked up.
+  std::atomic<unsigned> PendingTasks;
+
+  /// Number of tasks submitted and not yet completed, running ones included.
+  std::atomic<unsigned> OutstandingTasks;
+
+  /// Number of workers sleeping on QueueCondition.
+  std::atomic<unsigned> IdleThreads;
 
 #if LLVM_ENABLE_THREADS // avoids warning for unused variable
   /// Signal for the destruction of the pool, asking thread to exit.
@@ -18,10 +18,14 @@
 
 #include <functional>
 #include <map>
+#include <string>
+#include <system_error>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 namespace llvm {
+class FlatSummaryIndex;
 class LLVMContext;
 class GlobalValueSummary;
 class Module;
@@ -70,10 +74,49 @@ public:
   PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
 };
 
-/// Compute all the imports and exports for every module in the Index.
+/// The import lists computed by a previous link, kept in a file so that the
+/// next link can reuse them.
 ///
-/// \p ModuleToDefinedGVSummaries contains for each Module a map
-/// (GUID -> Summary) for every global defined in the module.
+/// An entry records, for one importing module, the import list and the
+/// exports it caused, together with the GUIDs whose summaries the computation
+/// looked at. The entry is reused as long as the module, the summaries of
+/// these GUIDs (identified by the hash and path of the modules that define
+/// them) and the dead symbols among the module's definitions did not change,
+/// so a link in which a few modules changed only recomputes the imports of
+/// these modules and of the modules that import from them.
+class ImportListCache {
+public:
+  struct Entry {
+    /// SHA1 of everything the import computation depends on.
+    std::string InputHash;
+    /// The GUIDs whose summaries were looked at, sorted.
+    std::vector<GlobalValue::GUID> Consulted;
+    FunctionImporter::ImportMapTy ImportList;
+    /// The exports this module caused in each module it imports from.
+    StringMap<FunctionImporter::ExportSetTy> Exports;
+  };
+
+  /// Load the entries of the previous link from the file at \p Path. A
+  /// missing or malformed file, or one written with different import
+  /// options, is treated as empty.
+  explicit ImportListCache(std::string Path);
+
+  /// Return the entry of the previous link for \p ModulePath, or null.
+  const Entry *lookup(StringRef ModulePath) const;
+
+  /// Record the entry for \p ModulePath in this link.
+  void insert(StringRef ModulePath, Entry E);
+
+  /// Replace the file with the entries recorded in this link.
+  std::error_code save() const;
+
+private:
+  std::string Path;
+  StringMap<Entry> Previous;
+  StringMap<Entry> Current;
+};
+
+/// Compute all the imports and exports for every module in the Index.
 ///
 /// \p ImportLists will be populated with an entry for every Module we are
 /// importing into. This entry is itself a map that can be passed to
@@ -85,17 +128,24 @@ public:
 ///
 /// \p DeadSymbols (optional) contains a list of GUID that are deemed "dead" and
 /// will be ignored for the purpose of importing.
+///
+/// \p Cache (optional) provides the import lists of a previous link, and
+/// records the import lists of this one.
 void ComputeCrossModuleImport(
-    const ModuleSummaryIndex &Index,
-    const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
+    const FlatSummaryIndex &Index,
     StringMap<FunctionImporter::ImportMapTy> &ImportLists,
     StringMap<FunctionImporter::ExportSetTy> &ExportLists,
-    const DenseSet<GlobalValue::GUID> *DeadSymbols = nullptr);
+    const DenseSet<GlobalValue::GUID> *DeadSymbols = nullptr,
+    ImportListCache *Cache = nullptr);
 
 /// Compute all the imports for the given module using the Index.
 ///
 /// \p ImportList will be populated with a map that can be passed to
-/// FunctionImporter::importFunctions() above (see description there).
+/// FunctionImporter::importFunctions() above (see description there). Given a
+/// ModuleSummaryIndex, only the summaries the import can reach are flattened.
+void ComputeCrossModuleImportForModule(
+    StringRef ModulePath, const FlatSummaryIndex &Index,
+    FunctionImporter::ImportMapTy &ImportList);
 void ComputeCrossModuleImportForModule(
     StringRef ModulePath, const ModuleSummaryIndex &Index,
     FunctionImporter::ImportMapTy &ImportList);
@@ -104,6 +154,9 @@ void ComputeCrossModuleImportForModule(
 /// in the graph from any of the given symbols listed in
 /// \p GUIDPreservedSymbols.
 DenseSet<GlobalValue::GUID>
+computeDeadSymbols(const FlatSummaryIndex &Index,
+                   const DenseSet<GlobalValue::GUID> &GUIDPreservedSymbols);
+DenseSet<GlobalValue::GUID>
 computeDeadSymbols(const ModuleSummaryIndex &Index,
                    const DenseSet<GlobalValue::GUID> &GUIDPreservedSymbols);
 
@@ -75,6 +75,11 @@ protected:
   AssumptionCacheTracker *ACT;
   ProfileSummaryInfo *PSI;
   ImportedFunctionsInliningStatistics ImportedFunctionsStats;
+
+  /// Inline cost analyses of the calls in the SCC being processed, which
+  /// subclasses may pass to \c llvm::getInlineCost. \c inlineCalls keeps it
+  /// up to date as it changes functions, and clears it when it is done.
+  InlineCostCache CostCache;
 };
 
 /// The inliner pass for the new pass manager.
@@ -14,9 +14,12 @@
 #define LLVM_XRAY_TRACE_H
 
 #include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/iterator_range.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/XRay/XRayRecord.h"
@@ -24,6 +27,8 @@
 namespace llvm {
 namespace xray {
 
+struct FDRState;
+
 /// A Trace object represents the records that have been loaded from XRay
 /// log files generated by instrumented binaries. We encapsulate the logic of
 /// reading the traces in factory functions that populate the Trace object
@@ -65,6 +70,114 @@ public:
 /// |Filename|.
 Expected<Trace> loadTraceFile(StringRef Filename, bool Sort = false);
 
+/// A TraceStream reads the records of an XRay log file incrementally, in the
+/// order in which they appear in the file. Binary logs are mapped a fixed-size
+/// window at a time and decoded in fixed-size batches, so the memory used does
+/// not depend on the size of the trace. YAML logs can't be decoded that way
+/// and are loaded at once when the stream is opened.
+///
+/// Usage:
+///
+///   if (auto StreamOrErr = openTraceFile("xray-log.something.xray")) {
+///     auto &S = **StreamOrErr;
+///     Error Err = Error::success();
+///     for (const XRayRecord &R : S.records(Err)) {
+///       // ... do something with R here.
+///     }
+///     if (Err)
+///       // Handle the decoding error here.
+///   } else {
+///     // Handle the error here.
+///   }
+///
+class TraceStream {
+public:
+  /// Iterates over the records of a TraceStream. Incrementing the iterator
+  /// may have to decode the next batch of records; if that fails, the error
+  /// is stored in the Error passed to records() and the iterator becomes the
+  /// end iterator.
+  class record_iterator {
+    TraceStream *Stream;
+    Error *E;
+
+  public:
+    record_iterator() : Stream(nullptr), E(nullptr) {}
+    record_iterator(TraceStream *Stream, Error *E) : Stream(Stream), E(E) {}
+
+    const XRayRecord &operator*() const {
+      return Stream->Batch[Stream->BatchIndex];
+    }
+    const XRayRecord *operator->() const { return &**this; }
+
+    bool operator==(const record_iterator &Other) const {
+      return Stream == Other.Stream;
+    }
+    bool operator!=(const record_iterator &Other) const {
+      return !(*this == Other);
+    }
+
+    record_iterator &operator++();
+  };
+
+  /// The default size of the file window kept mapped while decoding a binary
+  /// log.
+  static constexpr uint64_t DefaultWindowSize = 16 * 1024 * 1024;
+  /// The number of records decoded at a time.
+  static constexpr size_t BatchSize = 4096;
+
+  ~TraceStream();
+
+  /// Provides access to the XRay trace file header.
+  const XRayFileHeader &getFileHeader() const { return FileHeader; }
+
+  /// Returns the records of the trace, decoding them as the iteration goes.
+  /// A stream can only be iterated over once. Errors are reported through
+  /// \p Err, which has to be checked once the iteration is over.
+  iterator_range<record_iterator> records(Error &Err);
+
+private:
+  friend Expected<std::unique_ptr<TraceStream>> openTraceFile(StringRef,
+                                                              uint64_t);
+
+  enum class Format { NAIVE, FDR, YAML };
+
+  TraceStream(StringRef Filename, int FD, uint64_t WindowSize);
+
+  /// Maps the part of the file that holds the next \p Size bytes to decode,
+  /// or what remains of the file if it is shorter.
+  Error mapWindow(uint64_t Size);
+  /// Returns the mapped bytes from the current offset on.
+  StringRef getMappedData() const;
+  /// Replaces the current batch with the next records of the file. The batch
+  /// is left empty at the end of the trace.
+  Error readBatch();
+
+  std::string Filename;
+  int FD;
+  uint64_t WindowSize;
+  uint64_t FileSize = 0;
+  Format Kind = Format::NAIVE;
+  XRayFileHeader FileHeader;
+
+  /// The mapped part of the file, which starts at WindowOffset.
+  std::unique_ptr<sys::fs::mapped_file_region> Window;
+  uint64_t WindowOffset = 0;
+  /// The offset of the first byte that hasn't been decoded yet.
+  uint64_t Offset = 0;
+  std::unique_ptr<FDRState> State;
+
+  std::vector<XRayRecord> Batch;
+  size_t BatchIndex = 0;
+  bool Started = false;
+};
+
+/// Opens the XRay log file \p Filename for reading its records through a
+/// TraceStream. Only the file header is read at this point. At least
+/// \p WindowSize bytes of the file are mapped at a time.
+Expected<std::unique_ptr<TraceStream>>
+openTraceFile(StringRef Filename,
+              uint64_t WindowSize = TraceStream::DefaultWindowSize);
+
 } // namespace xray
 } // namespace llvm
 
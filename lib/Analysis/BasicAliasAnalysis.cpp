@@ -45,12 +45,21 @@ using namespace llvm;
 /// Enable analysis of recursive PHI nodes.
 static cl::opt<bool> EnableRecPhiAnalysis("basicaa-recphi", cl::Hidden,
                                           cl::init(false));
+
+/// Keep GEP decompositions from one query to the next.
+static cl::opt<bool> CacheDecomposedGEPs("basicaa-cache-decomposed-geps",
+                                         cl::Hidden, cl::init(true));
 /// SearchLimitReached / SearchTimes shows how often the limit of
 /// to decompose GEPs is reached. It will affect the precision
 /// of basic alias analysis.
 STATISTIC(SearchLimitReached, "Number of times the limit to "
                               "decompose GEPs is reached");
 STATISTIC(SearchTimes, "Number of times a GEP is decomposed");
+STATISTIC(DecomposedGEPQueries, "Number of GEP decompositions requested");
+STATISTIC(DecomposedGEPCacheHits,
+          "Number of GEP decompositions found in the cache");
+STATISTIC(AliasCacheQueries, "Number of alias queries checked in the cache");
+STATISTIC(AliasCacheHits, "Number of alias queries found in the cache");
 
 /// Cutoff after which to stop analysing a set of phi nodes potentially involved
 /// in a cycle. Because we are analysing 'through' phi nodes, we need to be
@@ -65,19 +74,77 @@ static const unsigned MaxLookupSearchDepth = 6;
 
 bool BasicAAResult::invalidate(Function &F, const PreservedAnalyses &PA,
                                FunctionAnalysisManager::Invalidator &Inv) {
-  // We don't care if this analysis itself is preserved, it has no state. But
-  // we need to check that the analyses it depends on have been. Note that we
-  // may be created without handles to some analyses and in that case don't
-  // depend on them.
+  // We need to check that the analyses we depend on have been preserved. Note
+  // that we may be created without handles to some analyses and in that case
+  // don't depend on them.
   if (Inv.invalidate<AssumptionAnalysis>(F, PA) ||
       (DT && Inv.invalidate<DominatorTreeAnalysis>(F, PA)) ||
       (LI && Inv.invalidate<LoopAnalysis>(F, PA)))
     return true;
 
-  // Otherwise this analysis result remains valid.
+  // Otherwise this analysis result remains valid. The decomposition cache is
+  // only kept if this analysis itself was preserved, so that it does not
+  // outlive passes that rewrite the IR in place.
+  auto PAC = PA.getChecker<BasicAA>();
+  if (!PAC.preserved() && !PAC.preservedSet<AllAnalysesOn<Function>>()) {
+    DecomposedGEPs.clear();
+    DecomposedGEPUsers.clear();
+  }
   return false;
 }
 
+void BasicAAResult::DecomposedGEPCallbackVH::deleted() {
+  assert(AAR && "DecomposedGEPCallbackVH called with a null result!");
+  AAR->forgetDecomposedGEPs(getValPtr());
+  // this now dangles!
+}
+
+void BasicAAResult::DecomposedGEPCallbackVH::allUsesReplacedWith(Value *) {
+  assert(AAR && "DecomposedGEPCallbackVH called with a null result!");
+  AAR->forgetDecomposedGEPs(getValPtr());
+  // this now dangles!
+}
+
+void BasicAAResult::forgetDecomposedGEPs(Value *V) {
+  auto It = DecomposedGEPUsers.find_as(V);
+  if (It == DecomposedGEPUsers.end())
+    return;
+  for (const Value *Ptr : It->second)
+    DecomposedGEPs.erase(Ptr);
+  DecomposedGEPUsers.erase(It);
+}
+
+bool BasicAAResult::decomposeGEP(const Value *V, DecomposedGEP &Decomposed) {
+  ++DecomposedGEPQueries;
+  if (!CacheDecomposedGEPs)
+    return DecomposeGEPExpression(V, Decomposed, DL, &AC, DT);
+
+  auto It = DecomposedGEPs.find(V);
+  if (It != DecomposedGEPs.end()) {
+    ++DecomposedGEPCacheHits;
+    Decomposed = It->second.Decomposed;
+    return It->second.MaxLookupReached;
+  }
+
+  SmallVector<const Value *, 8> Walked;
+  bool MaxLookupReached =
+      DecomposeGEPExpression(V, Decomposed, DL, &AC, DT, &Walked);
+  Walked.push_back(Decomposed.Base);
+  for (const VariableGEPIndex &Index : Decomposed.VarIndices)
+    Walked.push_back(Index.V);
+
+  for (const Value *W : Walked) {
+    auto Pair = DecomposedGEPUsers.insert(std::make_pair(
+        DecomposedGEPCallbackVH(const_cast<Value *>(W), this),
+        SmallVector<const Value *, 2>()));
+    SmallVectorImpl<const Value *> &Ptrs = Pair.first->second;
+    if (Ptrs.empty() || Ptrs.back() != V)
+      Ptrs.push_back(V);
+  }
+  DecomposedGEPs[V] = {Decomposed, MaxLookupReached};
+  return MaxLookupReached;
+}
+
 //===----------------------------------------------------------------------===//
 // Useful predicates
 //===----------------------------------------------------------------------===//
@@ -360,9 +427,12 @@ static int64_t adjustToPointerSize(int64_t Offset, unsigned PointerSize) {
 /// GetUnderlyingObject and DecomposeGEPExpression must use the same search
 /// depth (MaxLookupSearchDepth). When DataLayout not is around, it just looks
 /// through pointer casts.
+///
+/// If \p Walked is given, every value that the decomposition looked at, other
+/// than the base and the variable indices, is appended to it.
 bool BasicAAResult::DecomposeGEPExpression(const Value *V,
        DecomposedGEP &Decomposed, const DataLayout &DL, AssumptionCache *AC,
-       DominatorTree *DT) {
+       DominatorTree *DT, SmallVectorImpl<const Value *> *Walked) {
   // Limit recursion depth to limit compile time in crazy cases.
   unsigned MaxLookup = MaxLookupSearchDepth;
   SearchTimes++;
@@ -371,6 +441,9 @@ bool BasicAAResult::DecomposeGEPExpression(const Value *V,
   Decomposed.OtherOffset = 0;
   Decomposed.VarIndices.clear();
   do {
+    if (Walked)
+      Walked->push_back(V);
+
     // See if this is a bitcast or GEP.
     const Operator *Op = dyn_cast<Operator>(V);
     if (!Op) {
@@ -431,6 +504,8 @@ bool BasicAAResult::DecomposeGEPExpression(const Value *V,
     for (User::const_op_iterator I = GEPOp->op_begin() + 1, E = GEPOp->op_end();
          I != E; ++I, ++GTI) {
       const Value *Index = *I;
+      if (Walked && !isa<Constant>(Index))
+        Walked->push_back(Index);
       // Compute the (potentially symbolic) offset in bytes for this index.
       if (StructType *STy = GTI.getStructTypeOrNull()) {
         // For a struct, add the member offset.
@@ -707,10 +782,14 @@ AliasResult BasicAAResult::alias(const MemoryLocation &LocA,
 
   // If we have a directly cached entry for these locations, we have recursed
   // through this once, so just return the cached results. Notably, when this
-  // happens, we don't clear the cache.
+  // happens, we don't clear the cache. A miss is counted by aliasCheck, which
+  // looks the query up again.
   auto CacheIt = AliasCache.find(LocPair(LocA, LocB));
-  if (CacheIt != AliasCache.end())
+  if (CacheIt != AliasCache.end()) {
+    ++AliasCacheQueries;
+    ++AliasCacheHits;
     return CacheIt->second;
+  }
 
   AliasResult Alias = aliasCheck(LocA.Ptr, LocA.Size, LocA.AATags, LocB.Ptr,
                                  LocB.Size, LocB.AATags);
@@ -1122,10 +1201,8 @@ AliasResult BasicAAResult::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
                                     const Value *UnderlyingV1,
                                     const Value *UnderlyingV2) {
   DecomposedGEP DecompGEP1, DecompGEP2;
-  bool GEP1MaxLookupReached =
-    DecomposeGEPExpression(GEP1, DecompGEP1, DL, &AC, DT);
-  bool GEP2MaxLookupReached =
-    DecomposeGEPExpression(V2, DecompGEP2, DL, &AC, DT);
+  bool GEP1MaxLookupReached = decomposeGEP(GEP1, DecompGEP1);
+  bool GEP2MaxLookupReached = decomposeGEP(V2, DecompGEP2);
 
   int64_t GEP1BaseOffset = DecompGEP1.StructOffset + DecompGEP1.OtherOffset;
   int64_t GEP2BaseOffset = DecompGEP2.StructOffset + DecompGEP2.OtherOffset;
@@ -1588,10 +1665,13 @@ AliasResult BasicAAResult::aliasCheck(const Value *V1, uint64_t V1Size,
                MemoryLocation(V2, V2Size, V2AAInfo));
   if (V1 > V2)
     std::swap(Locs.first, Locs.second);
+  ++AliasCacheQueries;
   std::pair<AliasCacheTy::iterator, bool> Pair =
       AliasCache.insert(std::make_pair(Locs, MayAlias));
-  if (!Pair.second)
+  if (!Pair.second) {
+    ++AliasCacheHits;
     return Pair.first->second;
+  }
 
   // FIXME: This isn't aggressively handling alias(GEP, PHI) for example: if the
   // GEP can't simplify, we don't even look at the PHI cases.
@@ -40,6 +40,8 @@ using namespace llvm;
 #define DEBUG_TYPE "inline-cost"
 
 STATISTIC(NumCallsAnalyzed, "Number of call sites analyzed");
+STATISTIC(NumCalleeWalksCached,
+          "Number of callee simulations avoided by the inline cost cache");
 
 static cl::opt<int> InlineThreshold(
     "inline-threshold", cl::Hidden, cl::init(225), cl::ZeroOrMore,
@@ -98,6 +100,9 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
   /// Tunable parameters that control the analysis.
   const InlineParams &Params;
 
+  /// Optional cache of the walks of callee bodies.
+  InlineCostCache *Cache;
+
   int Threshold;
   int Cost;
 
@@ -174,6 +179,7 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
 
   // Custom analysis routines.
   bool analyzeBlock(BasicBlock *BB, SmallPtrSetImpl<const Value *> &EphValues);
+  bool analyzeCallee(int SingleBBBonus, bool OnlyOneCallAndLocalLinkage);
 
   // Disable several entry points to the visitor so we don't accidentally use
   // them by declaring but not defining them here.
@@ -218,10 +224,11 @@ public:
                std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
                Optional<function_ref<BlockFrequencyInfo &(Function &)>> &GetBFI,
                ProfileSummaryInfo *PSI, Function &Callee, CallSite CSArg,
-               const InlineParams &Params)
+               const InlineParams &Params, InlineCostCache *Cache = nullptr)
       : TTI(TTI), GetAssumptionCache(GetAssumptionCache), GetBFI(GetBFI),
         PSI(PSI), F(Callee), DL(F.getParent()->getDataLayout()),
-        CandidateCS(CSArg), Params(Params), Threshold(Params.DefaultThreshold),
+        CandidateCS(CSArg), Params(Params), Cache(Cache),
+        Threshold(Params.DefaultThreshold),
         Cost(0), IsCallerRecursive(false), IsRecursiveCall(false),
         ExposesReturnsTwice(false), HasDynamicAlloca(false),
         ContainsNoDuplicateCall(false), HasReturn(false), HasIndirectBr(false),
@@ -1202,6 +1209,7 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
 
   // Update the threshold based on callsite properties
   updateThreshold(CS, F);
+  int CallSiteThreshold = Threshold;
 
   FiftyPercentVectorBonus = 3 * Threshold / 2;
   TenPercentVectorBonus = 3 * Threshold / 4;
@@ -1209,7 +1217,6 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
   // Track whether the post-inlining function would have more than one basic
   // block. A single basic block is often intended for inlining. Balloon the
   // threshold by 50% until we pass the single-BB phase.
-  bool SingleBB = true;
   int SingleBBBonus = Threshold / 2;
 
   // Speculatively apply all possible bonuses to Threshold. If cost exceeds
@@ -1279,6 +1286,16 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
     }
   }
 
+  // The walk of the callee below depends on the call site only through the
+  // state set up so far and the arguments, so describe them for the cache.
+  InlineCostCache::Entry Key;
+  Key.Threshold = CallSiteThreshold;
+  Key.Cost = Cost;
+  Key.IsCallerRecursive = IsCallerRecursive;
+  Key.OnlyOneCallAndLocalLinkage = OnlyOneCallAndLocalLinkage;
+  Key.CallSiteAttrs = CS.getAttributes();
+  SmallVector<Value *, 4> PtrArgBases;
+
   // Populate our simplified values by mapping from function arguments to call
   // arguments with known important simplifications.
   CallSite::arg_iterator CAI = CS.arg_begin();
@@ -1297,12 +1314,48 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
         SROAArgValues[&*FAI] = PtrArg;
         SROAArgCosts[PtrArg] = 0;
       }
+
+      // The analysis only ever compares the bases of pointer arguments with
+      // each other, so number them in order of appearance.
+      if (Cache) {
+        unsigned BaseIndex = find(PtrArgBases, PtrArg) - PtrArgBases.begin();
+        if (BaseIndex == PtrArgBases.size())
+          PtrArgBases.push_back(PtrArg);
+        Key.PointerArgs.push_back({FAI->getArgNo(), BaseIndex,
+                                   isa<AllocaInst>(PtrArg), C->getValue()});
+      }
     }
   }
   NumConstantArgs = SimplifiedValues.size();
   NumConstantOffsetPtrArgs = ConstantOffsetPtrs.size();
   NumAllocaArgs = SROAArgValues.size();
 
+  // Constant arguments can fold away parts of the callee, so only the calls
+  // without them are worth remembering.
+  if (!Cache || NumConstantArgs)
+    return analyzeCallee(SingleBBBonus, OnlyOneCallAndLocalLinkage);
+
+  if (const InlineCostCache::Entry *Cached = Cache->lookup(F, Key)) {
+    ++NumCalleeWalksCached;
+    Cost = Cached->FinalCost;
+    Threshold = Cached->FinalThreshold;
+    return Cached->ShouldInline;
+  }
+
+  bool ShouldInline = analyzeCallee(SingleBBBonus, OnlyOneCallAndLocalLinkage);
+  Key.ShouldInline = ShouldInline;
+  Key.FinalCost = Cost;
+  Key.FinalThreshold = Threshold;
+  Cache->insert(F, std::move(Key));
+  return ShouldInline;
+}
+
+/// \brief Walk the callee body, once the threshold and the simplifications
+/// that follow from the call site are set up.
+bool CallAnalyzer::analyzeCallee(int SingleBBBonus,
+                                 bool OnlyOneCallAndLocalLinkage) {
+  bool SingleBB = true;
+
   // FIXME: If a caller has multiple calls to a callee, we end up recomputing
   // the ephemeral values multiple times (and they're completely determined by
   // the callee, so this is purely duplicate work).
@@ -1435,9 +1488,9 @@ InlineCost llvm::getInlineCost(
     CallSite CS, const InlineParams &Params, TargetTransformInfo &CalleeTTI,
     std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
     Optional<function_ref<BlockFrequencyInfo &(Function &)>> GetBFI,
-    ProfileSummaryInfo *PSI) {
+    ProfileSummaryInfo *PSI, InlineCostCache *Cache) {
   return getInlineCost(CS, CS.getCalledFunction(), Params, CalleeTTI,
-                       GetAssumptionCache, GetBFI, PSI);
+                       GetAssumptionCache, GetBFI, PSI, Cache);
 }
 
 InlineCost llvm::getInlineCost(
@@ -1445,7 +1498,7 @@ InlineCost llvm::getInlineCost(
     TargetTransformInfo &CalleeTTI,
     std::function<AssumptionCache &(Function &)> &GetAssumptionCache,
     Optional<function_ref<BlockFrequencyInfo &(Function &)>> GetBFI,
-    ProfileSummaryInfo *PSI) {
+    ProfileSummaryInfo *PSI, InlineCostCache *Cache) {
 
   // Cannot inline indirect calls.
   if (!Callee)
@@ -1480,7 +1533,7 @@ InlineCost llvm::getInlineCost(
                      << "...\n");
 
   CallAnalyzer CA(CalleeTTI, GetAssumptionCache, GetBFI, PSI, *Callee, CS,
-                  Params);
+                  Params, Cache);
   bool ShouldInline = CA.analyzeCall(CS);
 
   DEBUG(CA.dump());
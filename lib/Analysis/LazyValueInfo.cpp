@@ -15,6 +15,7 @@
 #include "llvm/Analysis/LazyValueInfo.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
@@ -31,6 +32,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/PatternMatch.h"
 #include "llvm/IR/ValueHandle.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/raw_ostream.h"
@@ -41,9 +43,30 @@ using namespace PatternMatch;
 
 #define DEBUG_TYPE "lazy-value-info"
 
+STATISTIC(NumQueriesAbandoned,
+          "Number of queries that gave up and returned overdefined");
+STATISTIC(NumCacheTrims, "Number of times the cache exceeded its budget");
+STATISTIC(NumBlocksEvicted, "Number of blocks evicted from the cache");
+STATISTIC(NumEntriesEvicted, "Number of lattice values evicted from the cache");
+
 // This is the number of worklist items we will process to try to discover an
 // answer for a given value.
-static const unsigned MaxProcessedPerValue = 500;
+static cl::opt<unsigned> MaxProcessedPerValue(
+    "lvi-max-processed-per-value", cl::Hidden, cl::init(500),
+    cl::desc("Maximum number of worklist items processed per query"));
+
+// This is the number of nested values a query may be waiting on before it
+// gives up. Zero means no limit other than MaxProcessedPerValue.
+static cl::opt<unsigned> MaxStackDepth(
+    "lvi-max-stack-depth", cl::Hidden, cl::init(0),
+    cl::desc("Maximum depth of the worklist of a query (0 = unlimited)"));
+
+// This is the number of lattice values the cache may hold across queries.
+// Once it is exceeded, the values of the least recently queried blocks are
+// dropped. Zero means no limit.
+static cl::opt<unsigned> CacheBudget(
+    "lvi-cache-budget", cl::Hidden, cl::init(0),
+    cl::desc("Maximum number of lattice values cached (0 = unlimited)"));
 
 char LazyValueInfoWrapperPass::ID = 0;
 INITIALIZE_PASS_BEGIN(LazyValueInfoWrapperPass, "lazy-value-info",
@@ -132,6 +155,16 @@ public:
   bool isConstantRange() const { return Tag == constantrange; }
   bool isOverdefined() const   { return Tag == overdefined; }
 
+  bool operator==(const LVILatticeVal &RHS) const {
+    if (Tag != RHS.Tag)
+      return false;
+    if (isConstant() || isNotConstant())
+      return Val == RHS.Val;
+    if (isConstantRange())
+      return Range == RHS.Range;
+    return true;
+  }
+
   Constant *getConstant() const {
     assert(isConstant() && "Cannot get the constant of a non-constant!");
     return Val;
@@ -366,14 +399,22 @@ namespace {
   class LazyValueInfoCache {
     friend class LazyValueInfoAnnotatedWriter;
     /// This is all of the cached block information for exactly one Value*.
-    /// The entries are sorted by the BasicBlock* of the
-    /// entries, allowing us to do a lookup with a binary search.
+    /// A value usually has the same lattice value in many blocks, so each
+    /// distinct lattice value is stored once in Vals and BlockVals maps the
+    /// blocks to their index in it.
     /// Over-defined lattice values are recorded in OverDefinedCache to reduce
     /// memory overhead.
     struct ValueCacheEntryTy {
       ValueCacheEntryTy(Value *V, LazyValueInfoCache *P) : Handle(V, P) {}
       LVIValueHandle Handle;
-      SmallDenseMap<PoisoningVH<BasicBlock>, LVILatticeVal, 4> BlockVals;
+      SmallVector<LVILatticeVal, 1> Vals;
+      SmallDenseMap<PoisoningVH<BasicBlock>, unsigned, 4> BlockVals;
+
+      /// Set the lattice value in \p BB, returning true if the block did not
+      /// have one.
+      bool set(BasicBlock *BB, const LVILatticeVal &Val);
+      /// Drop the lattice values that no block refers to any more.
+      void compact();
     };
 
     /// This tracks, on a per-block basis, the set of values that are
@@ -381,8 +422,20 @@ namespace {
     typedef DenseMap<PoisoningVH<BasicBlock>, SmallPtrSet<Value *, 4>>
         OverDefinedCacheTy;
     /// Keep track of all blocks that we have ever seen, so we
-    /// don't spend time removing unused blocks from our caches.
-    DenseSet<PoisoningVH<BasicBlock> > SeenBlocks;
+    /// don't spend time removing unused blocks from our caches, along with
+    /// the time each of them was last used.
+    DenseMap<PoisoningVH<BasicBlock>, uint64_t> SeenBlocks;
+
+    /// Counts the uses of the cache, to order the blocks by their last use.
+    uint64_t Clock = 0;
+    /// The number of lattice values in ValueCache and OverDefinedCache.
+    unsigned NumEntries = 0;
+
+    /// Record a use of the values of \p BB.
+    void touch(BasicBlock *BB) {
+      if (CacheBudget)
+        SeenBlocks[BB] = ++Clock;
+    }
 
   protected:
     /// This is all of the cached information for all values,
@@ -393,20 +446,22 @@ namespace {
 
   public:
     void insertResult(Value *Val, BasicBlock *BB, const LVILatticeVal &Result) {
-      SeenBlocks.insert(BB);
+      SeenBlocks[BB] = ++Clock;
 
       // Insert over-defined values into their own cache to reduce memory
       // overhead.
-      if (Result.isOverdefined())
-        OverDefinedCache[BB].insert(Val);
-      else {
+      if (Result.isOverdefined()) {
+        if (OverDefinedCache[BB].insert(Val).second)
+          ++NumEntries;
+      } else {
         auto It = ValueCache.find_as(Val);
         if (It == ValueCache.end()) {
           ValueCache[Val] = make_unique<ValueCacheEntryTy>(Val, this);
           It = ValueCache.find_as(Val);
           assert(It != ValueCache.end() && "Val was just added to the map!");
         }
-        It->second->BlockVals[BB] = Result;
+        if (It->second->set(BB, Result))
+          ++NumEntries;
       }
     }
 
@@ -419,7 +474,8 @@ namespace {
       return ODI->second.count(V);
     }
 
-    bool hasCachedValueInfo(Value *V, BasicBlock *BB) const {
+    bool hasCachedValueInfo(Value *V, BasicBlock *BB) {
+      touch(BB);
       if (isOverdefined(V, BB))
         return true;
 
@@ -430,7 +486,8 @@ namespace {
       return I->second->BlockVals.count(BB);
     }
 
-    LVILatticeVal getCachedValueInfo(Value *V, BasicBlock *BB) const {
+    LVILatticeVal getCachedValueInfo(Value *V, BasicBlock *BB) {
+      touch(BB);
       if (isOverdefined(V, BB))
         return LVILatticeVal::getOverdefined();
 
@@ -440,7 +497,7 @@ namespace {
       auto BBI = I->second->BlockVals.find(BB);
       if (BBI == I->second->BlockVals.end())
         return LVILatticeVal();
-      return BBI->second;
+      return I->second->Vals[BBI->second];
     }
 
     void printCache(Function &F, raw_ostream &OS);
@@ -449,8 +506,22 @@ namespace {
       SeenBlocks.clear();
       ValueCache.clear();
       OverDefinedCache.clear();
+      NumEntries = 0;
+    }
+
+    /// Start a new query. If the cache has grown past its budget, this first
+    /// evicts the blocks that were used least recently. It must not be called
+    /// while a query is being solved, as the solver expects the values it has
+    /// computed to stay in the cache.
+    void startQuery() {
+      if (CacheBudget && NumEntries > CacheBudget)
+        evictBlocks();
     }
 
+    /// Evict the least recently used blocks until the cache is back under
+    /// three quarters of its budget.
+    void evictBlocks();
+
     /// Inform the cache that a given value has been deleted.
     void eraseValue(Value *V);
 
@@ -496,7 +567,7 @@ namespace {
         auto BBI = VI->second->BlockVals.find(const_cast<BasicBlock *>(BB));
         if (BBI != VI->second->BlockVals.end())
           OS << "; CachedLatticeValue for: '" << *VI->first << "' is: '"
-             << BBI->second << "'\n";
+             << VI->second->Vals[BBI->second] << "'\n";
       }
     }
 
@@ -510,7 +581,7 @@ namespace {
       for (auto &BV : VI->second->BlockVals) {
         OS << "; at beginning of BasicBlock: '";
         BV.first->printAsOperand(OS, false);
-        OS << "' LatticeVal: '" << BV.second << "' \n";
+        OS << "' LatticeVal: '" << VI->second->Vals[BV.second] << "' \n";
       }
     }
 };
@@ -522,18 +593,62 @@ void LazyValueInfoCache::printCache(Function &F, raw_ostream &OS) {
 
 }
 
+bool LazyValueInfoCache::ValueCacheEntryTy::set(BasicBlock *BB,
+                                                const LVILatticeVal &Val) {
+  // Look for the value among the last few distinct ones; the same value is
+  // usually inserted for many blocks in a row.
+  unsigned Index = Vals.size();
+  for (unsigned I = Vals.size(), E = I > 4 ? I - 4 : 0; I != E; --I)
+    if (Vals[I - 1] == Val) {
+      Index = I - 1;
+      break;
+    }
+  if (Index == Vals.size())
+    Vals.push_back(Val);
+
+  auto Pair = BlockVals.insert(std::make_pair(BB, Index));
+  if (!Pair.second)
+    Pair.first->second = Index;
+  return Pair.second;
+}
+
+void LazyValueInfoCache::ValueCacheEntryTy::compact() {
+  SmallVector<unsigned, 8> NewIndex(Vals.size(), ~0U);
+  for (auto &BV : BlockVals)
+    NewIndex[BV.second] = 0;
+
+  unsigned NumVals = 0;
+  for (unsigned I = 0, E = Vals.size(); I != E; ++I) {
+    if (NewIndex[I] == ~0U)
+      continue;
+    NewIndex[I] = NumVals;
+    if (I != NumVals)
+      Vals[NumVals] = std::move(Vals[I]);
+    ++NumVals;
+  }
+  Vals.resize(NumVals);
+
+  for (auto &BV : BlockVals)
+    BV.second = NewIndex[BV.second];
+}
+
 void LazyValueInfoCache::eraseValue(Value *V) {
   for (auto I = OverDefinedCache.begin(), E = OverDefinedCache.end(); I != E;) {
     // Copy and increment the iterator immediately so we can erase behind
     // ourselves.
     auto Iter = I++;
     SmallPtrSetImpl<Value *> &ValueSet = Iter->second;
-    ValueSet.erase(V);
+    if (ValueSet.erase(V))
+      --NumEntries;
     if (ValueSet.empty())
       OverDefinedCache.erase(Iter);
   }
 
-  ValueCache.erase(V);
+  auto I = ValueCache.find(V);
+  if (I == ValueCache.end())
+    return;
+  NumEntries -= I->second->BlockVals.size();
+  ValueCache.erase(I);
 }
 
 void LVIValueHandle::deleted() {
@@ -544,17 +659,80 @@ void LVIValueHandle::deleted() {
 
 void LazyValueInfoCache::eraseBlock(BasicBlock *BB) {
   // Shortcut if we have never seen this block.
-  DenseSet<PoisoningVH<BasicBlock> >::iterator I = SeenBlocks.find(BB);
+  auto I = SeenBlocks.find(BB);
   if (I == SeenBlocks.end())
     return;
   SeenBlocks.erase(I);
 
   auto ODI = OverDefinedCache.find(BB);
-  if (ODI != OverDefinedCache.end())
+  if (ODI != OverDefinedCache.end()) {
+    NumEntries -= ODI->second.size();
     OverDefinedCache.erase(ODI);
+  }
 
   for (auto &I : ValueCache)
-    I.second->BlockVals.erase(BB);
+    if (I.second->BlockVals.erase(BB))
+      --NumEntries;
+}
+
+void LazyValueInfoCache::evictBlocks() {
+  ++NumCacheTrims;
+
+  // Count the lattice values cached for each block.
+  DenseMap<BasicBlock *, unsigned> BlockEntries;
+  for (auto &OD : OverDefinedCache)
+    BlockEntries[OD.first] += OD.second.size();
+  for (auto &VC : ValueCache)
+    for (auto &BV : VC.second->BlockVals)
+      ++BlockEntries[BV.first];
+
+  std::vector<std::pair<uint64_t, BasicBlock *>> Blocks;
+  Blocks.reserve(SeenBlocks.size());
+  for (auto &SB : SeenBlocks)
+    Blocks.push_back(std::make_pair(SB.second, (BasicBlock *)SB.first));
+  std::sort(Blocks.begin(), Blocks.end(),
+            [](const std::pair<uint64_t, BasicBlock *> &L,
+               const std::pair<uint64_t, BasicBlock *> &R) {
+              return L.first < R.first;
+            });
+
+  // Stop well below the budget, so that the walks over the whole cache here
+  // are amortized over many insertions.
+  unsigned Target = CacheBudget - CacheBudget / 4;
+  DenseSet<BasicBlock *> Evicted;
+  for (auto &B : Blocks) {
+    if (NumEntries <= Target)
+      break;
+    Evicted.insert(B.second);
+    SeenBlocks.erase(B.second);
+    NumEntries -= BlockEntries.lookup(B.second);
+    NumEntriesEvicted += BlockEntries.lookup(B.second);
+    ++NumBlocksEvicted;
+
+    auto ODI = OverDefinedCache.find(B.second);
+    if (ODI != OverDefinedCache.end())
+      OverDefinedCache.erase(ODI);
+  }
+
+  for (auto I = ValueCache.begin(), E = ValueCache.end(); I != E;) {
+    // Copy and increment the iterator immediately so we can erase behind
+    // ourselves.
+    auto Iter = I++;
+    ValueCacheEntryTy &Entry = *Iter->second;
+    bool Changed = false;
+    for (auto BI = Entry.BlockVals.begin(), BE = Entry.BlockVals.end();
+         BI != BE;) {
+      auto BIter = BI++;
+      if (Evicted.count(BIter->first)) {
+        Entry.BlockVals.erase(BIter);
+        Changed = true;
+      }
+    }
+    if (Entry.BlockVals.empty())
+      ValueCache.erase(Iter);
+    else if (Changed)
+      Entry.compact();
+  }
 }
 
 void LazyValueInfoCache::threadEdgeImpl(BasicBlock *OldSucc,
@@ -598,6 +776,7 @@ void LazyValueInfoCache::threadEdgeImpl(BasicBlock *OldSucc,
     for (Value *V : ValsToClear) {
       if (!ValueSet.erase(V))
         continue;
+      --NumEntries;
 
       // If we removed anything, then we potentially need to update
       // blocks successors too.
@@ -729,8 +908,10 @@ void LazyValueInfoImpl::solve() {
     // the same overdefined result again and again.  Once something like
     // PredicateInfo is used in LVI or CVP, we should be able to make the
     // overdefined cache global, and remove this throttle.
-    if (processedCount > MaxProcessedPerValue) {
+    if (processedCount > MaxProcessedPerValue ||
+        (MaxStackDepth && BlockValueStack.size() > MaxStackDepth)) {
       DEBUG(dbgs() << "Giving up on stack because we are getting too deep\n");
+      ++NumQueriesAbandoned;
       // Fill in the original values
       while (!StartingStack.empty()) {
         std::pair<BasicBlock *, Value *> &e = StartingStack.back();
@@ -1501,6 +1682,7 @@ LVILatticeVal LazyValueInfoImpl::getValueInBlock(Value *V, BasicBlock *BB,
         << BB->getName() << "'\n");
 
   assert(BlockValueStack.empty() && BlockValueSet.empty());
+  TheCache.startQuery();
   if (!hasBlockValue(V, BB)) {
     pushBlockValue(std::make_pair(BB, V));
     solve();
@@ -1534,6 +1716,7 @@ getValueOnEdge(Value *V, BasicBlock *FromBB, BasicBlock *ToBB,
   DEBUG(dbgs() << "LVI Getting edge value " << *V << " from '"
         << FromBB->getName() << "' to '" << ToBB->getName() << "'\n");
 
+  TheCache.startQuery();
   LVILatticeVal Result;
   if (!getEdgeValue(V, FromBB, ToBB, Result, CxtI)) {
     solve();
@@ -71,6 +71,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
@@ -93,6 +94,11 @@ static cl::opt<bool> PrintSummaryGUIDs(
     cl::desc(
         "Print the global id for each value when reading the module summary"));
 
+static cl::opt<unsigned> ReaderThreads(
+    "bitcode-reader-threads", cl::init(1), cl::Hidden,
+    cl::desc("Number of threads used to decode function blocks when a whole "
+             "module is materialized"));
+
 namespace {
 
 enum {
@@ -463,6 +469,10 @@ class BitcodeReader : public BitcodeReaderBase, public GVMaterializer {
   /// where to find deferred function body in the stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
 
+  /// Function bodies that materializeModuleParallel decoded ahead of time, to
+  /// be replayed instead of read from the stream.
+  DenseMap<Function *, const BitstreamBlockRecording *> FunctionRecordings;
+
   /// When Metadata block is initially scanned when parsing the module, we may
   /// choose to defer parsing of the metadata. This vector contains info about
   /// which Metadata blocks are deferred.
@@ -496,9 +506,11 @@ public:
                 LLVMContext &Context);
 
   Error materializeForwardReferencedFunctions();
+  Error finishMaterializingModule();
 
   Error materialize(GlobalValue *GV) override;
   Error materializeModule() override;
+  Error materializeModuleParallel(unsigned NumThreads) override;
   std::vector<StructType *> getIdentifiedStructTypes() const override;
 
   /// \brief Main interface to parsing a bitcode buffer.
@@ -4463,8 +4475,14 @@ Error BitcodeReader::materialize(GlobalValue *GV) {
   if (Error Err = materializeMetadata())
     return Err;
 
-  // Move the bit stream to the saved position of the deferred function body.
-  Stream.JumpToBit(DFII->second);
+  // Move the bit stream to the saved position of the deferred function body,
+  // or replay it if it was already decoded.
+  auto Recording = FunctionRecordings.find(F);
+  if (Recording != FunctionRecordings.end()) {
+    Stream.replayBlock(*Recording->second);
+    FunctionRecordings.erase(Recording);
+  } else
+    Stream.JumpToBit(DFII->second);
 
   if (Error Err = parseFunctionBody(F))
     return Err;
@@ -4512,18 +4530,86 @@ Error BitcodeReader::materialize(GlobalValue *GV) {
 }
 
 Error BitcodeReader::materializeModule() {
+  return materializeModuleParallel(ReaderThreads);
+}
+
+Error BitcodeReader::materializeModuleParallel(unsigned NumThreads) {
   if (Error Err = materializeMetadata())
     return Err;
 
   // Promise to materialize all forward references.
   WillMaterializeAllForwardRefs = true;
 
-  // Iterate over the module, deserializing any functions that are still on
-  // disk.
+  if (NumThreads <= 1) {
+    // Iterate over the module, deserializing any functions that are still on
+    // disk.
+    for (Function &F : *TheModule) {
+      if (Error Err = materialize(&F))
+        return Err;
+    }
+    return finishMaterializingModule();
+  }
+
+  // Find the function bodies up front, which only requires scanning the
+  // stream for old bitcode without function offsets in the VST. If that
+  // fails, the bodies after the failure are left to the serial loop below,
+  // so that errors in the earlier bodies are reported first.
+  std::vector<Function *> Bodies;
+  for (Function &F : *TheModule) {
+    if (!F.isMaterializable())
+      continue;
+    auto DFII = DeferredFunctionInfo.find(&F);
+    assert(DFII != DeferredFunctionInfo.end() && "Deferred function not found!");
+    if (DFII->second == 0)
+      if (Error Err = findFunctionInStream(&F, DFII)) {
+        consumeError(std::move(Err));
+        break;
+      }
+    Bodies.push_back(&F);
+  }
+
+  // Decoding the records of a function body is independent of the IR, so it
+  // is done on the thread pool, while the bodies decoded so far are turned
+  // into IR in module order on this thread. A bounded number of bodies is
+  // decoded ahead to limit the memory used by the recordings. A body that
+  // fails to decode is read from the stream, which reports the error.
+  std::vector<BitstreamBlockRecording> Recordings(Bodies.size());
+  std::vector<std::shared_future<ThreadPool::VoidTy>> Decoded(Bodies.size());
+  std::vector<char> IsValid(Bodies.size());
+  ArrayRef<uint8_t> Bytes = Stream.getBitcodeBytes();
+  ThreadPool Pool(NumThreads);
+  size_t NumScheduled = 0;
+  const size_t Window = NumThreads * 8;
+  for (size_t I = 0, E = Bodies.size(); I != E; ++I) {
+    for (; NumScheduled != E && NumScheduled < I + Window; ++NumScheduled) {
+      size_t Index = NumScheduled;
+      uint64_t BitNo = DeferredFunctionInfo[Bodies[Index]];
+      Decoded[Index] = Pool.async([&, Index, BitNo] {
+        BitstreamCursor Cursor(Bytes);
+        Cursor.setBlockInfo(&BlockInfo);
+        IsValid[Index] = !Recordings[Index].record(Cursor, BitNo,
+                                                   bitc::FUNCTION_BLOCK_ID);
+      });
+    }
+
+    Pool.wait(Decoded[I]);
+    if (IsValid[I] && Bodies[I]->isMaterializable())
+      FunctionRecordings[Bodies[I]] = &Recordings[I];
+    Error Err = materialize(Bodies[I]);
+    FunctionRecordings.clear();
+    Recordings[I] = BitstreamBlockRecording();
+    if (Err)
+      return Err;
+  }
+
   for (Function &F : *TheModule) {
     if (Error Err = materialize(&F))
       return Err;
   }
+  return finishMaterializingModule();
+}
+
+Error BitcodeReader::finishMaterializingModule() {
   // At this point, if there are any function bodies, parse the rest of
   // the bits in the module past the last function block we have recorded
   // through either lazy scanning or the VST.
@@ -4783,6 +4869,20 @@ Error ModuleSummaryIndexBitcodeReader::parseModule(StringRef ModulePath) {
           // was historically always the start of the regular bitcode header.
           VSTOffset = Record[0] - 1;
           break;
+        /// MODULE_CODE_SUMMARYOFFSET: [offset]
+        case bitc::MODULE_CODE_SUMMARYOFFSET: {
+          if (Record.size() < 1)
+            return error("Invalid record");
+          // The record follows the global value records and the VSTOFFSET
+          // record, so we have everything we need from before the summary
+          // block, and can jump over the function blocks directly to it.
+          uint64_t SummaryBit = Record[0] * 32;
+          if (SummaryBit <= Stream.GetCurrentBitNo() ||
+              !Stream.canSkipToPos(SummaryBit / 8))
+            return error("Invalid summary offset");
+          Stream.JumpToBit(SummaryBit);
+          break;
+        }
         // GLOBALVAR: [pointer type, isconst,     initid,       linkage, ...]
         // FUNCTION:  [type,         callingconv, isproto,      linkage, ...]
         // ALIAS:     [alias type,   addrspace,   aliasee val#, linkage, ...]
@@ -5212,14 +5312,54 @@ const std::error_category &llvm::BitcodeErrorCategory() {
 // External interface
 //===----------------------------------------------------------------------===//
 
+/// Return the blob of the last \p RecordID record in the block \p Block, which
+/// \p Stream is about to enter, or an empty string if the block is malformed.
+/// The block is read through a copy of the cursor, so the caller still skips
+/// it as it does blocks that it does not know.
+static StringRef readBlobInRecord(const BitstreamCursor &Stream, unsigned Block,
+                                  unsigned RecordID) {
+  BitstreamCursor Cursor = Stream;
+  if (Cursor.EnterSubBlock(Block))
+    return StringRef();
+
+  StringRef Result;
+  SmallVector<uint64_t, 1> Record;
+  while (true) {
+    BitstreamEntry Entry = Cursor.advanceSkippingSubblocks();
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return StringRef();
+    case BitstreamEntry::EndBlock:
+      return Result;
+    case BitstreamEntry::Record: {
+      StringRef Blob;
+      Record.clear();
+      if (Cursor.readRecord(Entry.ID, Record, &Blob) == RecordID)
+        Result = Blob;
+      break;
+    }
+    }
+  }
+}
+
 Expected<std::vector<BitcodeModule>>
 llvm::getBitcodeModuleList(MemoryBufferRef Buffer) {
+  Expected<BitcodeFileContents> FOrErr = getBitcodeFileContents(Buffer);
+  if (!FOrErr)
+    return FOrErr.takeError();
+  return std::move(FOrErr->Mods);
+}
+
+Expected<BitcodeFileContents>
+llvm::getBitcodeFileContents(MemoryBufferRef Buffer) {
   Expected<BitstreamCursor> StreamOrErr = initStream(Buffer);
   if (!StreamOrErr)
     return StreamOrErr.takeError();
   BitstreamCursor &Stream = *StreamOrErr;
 
-  std::vector<BitcodeModule> Modules;
+  BitcodeFileContents F;
+  std::vector<BitcodeModule> &Modules = F.Mods;
   while (true) {
     uint64_t BCBegin = Stream.getCurrentByteNo();
 
@@ -5227,7 +5367,7 @@ llvm::getBitcodeModuleList(MemoryBufferRef Buffer) {
     // of the bitcode stream (e.g. Apple's ar tool). If we are close enough to
     // the end that there cannot possibly be another module, stop looking.
     if (BCBegin + 8 >= Stream.getBitcodeBytes().size())
-      return Modules;
+      return std::move(F);
 
     BitstreamEntry Entry = Stream.advance();
     switch (Entry.Kind) {
@@ -5260,6 +5400,19 @@ llvm::getBitcodeModuleList(MemoryBufferRef Buffer) {
         continue;
       }
 
+      // A file made by binary concatenation, for example with "llvm-cat -b",
+      // has one symbol table per input. Keep the first one and the string
+      // table that follows it; irsymtab::readBitcode notices that it does not
+      // cover every module and rebuilds it. The tables are only a cache, so
+      // a table that cannot be read is ignored.
+      if (Entry.ID == bitc::SYMTAB_BLOCK_ID && F.Symtab.empty())
+        F.Symtab =
+            readBlobInRecord(Stream, bitc::SYMTAB_BLOCK_ID, bitc::SYMTAB_BLOB);
+      if (Entry.ID == bitc::STRTAB_BLOCK_ID && !F.Symtab.empty() &&
+          F.StrtabForSymtab.empty())
+        F.StrtabForSymtab =
+            readBlobInRecord(Stream, bitc::STRTAB_BLOCK_ID, bitc::STRTAB_BLOB);
+
       if (Stream.SkipBlock())
         return error("Malformed block");
       continue;
@@ -5367,7 +5520,10 @@ Expected<bool> BitcodeModule::hasSummary() {
       continue;
 
     case BitstreamEntry::Record:
-      Stream.skipRecord(Entry.ID);
+      // Modules with a summary record its offset before any sub-blocks that
+      // could be large, so we usually don't have to skip past them.
+      if (Stream.skipRecord(Entry.ID) == bitc::MODULE_CODE_SUMMARYOFFSET)
+        return true;
       continue;
     }
   }
@@ -21,6 +21,17 @@ using namespace llvm;
 /// EnterSubBlock - Having read the ENTER_SUBBLOCK abbrevid, enter
 /// the block, and return true if the block has an error.
 bool BitstreamCursor::EnterSubBlock(unsigned BlockID, unsigned *NumWordsP) {
+  if (Replay) {
+    const BitstreamBlockRecording::Entry &E = Replay->Entries[ReplayIndex - 1];
+    assert(E.Header.Kind == BitstreamEntry::SubBlock &&
+           E.Header.ID == BlockID && "Entering the wrong block");
+    (void)BlockID;
+    ++ReplayDepth;
+    if (NumWordsP)
+      *NumWordsP = E.CodeOrNumWords;
+    return false;
+  }
+
   // Save the current block's state on BlockScope.
   BlockScope.push_back(Block(CurCodeSize));
   BlockScope.back().PrevAbbrevs.swap(CurAbbrevs);
@@ -94,6 +105,9 @@ static void skipAbbreviatedField(BitstreamCursor &Cursor,
 
 /// skipRecord - Read the current record and discard it.
 unsigned BitstreamCursor::skipRecord(unsigned AbbrevID) {
+  if (Replay)
+    return Replay->Entries[ReplayIndex - 1].CodeOrNumWords;
+
   // Skip unabbreviated records by reading past their entries.
   if (AbbrevID == bitc::UNABBREV_RECORD) {
     unsigned Code = ReadVBR(6);
@@ -179,6 +193,9 @@ unsigned BitstreamCursor::skipRecord(unsigned AbbrevID) {
 unsigned BitstreamCursor::readRecord(unsigned AbbrevID,
                                      SmallVectorImpl<uint64_t> &Vals,
                                      StringRef *Blob) {
+  if (Replay)
+    return readReplayedRecord(Vals, Blob);
+
   if (AbbrevID == bitc::UNABBREV_RECORD) {
     unsigned Code = ReadVBR(6);
     unsigned NumElts = ReadVBR(6);
@@ -282,6 +299,84 @@ unsigned BitstreamCursor::readRecord(unsigned AbbrevID,
   return Code;
 }
 
+BitstreamEntry BitstreamCursor::advanceReplay(unsigned Flags) {
+  if (ReplayIndex == Replay->Entries.size())
+    return BitstreamEntry::getError();
+  BitstreamEntry Entry = Replay->Entries[ReplayIndex++].Header;
+  if (Entry.Kind == BitstreamEntry::EndBlock &&
+      !(Flags & AF_DontPopBlockAtEnd) && ReadBlockEnd())
+    return BitstreamEntry::getError();
+  return Entry;
+}
+
+unsigned BitstreamCursor::readReplayedRecord(SmallVectorImpl<uint64_t> &Vals,
+                                             StringRef *Blob) {
+  const BitstreamBlockRecording::Entry &E = Replay->Entries[ReplayIndex - 1];
+  assert(E.Header.Kind == BitstreamEntry::Record && "Not a record");
+  Vals.append(Replay->Ops.begin() + E.Begin, Replay->Ops.begin() + E.End);
+  // The blob is always the last operand of an abbreviation.
+  if (E.Blob.data()) {
+    if (Blob)
+      *Blob = E.Blob;
+    else
+      Vals.append(E.Blob.bytes_begin(), E.Blob.bytes_end());
+  }
+  return E.CodeOrNumWords;
+}
+
+//===----------------------------------------------------------------------===//
+//  BitstreamBlockRecording implementation
+//===----------------------------------------------------------------------===//
+
+bool BitstreamBlockRecording::record(BitstreamCursor &Cursor, uint64_t BitNo,
+                                     unsigned BlockID) {
+  Entries.clear();
+  Ops.clear();
+  Cursor.JumpToBit(BitNo);
+
+  // The indices of the entries of the blocks being recorded.
+  SmallVector<size_t, 4> OpenBlocks;
+  auto EnterBlock = [&](unsigned ID) {
+    unsigned NumWords;
+    if (Cursor.EnterSubBlock(ID, &NumWords))
+      return true;
+    OpenBlocks.push_back(Entries.size());
+    Entries.push_back({BitstreamEntry::getSubBlock(ID), NumWords, 0, 0, {}});
+    return false;
+  };
+  if (EnterBlock(BlockID))
+    return true;
+
+  SmallVector<uint64_t, 64> Vals;
+  while (!OpenBlocks.empty()) {
+    BitstreamEntry Entry = Cursor.advance();
+    switch (Entry.Kind) {
+    case BitstreamEntry::Error:
+      return true;
+    case BitstreamEntry::SubBlock:
+      if (EnterBlock(Entry.ID))
+        return true;
+      break;
+    case BitstreamEntry::EndBlock:
+      Entries[OpenBlocks.pop_back_val()].End = Entries.size();
+      Entries.push_back({Entry, 0, 0, 0, {}});
+      break;
+    case BitstreamEntry::Record: {
+      Vals.clear();
+      StringRef Blob;
+      unsigned Code = Cursor.readRecord(Entry.ID, Vals, &Blob);
+      Entries.push_back({Entry, Code, Ops.size(), Ops.size() + Vals.size(),
+                         Blob});
+      Ops.insert(Ops.end(), Vals.begin(), Vals.end());
+      break;
+    }
+    }
+  }
+
+  EndBit = Cursor.GetCurrentBitNo();
+  return false;
+}
+
 void BitstreamCursor::ReadAbbrevRecord() {
   auto Abbv = std::make_shared<BitCodeAbbrev>();
   unsigned NumOpInfo = ReadVBR(5);
@@ -28,11 +28,15 @@
 #include "llvm/IR/Operator.h"
 #include "llvm/IR/UseListOrder.h"
 #include "llvm/IR/ValueSymbolTable.h"
+#include "llvm/Object/IRSymtab.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/SHA1.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <atomic>
 #include <cctype>
 #include <map>
 using namespace llvm;
@@ -43,6 +47,11 @@ cl::opt<unsigned>
     IndexThreshold("bitcode-mdindex-threshold", cl::Hidden, cl::init(25),
                    cl::desc("Number of metadatas above which we emit an index "
                             "to enable lazy-loading"));
+
+cl::opt<unsigned> WriterThreads(
+    "bitcode-writer-threads", cl::Hidden, cl::init(1),
+    cl::desc("Number of threads used to encode function blocks; the output "
+             "doesn't depend on it"));
 /// These are manifest constants used by the bitcode writer. They do not need to
 /// be kept in sync with the reader, but need to be consistent within this file.
 enum {
@@ -127,6 +136,10 @@ class ModuleBitcodeWriter : public BitcodeWriterBase {
   /// Tracks the last value id recorded in the GUIDToValueMap.
   unsigned GlobalValueId;
 
+  /// Saves the offset of the SUMMARYOFFSET record that must eventually be
+  /// backpatched with the offset of the summary block.
+  uint64_t SummaryOffsetPlaceholder = 0;
+
 public:
   /// Constructs a ModuleBitcodeWriter object for the given Module,
   /// writing to the provided \p Buffer.
@@ -163,6 +176,14 @@ public:
   void write();
 
 private:
+  /// Constructs a writer for the function blocks of \p Parent's module, which
+  /// encodes them into \p Stream with its own copy of the ValueEnumerator.
+  ModuleBitcodeWriter(const ModuleBitcodeWriter &Parent,
+                      SmallVectorImpl<char> &Buffer, BitstreamWriter &Stream)
+      : BitcodeWriterBase(Stream), Buffer(Buffer), M(Parent.M), VE(Parent.VE),
+        Index(Parent.Index), GenerateHash(false), ModHash(nullptr),
+        BitcodeStartBit(0), GlobalValueId(Parent.GlobalValueId) {}
+
   uint64_t bitcodeStartBit() { return BitcodeStartBit; }
 
   void writeAttributeGroupTable();
@@ -170,6 +191,7 @@ private:
   void writeTypeTable();
   void writeComdats();
   void writeModuleInfo();
+  void writeSummaryForwardDecl();
   void writeValueAsMetadata(const ValueAsMetadata *MD,
                             SmallVectorImpl<uint64_t> &Record);
   void writeMDTuple(const MDTuple *N, SmallVectorImpl<uint64_t> &Record,
@@ -269,6 +291,10 @@ private:
   void
   writeFunction(const Function &F,
                 DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex);
+  void writeFunctionBlock(const Function &F);
+  void writeFunctionsInParallel(
+      unsigned NumThreads,
+      DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex);
   void writeBlockInfo();
   void writePerModuleFunctionSummaryRecord(SmallVector<uint64_t, 64> &NameVals,
                                            GlobalValueSummary *Summary,
@@ -1308,9 +1334,28 @@ void ModuleBitcodeWriter::writeModuleInfo() {
   }
 
   // If we have a VST, write the VSTOFFSET record placeholder.
-  if (M.getValueSymbolTable().empty())
-    return;
-  writeValueSymbolTableForwardDecl();
+  if (!M.getValueSymbolTable().empty())
+    writeValueSymbolTableForwardDecl();
+
+  // If we have a summary, write the SUMMARYOFFSET record placeholder. This
+  // must follow the VSTOFFSET record and the global value records, which the
+  // summary reader needs before it jumps to the summary block.
+  if (Index)
+    writeSummaryForwardDecl();
+}
+
+/// Write a record that will eventually hold the word offset of the per-module
+/// summary block, so that summary readers can jump over the function blocks.
+/// Like the VSTOFFSET record, it is backpatched when the block is written.
+void ModuleBitcodeWriter::writeSummaryForwardDecl() {
+  auto Abbv = std::make_shared<BitCodeAbbrev>();
+  Abbv->Add(BitCodeAbbrevOp(bitc::MODULE_CODE_SUMMARYOFFSET));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+  unsigned SummaryOffsetAbbrev = Stream.EmitAbbrev(std::move(Abbv));
+
+  uint64_t Vals[] = {bitc::MODULE_CODE_SUMMARYOFFSET, 0};
+  Stream.EmitRecordWithAbbrev(SummaryOffsetAbbrev, Vals);
+  SummaryOffsetPlaceholder = Stream.GetCurrentBitNo() - 32;
 }
 
 static uint64_t getOptimizationFlags(const Value *V) {
@@ -3053,7 +3098,10 @@ void ModuleBitcodeWriter::writeFunction(
   // Save the bitcode index of the start of this function block for recording
   // in the VST.
   FunctionToBitcodeIndex[&F] = Stream.GetCurrentBitNo();
+  writeFunctionBlock(F);
+}
 
+void ModuleBitcodeWriter::writeFunctionBlock(const Function &F) {
   Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
   VE.incorporateFunction(F);
 
@@ -3124,6 +3172,63 @@ void ModuleBitcodeWriter::writeFunction(
   Stream.ExitBlock();
 }
 
+/// Emit the function bodies, encoding the function blocks on \p NumThreads
+/// threads. The function blocks don't refer to each other, nor to their
+/// position in the stream, so each one is encoded into a private stream and
+/// they are then spliced in module order: the result is the same as writing
+/// them one after another.
+void ModuleBitcodeWriter::writeFunctionsInParallel(
+    unsigned NumThreads,
+    DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex) {
+  std::vector<const Function *> Functions;
+  for (const Function &F : M)
+    if (!F.isDeclaration()) {
+      Functions.push_back(&F);
+      // Arguments are created lazily, make sure that doesn't happen
+      // concurrently.
+      (void)F.arg_begin();
+    }
+
+  // The use-list orders of the functions are at the top of the stack, in
+  // order; give each function its own stack.
+  std::vector<UseListOrderStack> UseListOrders(Functions.size());
+  if (VE.shouldPreserveUseListOrder())
+    for (size_t I = 0, E = Functions.size(); I != E; ++I) {
+      auto &Orders = UseListOrders[I];
+      while (!VE.UseListOrders.empty() &&
+             VE.UseListOrders.back().F == Functions[I]) {
+        Orders.push_back(std::move(VE.UseListOrders.back()));
+        VE.UseListOrders.pop_back();
+      }
+      std::reverse(Orders.begin(), Orders.end());
+    }
+
+  std::vector<SmallVector<char, 0>> Blocks(Functions.size());
+  std::atomic<size_t> NextFunction(0);
+  ThreadPool Pool(NumThreads);
+  for (unsigned T = 0; T != NumThreads; ++T)
+    Pool.async([&]() {
+      SmallVector<char, 0> Buffer;
+      BitstreamWriter FunctionStream(Buffer);
+      FunctionStream.InheritBlockInfo(Stream);
+      ModuleBitcodeWriter Writer(*this, Buffer, FunctionStream);
+      for (size_t I = NextFunction++; I < Functions.size();
+           I = NextFunction++) {
+        Writer.VE.UseListOrders = std::move(UseListOrders[I]);
+        Writer.writeFunctionBlock(*Functions[I]);
+        Blocks[I] = std::move(Buffer);
+        Buffer.clear();
+      }
+    });
+  Pool.wait();
+
+  for (size_t I = 0, E = Functions.size(); I != E; ++I) {
+    FunctionToBitcodeIndex[Functions[I]] = Stream.GetCurrentBitNo();
+    Stream.SpliceBlock(bitc::FUNCTION_BLOCK_ID, 4, Blocks[I]);
+    Blocks[I] = SmallVector<char, 0>();
+  }
+}
+
 // Emit blockinfo, which defines the standard abbreviations etc.
 void ModuleBitcodeWriter::writeBlockInfo() {
   // We only want to emit block info records for blocks that have multiple
@@ -3493,6 +3598,12 @@ static const uint64_t INDEX_VERSION = 3;
 /// Emit the per-module summary section alongside the rest of
 /// the module's bitcode.
 void ModuleBitcodeWriter::writePerModuleGlobalValueSummary() {
+  // Backpatch the word offset of the summary block, relative to the start of
+  // the identification block, into the SUMMARYOFFSET record.
+  uint64_t SummaryOffset = Stream.GetCurrentBitNo() - bitcodeStartBit();
+  assert((SummaryOffset & 31) == 0 && "Summary block not 32-bit aligned");
+  Stream.BackpatchWord(SummaryOffsetPlaceholder, SummaryOffset / 32);
+
   Stream.EnterSubblock(bitc::GLOBALVAL_SUMMARY_BLOCK_ID, 4);
 
   Stream.EmitRecord(bitc::FS_VERSION, ArrayRef<uint64_t>{INDEX_VERSION});
@@ -3848,9 +3959,12 @@ void ModuleBitcodeWriter::write() {
 
   // Emit function bodies.
   DenseMap<const Function *, uint64_t> FunctionToBitcodeIndex;
-  for (Module::const_iterator F = M.begin(), E = M.end(); F != E; ++F)
-    if (!F->isDeclaration())
-      writeFunction(*F, FunctionToBitcodeIndex);
+  if (WriterThreads > 1)
+    writeFunctionsInParallel(WriterThreads, FunctionToBitcodeIndex);
+  else
+    for (Module::const_iterator F = M.begin(), E = M.end(); F != E; ++F)
+      if (!F->isDeclaration())
+        writeFunction(*F, FunctionToBitcodeIndex);
 
   // Need to write after the above call to WriteFunction which populates
   // the summary information in the index.
@@ -3952,12 +4066,59 @@ void BitcodeWriter::writeModule(const Module *M,
                                 bool ShouldPreserveUseListOrder,
                                 const ModuleSummaryIndex *Index,
                                 bool GenerateHash, ModuleHash *ModHash) {
+  // The symbol table builder needs a non-const Module to materialize
+  // metadata, but does not otherwise modify the module.
+  Mods.push_back(const_cast<Module *>(M));
+
   ModuleBitcodeWriter ModuleWriter(M, Buffer, *Stream,
                                    ShouldPreserveUseListOrder, Index,
                                    GenerateHash, ModHash);
   ModuleWriter.write();
 }
 
+static void writeBlob(BitstreamWriter &Stream, unsigned Block, unsigned Code,
+                      StringRef Blob) {
+  Stream.EnterSubblock(Block, 3);
+
+  auto Abbv = std::make_shared<BitCodeAbbrev>();
+  Abbv->Add(BitCodeAbbrevOp(Code));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob));
+  unsigned BlobAbbrev = Stream.EmitAbbrev(std::move(Abbv));
+
+  uint64_t Vals[] = {Code};
+  Stream.EmitRecordWithBlob(BlobAbbrev, Vals, Blob);
+
+  Stream.ExitBlock();
+}
+
+void BitcodeWriter::writeSymtab() {
+  // The symbol table of a module with inline asm is only accurate if we can
+  // parse the asm, so leave it out rather than writing an incomplete one.
+  for (Module *M : Mods) {
+    if (M->getModuleInlineAsm().empty())
+      continue;
+
+    std::string Err;
+    const Triple TT(M->getTargetTriple());
+    const Target *T = TargetRegistry::lookupTarget(TT.str(), Err);
+    if (!T || !T->hasMCAsmParser())
+      return;
+  }
+
+  // Readers rebuild the symbol table of files that don't have one, so failing
+  // to build it here is not an error.
+  SmallVector<char, 0> Symtab, Strtab;
+  if (Error E = irsymtab::build(Mods, Symtab, Strtab)) {
+    consumeError(std::move(E));
+    return;
+  }
+
+  writeBlob(*Stream, bitc::SYMTAB_BLOCK_ID, bitc::SYMTAB_BLOB,
+            {Symtab.data(), Symtab.size()});
+  writeBlob(*Stream, bitc::STRTAB_BLOCK_ID, bitc::STRTAB_BLOB,
+            {Strtab.data(), Strtab.size()});
+}
+
 /// WriteBitcodeToFile - Write the specified module to the specified output
 /// stream.
 void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
@@ -3976,6 +4137,7 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
   BitcodeWriter Writer(Buffer);
   Writer.writeModule(M, ShouldPreserveUseListOrder, Index, GenerateHash,
                      ModHash);
+  Writer.writeSymtab();
 
   if (TT.isOSDarwin() || TT.isOSBinFormatMachO())
     emitDarwinBCHeaderAndTrailer(Buffer, TT);
@@ -909,6 +909,22 @@ void ValueEnumerator::EnumerateAttributes(AttributeList PAL) {
   }
 }
 
+ValueEnumerator::ValueEnumerator(const ValueEnumerator &VE)
+    : TypeMap(VE.TypeMap), Types(VE.Types), ValueMap(VE.ValueMap),
+      Values(VE.Values), Comdats(VE.Comdats), MDs(VE.MDs),
+      FunctionMDs(VE.FunctionMDs), MetadataMap(VE.MetadataMap),
+      FunctionMDInfo(VE.FunctionMDInfo),
+      ShouldPreserveUseListOrder(VE.ShouldPreserveUseListOrder),
+      AttributeGroupMap(VE.AttributeGroupMap),
+      AttributeGroups(VE.AttributeGroups), AttributeMap(VE.AttributeMap),
+      Attribute(VE.Attribute), GlobalBasicBlockIDs(VE.GlobalBasicBlockIDs),
+      InstructionMap(VE.InstructionMap),
+      InstructionCount(VE.InstructionCount), BasicBlocks(VE.BasicBlocks),
+      NumModuleValues(VE.NumModuleValues), NumModuleMDs(VE.NumModuleMDs),
+      NumMDStrings(VE.NumMDStrings),
+      FirstFuncConstantID(VE.FirstFuncConstantID),
+      FirstInstID(VE.FirstInstID) {}
+
 void ValueEnumerator::incorporateFunction(const Function &F) {
   InstructionCount = 0;
   NumModuleValues = Values.size();
@@ -134,10 +134,13 @@ private:
   unsigned FirstFuncConstantID;
   unsigned FirstInstID;
 
-  ValueEnumerator(const ValueEnumerator &) = delete;
   void operator=(const ValueEnumerator &) = delete;
 public:
   ValueEnumerator(const Module &M, bool ShouldPreserveUseListOrder);
+  /// Copies are only made to write function blocks concurrently: each thread
+  /// incorporates and purges functions in its own copy. The use-list orders
+  /// are not copied.
+  ValueEnumerator(const ValueEnumerator &VE);
 
   void dump() const;
   void print(raw_ostream &OS, const ValueMapType &Map, const char *Name) const;
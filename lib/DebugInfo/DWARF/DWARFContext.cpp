@@ -458,7 +458,36 @@ DWARFCompileUnit *DWARFContext::getCompileUnitForAddress(uint64_t Address) {
   // First, get the offset of the compile unit.
   uint32_t CUOffset = getDebugAranges()->findAddress(Address);
   // Retrieve the compile unit.
-  return getCompileUnitForOffset(CUOffset);
+  DWARFCompileUnit *CU = getCompileUnitForOffset(CUOffset);
+  if (CU && MaxParsedUnits)
+    touchParsedUnit(CU);
+  return CU;
+}
+
+void DWARFContext::setMaxParsedUnitsForAddressQueries(unsigned Max) {
+  MaxParsedUnits = Max;
+  if (!MaxParsedUnits) {
+    RecentUnits.clear();
+    return;
+  }
+  while (RecentUnits.size() > MaxParsedUnits) {
+    RecentUnits.front()->releaseDIEs();
+    RecentUnits.erase(RecentUnits.begin());
+  }
+}
+
+void DWARFContext::touchParsedUnit(DWARFCompileUnit *CU) {
+  auto It = std::find(RecentUnits.begin(), RecentUnits.end(), CU);
+  if (It != RecentUnits.end()) {
+    // Move the unit to the most recently used position.
+    std::rotate(It, It + 1, RecentUnits.end());
+    return;
+  }
+  RecentUnits.push_back(CU);
+  if (RecentUnits.size() > MaxParsedUnits) {
+    RecentUnits.front()->releaseDIEs();
+    RecentUnits.erase(RecentUnits.begin());
+  }
 }
 
 static bool getFunctionNameAndStartLineForAddress(DWARFCompileUnit *CU,
@@ -26,6 +26,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <set>
 #include <vector>
 
 using namespace llvm;
@@ -158,6 +159,8 @@ void DWARFUnit::clear() {
   AddrOffsetSectionBase = 0;
   clearDIEs(false);
   DWO.reset();
+  SubprogramRanges.clear();
+  SubprogramRangesBuilt = false;
 }
 
 const char *DWARFUnit::getCompilationDir() {
@@ -310,6 +313,11 @@ void DWARFUnit::clearDIEs(bool KeepCUDie) {
   }
 }
 
+void DWARFUnit::releaseDIEs() {
+  clearDIEs(true);
+  DWO.reset();
+}
+
 void DWARFUnit::collectAddressRanges(DWARFAddressRangesVector &CURanges) {
   DWARFDie UnitDie = getUnitDIE();
   if (!UnitDie)
@@ -343,17 +351,79 @@ void DWARFUnit::collectAddressRanges(DWARFAddressRangesVector &CURanges) {
     clearDIEs(true);
 }
 
+void DWARFUnit::buildSubprogramRanges() {
+  struct Endpoint {
+    uint64_t Address;
+    uint32_t DIEIndex;
+    bool IsRangeStart;
+
+    Endpoint(uint64_t Address, uint32_t DIEIndex, bool IsRangeStart)
+        : Address(Address), DIEIndex(DIEIndex), IsRangeStart(IsRangeStart) {}
+
+    bool operator<(const Endpoint &Other) const {
+      return Address < Other.Address;
+    }
+  };
+
+  std::vector<Endpoint> Endpoints;
+  for (uint32_t I = 0, E = DieArray.size(); I != E; ++I) {
+    DWARFDie DIE(this, &DieArray[I]);
+    if (!DIE.isSubprogramDIE())
+      continue;
+    for (const auto &R : DIE.getAddressRanges()) {
+      if (R.first >= R.second)
+        continue;
+      Endpoints.emplace_back(R.first, I, true);
+      Endpoints.emplace_back(R.second, I, false);
+    }
+  }
+
+  // Sweep over the endpoints the same way DWARFDebugAranges does. Where
+  // subprograms overlap (e.g. nested functions), the DIE that comes first
+  // wins, which is what a linear scan over DieArray would have returned.
+  std::multiset<uint32_t> ValidDIEs;
+  std::sort(Endpoints.begin(), Endpoints.end());
+  uint64_t PrevAddress = -1ULL;
+  for (const auto &E : Endpoints) {
+    if (PrevAddress < E.Address && !ValidDIEs.empty()) {
+      uint32_t DIEIndex = *ValidDIEs.begin();
+      if (!SubprogramRanges.empty() &&
+          SubprogramRanges.back().HighPC == PrevAddress &&
+          SubprogramRanges.back().DIEIndex == DIEIndex)
+        SubprogramRanges.back().HighPC = E.Address;
+      else
+        SubprogramRanges.emplace_back(PrevAddress, E.Address, DIEIndex);
+    }
+    if (E.IsRangeStart) {
+      ValidDIEs.insert(E.DIEIndex);
+    } else {
+      auto Pos = ValidDIEs.find(E.DIEIndex);
+      assert(Pos != ValidDIEs.end());
+      ValidDIEs.erase(Pos);
+    }
+    PrevAddress = E.Address;
+  }
+  assert(ValidDIEs.empty());
+  SubprogramRangesBuilt = true;
+}
+
 DWARFDie
 DWARFUnit::getSubprogramForAddress(uint64_t Address) {
   extractDIEsIfNeeded(false);
-  for (const DWARFDebugInfoEntry &D : DieArray) {
-    DWARFDie DIE(this, &D);
-    if (DIE.isSubprogramDIE() &&
-        DIE.addressRangeContainsAddress(Address)) {
-      return DIE;
-    }
-  }
-  return DWARFDie();
+  if (!SubprogramRangesBuilt)
+    buildSubprogramRanges();
+
+  auto It = std::upper_bound(
+      SubprogramRanges.begin(), SubprogramRanges.end(), Address,
+      [](uint64_t Address, const SubprogramRange &R) {
+        return Address < R.LowPC;
+      });
+  if (It == SubprogramRanges.begin())
+    return DWARFDie();
+  --It;
+  if (Address >= It->HighPC)
+    return DWARFDie();
+  return getDIEAtIndex(It->DIEIndex);
 }
 
 void
@@ -0,0 +1,438 @@
+//===- CachedSymbolizableModule.cpp ---------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Implementation of CachedSymbolizableModule class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CachedSymbolizableModule.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Object/COFF.h"
+#include "llvm/Object/MachO.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/COFF.h"
+#include "llvm/Support/Casting.h"
+#include "llvm/Support/DataExtractor.h"
+#include "llvm/Support/ELF.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace llvm;
+using namespace object;
+using namespace symbolize;
+
+namespace {
+
+// Bump the version whenever the layout below or the cache key changes.
+const char CacheMagic[8] = {'L', 'L', 'V', 'M', 'S', 'Y', 'M', 'C'};
+const uint32_t CacheVersion = 1;
+
+// All on-disk structures are little-endian and byte-aligned so that a mapped
+// file can be read in place.
+struct CacheHeader {
+  char Magic[8];
+  support::ulittle32_t Version;
+  support::ulittle32_t NumEntries;
+  support::ulittle32_t NumFrames;
+  support::ulittle32_t StringsSize;
+};
+
+struct CacheEntry {
+  support::ulittle64_t Address;
+  support::ulittle32_t Kind;
+  support::ulittle32_t FirstFrame;
+  support::ulittle32_t NumFrames;
+};
+
+struct CacheFrame {
+  support::ulittle32_t FunctionName;
+  support::ulittle32_t FileName;
+  support::ulittle32_t Line;
+  support::ulittle32_t Column;
+  support::ulittle32_t StartLine;
+  support::ulittle32_t Discriminator;
+};
+
+/// A view of a cache file in memory.
+struct CacheTable {
+  const CacheEntry *Entries = nullptr;
+  const CacheFrame *Frames = nullptr;
+  const char *Strings = nullptr;
+  uint32_t NumEntries = 0;
+  uint32_t NumFrames = 0;
+  uint32_t StringsSize = 0;
+
+  /// Points into \p Data. Returns false if it isn't a well-formed table.
+  bool init(StringRef Data);
+
+  /// Appends the frames of the entry for (\p Address, \p Kind) to \p Frames.
+  /// Returns false if there is no such entry.
+  bool lookup(uint64_t Address, uint32_t Kind,
+              SmallVectorImpl<DILineInfo> &Frames) const;
+};
+
+} // end anonymous namespace
+
+bool CacheTable::init(StringRef Data) {
+  if (Data.size() < sizeof(CacheHeader))
+    return false;
+  const auto *Header = reinterpret_cast<const CacheHeader *>(Data.data());
+  if (memcmp(Header->Magic, CacheMagic, sizeof(CacheMagic)) ||
+      Header->Version != CacheVersion)
+    return false;
+  uint64_t ExpectedSize = sizeof(CacheHeader) +
+                          uint64_t(Header->NumEntries) * sizeof(CacheEntry) +
+                          uint64_t(Header->NumFrames) * sizeof(CacheFrame) +
+                          Header->StringsSize;
+  if (Data.size() != ExpectedSize ||
+      (Header->StringsSize && Data.back() != '\0'))
+    return false;
+  NumEntries = Header->NumEntries;
+  NumFrames = Header->NumFrames;
+  StringsSize = Header->StringsSize;
+  Entries = reinterpret_cast<const CacheEntry *>(Data.data() +
+                                                 sizeof(CacheHeader));
+  Frames = reinterpret_cast<const CacheFrame *>(Entries + NumEntries);
+  Strings = reinterpret_cast<const char *>(Frames + NumFrames);
+  return true;
+}
+
+bool CacheTable::lookup(uint64_t Address, uint32_t Kind,
+                        SmallVectorImpl<DILineInfo> &Result) const {
+  auto Key = std::make_pair(Address, Kind);
+  const CacheEntry *E = std::lower_bound(
+      Entries, Entries + NumEntries, Key,
+      [](const CacheEntry &E, const std::pair<uint64_t, uint32_t> &Key) {
+        return std::make_pair(uint64_t(E.Address), uint32_t(E.Kind)) < Key;
+      });
+  if (E == Entries + NumEntries || E->Address != Address || E->Kind != Kind)
+    return false;
+  if (uint64_t(E->FirstFrame) + E->NumFrames > NumFrames)
+    return false;
+
+  auto GetString = [&](uint32_t Offset) {
+    return Offset < StringsSize ? StringRef(Strings + Offset) : StringRef();
+  };
+  for (const CacheFrame &F : makeArrayRef(Frames + E->FirstFrame,
+                                          E->NumFrames)) {
+    DILineInfo Frame;
+    Frame.FunctionName = GetString(F.FunctionName);
+    Frame.FileName = GetString(F.FileName);
+    Frame.Line = F.Line;
+    Frame.Column = F.Column;
+    Frame.StartLine = F.StartLine;
+    Frame.Discriminator = F.Discriminator;
+    Result.push_back(std::move(Frame));
+  }
+  return true;
+}
+
+/// Returns the GNU build ID of an ELF object, or the UUID of a Mach-O object.
+static ArrayRef<uint8_t> getBuildID(const ObjectFile &Obj) {
+  if (auto *MachO = dyn_cast<MachOObjectFile>(&Obj))
+    return MachO->getUuid();
+  if (!Obj.isELF())
+    return ArrayRef<uint8_t>();
+  for (const SectionRef &Section : Obj.sections()) {
+    StringRef Name;
+    StringRef Data;
+    if (Section.getName(Name) || Name != ".note.gnu.build-id" ||
+        Section.getContents(Data))
+      continue;
+    DataExtractor Extractor(Data, Obj.isLittleEndian(), 0);
+    uint32_t Offset = 0;
+    uint32_t NameSize = Extractor.getU32(&Offset);
+    uint32_t DescSize = Extractor.getU32(&Offset);
+    uint32_t Type = Extractor.getU32(&Offset);
+    uint64_t DescOffset = Offset + alignTo(NameSize, 4);
+    if (Type != ELF::NT_GNU_BUILD_ID || DescOffset + DescSize > Data.size())
+      continue;
+    return ArrayRef<uint8_t>(
+        reinterpret_cast<const uint8_t *>(Data.data()) + DescOffset, DescSize);
+  }
+  return ArrayRef<uint8_t>();
+}
+
+static void hashField(MD5 &Hash, StringRef Field) {
+  Hash.update(Field);
+  Hash.update(StringRef("\0", 1));
+}
+
+static void hashObject(MD5 &Hash, const ObjectFile &Obj) {
+  Hash.update(getBuildID(Obj));
+  hashField(Hash, "");
+  SmallString<128> Path(Obj.getFileName());
+  sys::fs::make_absolute(Path);
+  hashField(Hash, Path);
+  sys::fs::file_status Status;
+  if (!sys::fs::status(Path, Status)) {
+    hashField(Hash, utostr(Status.getSize()));
+    hashField(Hash, utostr(Status.getLastModificationTime()
+                               .time_since_epoch()
+                               .count()));
+  }
+}
+
+std::string CachedSymbolizableModule::getCachePath(
+    StringRef CacheDir, const ObjectFile &Obj, const ObjectFile &DebugObj,
+    StringRef ArchName, FunctionNameKind FNKind, bool UseSymbolTable) {
+  MD5 Hash;
+  hashField(Hash, utostr(CacheVersion));
+  hashObject(Hash, Obj);
+  if (&DebugObj != &Obj)
+    hashObject(Hash, DebugObj);
+  hashField(Hash, ArchName);
+  hashField(Hash, utostr(static_cast<unsigned>(FNKind)));
+  hashField(Hash, UseSymbolTable ? "1" : "0");
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Key;
+  MD5::stringifyResult(Result, Key);
+
+  SmallString<128> Path(CacheDir);
+  sys::path::append(Path, Twine(Key) + ".symcache");
+  return Path.str();
+}
+
+CachedSymbolizableModule::CachedSymbolizableModule(std::string CachePath,
+                                                   const ObjectFile &Obj,
+                                                   ModuleFactory CreateModule)
+    : CachePath(std::move(CachePath)), IsWin32Module(false), PreferredBase(0),
+      CreateModule(std::move(CreateModule)), ModuleError(Error::success()) {
+  // These mirror SymbolizableObjectFile and only need the object headers.
+  if (auto *CoffObject = dyn_cast<COFFObjectFile>(&Obj)) {
+    IsWin32Module =
+        CoffObject->getMachine() == COFF::IMAGE_FILE_MACHINE_I386;
+    PreferredBase = CoffObject->getImageBase();
+  }
+
+  auto BufferOrErr = MemoryBuffer::getFile(this->CachePath, -1,
+                                           /*RequiresNullTerminator=*/false);
+  if (!BufferOrErr)
+    return;
+  // A malformed or truncated file is ignored and overwritten on exit.
+  CacheTable Table;
+  if (Table.init((*BufferOrErr)->getBuffer()))
+    Buffer = std::move(*BufferOrErr);
+}
+
+CachedSymbolizableModule::~CachedSymbolizableModule() {
+  writeCache();
+  consumeError(std::move(ModuleError));
+}
+
+bool CachedSymbolizableModule::lookup(
+    uint64_t Address, QueryKind Kind,
+    SmallVectorImpl<DILineInfo> &Frames) const {
+  auto I = NewEntries.find(std::make_pair(Address, Kind));
+  if (I != NewEntries.end()) {
+    Frames.append(I->second.begin(), I->second.end());
+    return true;
+  }
+  CacheTable Table;
+  return Buffer && Table.init(Buffer->getBuffer()) &&
+         Table.lookup(Address, Kind, Frames);
+}
+
+const SymbolizableModule *CachedSymbolizableModule::getModule() const {
+  if (!ModuleCreated) {
+    ModuleCreated = true;
+    auto ModuleOrErr = CreateModule();
+    if (ModuleOrErr) {
+      Module = std::move(*ModuleOrErr);
+    } else {
+      // The success value ModuleError starts with has to be checked before
+      // it is overwritten.
+      consumeError(std::move(ModuleError));
+      ModuleError = ModuleOrErr.takeError();
+    }
+  }
+  return Module.get();
+}
+
+Error CachedSymbolizableModule::takeModuleError() {
+  return std::move(ModuleError);
+}
+
+DILineInfo CachedSymbolizableModule::symbolizeCode(uint64_t ModuleOffset,
+                                                   FunctionNameKind FNKind,
+                                                   bool UseSymbolTable) const {
+  SmallVector<DILineInfo, 1> Frames;
+  if (lookup(ModuleOffset, QK_Code, Frames) && Frames.size() == 1)
+    return Frames[0];
+
+  const SymbolizableModule *M = getModule();
+  if (!M)
+    return DILineInfo();
+  DILineInfo LineInfo = M->symbolizeCode(ModuleOffset, FNKind, UseSymbolTable);
+  NewEntries[std::make_pair(ModuleOffset, uint32_t(QK_Code))] = {LineInfo};
+  return LineInfo;
+}
+
+DIInliningInfo CachedSymbolizableModule::symbolizeInlinedCode(
+    uint64_t ModuleOffset, FunctionNameKind FNKind, bool UseSymbolTable) const {
+  SmallVector<DILineInfo, 4> Frames;
+  DIInliningInfo InlinedContext;
+  if (lookup(ModuleOffset, QK_InlinedCode, Frames)) {
+    for (const DILineInfo &Frame : Frames)
+      InlinedContext.addFrame(Frame);
+    return InlinedContext;
+  }
+
+  const SymbolizableModule *M = getModule();
+  if (!M) {
+    InlinedContext.addFrame(DILineInfo());
+    return InlinedContext;
+  }
+  InlinedContext =
+      M->symbolizeInlinedCode(ModuleOffset, FNKind, UseSymbolTable);
+  auto &Entry =
+      NewEntries[std::make_pair(ModuleOffset, uint32_t(QK_InlinedCode))];
+  for (uint32_t I = 0, N = InlinedContext.getNumberOfFrames(); I != N; ++I)
+    Entry.push_back(InlinedContext.getFrame(I));
+  return InlinedContext;
+}
+
+DIGlobal CachedSymbolizableModule::symbolizeData(uint64_t ModuleOffset) const {
+  // Data lookups only consult the symbol table and are not cached.
+  if (const SymbolizableModule *M = getModule())
+    return M->symbolizeData(ModuleOffset);
+  return DIGlobal();
+}
+
+/// Adds the entries of \p Table that are not in \p AllEntries to it.
+static void
+mergeTable(const CacheTable &Table,
+           std::map<std::pair<uint64_t, uint32_t>, std::vector<DILineInfo>>
+               &AllEntries) {
+  for (const CacheEntry &E : makeArrayRef(Table.Entries, Table.NumEntries)) {
+    auto Key = std::make_pair(uint64_t(E.Address), uint32_t(E.Kind));
+    if (AllEntries.count(Key))
+      continue;
+    SmallVector<DILineInfo, 4> Frames;
+    if (Table.lookup(Key.first, Key.second, Frames))
+      AllEntries.insert(std::make_pair(
+          Key, std::vector<DILineInfo>(Frames.begin(), Frames.end())));
+  }
+}
+
+void CachedSymbolizableModule::writeCache() const {
+  if (NewEntries.empty())
+    return;
+
+  // Other symbolizers may have updated the cache file since it was mapped.
+  // Hold its lock file while merging with its current contents and replacing
+  // it, so that their results are kept. Failures are ignored: the cache is
+  // only an optimization.
+  sys::fs::create_directories(sys::path::parent_path(CachePath));
+  while (true) {
+    LockFileManager Lock(CachePath);
+    switch (Lock) {
+    case LockFileManager::LFS_Error:
+      return;
+    case LockFileManager::LFS_Shared:
+      // Try again once the owner is done, or after removing the lock file of
+      // an owner that died.
+      if (Lock.waitForUnlock() == LockFileManager::Res_Timeout)
+        return;
+      continue;
+    case LockFileManager::LFS_Owned:
+      writeCacheLocked();
+      return;
+    }
+  }
+}
+
+void CachedSymbolizableModule::writeCacheLocked() const {
+  // Merge the entries on disk, then the ones mapped when this module was
+  // created in case the file was removed since, with the ones computed in
+  // this session.
+  auto AllEntries = NewEntries;
+  CacheTable Table;
+  auto BufferOrErr = MemoryBuffer::getFile(CachePath, -1,
+                                           /*RequiresNullTerminator=*/false);
+  if (BufferOrErr && Table.init((*BufferOrErr)->getBuffer()))
+    mergeTable(Table, AllEntries);
+  if (Buffer && Table.init(Buffer->getBuffer()))
+    mergeTable(Table, AllEntries);
+
+  std::string Strings;
+  StringMap<uint32_t> StringOffsets;
+  auto AddString = [&](StringRef S) -> uint32_t {
+    auto R = StringOffsets.insert(std::make_pair(S, Strings.size()));
+    if (R.second) {
+      Strings += S;
+      Strings.push_back('\0');
+    }
+    return R.first->second;
+  };
+
+  std::vector<CacheEntry> Entries;
+  std::vector<CacheFrame> Frames;
+  Entries.reserve(AllEntries.size());
+  for (const auto &KV : AllEntries) {
+    CacheEntry E;
+    E.Address = KV.first.first;
+    E.Kind = KV.first.second;
+    E.FirstFrame = Frames.size();
+    E.NumFrames = KV.second.size();
+    Entries.push_back(E);
+    for (const DILineInfo &Info : KV.second) {
+      CacheFrame F;
+      F.FunctionName = AddString(Info.FunctionName);
+      F.FileName = AddString(Info.FileName);
+      F.Line = Info.Line;
+      F.Column = Info.Column;
+      F.StartLine = Info.StartLine;
+      F.Discriminator = Info.Discriminator;
+      Frames.push_back(F);
+    }
+  }
+
+  CacheHeader Header;
+  memcpy(Header.Magic, CacheMagic, sizeof(CacheMagic));
+  Header.Version = CacheVersion;
+  Header.NumEntries = Entries.size();
+  Header.NumFrames = Frames.size();
+  Header.StringsSize = Strings.size();
+
+  // Write to a temporary file and rename it over the cache, so concurrent
+  // readers never observe a partially written table.
+  SmallString<128> TempPath;
+  int FD;
+  if (sys::fs::createUniqueFile(CachePath + ".tmp-%%%%%%", FD, TempPath))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+    OS.write(reinterpret_cast<const char *>(Entries.data()),
+             Entries.size() * sizeof(CacheEntry));
+    OS.write(reinterpret_cast<const char *>(Frames.data()),
+             Frames.size() * sizeof(CacheFrame));
+    OS << Strings;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath);
+      return;
+    }
+  }
+  if (sys::fs::rename(TempPath, CachePath))
+    sys::fs::remove(TempPath);
+}
@@ -0,0 +1,118 @@
+//===- CachedSymbolizableModule.h -------------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the CachedSymbolizableModule class, which answers
+// symbolization queries from a persistent on-disk table and only falls back
+// to parsing debug info for addresses it has not seen before.
+//
+//===----------------------------------------------------------------------===//
+#ifndef LLVM_LIB_DEBUGINFO_SYMBOLIZE_CACHEDSYMBOLIZABLEMODULE_H
+#define LLVM_LIB_DEBUGINFO_SYMBOLIZE_CACHEDSYMBOLIZABLEMODULE_H
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/DebugInfo/DIContext.h"
+#include "llvm/DebugInfo/Symbolize/SymbolizableModule.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+
+namespace object {
+class ObjectFile;
+}
+
+namespace symbolize {
+
+/// A SymbolizableModule that memoizes code symbolization results in a file.
+///
+/// The cache file is a sorted table of (address, query kind) entries, each
+/// pointing to a run of frames whose strings live in a shared string table.
+/// It is mapped read-only when the module is created; results for addresses
+/// that are not in it are computed by the underlying module, which is only
+/// created on the first miss, and the merged table is written back (through
+/// a temporary file and a rename) when this object is destroyed. Writers
+/// hold a lock file while they merge their results with the table currently
+/// on disk, so that concurrent symbolizers don't drop each other's results.
+class CachedSymbolizableModule : public SymbolizableModule {
+public:
+  typedef std::function<Expected<std::unique_ptr<SymbolizableModule>>()>
+      ModuleFactory;
+
+  /// Returns the path of the cache file for the given object files and
+  /// symbolization options inside \p CacheDir. The key covers the build ID
+  /// (or Mach-O UUID), path, size and modification time of both objects, so
+  /// a rebuilt binary never picks up stale results.
+  static std::string getCachePath(StringRef CacheDir,
+                                  const object::ObjectFile &Obj,
+                                  const object::ObjectFile &DebugObj,
+                                  StringRef ArchName, FunctionNameKind FNKind,
+                                  bool UseSymbolTable);
+
+  CachedSymbolizableModule(std::string CachePath,
+                           const object::ObjectFile &Obj,
+                           ModuleFactory CreateModule);
+  ~CachedSymbolizableModule() override;
+
+  DILineInfo symbolizeCode(uint64_t ModuleOffset, FunctionNameKind FNKind,
+                           bool UseSymbolTable) const override;
+  DIInliningInfo symbolizeInlinedCode(uint64_t ModuleOffset,
+                                      FunctionNameKind FNKind,
+                                      bool UseSymbolTable) const override;
+  DIGlobal symbolizeData(uint64_t ModuleOffset) const override;
+
+  /// Returns the error the underlying module failed to be created with, if
+  /// the last query missed the cache and this happened. Queries that miss
+  /// the cache return empty results in that case, and the error is only
+  /// returned once.
+  Error takeModuleError();
+
+  bool isWin32Module() const override { return IsWin32Module; }
+  uint64_t getModulePreferredBase() const override { return PreferredBase; }
+
+private:
+  enum QueryKind : uint32_t { QK_Code = 0, QK_InlinedCode = 1 };
+
+  bool lookup(uint64_t Address, QueryKind Kind,
+              SmallVectorImpl<DILineInfo> &Frames) const;
+  const SymbolizableModule *getModule() const;
+  void writeCache() const;
+  /// Merges and writes the cache file, while holding its lock file.
+  void writeCacheLocked() const;
+
+  std::string CachePath;
+  bool IsWin32Module;
+  uint64_t PreferredBase;
+
+  /// The mapped cache file, or null if it did not exist or was malformed.
+  std::unique_ptr<MemoryBuffer> Buffer;
+
+  /// Results computed in this session that are not in the file yet.
+  mutable std::map<std::pair<uint64_t, uint32_t>, std::vector<DILineInfo>>
+      NewEntries;
+
+  ModuleFactory CreateModule;
+  mutable std::unique_ptr<SymbolizableModule> Module;
+  mutable bool ModuleCreated = false;
+  /// The error CreateModule failed with, until takeModuleError() is called.
+  mutable Error ModuleError;
+};
+
+} // end namespace symbolize
+
+} // end namespace llvm
+
+#endif // LLVM_LIB_DEBUGINFO_SYMBOLIZE_CACHEDSYMBOLIZABLEMODULE_H
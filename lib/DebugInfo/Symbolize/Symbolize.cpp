@@ -13,8 +13,10 @@
 
 #include "llvm/DebugInfo/Symbolize/Symbolize.h"
 
+#include "CachedSymbolizableModule.h"
 #include "SymbolizableObjectFile.h"
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Config/config.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
@@ -32,10 +34,12 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
+#include <thread>
 
 #if defined(_MSC_VER)
 #include <Windows.h>
@@ -64,15 +68,9 @@ Expected<DILineInfo> LLVMSymbolizer::symbolizeCode(const std::string &ModuleName
   if (!Info)
     return DILineInfo();
 
-  // If the user is giving us relative addresses, add the preferred base of the
-  // object to the offset before we do the query. It's what DIContext expects.
-  if (Opts.RelativeAddresses)
-    ModuleOffset += Info->getModulePreferredBase();
-
-  DILineInfo LineInfo = Info->symbolizeCode(ModuleOffset, Opts.PrintFunctions,
-                                            Opts.UseSymbolTable);
-  if (Opts.Demangle)
-    LineInfo.FunctionName = DemangleName(LineInfo.FunctionName, Info);
+  DILineInfo LineInfo = symbolizeCodeInModule(*Info, ModuleOffset);
+  if (Error E = takeModuleError(*Info))
+    return std::move(E);
   return LineInfo;
 }
 
@@ -90,22 +88,135 @@ LLVMSymbolizer::symbolizeInlinedCode(const std::string &ModuleName,
   if (!Info)
     return DIInliningInfo();
 
+  DIInliningInfo InlinedContext =
+      symbolizeInlinedCodeInModule(*Info, ModuleOffset);
+  if (Error E = takeModuleError(*Info))
+    return std::move(E);
+  return InlinedContext;
+}
+
+DILineInfo LLVMSymbolizer::symbolizeCodeInModule(SymbolizableModule &Info,
+                                                 uint64_t ModuleOffset) const {
   // If the user is giving us relative addresses, add the preferred base of the
   // object to the offset before we do the query. It's what DIContext expects.
   if (Opts.RelativeAddresses)
-    ModuleOffset += Info->getModulePreferredBase();
+    ModuleOffset += Info.getModulePreferredBase();
+
+  DILineInfo LineInfo = Info.symbolizeCode(ModuleOffset, Opts.PrintFunctions,
+                                           Opts.UseSymbolTable);
+  if (Opts.Demangle)
+    LineInfo.FunctionName = DemangleName(LineInfo.FunctionName, &Info);
+  return LineInfo;
+}
 
-  DIInliningInfo InlinedContext = Info->symbolizeInlinedCode(
+DIInliningInfo
+LLVMSymbolizer::symbolizeInlinedCodeInModule(SymbolizableModule &Info,
+                                             uint64_t ModuleOffset) const {
+  // If the user is giving us relative addresses, add the preferred base of the
+  // object to the offset before we do the query. It's what DIContext expects.
+  if (Opts.RelativeAddresses)
+    ModuleOffset += Info.getModulePreferredBase();
+
+  DIInliningInfo InlinedContext = Info.symbolizeInlinedCode(
       ModuleOffset, Opts.PrintFunctions, Opts.UseSymbolTable);
   if (Opts.Demangle) {
     for (int i = 0, n = InlinedContext.getNumberOfFrames(); i < n; i++) {
       auto *Frame = InlinedContext.getMutableFrame(i);
-      Frame->FunctionName = DemangleName(Frame->FunctionName, Info);
+      Frame->FunctionName = DemangleName(Frame->FunctionName, &Info);
     }
   }
   return InlinedContext;
 }
 
+template <typename ResultTy, typename SymbolizeFnTy>
+std::vector<Expected<ResultTy>>
+LLVMSymbolizer::symbolizeBatch(ArrayRef<BatchRequest> Requests,
+                               unsigned ThreadCount, SymbolizeFnTy Symbolize) {
+  // Load the modules serially and in request order: the lookup tables in this
+  // class are not thread-safe, and a module that fails to load reports its
+  // error on the first request that names it, as with one-by-one queries.
+  std::map<size_t, Error> LoadErrors;
+  DenseMap<SymbolizableModule *, unsigned> ModuleIndex;
+  std::vector<std::pair<SymbolizableModule *, std::vector<size_t>>> Work;
+  for (size_t I = 0, E = Requests.size(); I != E; ++I) {
+    auto InfoOrErr = getOrCreateModuleInfo(Requests[I].first);
+    if (!InfoOrErr) {
+      LoadErrors.insert(std::make_pair(I, InfoOrErr.takeError()));
+      continue;
+    }
+    SymbolizableModule *Info = InfoOrErr.get();
+    if (!Info)
+      continue;
+    auto Inserted = ModuleIndex.insert(std::make_pair(Info, Work.size()));
+    if (Inserted.second)
+      Work.emplace_back(Info, std::vector<size_t>());
+    Work[Inserted.first->second].second.push_back(I);
+  }
+
+  // Each module is owned by a single task, which resolves its addresses in
+  // ascending order so that consecutive lookups hit the same compile unit.
+  // A cached module that fails to load its debug info reports the error on
+  // the first of its requests that misses the cache, in address order.
+  std::vector<ResultTy> Values(Requests.size());
+  std::vector<std::map<size_t, Error>> QueryErrors(Work.size());
+  {
+    ThreadPool Pool(ThreadCount
+                        ? ThreadCount
+                        : std::max(1u, std::thread::hardware_concurrency()));
+    for (size_t W = 0, E = Work.size(); W != E; ++W) {
+      Pool.async([this, &Requests, &Values, &Symbolize, &Work, &QueryErrors,
+                  W]() {
+        SymbolizableModule &Info = *Work[W].first;
+        std::vector<size_t> &Indices = Work[W].second;
+        std::stable_sort(Indices.begin(), Indices.end(),
+                         [&Requests](size_t LHS, size_t RHS) {
+                           return Requests[LHS].second < Requests[RHS].second;
+                         });
+        for (size_t I : Indices) {
+          Values[I] = Symbolize(Info, Requests[I].second);
+          if (Error E = takeModuleError(Info))
+            QueryErrors[W].insert(std::make_pair(I, std::move(E)));
+        }
+      });
+    }
+    Pool.wait();
+  }
+  for (auto &Errors : QueryErrors)
+    for (auto &KV : Errors)
+      LoadErrors.insert(std::make_pair(KV.first, std::move(KV.second)));
+
+  std::vector<Expected<ResultTy>> Results;
+  Results.reserve(Requests.size());
+  for (size_t I = 0, E = Requests.size(); I != E; ++I) {
+    auto It = LoadErrors.find(I);
+    if (It != LoadErrors.end())
+      Results.push_back(std::move(It->second));
+    else
+      Results.push_back(std::move(Values[I]));
+  }
+  return Results;
+}
+
+std::vector<Expected<DILineInfo>>
+LLVMSymbolizer::symbolizeCodeBatch(ArrayRef<BatchRequest> Requests,
+                                   unsigned ThreadCount) {
+  return symbolizeBatch<DILineInfo>(
+      Requests, ThreadCount,
+      [this](SymbolizableModule &Info, uint64_t ModuleOffset) {
+        return symbolizeCodeInModule(Info, ModuleOffset);
+      });
+}
+
+std::vector<Expected<DIInliningInfo>>
+LLVMSymbolizer::symbolizeInlinedCodeBatch(ArrayRef<BatchRequest> Requests,
+                                          unsigned ThreadCount) {
+  return symbolizeBatch<DIInliningInfo>(
+      Requests, ThreadCount,
+      [this](SymbolizableModule &Info, uint64_t ModuleOffset) {
+        return symbolizeInlinedCodeInModule(Info, ModuleOffset);
+      });
+}
+
 Expected<DIGlobal> LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
                                                  uint64_t ModuleOffset) {
   SymbolizableModule *Info;
@@ -126,16 +237,20 @@ Expected<DIGlobal> LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
     ModuleOffset += Info->getModulePreferredBase();
 
   DIGlobal Global = Info->symbolizeData(ModuleOffset);
+  if (Error E = takeModuleError(*Info))
+    return std::move(E);
   if (Opts.Demangle)
     Global.Name = DemangleName(Global.Name, Info);
   return Global;
 }
 
 void LLVMSymbolizer::flush() {
+  // Modules go first: a cached module writes its results out on destruction.
+  CachedModules.clear();
+  Modules.clear();
   ObjectForUBPathAndArch.clear();
   BinaryForPath.clear();
   ObjectPairForPathArch.clear();
-  Modules.clear();
 }
 
 namespace {
@@ -387,6 +502,41 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
   }
   ObjectPair Objects = ObjectsOrErr.get();
 
+  std::unique_ptr<SymbolizableModule> SymMod;
+  if (!Opts.CacheDir.empty()) {
+    // Debug info is only parsed if the cache misses.
+    std::string CachePath = CachedSymbolizableModule::getCachePath(
+        Opts.CacheDir, *Objects.first, *Objects.second, ArchName,
+        Opts.PrintFunctions, Opts.UseSymbolTable);
+    auto CachedMod = llvm::make_unique<CachedSymbolizableModule>(
+        std::move(CachePath), *Objects.first,
+        [this, Objects]() { return createModuleInfo(Objects); });
+    CachedModules[CachedMod.get()] = CachedMod.get();
+    SymMod = std::move(CachedMod);
+  } else {
+    auto InfoOrErr = createModuleInfo(Objects);
+    if (!InfoOrErr) {
+      Modules.insert(
+          std::make_pair(ModuleName, std::unique_ptr<SymbolizableModule>()));
+      return InfoOrErr.takeError();
+    }
+    SymMod = std::move(InfoOrErr.get());
+  }
+  auto InsertResult =
+      Modules.insert(std::make_pair(ModuleName, std::move(SymMod)));
+  assert(InsertResult.second);
+  return InsertResult.first->second.get();
+}
+
+Error LLVMSymbolizer::takeModuleError(SymbolizableModule &Info) const {
+  auto I = CachedModules.find(&Info);
+  if (I == CachedModules.end())
+    return Error::success();
+  return I->second->takeModuleError();
+}
+
+Expected<std::unique_ptr<SymbolizableModule>>
+LLVMSymbolizer::createModuleInfo(ObjectPair Objects) {
   std::unique_ptr<DIContext> Context;
   // If this is a COFF object containing PDB info, use a PDBContext to
   // symbolize. Otherwise, use DWARF.
@@ -398,28 +548,24 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
       using namespace pdb;
       std::unique_ptr<IPDBSession> Session;
       if (auto Err = loadDataForEXE(PDB_ReaderType::DIA,
-                                    Objects.first->getFileName(), Session)) {
-        Modules.insert(
-            std::make_pair(ModuleName, std::unique_ptr<SymbolizableModule>()));
+                                    Objects.first->getFileName(), Session))
         return std::move(Err);
-      }
       Context.reset(new PDBContext(*CoffObject, std::move(Session)));
     }
   }
-  if (!Context)
-    Context.reset(new DWARFContextInMemory(*Objects.second));
+  if (!Context) {
+    auto DICtx = llvm::make_unique<DWARFContextInMemory>(*Objects.second);
+    // Each query looks up a single unit by address, so releasing the DIEs of
+    // the other units doesn't invalidate the ones it uses.
+    DICtx->setMaxParsedUnitsForAddressQueries(Opts.MaxParsedUnits);
+    Context = std::move(DICtx);
+  }
   assert(Context);
   auto InfoOrErr =
       SymbolizableObjectFile::create(Objects.first, std::move(Context));
-  std::unique_ptr<SymbolizableModule> SymMod;
-  if (InfoOrErr)
-    SymMod = std::move(InfoOrErr.get());
-  auto InsertResult =
-      Modules.insert(std::make_pair(ModuleName, std::move(SymMod)));
-  assert(InsertResult.second);
   if (auto EC = InfoOrErr.getError())
     return errorCodeToError(EC);
-  return InsertResult.first->second.get();
+  return std::unique_ptr<SymbolizableModule>(std::move(InfoOrErr.get()));
 }
 
 namespace {
@@ -286,6 +286,9 @@ Constant *Constant::getAggregateElement(Constant *Elt) const {
 }
 
 void Constant::destroyConstant() {
+  // Dropping the operands updates use lists shared with constant creation.
+  std::lock_guard<UniquingLock> Guard(getContext().pImpl->ConstantsLock);
+
   /// First call destroyConstantImpl on the subclass.  This gives the subclass
   /// a chance to remove the constant from any maps/pools it's contained in.
   switch (getValueID()) {
@@ -537,6 +540,7 @@ Constant *ConstantInt::getFalse(Type *Ty) {
 ConstantInt *ConstantInt::get(LLVMContext &Context, const APInt &V) {
   // get an existing value or the insertion position
   LLVMContextImpl *pImpl = Context.pImpl;
+  std::lock_guard<UniquingLock> Guard(pImpl->IntConstantsLock);
   std::unique_ptr<ConstantInt> &Slot = pImpl->IntConstants[V];
   if (!Slot) {
     // Get the corresponding integer type for the bit width of the value.
@@ -677,6 +681,7 @@ Constant *ConstantFP::getZeroValueForNegation(Type *Ty) {
 ConstantFP* ConstantFP::get(LLVMContext &Context, const APFloat& V) {
   LLVMContextImpl* pImpl = Context.pImpl;
 
+  std::lock_guard<UniquingLock> Guard(pImpl->FPConstantsLock);
   std::unique_ptr<ConstantFP> &Slot = pImpl->FPConstants[V];
 
   if (!Slot) {
@@ -1036,6 +1041,7 @@ Constant *ConstantVector::getSplat(unsigned NumElts, Constant *V) {
 
 ConstantTokenNone *ConstantTokenNone::get(LLVMContext &Context) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  std::lock_guard<UniquingLock> Guard(pImpl->UVConstantsLock);
   if (!pImpl->TheNoneToken)
     pImpl->TheNoneToken.reset(new ConstantTokenNone(Context));
   return pImpl->TheNoneToken.get();
@@ -1247,8 +1253,9 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
   assert((Ty->isStructTy() || Ty->isArrayTy() || Ty->isVectorTy()) &&
          "Cannot create an aggregate zero of non-aggregate type!");
 
-  std::unique_ptr<ConstantAggregateZero> &Entry =
-      Ty->getContext().pImpl->CAZConstants[Ty];
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  std::lock_guard<UniquingLock> Guard(pImpl->CAZConstantsLock);
+  std::unique_ptr<ConstantAggregateZero> &Entry = pImpl->CAZConstants[Ty];
   if (!Entry)
     Entry.reset(new ConstantAggregateZero(Ty));
 
@@ -1257,7 +1264,9 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
 
 /// Remove the constant from the constant table.
 void ConstantAggregateZero::destroyConstantImpl() {
-  getContext().pImpl->CAZConstants.erase(getType());
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  std::lock_guard<UniquingLock> Guard(pImpl->CAZConstantsLock);
+  pImpl->CAZConstants.erase(getType());
 }
 
 /// Remove the constant from the constant table.
@@ -1313,8 +1322,9 @@ const APInt &Constant::getUniqueInteger() const {
 //
 
 ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
-  std::unique_ptr<ConstantPointerNull> &Entry =
-      Ty->getContext().pImpl->CPNConstants[Ty];
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  std::lock_guard<UniquingLock> Guard(pImpl->CPNConstantsLock);
+  std::unique_ptr<ConstantPointerNull> &Entry = pImpl->CPNConstants[Ty];
   if (!Entry)
     Entry.reset(new ConstantPointerNull(Ty));
 
@@ -1323,11 +1333,15 @@ ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
 
 /// Remove the constant from the constant table.
 void ConstantPointerNull::destroyConstantImpl() {
-  getContext().pImpl->CPNConstants.erase(getType());
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  std::lock_guard<UniquingLock> Guard(pImpl->CPNConstantsLock);
+  pImpl->CPNConstants.erase(getType());
 }
 
 UndefValue *UndefValue::get(Type *Ty) {
-  std::unique_ptr<UndefValue> &Entry = Ty->getContext().pImpl->UVConstants[Ty];
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  std::lock_guard<UniquingLock> Guard(pImpl->UVConstantsLock);
+  std::unique_ptr<UndefValue> &Entry = pImpl->UVConstants[Ty];
   if (!Entry)
     Entry.reset(new UndefValue(Ty));
 
@@ -1337,7 +1351,9 @@ UndefValue *UndefValue::get(Type *Ty) {
 /// Remove the constant from the constant table.
 void UndefValue::destroyConstantImpl() {
   // Free the constant and any dangling references to it.
-  getContext().pImpl->UVConstants.erase(getType());
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  std::lock_guard<UniquingLock> Guard(pImpl->UVConstantsLock);
+  pImpl->UVConstants.erase(getType());
 }
 
 BlockAddress *BlockAddress::get(BasicBlock *BB) {
@@ -1346,6 +1362,7 @@ BlockAddress *BlockAddress::get(BasicBlock *BB) {
 }
 
 BlockAddress *BlockAddress::get(Function *F, BasicBlock *BB) {
+  std::lock_guard<UniquingLock> Guard(F->getContext().pImpl->ConstantsLock);
   BlockAddress *&BA =
     F->getContext().pImpl->BlockAddresses[std::make_pair(F, BB)];
   if (!BA)
@@ -1369,6 +1386,7 @@ BlockAddress *BlockAddress::lookup(const BasicBlock *BB) {
 
   const Function *F = BB->getParent();
   assert(F && "Block must have a parent");
+  std::lock_guard<UniquingLock> Guard(F->getContext().pImpl->ConstantsLock);
   BlockAddress *BA =
       F->getContext().pImpl->BlockAddresses.lookup(std::make_pair(F, BB));
   assert(BA && "Refcount and block address map disagree!");
@@ -1383,6 +1401,7 @@ void BlockAddress::destroyConstantImpl() {
 }
 
 Value *BlockAddress::handleOperandChangeImpl(Value *From, Value *To) {
+  std::lock_guard<UniquingLock> Guard(getContext().pImpl->ConstantsLock);
   // This could be replacing either the Basic Block or the Function.  In either
   // case, we have to remove the map entry.
   Function *NewF = getFunction();
@@ -2341,10 +2360,10 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
     return ConstantAggregateZero::get(Ty);
 
   // Do a lookup to see if we have already formed one of these.
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  std::lock_guard<UniquingLock> Guard(pImpl->CDSConstantsLock);
   auto &Slot =
-      *Ty->getContext()
-           .pImpl->CDSConstants.insert(std::make_pair(Elements, nullptr))
-           .first;
+      *pImpl->CDSConstants.insert(std::make_pair(Elements, nullptr)).first;
 
   // The bucket can point to a linked list of different CDS's that have the same
   // body but different types.  For example, 0,0,0,1 could be a 4 element array
@@ -2367,8 +2386,9 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
 
 void ConstantDataSequential::destroyConstantImpl() {
   // Remove the constant from the StringMap.
-  StringMap<ConstantDataSequential*> &CDSConstants = 
-    getType()->getContext().pImpl->CDSConstants;
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  std::lock_guard<UniquingLock> Guard(pImpl->CDSConstantsLock);
+  StringMap<ConstantDataSequential*> &CDSConstants = pImpl->CDSConstants;
 
   StringMap<ConstantDataSequential*>::iterator Slot =
     CDSConstants.find(getRawDataValues());
@@ -2382,7 +2402,7 @@ void ConstantDataSequential::destroyConstantImpl() {
     // If there is only one value in the bucket (common case) it must be this
     // entry, and removing the entry should remove the bucket completely.
     assert((*Entry) == this && "Hash mismatch in ConstantDataSequential");
-    getContext().pImpl->CDSConstants.erase(Slot);
+    CDSConstants.erase(Slot);
   } else {
     // Otherwise, there are multiple entries linked off the bucket, unlink the 
     // node we care about but keep the bucket around.
@@ -22,6 +22,7 @@
 #include "llvm/ADT/None.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
+#include "UniquingLock.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/InlineAsm.h"
@@ -647,8 +648,14 @@ public:
 
 private:
   MapTy Map;
+  /// Guards Map when the context is in thread-safe uniquing mode. It is
+  /// shared by all the maps of a context, as creating a constant adds uses to
+  /// its operands, which may be constants of any other map.
+  UniquingLock &Lock;
 
 public:
+  explicit ConstantUniqueMap(UniquingLock &Lock) : Lock(Lock) {}
+
   typename MapTy::iterator begin() { return Map.begin(); }
   typename MapTy::iterator end() { return Map.end(); }
 
@@ -676,6 +683,7 @@ public:
 
     ConstantClass *Result = nullptr;
 
+    std::lock_guard<UniquingLock> Guard(Lock);
     auto I = Map.find_as(Lookup);
     if (I == Map.end())
       Result = create(Ty, V, Lookup);
@@ -688,6 +696,7 @@ public:
 
   /// Remove this constant from the map
   void remove(ConstantClass *CP) {
+    std::lock_guard<UniquingLock> Guard(Lock);
     typename MapTy::iterator I = Map.find(CP);
     assert(I != Map.end() && "Constant not found in constant table!");
     assert(*I == CP && "Didn't find correct element?");
@@ -702,6 +711,7 @@ public:
     /// Hash once, and reuse it for the lookup and the insertion if needed.
     LookupKeyHashed Lookup(MapInfo::getHashValue(Key), Key);
 
+    std::lock_guard<UniquingLock> Guard(Lock);
     auto I = Map.find_as(Lookup);
     if (I != Map.end())
       return *I;
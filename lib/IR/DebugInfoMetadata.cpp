@@ -45,6 +45,7 @@ DILocation *DILocation::getImpl(LLVMContext &Context, unsigned Line,
   // Fixup column.
   adjustColumn(Column);
 
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DILocationsLock);
   if (Storage == Uniqued) {
     if (auto *N =
             getUniqued(Context.pImpl->DILocations,
@@ -166,6 +167,7 @@ GenericDINode *GenericDINode::getImpl(LLVMContext &Context, unsigned Tag,
                                       ArrayRef<Metadata *> DwarfOps,
                                       StorageType Storage, bool ShouldCreate) {
   unsigned Hash = 0;
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->GenericDINodesLock);
   if (Storage == Uniqued) {
     GenericDINodeInfo::KeyTy Key(Tag, Header, DwarfOps);
     if (auto *N = getUniqued(Context.pImpl->GenericDINodes, Key))
@@ -217,6 +219,7 @@ void GenericDINode::recalculateHash() {
 
 DISubrange *DISubrange::getImpl(LLVMContext &Context, int64_t Count, int64_t Lo,
                                 StorageType Storage, bool ShouldCreate) {
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DISubrangesLock);
   DEFINE_GETIMPL_LOOKUP(DISubrange, (Count, Lo));
   DEFINE_GETIMPL_STORE_NO_OPS(DISubrange, (Count, Lo));
 }
@@ -225,6 +228,7 @@ DIEnumerator *DIEnumerator::getImpl(LLVMContext &Context, int64_t Value,
                                     MDString *Name, StorageType Storage,
                                     bool ShouldCreate) {
   assert(isCanonical(Name) && "Expected canonical MDString");
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DIEnumeratorsLock);
   DEFINE_GETIMPL_LOOKUP(DIEnumerator, (Value, Name));
   Metadata *Ops[] = {Name};
   DEFINE_GETIMPL_STORE(DIEnumerator, (Value), Ops);
@@ -235,6 +239,7 @@ DIBasicType *DIBasicType::getImpl(LLVMContext &Context, unsigned Tag,
                                   uint32_t AlignInBits, unsigned Encoding,
                                   StorageType Storage, bool ShouldCreate) {
   assert(isCanonical(Name) && "Expected canonical MDString");
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DIBasicTypesLock);
   DEFINE_GETIMPL_LOOKUP(DIBasicType,
                         (Tag, Name, SizeInBits, AlignInBits, Encoding));
   Metadata *Ops[] = {nullptr, nullptr, Name};
@@ -249,6 +254,7 @@ DIDerivedType *DIDerivedType::getImpl(
     Optional<unsigned> DWARFAddressSpace, DIFlags Flags, Metadata *ExtraData,
     StorageType Storage, bool ShouldCreate) {
   assert(isCanonical(Name) && "Expected canonical MDString");
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DIDerivedTypesLock);
   DEFINE_GETIMPL_LOOKUP(DIDerivedType,
                         (Tag, Name, File, Line, Scope, BaseType, SizeInBits,
                          AlignInBits, OffsetInBits, DWARFAddressSpace, Flags,
@@ -269,6 +275,7 @@ DICompositeType *DICompositeType::getImpl(
   assert(isCanonical(Name) && "Expected canonical MDString");
 
   // Keep this in sync with buildODRType.
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DICompositeTypesLock);
   DEFINE_GETIMPL_LOOKUP(
       DICompositeType, (Tag, Name, File, Line, Scope, BaseType, SizeInBits,
                         AlignInBits, OffsetInBits, Flags, Elements, RuntimeLang,
@@ -344,6 +351,7 @@ DISubroutineType *DISubroutineType::getImpl(LLVMContext &Context, DIFlags Flags,
                                             uint8_t CC, Metadata *TypeArray,
                                             StorageType Storage,
                                             bool ShouldCreate) {
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DISubroutineTypesLock);
   DEFINE_GETIMPL_LOOKUP(DISubroutineType, (Flags, CC, TypeArray));
   Metadata *Ops[] = {nullptr, nullptr, nullptr, TypeArray};
   DEFINE_GETIMPL_STORE(DISubroutineType, (Flags, CC), Ops);
@@ -374,6 +382,7 @@ DIFile *DIFile::getImpl(LLVMContext &Context, MDString *Filename,
   assert(isCanonical(Filename) && "Expected canonical MDString");
   assert(isCanonical(Directory) && "Expected canonical MDString");
   assert(isCanonical(Checksum) && "Expected canonical MDString");
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DIFilesLock);
   DEFINE_GETIMPL_LOOKUP(DIFile, (Filename, Directory, CSKind, Checksum));
   Metadata *Ops[] = {Filename, Directory, Checksum};
   DEFINE_GETIMPL_STORE(DIFile, (CSKind), Ops);
@@ -444,6 +453,7 @@ DISubprogram *DISubprogram::getImpl(
     StorageType Storage, bool ShouldCreate) {
   assert(isCanonical(Name) && "Expected canonical MDString");
   assert(isCanonical(LinkageName) && "Expected canonical MDString");
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DISubprogramsLock);
   DEFINE_GETIMPL_LOOKUP(
       DISubprogram,
       (Scope, Name, LinkageName, File, Line, Type, IsLocalToUnit, IsDefinition,
@@ -476,6 +486,7 @@ DILexicalBlock *DILexicalBlock::getImpl(LLVMContext &Context, Metadata *Scope,
   adjustColumn(Column);
 
   assert(Scope && "Expected scope");
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DILexicalBlocksLock);
   DEFINE_GETIMPL_LOOKUP(DILexicalBlock, (Scope, File, Line, Column));
   Metadata *Ops[] = {File, Scope};
   DEFINE_GETIMPL_STORE(DILexicalBlock, (Line, Column), Ops);
@@ -487,6 +498,7 @@ DILexicalBlockFile *DILexicalBlockFile::getImpl(LLVMContext &Context,
                                                 StorageType Storage,
                                                 bool ShouldCreate) {
   assert(Scope && "Expected scope");
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DILexicalBlockFilesLock);
   DEFINE_GETIMPL_LOOKUP(DILexicalBlockFile, (Scope, File, Discriminator));
   Metadata *Ops[] = {File, Scope};
   DEFINE_GETIMPL_STORE(DILexicalBlockFile, (Discriminator), Ops);
@@ -497,6 +509,7 @@ DINamespace *DINamespace::getImpl(LLVMContext &Context, Metadata *Scope,
                                   bool ExportSymbols, StorageType Storage,
                                   bool ShouldCreate) {
   assert(isCanonical(Name) && "Expected canonical MDString");
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DINamespacesLock);
   DEFINE_GETIMPL_LOOKUP(DINamespace, (Scope, File, Name, Line, ExportSymbols));
   Metadata *Ops[] = {File, Scope, Name};
   DEFINE_GETIMPL_STORE(DINamespace, (Line, ExportSymbols), Ops);
@@ -507,6 +520,7 @@ DIModule *DIModule::getImpl(LLVMContext &Context, Metadata *Scope,
                             MDString *IncludePath, MDString *ISysRoot,
                             StorageType Storage, bool ShouldCreate) {
   assert(isCanonical(Name) && "Expected canonical MDString");
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DIModulesLock);
   DEFINE_GETIMPL_LOOKUP(
       DIModule, (Scope, Name, ConfigurationMacros, IncludePath, ISysRoot));
   Metadata *Ops[] = {Scope, Name, ConfigurationMacros, IncludePath, ISysRoot};
@@ -519,6 +533,8 @@ DITemplateTypeParameter *DITemplateTypeParameter::getImpl(LLVMContext &Context,
                                                           StorageType Storage,
                                                           bool ShouldCreate) {
   assert(isCanonical(Name) && "Expected canonical MDString");
+  std::lock_guard<UniquingLock> Guard(
+      Context.pImpl->DITemplateTypeParametersLock);
   DEFINE_GETIMPL_LOOKUP(DITemplateTypeParameter, (Name, Type));
   Metadata *Ops[] = {Name, Type};
   DEFINE_GETIMPL_STORE_NO_CONSTRUCTOR_ARGS(DITemplateTypeParameter, Ops);
@@ -528,6 +544,8 @@ DITemplateValueParameter *DITemplateValueParameter::getImpl(
     LLVMContext &Context, unsigned Tag, MDString *Name, Metadata *Type,
     Metadata *Value, StorageType Storage, bool ShouldCreate) {
   assert(isCanonical(Name) && "Expected canonical MDString");
+  std::lock_guard<UniquingLock> Guard(
+      Context.pImpl->DITemplateValueParametersLock);
   DEFINE_GETIMPL_LOOKUP(DITemplateValueParameter, (Tag, Name, Type, Value));
   Metadata *Ops[] = {Name, Type, Value};
   DEFINE_GETIMPL_STORE(DITemplateValueParameter, (Tag), Ops);
@@ -542,6 +560,7 @@ DIGlobalVariable::getImpl(LLVMContext &Context, Metadata *Scope, MDString *Name,
                           bool ShouldCreate) {
   assert(isCanonical(Name) && "Expected canonical MDString");
   assert(isCanonical(LinkageName) && "Expected canonical MDString");
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DIGlobalVariablesLock);
   DEFINE_GETIMPL_LOOKUP(DIGlobalVariable,
                         (Scope, Name, LinkageName, File, Line, Type,
                          IsLocalToUnit, IsDefinition,
@@ -565,6 +584,7 @@ DILocalVariable *DILocalVariable::getImpl(LLVMContext &Context, Metadata *Scope,
 
   assert(Scope && "Expected scope");
   assert(isCanonical(Name) && "Expected canonical MDString");
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DILocalVariablesLock);
   DEFINE_GETIMPL_LOOKUP(DILocalVariable,
                         (Scope, Name, File, Line, Type, Arg, Flags,
                          AlignInBits));
@@ -575,6 +595,7 @@ DILocalVariable *DILocalVariable::getImpl(LLVMContext &Context, Metadata *Scope,
 DIExpression *DIExpression::getImpl(LLVMContext &Context,
                                     ArrayRef<uint64_t> Elements,
                                     StorageType Storage, bool ShouldCreate) {
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DIExpressionsLock);
   DEFINE_GETIMPL_LOOKUP(DIExpression, (Elements));
   DEFINE_GETIMPL_STORE_NO_OPS(DIExpression, (Elements));
 }
@@ -663,6 +684,8 @@ DIGlobalVariableExpression *
 DIGlobalVariableExpression::getImpl(LLVMContext &Context, Metadata *Variable,
                                     Metadata *Expression, StorageType Storage,
                                     bool ShouldCreate) {
+  std::lock_guard<UniquingLock> Guard(
+      Context.pImpl->DIGlobalVariableExpressionsLock);
   DEFINE_GETIMPL_LOOKUP(DIGlobalVariableExpression, (Variable, Expression));
   Metadata *Ops[] = {Variable, Expression};
   DEFINE_GETIMPL_STORE_NO_CONSTRUCTOR_ARGS(DIGlobalVariableExpression, Ops);
@@ -675,6 +698,7 @@ DIObjCProperty *DIObjCProperty::getImpl(
   assert(isCanonical(Name) && "Expected canonical MDString");
   assert(isCanonical(GetterName) && "Expected canonical MDString");
   assert(isCanonical(SetterName) && "Expected canonical MDString");
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DIObjCPropertysLock);
   DEFINE_GETIMPL_LOOKUP(DIObjCProperty, (Name, File, Line, GetterName,
                                          SetterName, Attributes, Type));
   Metadata *Ops[] = {Name, File, GetterName, SetterName, Type};
@@ -687,6 +711,7 @@ DIImportedEntity *DIImportedEntity::getImpl(LLVMContext &Context, unsigned Tag,
                                             StorageType Storage,
                                             bool ShouldCreate) {
   assert(isCanonical(Name) && "Expected canonical MDString");
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DIImportedEntitysLock);
   DEFINE_GETIMPL_LOOKUP(DIImportedEntity, (Tag, Scope, Entity, Line, Name));
   Metadata *Ops[] = {Scope, Entity, Name};
   DEFINE_GETIMPL_STORE(DIImportedEntity, (Tag, Line), Ops);
@@ -696,6 +721,7 @@ DIMacro *DIMacro::getImpl(LLVMContext &Context, unsigned MIType,
                           unsigned Line, MDString *Name, MDString *Value,
                           StorageType Storage, bool ShouldCreate) {
   assert(isCanonical(Name) && "Expected canonical MDString");
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DIMacrosLock);
   DEFINE_GETIMPL_LOOKUP(DIMacro, (MIType, Line, Name, Value));
   Metadata *Ops[] = { Name, Value };
   DEFINE_GETIMPL_STORE(DIMacro, (MIType, Line), Ops);
@@ -705,6 +731,7 @@ DIMacroFile *DIMacroFile::getImpl(LLVMContext &Context, unsigned MIType,
                                   unsigned Line, Metadata *File,
                                   Metadata *Elements, StorageType Storage,
                                   bool ShouldCreate) {
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->DIMacroFilesLock);
   DEFINE_GETIMPL_LOOKUP(DIMacroFile,
                         (MIType, Line, File, Elements));
   Metadata *Ops[] = { File, Elements };
@@ -0,0 +1,229 @@
+//===-- FlatSummaryIndex.cpp - Flat Module Summary Index ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the flattening of a module summary index into arrays,
+// and the lookups on it.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/FlatSummaryIndex.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include <algorithm>
+
+using namespace llvm;
+
+const uint32_t FlatSummaryIndex::NotFound;
+
+static GlobalValue::GUID getValueGUID(const ValueInfo &VI) {
+  return VI.isGUID() ? VI.getGUID() : VI.getValue()->getGUID();
+}
+
+FlatSummaryIndex::FlatSummaryIndex(const ModuleSummaryIndex &Index,
+                                   const DenseSet<GlobalValue::GUID> *OnlyValues) {
+  // Collect the summary lists to copy, in GUID order.
+  typedef std::pair<GlobalValue::GUID, const GlobalValueSummaryList *>
+      SummaryListTy;
+  std::vector<SummaryListTy> Lists;
+  if (OnlyValues) {
+    for (GlobalValue::GUID GUID : *OnlyValues) {
+      auto It = Index.findGlobalValueSummaryList(GUID);
+      if (It != Index.end())
+        Lists.push_back({GUID, &It->second});
+    }
+    std::sort(Lists.begin(), Lists.end(), llvm::less_first());
+  } else {
+    Lists.reserve(Index.size());
+    for (const auto &Entry : Index)
+      Lists.push_back({Entry.first, &Entry.second});
+  }
+
+  // Number the modules in path order, so that flattening the same index always
+  // gives the same arrays. Summaries may refer to a module path that isn't in
+  // the table (e.g. in a per-module index); such paths get an entry too.
+  std::vector<StringRef> Paths;
+  for (const auto &Entry : Index.modulePaths())
+    Paths.push_back(Entry.first());
+  std::sort(Paths.begin(), Paths.end());
+  StringMap<ModuleIndex> ModuleIndices;
+  for (StringRef Path : Paths)
+    ModuleIndices.insert({Path, ModuleIndices.size()});
+  for (const SummaryListTy &List : Lists)
+    for (const auto &Summary : *List.second)
+      if (Summary && !ModuleIndices.count(Summary->modulePath())) {
+        ModuleIndices.insert({Summary->modulePath(), ModuleIndices.size()});
+        Paths.push_back(Summary->modulePath());
+      }
+
+  // Number the values in GUID order: those copied, and those that are only
+  // referenced.
+  std::vector<GlobalValue::GUID> GUIDs;
+  for (const SummaryListTy &List : Lists) {
+    GUIDs.push_back(List.first);
+    for (const auto &Summary : *List.second) {
+      if (!Summary)
+        continue;
+      for (const ValueInfo &Ref : Summary->refs())
+        GUIDs.push_back(getValueGUID(Ref));
+      if (auto *FS = dyn_cast<FunctionSummary>(Summary.get()))
+        for (const FunctionSummary::EdgeTy &Call : FS->calls())
+          GUIDs.push_back(getValueGUID(Call.first));
+    }
+  }
+  std::sort(GUIDs.begin(), GUIDs.end());
+  GUIDs.erase(std::unique(GUIDs.begin(), GUIDs.end()), GUIDs.end());
+
+  // Lay out the summaries of each value, in the order of the index.
+  Values.resize(GUIDs.size());
+  std::vector<const GlobalValueSummary *> SummaryPtrs;
+  DenseMap<const GlobalValueSummary *, SummaryIndex> SummaryIndices;
+  auto ListIt = Lists.begin();
+  for (ValueIndex V = 0, E = GUIDs.size(); V != E; ++V) {
+    ValueEntry &VE = Values[V];
+    VE.GUID = GUIDs[V];
+    VE.FirstSummary = SummaryPtrs.size();
+    VE.Flags = 0;
+    if (ListIt == Lists.end() || ListIt->first != GUIDs[V]) {
+      // Only a partial copy has to look up whether the index has the value.
+      if (OnlyValues &&
+          Index.findGlobalValueSummaryList(GUIDs[V]) != Index.end())
+        VE.Flags = VF_InIndex;
+      continue;
+    }
+    VE.Flags = VF_InIndex;
+    for (const auto &Summary : *ListIt->second)
+      if (Summary) {
+        SummaryIndices[Summary.get()] = SummaryPtrs.size();
+        SummaryPtrs.push_back(Summary.get());
+      }
+    ++ListIt;
+  }
+  // Free what isn't needed anymore before the edge arrays are filled; the
+  // values are looked up with findValue() from now on.
+  std::vector<SummaryListTy>().swap(Lists);
+  std::vector<GlobalValue::GUID>().swap(GUIDs);
+
+  Summaries.resize(SummaryPtrs.size());
+  std::vector<std::vector<SummaryIndex>> Defs(Paths.size());
+  for (SummaryIndex S = 0, E = SummaryPtrs.size(); S != E; ++S) {
+    const GlobalValueSummary *Summary = SummaryPtrs[S];
+    SummaryEntry &SE = Summaries[S];
+    SE.OriginalName =
+        const_cast<GlobalValueSummary *>(Summary)->getOriginalName();
+    SE.Value = 0; // Set below.
+    SE.Module = ModuleIndices.lookup(Summary->modulePath());
+    SE.Kind = Summary->getSummaryKind();
+    SE.Linkage = Summary->linkage();
+    SE.Flags = (Summary->notEligibleToImport() ? SF_NotEligibleToImport : 0) |
+               (Summary->liveRoot() ? SF_LiveRoot : 0);
+    SE.InstCount = 0;
+    SE.Aliasee = NotFound;
+    SE.FirstCall = Calls.size();
+    SE.FirstRef = Refs.size();
+    if (auto *FS = dyn_cast<FunctionSummary>(Summary)) {
+      SE.InstCount = FS->instCount();
+      for (const FunctionSummary::EdgeTy &Call : FS->calls()) {
+        CallEdge Edge;
+        Edge.Callee = findValue(getValueGUID(Call.first));
+        Edge.Hotness = uint8_t(Call.second.Hotness);
+        Calls.push_back(Edge);
+      }
+    } else if (auto *AS = dyn_cast<AliasSummary>(Summary)) {
+      auto It = SummaryIndices.find(&AS->getAliasee());
+      if (It != SummaryIndices.end())
+        SE.Aliasee = It->second;
+    }
+    for (const ValueInfo &Ref : Summary->refs())
+      Refs.push_back(findValue(getValueGUID(Ref)));
+  }
+
+  // Fix up the value of each summary, and collect the definitions of each
+  // module, keeping the last summary when a module has several for a value.
+  for (ValueIndex V = 0, E = Values.size(); V != E; ++V) {
+    for (SummaryIndex S : summaries(V)) {
+      Summaries[S].Value = V;
+      auto &ModuleDefs = Defs[Summaries[S].Module];
+      if (!ModuleDefs.empty() && Summaries[ModuleDefs.back()].Value == V)
+        ModuleDefs.back() = S;
+      else
+        ModuleDefs.push_back(S);
+    }
+  }
+
+  Modules.resize(Paths.size());
+  for (ModuleIndex M = 0, E = Paths.size(); M != E; ++M) {
+    ModuleEntry &ME = Modules[M];
+    auto It = Index.modulePaths().find(Paths[M]);
+    ME.ModuleId = 0;
+    ME.Hash = {{0}};
+    if (It != Index.modulePaths().end()) {
+      ME.ModuleId = It->second.first;
+      ME.Hash = It->second.second;
+    }
+    ME.PathOffset = Strings.size();
+    ME.PathSize = Paths[M].size();
+    Strings += Paths[M];
+    ME.FirstDef = ModuleDefs.size();
+    ModuleDefs.insert(ModuleDefs.end(), Defs[M].begin(), Defs[M].end());
+  }
+
+  // The index only exposes the mapping of an original name to a GUID through
+  // lookups, so ask it about every original name of a summary.
+  std::vector<GlobalValue::GUID> OriginalIDs;
+  for (const SummaryEntry &SE : Summaries)
+    if (SE.OriginalName && SE.OriginalName != getGUID(SE.Value))
+      OriginalIDs.push_back(SE.OriginalName);
+  std::sort(OriginalIDs.begin(), OriginalIDs.end());
+  OriginalIDs.erase(std::unique(OriginalIDs.begin(), OriginalIDs.end()),
+                    OriginalIDs.end());
+  OriginalNames.reserve(OriginalIDs.size());
+  for (GlobalValue::GUID OriginalID : OriginalIDs) {
+    OriginalNameEntry ONE;
+    ONE.OriginalName = OriginalID;
+    ONE.GUID = Index.getGUIDFromOriginalID(OriginalID);
+    OriginalNames.push_back(ONE);
+  }
+}
+
+FlatSummaryIndex::SummaryIndex
+FlatSummaryIndex::findDefinedSummary(ModuleIndex M, ValueIndex V) const {
+  ArrayRef<SummaryIndex> Defs = getDefinedSummaries(M);
+  auto It = std::lower_bound(Defs.begin(), Defs.end(), V,
+                             [&](uint32_t S, ValueIndex V) {
+                               return Summaries[S].Value < V;
+                             });
+  if (It == Defs.end() || Summaries[*It].Value != V)
+    return NotFound;
+  return *It;
+}
+
+FlatSummaryIndex::ValueIndex
+FlatSummaryIndex::findValue(GlobalValue::GUID GUID) const {
+  auto It = std::lower_bound(Values.begin(), Values.end(), GUID,
+                             [](const ValueEntry &VE, GlobalValue::GUID GUID) {
+                               return VE.GUID < GUID;
+                             });
+  if (It == Values.end() || It->GUID != GUID)
+    return NotFound;
+  return It - Values.begin();
+}
+
+GlobalValue::GUID
+FlatSummaryIndex::getGUIDFromOriginalID(GlobalValue::GUID OriginalID) const {
+  auto It = std::lower_bound(OriginalNames.begin(), OriginalNames.end(),
+                             OriginalID,
+                             [](const OriginalNameEntry &ONE,
+                                GlobalValue::GUID OriginalID) {
+                               return ONE.OriginalName < OriginalID;
+                             });
+  if (It == OriginalNames.end() || It->OriginalName != OriginalID)
+    return 0;
+  return It->GUID;
+}
@@ -13,6 +13,11 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/GVMaterializer.h"
+#include "llvm/Support/Error.h"
 using namespace llvm;
 
 GVMaterializer::~GVMaterializer() {}
+
+Error GVMaterializer::materializeModuleParallel(unsigned NumThreads) {
+  return materializeModule();
+}
@@ -285,6 +285,14 @@ void LLVMContext::setDiscardValueNames(bool Discard) {
   pImpl->DiscardValueNames = Discard;
 }
 
+bool LLVMContext::hasThreadSafeUniquing() const {
+  return pImpl->ThreadSafeUniquing;
+}
+
+void LLVMContext::setThreadSafeUniquing(bool Enable) {
+  pImpl->setThreadSafeUniquing(Enable);
+}
+
 OptBisect &LLVMContext::getOptBisect() {
   return pImpl->getOptBisect();
 }
@@ -22,7 +22,10 @@
 using namespace llvm;
 
 LLVMContextImpl::LLVMContextImpl(LLVMContext &C)
-  : TheTrueVal(nullptr), TheFalseVal(nullptr),
+  : ArrayConstants(ConstantsLock), StructConstants(ConstantsLock),
+    VectorConstants(ConstantsLock), ExprConstants(ConstantsLock),
+    InlineAsms(ConstantsLock),
+    TheTrueVal(nullptr), TheFalseVal(nullptr),
     VoidTy(C, Type::VoidTyID),
     LabelTy(C, Type::LabelTyID),
     HalfTy(C, Type::HalfTyID),
@@ -215,6 +218,24 @@ uint32_t LLVMContextImpl::getOperandBundleTagID(StringRef Tag) const {
   return I->second;
 }
 
+void LLVMContextImpl::setThreadSafeUniquing(bool Enable) {
+  ThreadSafeUniquing = Enable;
+  IntConstantsLock.setEnabled(Enable);
+  FPConstantsLock.setEnabled(Enable);
+  CAZConstantsLock.setEnabled(Enable);
+  CPNConstantsLock.setEnabled(Enable);
+  UVConstantsLock.setEnabled(Enable);
+  CDSConstantsLock.setEnabled(Enable);
+  ConstantsLock.setEnabled(Enable);
+  TypesLock.setEnabled(Enable);
+  MDStringsLock.setEnabled(Enable);
+  ValuesAsMetadataLock.setEnabled(Enable);
+  MetadataUsesLock.setEnabled(Enable);
+  DistinctMDNodesLock.setEnabled(Enable);
+#define HANDLE_MDNODE_LEAF_UNIQUABLE(CLASS) CLASS##sLock.setEnabled(Enable);
+#include "llvm/IR/Metadata.def"
+}
+
 // ConstantsContext anchors
 void UnaryConstantExpr::anchor() { }
 
@@ -17,6 +17,7 @@
 
 #include "AttributeImpl.h"
 #include "ConstantsContext.h"
+#include "UniquingLock.h"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/ArrayRef.h"
@@ -1113,23 +1114,37 @@ public:
   typedef DenseMap<APInt, std::unique_ptr<ConstantInt>, DenseMapAPIntKeyInfo>
       IntMapTy;
   IntMapTy IntConstants;
+  UniquingLock IntConstantsLock;
 
   typedef DenseMap<APFloat, std::unique_ptr<ConstantFP>, DenseMapAPFloatKeyInfo>
       FPMapTy;
   FPMapTy FPConstants;
+  UniquingLock FPConstantsLock;
 
   FoldingSet<AttributeImpl> AttrsSet;
   FoldingSet<AttributeListImpl> AttrsLists;
   FoldingSet<AttributeSetNode> AttrsSetNodes;
 
   StringMap<MDString, BumpPtrAllocator> MDStringCache;
+  UniquingLock MDStringsLock;
+
   DenseMap<Value *, ValueAsMetadata *> ValuesAsMetadata;
+  UniquingLock ValuesAsMetadataLock;
+
   DenseMap<Metadata *, MetadataAsValue *> MetadataAsValues;
 
+  /// Guards the use maps of the ReplaceableMetadataImpls, which creating a
+  /// node updates for its ValueAsMetadata and unresolved operands. It is
+  /// only held while a single use map is accessed.
+  UniquingLock MetadataUsesLock;
+
   DenseMap<const Value*, ValueName*> ValueNames;
 
+  // Each MDNode uniquing set has a lock of its own, only held while the set
+  // is accessed or a node is created for it.
 #define HANDLE_MDNODE_LEAF_UNIQUABLE(CLASS)                                    \
-  DenseSet<CLASS *, CLASS##Info> CLASS##s;
+  DenseSet<CLASS *, CLASS##Info> CLASS##s;                                     \
+  UniquingLock CLASS##sLock;
 #include "llvm/IR/Metadata.def"
 
   // Optional map for looking up composite types by identifier.
@@ -1140,8 +1155,15 @@ public:
   // one object can destroy them.  Keep track of them here so we can delete
   // them on context teardown.
   std::vector<MDNode *> DistinctMDNodes;
+  UniquingLock DistinctMDNodesLock;
 
   DenseMap<Type *, std::unique_ptr<ConstantAggregateZero>> CAZConstants;
+  UniquingLock CAZConstantsLock;
+
+  /// Guards ArrayConstants, StructConstants, VectorConstants, BlockAddresses,
+  /// ExprConstants and InlineAsms, and the use lists that creating and
+  /// destroying these constants update.
+  UniquingLock ConstantsLock;
 
   typedef ConstantUniqueMap<ConstantArray> ArrayConstantsTy;
   ArrayConstantsTy ArrayConstants;
@@ -1153,10 +1175,14 @@ public:
   VectorConstantsTy VectorConstants;
 
   DenseMap<PointerType *, std::unique_ptr<ConstantPointerNull>> CPNConstants;
+  UniquingLock CPNConstantsLock;
 
   DenseMap<Type *, std::unique_ptr<UndefValue>> UVConstants;
+  /// Guards UVConstants and TheNoneToken.
+  UniquingLock UVConstantsLock;
 
   StringMap<ConstantDataSequential*> CDSConstants;
+  UniquingLock CDSConstantsLock;
 
   DenseMap<std::pair<const Function *, const BasicBlock *>, BlockAddress *>
     BlockAddresses;
@@ -1193,6 +1219,9 @@ public:
   DenseMap<Type*, PointerType*> PointerTypes;  // Pointers in AddrSpace = 0
   DenseMap<std::pair<Type*, unsigned>, PointerType*> ASPointerTypes;
 
+  /// Guards TypeAllocator and all the type tables above.
+  UniquingLock TypesLock;
+
 
   /// ValueHandles - This map keeps track of all of the value handles that are
   /// watching a Value*.  The Value::HasValueHandle bit is used to know
@@ -1244,6 +1273,10 @@ public:
   /// not.
   bool DiscardValueNames = false;
 
+  /// Flag to indicate if the uniquing tables are guarded by their locks.
+  bool ThreadSafeUniquing = false;
+  void setThreadSafeUniquing(bool Enable);
+
   LLVMContextImpl(LLVMContext &C);
   ~LLVMContextImpl();
 
@@ -1530,6 +1530,9 @@ bool FPPassManager::runOnFunction(Function &F) {
 bool FPPassManager::runOnModule(Module &M) {
   bool Changed = false;
 
+  // FIXME: Functions could be processed concurrently if the use lists of
+  // globals and constants could be updated from several threads; see
+  // ModuleToFunctionPassAdaptor.
   for (Function &F : M)
     Changed |= runOnFunction(F);
 
@@ -194,6 +194,7 @@ bool MetadataTracking::isReplaceable(const Metadata &MD) {
 }
 
 void ReplaceableMetadataImpl::addRef(void *Ref, OwnerTy Owner) {
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->MetadataUsesLock);
   bool WasInserted =
       UseMap.insert(std::make_pair(Ref, std::make_pair(Owner, NextIndex)))
           .second;
@@ -205,6 +206,7 @@ void ReplaceableMetadataImpl::addRef(void *Ref, OwnerTy Owner) {
 }
 
 void ReplaceableMetadataImpl::dropRef(void *Ref) {
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->MetadataUsesLock);
   bool WasErased = UseMap.erase(Ref);
   (void)WasErased;
   assert(WasErased && "Expected to drop a reference");
@@ -212,6 +214,7 @@ void ReplaceableMetadataImpl::dropRef(void *Ref) {
 
 void ReplaceableMetadataImpl::moveRef(void *Ref, void *New,
                                       const Metadata &MD) {
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->MetadataUsesLock);
   auto I = UseMap.find(Ref);
   assert(I != UseMap.end() && "Expected to move a reference");
   auto OwnerAndIndex = I->second;
@@ -229,20 +232,30 @@ void ReplaceableMetadataImpl::moveRef(void *Ref, void *New,
 }
 
 void ReplaceableMetadataImpl::replaceAllUsesWith(Metadata *MD) {
-  if (UseMap.empty())
+  // The owners are updated without holding MetadataUsesLock, as that takes
+  // the lock of their uniquing set, which is held while creating nodes.
+  UniquingLock &UsesLock = Context.pImpl->MetadataUsesLock;
+  UsesLock.lock();
+  if (UseMap.empty()) {
+    UsesLock.unlock();
     return;
+  }
 
   // Copy out uses since UseMap will get touched below.
   typedef std::pair<void *, std::pair<OwnerTy, uint64_t>> UseTy;
   SmallVector<UseTy, 8> Uses(UseMap.begin(), UseMap.end());
+  UsesLock.unlock();
   std::sort(Uses.begin(), Uses.end(), [](const UseTy &L, const UseTy &R) {
     return L.second.second < R.second.second;
   });
   for (const auto &Pair : Uses) {
     // Check that this Ref hasn't disappeared after RAUW (when updating a
     // previous Ref).
-    if (!UseMap.count(Pair.first))
-      continue;
+    {
+      std::lock_guard<UniquingLock> Guard(UsesLock);
+      if (!UseMap.count(Pair.first))
+        continue;
+    }
 
     OwnerTy Owner = Pair.second.first;
     if (!Owner) {
@@ -251,6 +264,7 @@ void ReplaceableMetadataImpl::replaceAllUsesWith(Metadata *MD) {
       Ref = MD;
       if (MD)
         MetadataTracking::track(Ref);
+      std::lock_guard<UniquingLock> Guard(UsesLock);
       UseMap.erase(Pair.first);
       continue;
     }
@@ -277,21 +291,25 @@ void ReplaceableMetadataImpl::replaceAllUsesWith(Metadata *MD) {
 }
 
 void ReplaceableMetadataImpl::resolveAllUses(bool ResolveUsers) {
-  if (UseMap.empty())
-    return;
+  typedef std::pair<void *, std::pair<OwnerTy, uint64_t>> UseTy;
+  SmallVector<UseTy, 8> Uses;
+  {
+    std::lock_guard<UniquingLock> Guard(Context.pImpl->MetadataUsesLock);
+    if (UseMap.empty())
+      return;
 
-  if (!ResolveUsers) {
+    if (!ResolveUsers) {
+      UseMap.clear();
+      return;
+    }
+
+    // Copy out uses since UseMap could get touched below.
+    Uses.append(UseMap.begin(), UseMap.end());
     UseMap.clear();
-    return;
   }
-
-  // Copy out uses since UseMap could get touched below.
-  typedef std::pair<void *, std::pair<OwnerTy, uint64_t>> UseTy;
-  SmallVector<UseTy, 8> Uses(UseMap.begin(), UseMap.end());
   std::sort(Uses.begin(), Uses.end(), [](const UseTy &L, const UseTy &R) {
     return L.second.second < R.second.second;
   });
-  UseMap.clear();
   for (const auto &Pair : Uses) {
     auto Owner = Pair.second.first;
     if (!Owner)
@@ -340,6 +358,7 @@ ValueAsMetadata *ValueAsMetadata::get(Value *V) {
   assert(V && "Unexpected null Value");
 
   auto &Context = V->getContext();
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->ValuesAsMetadataLock);
   auto *&Entry = Context.pImpl->ValuesAsMetadata[V];
   if (!Entry) {
     assert((isa<Constant>(V) || isa<Argument>(V) || isa<Instruction>(V)) &&
@@ -357,13 +376,17 @@ ValueAsMetadata *ValueAsMetadata::get(Value *V) {
 
 ValueAsMetadata *ValueAsMetadata::getIfExists(Value *V) {
   assert(V && "Unexpected null Value");
+  std::lock_guard<UniquingLock> Guard(
+      V->getContext().pImpl->ValuesAsMetadataLock);
   return V->getContext().pImpl->ValuesAsMetadata.lookup(V);
 }
 
 void ValueAsMetadata::handleDeletion(Value *V) {
   assert(V && "Expected valid value");
 
-  auto &Store = V->getType()->getContext().pImpl->ValuesAsMetadata;
+  auto &Context = V->getType()->getContext();
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->ValuesAsMetadataLock);
+  auto &Store = Context.pImpl->ValuesAsMetadata;
   auto I = Store.find(V);
   if (I == Store.end())
     return;
@@ -386,6 +409,7 @@ void ValueAsMetadata::handleRAUW(Value *From, Value *To) {
   assert(From->getType() == To->getType() && "Unexpected type change");
 
   LLVMContext &Context = From->getType()->getContext();
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->ValuesAsMetadataLock);
   auto &Store = Context.pImpl->ValuesAsMetadata;
   auto I = Store.find(From);
   if (I == Store.end()) {
@@ -442,6 +466,7 @@ void ValueAsMetadata::handleRAUW(Value *From, Value *To) {
 //
 
 MDString *MDString::get(LLVMContext &Context, StringRef Str) {
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->MDStringsLock);
   auto &Store = Context.pImpl->MDStringCache;
   auto I = Store.try_emplace(Str);
   auto &MapEntry = I.first->getValue();
@@ -749,7 +774,8 @@ void MDNode::deleteAsSubclass() {
 }
 
 template <class T, class InfoT>
-static T *uniquifyImpl(T *N, DenseSet<T *, InfoT> &Store) {
+static T *uniquifyImpl(T *N, DenseSet<T *, InfoT> &Store, UniquingLock &Lock) {
+  std::lock_guard<UniquingLock> Guard(Lock);
   if (T *U = getUniqued(Store, N))
     return U;
 
@@ -782,7 +808,8 @@ MDNode *MDNode::uniquify() {
     std::integral_constant<bool, HasCachedHash<CLASS>::value>                  \
         ShouldRecalculateHash;                                                 \
     dispatchRecalculateHash(SubclassThis, ShouldRecalculateHash);              \
-    return uniquifyImpl(SubclassThis, getContext().pImpl->CLASS##s);           \
+    return uniquifyImpl(SubclassThis, getContext().pImpl->CLASS##s,            \
+                        getContext().pImpl->CLASS##sLock);                     \
   }
 #include "llvm/IR/Metadata.def"
   }
@@ -793,9 +820,11 @@ void MDNode::eraseFromStore() {
   default:
     llvm_unreachable("Invalid or non-uniquable subclass of MDNode");
 #define HANDLE_MDNODE_LEAF_UNIQUABLE(CLASS)                                    \
-  case CLASS##Kind:                                                            \
+  case CLASS##Kind: {                                                          \
+    std::lock_guard<UniquingLock> Guard(getContext().pImpl->CLASS##sLock);     \
     getContext().pImpl->CLASS##s.erase(cast<CLASS>(this));                     \
-    break;
+    break;                                                                     \
+  }
 #include "llvm/IR/Metadata.def"
   }
 }
@@ -803,6 +832,7 @@ void MDNode::eraseFromStore() {
 MDTuple *MDTuple::getImpl(LLVMContext &Context, ArrayRef<Metadata *> MDs,
                           StorageType Storage, bool ShouldCreate) {
   unsigned Hash = 0;
+  std::lock_guard<UniquingLock> Guard(Context.pImpl->MDTuplesLock);
   if (Storage == Uniqued) {
     MDTupleInfo::KeyTy Key(MDs);
     if (auto *N = getUniqued(Context.pImpl->MDTuples, Key))
@@ -843,6 +873,7 @@ void MDNode::storeDistinctInContext() {
 #include "llvm/IR/Metadata.def"
   }
 
+  std::lock_guard<UniquingLock> Guard(getContext().pImpl->DistinctMDNodesLock);
   getContext().pImpl->DistinctMDNodes.push_back(this);
 }
 
@@ -378,6 +378,13 @@ Error Module::materializeAll() {
   return M->materializeModule();
 }
 
+Error Module::materializeAllParallel(unsigned NumThreads) {
+  if (!Materializer)
+    return Error::success();
+  std::unique_ptr<GVMaterializer> M = std::move(Materializer);
+  return M->materializeModuleParallel(NumThreads);
+}
+
 Error Module::materializeMetadata() {
   if (!Materializer)
     return Error::success();
@@ -0,0 +1,51 @@
+//===- UniquingLock.h - Optional lock for context uniquing tables -*- C++ -*-=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines UniquingLock, which guards one of the uniquing tables of
+// an LLVMContext when the context is in thread-safe uniquing mode.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LIB_IR_UNIQUINGLOCK_H
+#define LLVM_LIB_IR_UNIQUINGLOCK_H
+
+#include <mutex>
+
+namespace llvm {
+
+/// A lock guarding a single uniquing table of an LLVMContext. Locking is a
+/// no-op unless the lock was enabled by LLVMContext::setThreadSafeUniquing, so
+/// that single-threaded clients only pay for a predictable branch.
+///
+/// The lock is recursive since creating an entry of a table can require
+/// looking up other entries of the same table (e.g. when re-uniquing metadata
+/// after an operand change).
+class UniquingLock {
+  std::recursive_mutex Mutex;
+  bool Enabled = false;
+
+public:
+  /// Turn locking on or off. This must not be called while another thread
+  /// uses the context.
+  void setEnabled(bool Enable) { Enabled = Enable; }
+
+  void lock() {
+    if (Enabled)
+      Mutex.lock();
+  }
+
+  void unlock() {
+    if (Enabled)
+      Mutex.unlock();
+  }
+};
+
+} // end namespace llvm
+
+#endif // LLVM_LIB_IR_UNIQUINGLOCK_H
@@ -12,7 +12,9 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/LTO/Caching.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/CachePruning.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -22,6 +24,11 @@
 using namespace llvm;
 using namespace llvm::lto;
 
+#define DEBUG_TYPE "lto-cache"
+
+STATISTIC(NumCacheHits, "Number of native objects loaded from the cache");
+STATISTIC(NumCacheMisses, "Number of native objects missing from the cache");
+
 Expected<NativeObjectCache> lto::localCache(StringRef CacheDirectoryPath,
                                             AddBufferFn AddBuffer) {
   if (std::error_code EC = sys::fs::create_directories(CacheDirectoryPath))
@@ -36,6 +43,8 @@ Expected<NativeObjectCache> lto::localCache(StringRef CacheDirectoryPath,
     ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
         MemoryBuffer::getFile(EntryPath);
     if (MBOrErr) {
+      ++NumCacheHits;
+      recordCacheAccess(EntryPath, (*MBOrErr)->getBufferSize());
       AddBuffer(Task, std::move(*MBOrErr));
       return AddStreamFn();
     }
@@ -43,6 +52,7 @@ Expected<NativeObjectCache> lto::localCache(StringRef CacheDirectoryPath,
     if (MBOrErr.getError() != errc::no_such_file_or_directory)
       report_fatal_error(Twine("Failed to open cache file ") + EntryPath +
                          ": " + MBOrErr.getError().message() + "\n");
+    ++NumCacheMisses;
 
     // This native object stream is responsible for commiting the resulting
     // file to the cache and calling AddBuffer to add it to the link.
@@ -75,6 +85,7 @@ Expected<NativeObjectCache> lto::localCache(StringRef CacheDirectoryPath,
         if (!MBOrErr)
           report_fatal_error(Twine("Failed to open cache file ") + EntryPath +
                              ": " + MBOrErr.getError().message() + "\n");
+        recordCacheAccess(EntryPath, (*MBOrErr)->getBufferSize());
         AddBuffer(Task, std::move(*MBOrErr));
       }
     };
@@ -25,6 +25,7 @@
 #include "llvm/Bitcode/BitcodeWriterPass.h"
 #include "llvm/ExecutionEngine/ObjectMemoryBuffer.h"
 #include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/FlatSummaryIndex.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Mangler.h"
@@ -58,6 +59,9 @@ using namespace llvm;
 
 #define DEBUG_TYPE "thinlto"
 
+STATISTIC(NumCacheHits, "Number of modules loaded from the cache");
+STATISTIC(NumCacheMisses, "Number of modules missing from the cache");
+
 namespace llvm {
 // Flags -discard-value-names, defined in LTOCodeGenerator.cpp
 extern cl::opt<bool> LTODiscardValueNames;
@@ -364,6 +368,12 @@ public:
     return MemoryBuffer::getFile(EntryPath);
   }
 
+  // Record an access to this entry in the cache index, for pruning.
+  void recordAccess(uint64_t Size) {
+    if (!EntryPath.empty())
+      recordCacheAccess(EntryPath, Size);
+  }
+
   // Cache the Produced object file
   void write(const MemoryBuffer &OutputBuffer) {
     if (EntryPath.empty())
@@ -392,6 +402,7 @@ public:
                            " to save cached entry\n");
       OS << OutputBuffer.getBuffer();
     }
+    recordAccess(OutputBuffer.getBufferSize());
   }
 };
 
@@ -589,6 +600,16 @@ std::unique_ptr<ModuleSummaryIndex> ThinLTOCodeGenerator::linkCombinedIndex() {
   return CombinedIndex;
 }
 
+const FlatSummaryIndex &
+ThinLTOCodeGenerator::getFlatIndex(const ModuleSummaryIndex &Index) {
+  if (!CachedFlatIndex || FlatIndexSource != &Index) {
+    CachedFlatIndex.reset();
+    CachedFlatIndex = llvm::make_unique<FlatSummaryIndex>(Index);
+    FlatIndexSource = &Index;
+  }
+  return *CachedFlatIndex;
+}
+
 /**
  * Perform promotion and renaming of exported internal functions.
  * Index is updated to reflect linkage changes from weak resolution.
@@ -607,13 +628,13 @@ void ThinLTOCodeGenerator::promote(Module &TheModule,
       PreservedSymbols, Triple(TheModule.getTargetTriple()));
 
   // Compute "dead" symbols, we don't want to import/export these!
-  auto DeadSymbols = computeDeadSymbols(Index, GUIDPreservedSymbols);
+  const FlatSummaryIndex &FlatIndex = getFlatIndex(Index);
+  auto DeadSymbols = computeDeadSymbols(FlatIndex, GUIDPreservedSymbols);
 
   // Generate import/export list
   StringMap<FunctionImporter::ImportMapTy> ImportLists(ModuleCount);
   StringMap<FunctionImporter::ExportSetTy> ExportLists(ModuleCount);
-  ComputeCrossModuleImport(Index, ModuleToDefinedGVSummaries, ImportLists,
-                           ExportLists, &DeadSymbols);
+  ComputeCrossModuleImport(FlatIndex, ImportLists, ExportLists, &DeadSymbols);
 
   // Resolve LinkOnce/Weak symbols.
   StringMap<std::map<GlobalValue::GUID, GlobalValue::LinkageTypes>> ResolvedODR;
@@ -643,22 +664,18 @@ void ThinLTOCodeGenerator::crossModuleImport(Module &TheModule,
   auto ModuleMap = generateModuleMap(Modules);
   auto ModuleCount = Index.modulePaths().size();
 
-  // Collect for each module the list of function it defines (GUID -> Summary).
-  StringMap<GVSummaryMapTy> ModuleToDefinedGVSummaries(ModuleCount);
-  Index.collectDefinedGVSummariesPerModule(ModuleToDefinedGVSummaries);
-
   // Convert the preserved symbols set from string to GUID
   auto GUIDPreservedSymbols = computeGUIDPreservedSymbols(
       PreservedSymbols, Triple(TheModule.getTargetTriple()));
 
   // Compute "dead" symbols, we don't want to import/export these!
-  auto DeadSymbols = computeDeadSymbols(Index, GUIDPreservedSymbols);
+  const FlatSummaryIndex &FlatIndex = getFlatIndex(Index);
+  auto DeadSymbols = computeDeadSymbols(FlatIndex, GUIDPreservedSymbols);
 
   // Generate import/export list
   StringMap<FunctionImporter::ImportMapTy> ImportLists(ModuleCount);
   StringMap<FunctionImporter::ExportSetTy> ExportLists(ModuleCount);
-  ComputeCrossModuleImport(Index, ModuleToDefinedGVSummaries, ImportLists,
-                           ExportLists, &DeadSymbols);
+  ComputeCrossModuleImport(FlatIndex, ImportLists, ExportLists, &DeadSymbols);
   auto &ImportList = ImportLists[TheModule.getModuleIdentifier()];
 
   crossImportIntoModule(TheModule, Index, ModuleMap, ImportList);
@@ -679,8 +696,7 @@ void ThinLTOCodeGenerator::gatherImportedSummariesForModule(
   // Generate import/export list
   StringMap<FunctionImporter::ImportMapTy> ImportLists(ModuleCount);
   StringMap<FunctionImporter::ExportSetTy> ExportLists(ModuleCount);
-  ComputeCrossModuleImport(Index, ModuleToDefinedGVSummaries, ImportLists,
-                           ExportLists);
+  ComputeCrossModuleImport(FlatSummaryIndex(Index), ImportLists, ExportLists);
 
   llvm::gatherImportedSummariesForModule(ModulePath, ModuleToDefinedGVSummaries,
                                          ImportLists[ModulePath],
@@ -695,15 +711,10 @@ void ThinLTOCodeGenerator::emitImports(StringRef ModulePath,
                                        ModuleSummaryIndex &Index) {
   auto ModuleCount = Index.modulePaths().size();
 
-  // Collect for each module the list of function it defines (GUID -> Summary).
-  StringMap<GVSummaryMapTy> ModuleToDefinedGVSummaries(ModuleCount);
-  Index.collectDefinedGVSummariesPerModule(ModuleToDefinedGVSummaries);
-
   // Generate import/export list
   StringMap<FunctionImporter::ImportMapTy> ImportLists(ModuleCount);
   StringMap<FunctionImporter::ExportSetTy> ExportLists(ModuleCount);
-  ComputeCrossModuleImport(Index, ModuleToDefinedGVSummaries, ImportLists,
-                           ExportLists);
+  ComputeCrossModuleImport(FlatSummaryIndex(Index), ImportLists, ExportLists);
 
   std::error_code EC;
   if ((EC = EmitImportsFiles(ModulePath, OutputName, ImportLists[ModulePath])))
@@ -729,13 +740,13 @@ void ThinLTOCodeGenerator::internalize(Module &TheModule,
   Index.collectDefinedGVSummariesPerModule(ModuleToDefinedGVSummaries);
 
   // Compute "dead" symbols, we don't want to import/export these!
-  auto DeadSymbols = computeDeadSymbols(Index, GUIDPreservedSymbols);
+  const FlatSummaryIndex &FlatIndex = getFlatIndex(Index);
+  auto DeadSymbols = computeDeadSymbols(FlatIndex, GUIDPreservedSymbols);
 
   // Generate import/export list
   StringMap<FunctionImporter::ImportMapTy> ImportLists(ModuleCount);
   StringMap<FunctionImporter::ExportSetTy> ExportLists(ModuleCount);
-  ComputeCrossModuleImport(Index, ModuleToDefinedGVSummaries, ImportLists,
-                           ExportLists, &DeadSymbols);
+  ComputeCrossModuleImport(FlatIndex, ImportLists, ExportLists, &DeadSymbols);
   auto &ExportList = ExportLists[ModuleIdentifier];
 
   // Be friendly and don't nuke totally the module when the client didn't
@@ -880,15 +891,35 @@ void ThinLTOCodeGenerator::run() {
   auto GUIDPreservedSymbols =
       computeGUIDPreservedSymbols(PreservedSymbols, TMBuilder.TheTriple);
 
-  // Compute "dead" symbols, we don't want to import/export these!
-  auto DeadSymbols = computeDeadSymbols(*Index, GUIDPreservedSymbols);
+  // Compute "dead" symbols, we don't want to import/export these! The flat
+  // index is only needed by the analyses, and is freed before the backends run.
+  auto FlatIndex = llvm::make_unique<FlatSummaryIndex>(*Index);
+  auto DeadSymbols = computeDeadSymbols(*FlatIndex, GUIDPreservedSymbols);
 
   // Collect the import/export lists for all modules from the call-graph in the
-  // combined index.
+  // combined index. When caching, the lists of the previous link are reused
+  // for the modules whose inputs did not change.
   StringMap<FunctionImporter::ImportMapTy> ImportLists(ModuleCount);
   StringMap<FunctionImporter::ExportSetTy> ExportLists(ModuleCount);
-  ComputeCrossModuleImport(*Index, ModuleToDefinedGVSummaries, ImportLists,
-                           ExportLists, &DeadSymbols);
+  if (CacheOptions.Path.empty()) {
+    ComputeCrossModuleImport(*FlatIndex, ImportLists, ExportLists,
+                             &DeadSymbols);
+  } else {
+    // This choice of file name allows the cache to be pruned (see pruneCache()
+    // in include/llvm/Support/CachePruning.h).
+    SmallString<128> ImportCachePath;
+    sys::path::append(ImportCachePath, CacheOptions.Path, "llvmcache-imports");
+    ImportListCache ImportCache(ImportCachePath.str());
+    ComputeCrossModuleImport(*FlatIndex, ImportLists, ExportLists,
+                             &DeadSymbols, &ImportCache);
+    uint64_t ImportCacheSize;
+    if (std::error_code EC = ImportCache.save())
+      errs() << "warning: can't save import lists to '" << ImportCachePath
+             << "': " << EC.message() << "\n";
+    else if (!sys::fs::file_size(ImportCachePath, ImportCacheSize))
+      recordCacheAccess(ImportCachePath, ImportCacheSize);
+  }
+  FlatIndex.reset();
 
   // We use a std::map here to be able to have a defined ordering when
   // producing a hash for the cache entry.
@@ -959,6 +990,8 @@ void ThinLTOCodeGenerator::run() {
 
           if (ErrOrBuffer) {
             // Cache Hit!
+            ++NumCacheHits;
+            CacheEntry.recordAccess(ErrOrBuffer.get()->getBufferSize());
             if (SavedObjectsDirectoryPath.empty())
               ProducedBinaries[count] = std::move(ErrOrBuffer.get());
             else
@@ -967,6 +1000,8 @@ void ThinLTOCodeGenerator::run() {
                   *ErrOrBuffer.get());
             return;
           }
+          if (!CacheEntryPath.empty())
+            ++NumCacheMisses;
         }
 
         LLVMContext Context;
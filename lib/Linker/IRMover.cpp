@@ -235,7 +235,7 @@ Type *TypeMapTy::get(Type *Ty, SmallPtrSet<StructType *, 8> &Visited) {
   // These are types that LLVM itself will unique.
   bool IsUniqued = !isa<StructType>(Ty) || cast<StructType>(Ty)->isLiteral();
 
-#ifndef NDEBUG
+#ifdef EXPENSIVE_CHECKS
   if (!IsUniqued) {
     for (auto &Pair : MappedTypes) {
       assert(!(Pair.first != Ty && Pair.second == Ty) &&
@@ -1336,59 +1336,33 @@ Error IRLinker::run() {
   return linkModuleFlagsMetadata();
 }
 
-IRMover::StructTypeKeyInfo::KeyTy::KeyTy(ArrayRef<Type *> E, bool P)
-    : ETypes(E), IsPacked(P) {}
-
-IRMover::StructTypeKeyInfo::KeyTy::KeyTy(const StructType *ST)
-    : ETypes(ST->elements()), IsPacked(ST->isPacked()) {}
-
-bool IRMover::StructTypeKeyInfo::KeyTy::operator==(const KeyTy &That) const {
-  return IsPacked == That.IsPacked && ETypes == That.ETypes;
-}
-
-bool IRMover::StructTypeKeyInfo::KeyTy::operator!=(const KeyTy &That) const {
-  return !this->operator==(That);
-}
-
-StructType *IRMover::StructTypeKeyInfo::getEmptyKey() {
-  return DenseMapInfo<StructType *>::getEmptyKey();
-}
-
-StructType *IRMover::StructTypeKeyInfo::getTombstoneKey() {
-  return DenseMapInfo<StructType *>::getTombstoneKey();
-}
-
-unsigned IRMover::StructTypeKeyInfo::getHashValue(const KeyTy &Key) {
-  return hash_combine(hash_combine_range(Key.ETypes.begin(), Key.ETypes.end()),
-                      Key.IsPacked);
-}
-
-unsigned IRMover::StructTypeKeyInfo::getHashValue(const StructType *ST) {
-  return getHashValue(KeyTy(ST));
-}
-
-bool IRMover::StructTypeKeyInfo::isEqual(const KeyTy &LHS,
-                                         const StructType *RHS) {
-  if (RHS == getEmptyKey() || RHS == getTombstoneKey())
-    return false;
-  return LHS == KeyTy(RHS);
-}
-
-bool IRMover::StructTypeKeyInfo::isEqual(const StructType *LHS,
-                                         const StructType *RHS) {
-  if (RHS == getEmptyKey() || RHS == getTombstoneKey())
-    return LHS == RHS;
-  return KeyTy(LHS) == KeyTy(RHS);
+static unsigned hashStructBody(ArrayRef<Type *> ETypes, bool IsPacked) {
+  unsigned Hash = hash_combine(hash_combine_range(ETypes.begin(), ETypes.end()),
+                               IsPacked);
+  // The hash is used as a DenseMap key, so it must be neither the empty key
+  // (~0U) nor the tombstone key (~0U - 1). Folding them onto other values only
+  // adds collisions, which the buckets already handle.
+  if (Hash == DenseMapInfo<unsigned>::getEmptyKey() ||
+      Hash == DenseMapInfo<unsigned>::getTombstoneKey())
+    Hash -= 2;
+  return Hash;
 }
 
 void IRMover::IdentifiedStructTypeSet::addNonOpaque(StructType *Ty) {
   assert(!Ty->isOpaque());
+  // Lookups find the first structure added with a given body.
+  auto &Bucket = NonOpaqueStructTypesByHash[hashStructBody(Ty->elements(),
+                                                           Ty->isPacked())];
+  for (StructType *Other : Bucket)
+    if (Other->elements() == Ty->elements() &&
+        Other->isPacked() == Ty->isPacked())
+      return;
+  Bucket.push_back(Ty);
   NonOpaqueStructTypes.insert(Ty);
 }
 
 void IRMover::IdentifiedStructTypeSet::switchToNonOpaque(StructType *Ty) {
-  assert(!Ty->isOpaque());
-  NonOpaqueStructTypes.insert(Ty);
+  addNonOpaque(Ty);
   bool Removed = OpaqueStructTypes.erase(Ty);
   (void)Removed;
   assert(Removed);
@@ -1402,16 +1376,19 @@ void IRMover::IdentifiedStructTypeSet::addOpaque(StructType *Ty) {
 StructType *
 IRMover::IdentifiedStructTypeSet::findNonOpaque(ArrayRef<Type *> ETypes,
                                                 bool IsPacked) {
-  IRMover::StructTypeKeyInfo::KeyTy Key(ETypes, IsPacked);
-  auto I = NonOpaqueStructTypes.find_as(Key);
-  return I == NonOpaqueStructTypes.end() ? nullptr : *I;
+  auto I = NonOpaqueStructTypesByHash.find(hashStructBody(ETypes, IsPacked));
+  if (I == NonOpaqueStructTypesByHash.end())
+    return nullptr;
+  for (StructType *Ty : I->second)
+    if (Ty->elements() == ETypes && Ty->isPacked() == IsPacked)
+      return Ty;
+  return nullptr;
 }
 
 bool IRMover::IdentifiedStructTypeSet::hasType(StructType *Ty) {
   if (Ty->isOpaque())
     return OpaqueStructTypes.count(Ty);
-  auto I = NonOpaqueStructTypes.find(Ty);
-  return I == NonOpaqueStructTypes.end() ? false : *I == Ty;
+  return NonOpaqueStructTypes.count(Ty);
 }
 
 IRMover::IRMover(Module &M) : Composite(M) {
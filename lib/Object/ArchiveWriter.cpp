@@ -13,15 +13,21 @@
 
 #include "llvm/Object/ArchiveWriter.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringRef.h"
-#include "llvm/IR/LLVMContext.h"
+#include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/Object/Archive.h"
+#include "llvm/Object/IRObjectFile.h"
+#include "llvm/Object/IRSymtab.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Object/SymbolicFile.h"
 #include "llvm/Support/EndianStream.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
@@ -107,19 +113,19 @@ Expected<NewArchiveMember> NewArchiveMember::getFile(StringRef FileName,
 }
 
 template <typename T>
-static void printWithSpacePadding(raw_fd_ostream &OS, T Data, unsigned Size,
+static void printWithSpacePadding(raw_ostream &OS, T Data, unsigned Size,
                                   bool MayTruncate = false) {
-  uint64_t OldPos = OS.tell();
-  OS << Data;
-  unsigned SizeSoFar = OS.tell() - OldPos;
-  if (Size > SizeSoFar) {
-    OS.indent(Size - SizeSoFar);
-  } else if (Size < SizeSoFar) {
+  SmallString<32> Buf;
+  raw_svector_ostream BufOS(Buf);
+  BufOS << Data;
+  if (Buf.size() > Size) {
     assert(MayTruncate && "Data doesn't fit in Size");
     // Some of the data this is used for (like UID) can be larger than the
     // space available in the archive format. Truncate in that case.
-    OS.seek(OldPos + Size);
+    Buf.resize(Size);
   }
+  OS << Buf;
+  OS.indent(Size - Buf.size());
 }
 
 static bool isBSDLike(object::Archive::Kind Kind) {
@@ -146,7 +152,7 @@ static void print32(raw_ostream &Out, object::Archive::Kind Kind,
 }
 
 static void printRestOfMemberHeader(
-    raw_fd_ostream &Out, const sys::TimePoint<std::chrono::seconds> &ModTime,
+    raw_ostream &Out, const sys::TimePoint<std::chrono::seconds> &ModTime,
     unsigned UID, unsigned GID, unsigned Perms, unsigned Size) {
   printWithSpacePadding(Out, sys::toTimeT(ModTime), 12);
   printWithSpacePadding(Out, UID, 6, true);
@@ -157,7 +163,7 @@ static void printRestOfMemberHeader(
 }
 
 static void
-printGNUSmallMemberHeader(raw_fd_ostream &Out, StringRef Name,
+printGNUSmallMemberHeader(raw_ostream &Out, StringRef Name,
                           const sys::TimePoint<std::chrono::seconds> &ModTime,
                           unsigned UID, unsigned GID, unsigned Perms,
                           unsigned Size) {
@@ -165,21 +171,25 @@ printGNUSmallMemberHeader(raw_fd_ostream &Out, StringRef Name,
   printRestOfMemberHeader(Out, ModTime, UID, GID, Perms, Size);
 }
 
+// Returns the size of the BSD header of a member called Name that starts at
+// offset Pos of the archive. The name is stored after the header and padded so
+// that even 64 bit object files are aligned.
+static unsigned getBSDMemberHeaderSize(uint64_t Pos, StringRef Name) {
+  uint64_t PosAfterHeader = Pos + 60 + Name.size();
+  return 60 + Name.size() + OffsetToAlignment(PosAfterHeader, 8);
+}
+
 static void
-printBSDMemberHeader(raw_fd_ostream &Out, StringRef Name,
+printBSDMemberHeader(raw_ostream &Out, uint64_t Pos, StringRef Name,
                      const sys::TimePoint<std::chrono::seconds> &ModTime,
                      unsigned UID, unsigned GID, unsigned Perms,
                      unsigned Size) {
-  uint64_t PosAfterHeader = Out.tell() + 60 + Name.size();
-  // Pad so that even 64 bit object files are aligned.
-  unsigned Pad = OffsetToAlignment(PosAfterHeader, 8);
-  unsigned NameWithPadding = Name.size() + Pad;
+  unsigned NameWithPadding = getBSDMemberHeaderSize(Pos, Name) - 60;
   printWithSpacePadding(Out, Twine("#1/") + Twine(NameWithPadding), 16);
   printRestOfMemberHeader(Out, ModTime, UID, GID, Perms,
                           NameWithPadding + Size);
   Out << Name;
-  assert(PosAfterHeader == Out.tell());
-  while (Pad--)
+  for (unsigned Pad = NameWithPadding - Name.size(); Pad--;)
     Out.write(uint8_t(0));
 }
 
@@ -188,13 +198,13 @@ static bool useStringTable(bool Thin, StringRef Name) {
 }
 
 static void
-printMemberHeader(raw_fd_ostream &Out, object::Archive::Kind Kind, bool Thin,
-                  StringRef Name,
+printMemberHeader(raw_ostream &Out, uint64_t Pos, object::Archive::Kind Kind,
+                  bool Thin, StringRef Name,
                   std::vector<unsigned>::iterator &StringMapIndexIter,
                   const sys::TimePoint<std::chrono::seconds> &ModTime,
                   unsigned UID, unsigned GID, unsigned Perms, unsigned Size) {
   if (isBSDLike(Kind))
-    return printBSDMemberHeader(Out, Name, ModTime, UID, GID, Perms, Size);
+    return printBSDMemberHeader(Out, Pos, Name, ModTime, UID, GID, Perms, Size);
   if (!useStringTable(Thin, Name))
     return printGNUSmallMemberHeader(Out, Name, ModTime, UID, GID, Perms, Size);
   Out << '/';
@@ -231,41 +241,39 @@ static std::string computeRelativePath(StringRef From, StringRef To) {
   return Relative.str();
 }
 
-static void writeStringTable(raw_fd_ostream &Out, StringRef ArcName,
+// Writes the member that holds the long member names of GNU archives. It must
+// start at an even offset.
+static void writeStringTable(raw_ostream &Out, StringRef ArcName,
                              ArrayRef<NewArchiveMember> Members,
                              std::vector<unsigned> &StringMapIndexes,
                              bool Thin) {
-  unsigned StartOffset = 0;
+  SmallString<0> Table;
+  raw_svector_ostream TableOS(Table);
   for (const NewArchiveMember &M : Members) {
     StringRef Path = M.Buf->getBufferIdentifier();
     StringRef Name = sys::path::filename(Path);
     if (!useStringTable(Thin, Name))
       continue;
-    if (StartOffset == 0) {
-      printWithSpacePadding(Out, "//", 58);
-      Out << "`\n";
-      StartOffset = Out.tell();
-    }
-    StringMapIndexes.push_back(Out.tell() - StartOffset);
+    StringMapIndexes.push_back(Table.size());
 
     if (Thin) {
       if (M.IsNew)
-        Out << computeRelativePath(ArcName, Path);
+        TableOS << computeRelativePath(ArcName, Path);
       else
-        Out << M.Buf->getBufferIdentifier();
+        TableOS << M.Buf->getBufferIdentifier();
     } else
-      Out << Name;
+      TableOS << Name;
 
-    Out << "/\n";
+    TableOS << "/\n";
   }
-  if (StartOffset == 0)
+  if (Table.empty())
     return;
-  if (Out.tell() % 2)
-    Out << '\n';
-  int Pos = Out.tell();
-  Out.seek(StartOffset - 12);
-  printWithSpacePadding(Out, Pos - StartOffset, 10);
-  Out.seek(Pos);
+  if (Table.size() % 2)
+    TableOS << '\n';
+  printWithSpacePadding(Out, "//", 48);
+  printWithSpacePadding(Out, Table.size(), 10);
+  Out << "`\n";
+  Out << Table;
 }
 
 static sys::TimePoint<std::chrono::seconds> now(bool Deterministic) {
@@ -276,99 +284,256 @@ static sys::TimePoint<std::chrono::seconds> now(bool Deterministic) {
   return sys::TimePoint<seconds>();
 }
 
-// Returns the offset of the first reference to a member offset.
-static ErrorOr<unsigned>
-writeSymbolTable(raw_fd_ostream &Out, object::Archive::Kind Kind,
-                 ArrayRef<NewArchiveMember> Members,
-                 std::vector<unsigned> &MemberOffsetRefs, bool Deterministic) {
-  unsigned HeaderStartOffset = 0;
-  unsigned BodyStartOffset = 0;
-  SmallString<128> NameBuf;
-  raw_svector_ostream NameOS(NameBuf);
-  LLVMContext Context;
-  for (unsigned MemberNum = 0, N = Members.size(); MemberNum < N; ++MemberNum) {
-    MemoryBufferRef MemberBuffer = Members[MemberNum].Buf->getMemBufferRef();
-    Expected<std::unique_ptr<object::SymbolicFile>> ObjOrErr =
-        object::SymbolicFile::createSymbolicFile(
-            MemberBuffer, sys::fs::file_magic::unknown, &Context);
-    if (!ObjOrErr) {
-      // FIXME: check only for "not an object file" errors.
-      consumeError(ObjOrErr.takeError());
+// Writes the names of the symbols that the bitcode file BC defines to
+// SymNames, using the IR symbol table stored in the file so that the file does
+// not need to be parsed. Returns false if BC cannot be read.
+static bool getBitcodeSymbols(MemoryBufferRef BC, raw_ostream &SymNames,
+                              std::vector<unsigned> &Ret) {
+  Expected<BitcodeFileContents> BFCOrErr = getBitcodeFileContents(BC);
+  if (!BFCOrErr) {
+    consumeError(BFCOrErr.takeError());
+    return false;
+  }
+  Expected<irsymtab::FileContents> FCOrErr = irsymtab::readBitcode(*BFCOrErr);
+  if (!FCOrErr) {
+    consumeError(FCOrErr.takeError());
+    return false;
+  }
+
+  irsymtab::Reader R = FCOrErr->getReader();
+  for (const irsymtab::Symbol &Sym : R.symbols()) {
+    if (Sym.isFormatSpecific() || !Sym.isGlobal() || Sym.isUndefined())
       continue;
+    Ret.push_back(SymNames.tell());
+    SymNames << Sym.getName() << '\0';
+  }
+  return true;
+}
+
+// Writes the names of the symbols that Buf defines to SymNames, each followed
+// by a null byte, and returns their offsets in SymNames. Sets HasObject if Buf
+// is an object file.
+static ErrorOr<std::vector<unsigned>>
+getSymbols(MemoryBufferRef Buf, raw_ostream &SymNames, bool &HasObject) {
+  std::vector<unsigned> Ret;
+
+  sys::fs::file_magic Magic = sys::fs::identify_magic(Buf.getBuffer());
+  if (Magic == sys::fs::file_magic::bitcode) {
+    HasObject = getBitcodeSymbols(Buf, SymNames, Ret);
+    return Ret;
+  }
+
+  Expected<std::unique_ptr<object::SymbolicFile>> ObjOrErr =
+      object::SymbolicFile::createSymbolicFile(Buf, Magic, nullptr);
+  if (!ObjOrErr) {
+    // FIXME: check only for "not an object file" errors.
+    consumeError(ObjOrErr.takeError());
+    return Ret;
+  }
+  object::SymbolicFile &Obj = *ObjOrErr.get();
+
+  // Use the symbols of the bitcode embedded in relocatable objects.
+  if (Magic == sys::fs::file_magic::elf_relocatable ||
+      Magic == sys::fs::file_magic::macho_object ||
+      Magic == sys::fs::file_magic::coff_object) {
+    ErrorOr<MemoryBufferRef> BCOrErr =
+        object::IRObjectFile::findBitcodeInObject(cast<object::ObjectFile>(Obj));
+    if (BCOrErr) {
+      HasObject = getBitcodeSymbols(
+          MemoryBufferRef(BCOrErr->getBuffer(), Buf.getBufferIdentifier()),
+          SymNames, Ret);
+      return Ret;
     }
-    object::SymbolicFile &Obj = *ObjOrErr.get();
+  }
 
-    if (!HeaderStartOffset) {
-      HeaderStartOffset = Out.tell();
-      if (isBSDLike(Kind))
-        printBSDMemberHeader(Out, "__.SYMDEF", now(Deterministic), 0, 0, 0, 0);
-      else
-        printGNUSmallMemberHeader(Out, "", now(Deterministic), 0, 0, 0, 0);
-      BodyStartOffset = Out.tell();
-      print32(Out, Kind, 0); // number of entries or bytes
+  HasObject = true;
+  for (const object::BasicSymbolRef &S : Obj.symbols()) {
+    uint32_t Symflags = S.getFlags();
+    if (Symflags & object::SymbolRef::SF_FormatSpecific)
+      continue;
+    if (!(Symflags & object::SymbolRef::SF_Global))
+      continue;
+    if (Symflags & object::SymbolRef::SF_Undefined)
+      continue;
+
+    Ret.push_back(SymNames.tell());
+    if (auto EC = S.printName(SymNames))
+      return EC;
+    SymNames << '\0';
+  }
+  return Ret;
+}
+
+namespace {
+/// The symbols that a member adds to the archive symbol table.
+struct MemberSymbols {
+  /// Whether the member is an object file. The symbol table is only written
+  /// if one of the members is.
+  bool HasObject = false;
+
+  /// The names of the symbols, each followed by a null byte.
+  SmallString<0> Names;
+
+  /// The offset of each name in Names.
+  std::vector<unsigned> Offsets;
+};
+
+/// The header and contents of a member, as they are written to the archive.
+struct MemberLayout {
+  std::string Header;
+  StringRef Data;
+  std::string Padding;
+};
+} // end anonymous namespace
+
+// Maps the contents of each member of the old archive to the names that its
+// symbol table lists for the member. Members that the table does not list are
+// left out, since the table does not tell whether they are object files.
+static DenseMap<const char *, std::vector<StringRef>>
+getOldSymbols(MemoryBufferRef OldArchiveBuf) {
+  DenseMap<const char *, std::vector<StringRef>> Ret;
+  Expected<std::unique_ptr<object::Archive>> ArchiveOrErr =
+      object::Archive::create(OldArchiveBuf);
+  if (!ArchiveOrErr) {
+    consumeError(ArchiveOrErr.takeError());
+    return Ret;
+  }
+  // The members of a thin archive live in their own files, which may have
+  // changed since the table was written.
+  object::Archive &OldArchive = **ArchiveOrErr;
+  if (OldArchive.isThin())
+    return Ret;
+
+  for (const object::Archive::Symbol &Sym : OldArchive.symbols()) {
+    Expected<object::Archive::Child> ChildOrErr = Sym.getMember();
+    if (!ChildOrErr) {
+      consumeError(ChildOrErr.takeError());
+      Ret.clear();
+      return Ret;
+    }
+    Expected<StringRef> BufOrErr = ChildOrErr->getBuffer();
+    if (!BufOrErr) {
+      consumeError(BufOrErr.takeError());
+      Ret.clear();
+      return Ret;
     }
+    Ret[BufOrErr->data()].push_back(Sym.getName());
+  }
+  return Ret;
+}
+
+// Computes the symbols of every member on the threads of the parallel
+// algorithms. The members that come unchanged from an old archive reuse the
+// entries of its symbol table instead of being read again.
+static std::error_code computeSymbols(ArrayRef<NewArchiveMember> Members,
+                                      const MemoryBuffer *OldArchiveBuf,
+                                      std::vector<MemberSymbols> &Ret) {
+  DenseMap<const char *, std::vector<StringRef>> OldSymbols;
+  if (OldArchiveBuf)
+    OldSymbols = getOldSymbols(OldArchiveBuf->getMemBufferRef());
+
+  Ret.resize(Members.size());
+  std::vector<std::error_code> Errors(Members.size());
+  parallel_for(size_t(0), Members.size(), [&](size_t I) {
+    const NewArchiveMember &M = Members[I];
+    MemberSymbols &Syms = Ret[I];
+    raw_svector_ostream NameOS(Syms.Names);
+
+    auto Old = M.IsNew ? OldSymbols.end()
+                       : OldSymbols.find(M.Buf->getBufferStart());
+    if (Old != OldSymbols.end()) {
+      Syms.HasObject = true;
+      for (StringRef Name : Old->second) {
+        Syms.Offsets.push_back(NameOS.tell());
+        NameOS << Name << '\0';
+      }
+      return;
+    }
+
+    ErrorOr<std::vector<unsigned>> OffsetsOrErr =
+        getSymbols(M.Buf->getMemBufferRef(), NameOS, Syms.HasObject);
+    if (OffsetsOrErr)
+      Syms.Offsets = std::move(*OffsetsOrErr);
+    else
+      Errors[I] = OffsetsOrErr.getError();
+  });
+
+  for (std::error_code EC : Errors)
+    if (EC)
+      return EC;
+  return std::error_code();
+}
+
+// Writes the symbol table, which must start at offset Out.tell() of the
+// archive. MemberOffsets is empty if the offsets are not known yet, in which
+// case zeros are written in their place.
+static void writeSymbolTable(raw_ostream &Out, object::Archive::Kind Kind,
+                             bool Deterministic,
+                             ArrayRef<MemberSymbols> Members,
+                             ArrayRef<unsigned> MemberOffsets) {
+  if (none_of(Members, [](const MemberSymbols &M) { return M.HasObject; }))
+    return;
+
+  uint64_t HeaderStartOffset = Out.tell();
+  uint64_t BodyStartOffset =
+      HeaderStartOffset + (isBSDLike(Kind) ? getBSDMemberHeaderSize(
+                                                 HeaderStartOffset, "__.SYMDEF")
+                                           : 60);
 
-    for (const object::BasicSymbolRef &S : Obj.symbols()) {
-      uint32_t Symflags = S.getFlags();
-      if (Symflags & object::SymbolRef::SF_FormatSpecific)
-        continue;
-      if (!(Symflags & object::SymbolRef::SF_Global))
-        continue;
-      if (Symflags & object::SymbolRef::SF_Undefined)
-        continue;
-
-      unsigned NameOffset = NameOS.tell();
-      if (auto EC = S.printName(NameOS))
-        return EC;
-      NameOS << '\0';
-      MemberOffsetRefs.push_back(MemberNum);
+  unsigned NumSyms = 0;
+  for (const MemberSymbols &M : Members)
+    NumSyms += M.Offsets.size();
+
+  SmallString<0> Body;
+  raw_svector_ostream BodyOS(Body);
+  if (isBSDLike(Kind))
+    print32(BodyOS, Kind, NumSyms * 8);
+  else
+    print32(BodyOS, Kind, NumSyms);
+
+  unsigned NameBase = 0;
+  for (unsigned MemberNum = 0, N = Members.size(); MemberNum < N; ++MemberNum) {
+    const MemberSymbols &M = Members[MemberNum];
+    for (unsigned NameOffset : M.Offsets) {
       if (isBSDLike(Kind))
-        print32(Out, Kind, NameOffset);
-      print32(Out, Kind, 0); // member offset
+        print32(BodyOS, Kind, NameBase + NameOffset);
+      print32(BodyOS, Kind,
+              MemberOffsets.empty() ? 0 : MemberOffsets[MemberNum]);
     }
+    NameBase += M.Names.size();
   }
 
-  if (HeaderStartOffset == 0)
-    return 0;
-
   // ld64 prefers the cctools type archive which pads its string table to a
   // boundary of sizeof(int32_t).
+  unsigned StringTableSize = NameBase;
   if (isBSDLike(Kind))
-    for (unsigned P = OffsetToAlignment(NameOS.tell(), sizeof(int32_t)); P--;)
-      NameOS << '\0';
+    StringTableSize += OffsetToAlignment(NameBase, sizeof(int32_t));
 
-  StringRef StringTable = NameOS.str();
   if (isBSDLike(Kind))
-    print32(Out, Kind, StringTable.size()); // byte count of the string table
-  Out << StringTable;
+    print32(BodyOS, Kind, StringTableSize); // byte count of the string table
+  for (const MemberSymbols &M : Members)
+    BodyOS << M.Names;
+  for (unsigned P = StringTableSize - NameBase; P--;)
+    BodyOS << '\0';
   // If there are no symbols, emit an empty symbol table, to satisfy Solaris
   // tools, older versions of which expect a symbol table in a non-empty
   // archive, regardless of whether there are any symbols in it.
-  if (StringTable.size() == 0)
-    print32(Out, Kind, 0);
+  if (StringTableSize == 0)
+    print32(BodyOS, Kind, 0);
 
   // ld64 requires the next member header to start at an offset that is
   // 4 bytes aligned.
-  unsigned Pad = OffsetToAlignment(Out.tell(), 4);
-  while (Pad--)
-    Out.write(uint8_t(0));
+  for (unsigned Pad = OffsetToAlignment(BodyStartOffset + Body.size(), 4);
+       Pad--;)
+    BodyOS.write(uint8_t(0));
 
-  // Patch up the size of the symbol table now that we know how big it is.
-  unsigned Pos = Out.tell();
-  const unsigned MemberHeaderSize = 60;
-  Out.seek(HeaderStartOffset + 48); // offset of the size field.
-  printWithSpacePadding(Out, Pos - MemberHeaderSize - HeaderStartOffset, 10);
-
-  // Patch up the number of symbols.
-  Out.seek(BodyStartOffset);
-  unsigned NumSyms = MemberOffsetRefs.size();
   if (isBSDLike(Kind))
-    print32(Out, Kind, NumSyms * 8);
+    printBSDMemberHeader(Out, HeaderStartOffset, "__.SYMDEF",
+                         now(Deterministic), 0, 0, 0, Body.size());
   else
-    print32(Out, Kind, NumSyms);
-
-  Out.seek(Pos);
-  return BodyStartOffset + 4;
+    printGNUSmallMemberHeader(Out, "", now(Deterministic), 0, 0, 0,
+                              Body.size());
+  Out << Body;
 }
 
 std::pair<StringRef, std::error_code>
@@ -376,44 +541,53 @@ llvm::writeArchive(StringRef ArcName,
                    std::vector<NewArchiveMember> &NewMembers,
                    bool WriteSymtab, object::Archive::Kind Kind,
                    bool Deterministic, bool Thin,
-                   std::unique_ptr<MemoryBuffer> OldArchiveBuf) {
+                   std::unique_ptr<MemoryBuffer> OldArchiveBuf,
+                   bool ReuseOldSymtab) {
   assert((!Thin || !isBSDLike(Kind)) && "Only the gnu format has a thin mode");
-  SmallString<128> TmpArchive;
-  int TmpArchiveFD;
-  if (auto EC = sys::fs::createUniqueFile(ArcName + ".temp-archive-%%%%%%%.a",
-                                          TmpArchiveFD, TmpArchive))
-    return std::make_pair(ArcName, EC);
-
-  tool_output_file Output(TmpArchive, TmpArchiveFD);
-  raw_fd_ostream &Out = Output.os();
-  if (Thin)
-    Out << "!<thin>\n";
-  else
-    Out << "!<arch>\n";
 
-  std::vector<unsigned> MemberOffsetRefs;
-
-  unsigned MemberReferenceOffset = 0;
-  if (WriteSymtab) {
-    ErrorOr<unsigned> MemberReferenceOffsetOrErr = writeSymbolTable(
-        Out, Kind, NewMembers, MemberOffsetRefs, Deterministic);
-    if (auto EC = MemberReferenceOffsetOrErr.getError())
+  std::vector<MemberSymbols> Symbols;
+  if (WriteSymtab)
+    if (std::error_code EC =
+            computeSymbols(NewMembers,
+                           ReuseOldSymtab ? OldArchiveBuf.get() : nullptr,
+                           Symbols))
       return std::make_pair(ArcName, EC);
-    MemberReferenceOffset = MemberReferenceOffsetOrErr.get();
-  }
 
   std::vector<unsigned> StringMapIndexes;
-  if (!isBSDLike(Kind))
-    writeStringTable(Out, ArcName, NewMembers, StringMapIndexes, Thin);
+  SmallString<0> StringTable;
+  if (!isBSDLike(Kind)) {
+    raw_svector_ostream StringTableOS(StringTable);
+    writeStringTable(StringTableOS, ArcName, NewMembers, StringMapIndexes,
+                     Thin);
+  }
 
+  // The size of the symbol table does not depend on the member offsets that
+  // it holds, so everything that precedes the members is written once to find
+  // where they start, and again once their offsets are known. The archive is
+  // then written in a single pass.
+  SmallString<0> Head;
+  auto WriteHead = [&](ArrayRef<unsigned> MemberOffsets) {
+    Head.clear();
+    raw_svector_ostream Out(Head);
+    if (Thin)
+      Out << "!<thin>\n";
+    else
+      Out << "!<arch>\n";
+    writeSymbolTable(Out, Kind, Deterministic, Symbols, MemberOffsets);
+    Out << StringTable;
+  };
+  WriteHead(None);
+
+  std::vector<unsigned> MemberOffsets;
+  std::vector<MemberLayout> Layout(NewMembers.size());
   std::vector<unsigned>::iterator StringMapIndexIter = StringMapIndexes.begin();
-  std::vector<unsigned> MemberOffset;
-  for (const NewArchiveMember &M : NewMembers) {
-    MemoryBufferRef File = M.Buf->getMemBufferRef();
+  uint64_t Pos = Head.size();
+  for (unsigned MemberNum = 0, N = NewMembers.size(); MemberNum < N;
+       ++MemberNum) {
+    const NewArchiveMember &M = NewMembers[MemberNum];
+    MemberLayout &L = Layout[MemberNum];
     unsigned Padding = 0;
-
-    unsigned Pos = Out.tell();
-    MemberOffset.push_back(Pos);
+    MemberOffsets.push_back(Pos);
 
     // ld64 expects the members to be 8-byte aligned for 64-bit content and at
     // least 4-byte aligned for 32-bit content.  Opt for the larger encoding
@@ -422,29 +596,40 @@ llvm::writeArchive(StringRef ArcName,
     if (Kind == object::Archive::K_DARWIN)
       Padding = OffsetToAlignment(M.Buf->getBufferSize(), 8);
 
-    printMemberHeader(Out, Kind, Thin,
+    raw_string_ostream HeaderOS(L.Header);
+    printMemberHeader(HeaderOS, Pos, Kind, Thin,
                       sys::path::filename(M.Buf->getBufferIdentifier()),
                       StringMapIndexIter, M.ModTime, M.UID, M.GID, M.Perms,
                       M.Buf->getBufferSize() + Padding);
+    HeaderOS.flush();
 
     if (!Thin)
-      Out << File.getBuffer();
-
-    while (Padding--)
-      Out << '\n';
-    if (Out.tell() % 2)
-      Out << '\n';
-  }
-
-  if (MemberReferenceOffset) {
-    Out.seek(MemberReferenceOffset);
-    for (unsigned MemberNum : MemberOffsetRefs) {
-      if (isBSDLike(Kind))
-        Out.seek(Out.tell() + 4); // skip over the string offset
-      print32(Out, Kind, MemberOffset[MemberNum]);
+      L.Data = M.Buf->getBuffer();
+    Pos += L.Header.size() + L.Data.size() + Padding;
+    if (Pos % 2) {
+      ++Padding;
+      ++Pos;
     }
+    L.Padding.assign(Padding, '\n');
   }
 
+  if (WriteSymtab)
+    WriteHead(MemberOffsets);
+  assert((MemberOffsets.empty() || Head.size() == MemberOffsets.front()) &&
+         "Symbol table size depends on the member offsets");
+
+  SmallString<128> TmpArchive;
+  int TmpArchiveFD;
+  if (auto EC = sys::fs::createUniqueFile(ArcName + ".temp-archive-%%%%%%%.a",
+                                          TmpArchiveFD, TmpArchive))
+    return std::make_pair(ArcName, EC);
+
+  tool_output_file Output(TmpArchive, TmpArchiveFD);
+  raw_fd_ostream &Out = Output.os();
+  Out << Head;
+  for (const MemberLayout &L : Layout)
+    Out << L.Header << L.Data << L.Padding;
+
   Output.keep();
   Out.close();
 
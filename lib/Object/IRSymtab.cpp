@@ -9,16 +9,26 @@
 
 #include "llvm/Object/IRSymtab.h"
 #include "llvm/Analysis/ObjectUtils.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Mangler.h"
 #include "llvm/IR/Module.h"
 #include "llvm/MC/StringTableBuilder.h"
 #include "llvm/Object/ModuleSymbolTable.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/StringSaver.h"
+#include <cstdlib>
 
 using namespace llvm;
 using namespace irsymtab;
 
+static const char *getExpectedProducerName() {
+  // Tests set this to check that tables from other producers are rebuilt.
+  if (const char *OverrideName = std::getenv("LLVM_OVERRIDE_PRODUCER"))
+    return OverrideName;
+  return LLVM_VERSION_STRING;
+}
+
 namespace {
 
 /// Stores the temporary state that is required to build an IR symbol table.
@@ -65,6 +75,10 @@ struct Builder {
 };
 
 Error Builder::addModule(Module *M) {
+  if (M->getDataLayoutStr().empty())
+    return make_error<StringError>("input module has no datalayout",
+                                   inconvertibleErrorCode());
+
   collectUsedGlobalVariables(*M, Used, /*CompilerUsed*/ false);
 
   storage::Module Mod;
@@ -190,6 +204,8 @@ Error Builder::build(ArrayRef<Module *> IRMods) {
   storage::Header Hdr;
 
   assert(!IRMods.empty());
+  Hdr.Version = storage::Header::kCurrentVersion;
+  setStr(Hdr.Producer, getExpectedProducerName());
   setStr(Hdr.TargetTriple, IRMods[0]->getTargetTriple());
   setStr(Hdr.SourceFileName, IRMods[0]->getSourceFileName());
   TT = Triple(IRMods[0]->getTargetTriple());
@@ -229,3 +245,84 @@ Error irsymtab::build(ArrayRef<Module *> Mods, SmallVector<char, 0> &Symtab,
                       SmallVector<char, 0> &Strtab) {
   return Builder(Symtab, Strtab).build(Mods);
 }
+
+/// Return true if every object of \p R lies within \p Symtab.
+template <typename T>
+static bool inBounds(storage::Range<T> R, StringRef Symtab) {
+  return R.Offset <= Symtab.size() &&
+         R.Size <= (Symtab.size() - R.Offset) / sizeof(T);
+}
+
+/// Return true if \p Symtab and \p Strtab were built by this version of LLVM
+/// for \p NumMods modules, and are safe to read.
+static bool isUpToDate(StringRef Symtab, StringRef Strtab, unsigned NumMods) {
+  // Every string is null-terminated, so checking the offsets is enough.
+  if (Symtab.size() < sizeof(storage::Header) || Strtab.empty() ||
+      Strtab.back() != '\0')
+    return false;
+  auto ValidStr = [&](storage::Str S) { return S.Offset < Strtab.size(); };
+
+  auto &Hdr = *reinterpret_cast<const storage::Header *>(Symtab.data());
+  if (Hdr.Version != storage::Header::kCurrentVersion ||
+      !ValidStr(Hdr.Producer) ||
+      Hdr.Producer.get(Strtab) != getExpectedProducerName() ||
+      Hdr.Modules.Size != NumMods)
+    return false;
+  if (!inBounds(Hdr.Modules, Symtab) || !inBounds(Hdr.Comdats, Symtab) ||
+      !inBounds(Hdr.Symbols, Symtab) || !inBounds(Hdr.Uncommons, Symtab) ||
+      !ValidStr(Hdr.TargetTriple) || !ValidStr(Hdr.SourceFileName) ||
+      !ValidStr(Hdr.COFFLinkerOpts))
+    return false;
+
+  uint32_t NumComdats = Hdr.Comdats.Size, NumSyms = Hdr.Symbols.Size,
+           NumUncommons = Hdr.Uncommons.Size;
+  for (const storage::Module &M : Hdr.Modules.get(Symtab))
+    if (M.Begin > M.End || M.End > NumSyms)
+      return false;
+  for (const storage::Comdat &C : Hdr.Comdats.get(Symtab))
+    if (!ValidStr(C.Name))
+      return false;
+  for (const storage::Symbol &Sym : Hdr.Symbols.get(Symtab))
+    if (!ValidStr(Sym.Name) || !ValidStr(Sym.IRName) ||
+        (Sym.ComdatIndex != -1u && Sym.ComdatIndex >= NumComdats) ||
+        (Sym.UncommonIndex != -1u && Sym.UncommonIndex >= NumUncommons))
+      return false;
+  for (const storage::Uncommon &Unc : Hdr.Uncommons.get(Symtab))
+    if (!ValidStr(Unc.COFFWeakExternFallbackName))
+      return false;
+  return true;
+}
+
+Expected<FileContents> irsymtab::readBitcode(const BitcodeFileContents &BFC) {
+  if (BFC.Mods.empty())
+    return make_error<StringError>("Bitcode file does not contain any modules",
+                                   inconvertibleErrorCode());
+
+  FileContents FC;
+  FC.Mods = BFC.Mods;
+  if (isUpToDate(BFC.Symtab, BFC.StrtabForSymtab, BFC.Mods.size())) {
+    FC.Symtab = BFC.Symtab;
+    FC.Strtab = BFC.StrtabForSymtab;
+    return std::move(FC);
+  }
+
+  LLVMContext Ctx;
+  std::vector<Module *> Mods;
+  std::vector<std::unique_ptr<Module>> OwnedMods;
+  for (BitcodeModule BM : BFC.Mods) {
+    Expected<std::unique_ptr<Module>> MOrErr =
+        BM.getLazyModule(Ctx, /*ShouldLazyLoadMetadata*/ true,
+                         /*IsImporting*/ false);
+    if (!MOrErr)
+      return MOrErr.takeError();
+
+    Mods.push_back(MOrErr->get());
+    OwnedMods.push_back(std::move(*MOrErr));
+  }
+
+  if (Error E = build(Mods, FC.OwnedSymtab, FC.OwnedStrtab))
+    return std::move(E);
+  FC.Symtab = {FC.OwnedSymtab.data(), FC.OwnedSymtab.size()};
+  FC.Strtab = {FC.OwnedStrtab.data(), FC.OwnedStrtab.size()};
+  return std::move(FC);
+}
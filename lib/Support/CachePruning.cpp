@@ -13,17 +13,21 @@
 
 #include "llvm/Support/CachePruning.h"
 
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 
 #define DEBUG_TYPE "cache-pruning"
 
-#include <set>
+#include <algorithm>
 #include <system_error>
+#include <vector>
 
 using namespace llvm;
 
@@ -92,6 +96,31 @@ llvm::parseCachePruningPolicy(StringRef PolicyStr) {
                                            "' must be between 0 and 100",
                                        inconvertibleErrorCode());
       Policy.PercentageOfAvailableSpace = Size;
+    } else if (Key == "cache_size_bytes") {
+      StringRef SizeStr = Value;
+      uint64_t Mult = 1;
+      switch (Value.empty() ? '\0' : Value.back()) {
+      case 'k':
+        Mult = 1024;
+        Value = Value.drop_back();
+        break;
+      case 'm':
+        Mult = 1024 * 1024;
+        Value = Value.drop_back();
+        break;
+      case 'g':
+        Mult = 1024 * 1024 * 1024;
+        Value = Value.drop_back();
+        break;
+      }
+      uint64_t Size;
+      if (Value.getAsInteger(0, Size))
+        return make_error<StringError>("'" + Value + "' not an integer",
+                                       inconvertibleErrorCode());
+      if (Size > UINT64_MAX / Mult)
+        return make_error<StringError>("'" + SizeStr + "' too large",
+                                       inconvertibleErrorCode());
+      Policy.MaxSizeBytes = Size * Mult;
     } else {
       return make_error<StringError>("Unknown key: '" + Key + "'",
                                      inconvertibleErrorCode());
@@ -101,6 +130,139 @@ llvm::parseCachePruningPolicy(StringRef PolicyStr) {
   return Policy;
 }
 
+namespace {
+/// The size and last access time of a cache file.
+struct CacheFileInfo {
+  sys::TimePoint<> Time;
+  uint64_t Size = 0;
+  std::string Path;
+};
+} // end anonymous namespace
+
+static const char CacheIndexName[] = "llvmcache.index";
+
+/// The index is compacted by recordCacheAccess() when it has more than this
+/// many lines per cache file.
+static const unsigned MaxIndexLinesPerFile = 4;
+/// How often recordCacheAccess() checks whether the index needs compacting,
+/// in bytes of index.
+static const uint64_t IndexCompactionCheckInterval = 64 * 1024;
+
+/// Read the index of the cache directory \p Path. An index line is
+/// "<access time> <size> <file name>"; the size and time of a file are taken
+/// from its latest access. The number of valid lines is stored in
+/// \p NumLines if it is not null.
+static StringMap<CacheFileInfo> readCacheIndex(StringRef Path,
+                                               unsigned *NumLines = nullptr) {
+  StringMap<CacheFileInfo> Index;
+  SmallString<128> IndexPath(Path);
+  sys::path::append(IndexPath, CacheIndexName);
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+      MemoryBuffer::getFile(IndexPath);
+  if (!MBOrErr)
+    return Index;
+  StringRef Data = (*MBOrErr)->getBuffer();
+  while (!Data.empty()) {
+    StringRef Line;
+    std::tie(Line, Data) = Data.split('\n');
+    StringRef TimeStr, SizeStr, Name;
+    std::tie(TimeStr, Line) = Line.split(' ');
+    std::tie(SizeStr, Name) = Line.split(' ');
+    uint64_t Time, Size;
+    // Skip lines that a concurrent writer has not finished.
+    if (TimeStr.getAsInteger(10, Time) || SizeStr.getAsInteger(10, Size) ||
+        !Name.startswith("llvmcache-"))
+      continue;
+    if (NumLines)
+      ++*NumLines;
+    CacheFileInfo &Info = Index[Name];
+    if (sys::toTimePoint(Time) < Info.Time)
+      continue;
+    Info.Time = sys::toTimePoint(Time);
+    Info.Size = Size;
+  }
+  return Index;
+}
+
+/// Replace the index of the cache directory \p Path with \p Files, the files
+/// kept by pruning. The accesses that other processes recorded while pruning
+/// are merged in first; those to the \p Removed files are dropped. Only the
+/// accesses recorded between this merge and the rename of the new index are
+/// lost, which just means that these files are stat()ed by the next pruning.
+static void writeCacheIndex(StringRef Path, std::vector<CacheFileInfo> Files,
+                            const StringSet<> &Removed) {
+  StringMap<CacheFileInfo> Latest = readCacheIndex(Path);
+  for (CacheFileInfo &File : Files) {
+    auto Entry = Latest.find(sys::path::filename(File.Path));
+    if (Entry == Latest.end())
+      continue;
+    if (Entry->second.Time > File.Time) {
+      File.Time = Entry->second.Time;
+      File.Size = Entry->second.Size;
+    }
+    Latest.erase(Entry);
+  }
+  // The remaining entries are for files created while pruning.
+  for (auto &Entry : Latest) {
+    if (Removed.count(Entry.first()))
+      continue;
+    Entry.second.Path = Entry.first();
+    Files.push_back(std::move(Entry.second));
+  }
+
+  SmallString<128> IndexPath(Path), TempModel(Path), TempPath;
+  sys::path::append(IndexPath, CacheIndexName);
+  if (Files.empty()) {
+    sys::fs::remove(IndexPath);
+    return;
+  }
+  sys::path::append(TempModel, "llvmcache.index.tmp%%%%%%");
+  int TempFD;
+  if (sys::fs::createUniqueFile(TempModel, TempFD, TempPath))
+    return;
+  {
+    raw_fd_ostream OS(TempFD, /* ShouldClose */ true);
+    for (const CacheFileInfo &File : Files)
+      OS << sys::toTimeT(File.Time) << ' ' << File.Size << ' '
+         << sys::path::filename(File.Path) << '\n';
+  }
+  if (sys::fs::rename(TempPath, IndexPath))
+    sys::fs::remove(TempPath);
+}
+
+void llvm::recordCacheAccess(StringRef EntryPath, uint64_t Size,
+                             sys::TimePoint<> Time) {
+  SmallString<128> IndexPath(sys::path::parent_path(EntryPath));
+  sys::path::append(IndexPath, CacheIndexName);
+  SmallString<128> Line;
+  raw_svector_ostream(Line) << sys::toTimeT(Time) << ' ' << Size << ' '
+                            << sys::path::filename(EntryPath) << '\n';
+  int FD;
+  if (sys::fs::openFileForWrite(IndexPath, FD, sys::fs::F_Append))
+    return;
+  raw_fd_ostream OS(FD, /* ShouldClose */ true);
+  // An unbuffered stream writes the line with a single write() to a file
+  // opened with O_APPEND, which doesn't interleave with other appends.
+  OS.SetUnbuffered();
+  OS << Line;
+
+  // The index is otherwise only rewritten by pruneCache(), which may run
+  // rarely or never. Once in a while, compact it if most of its lines are
+  // stale, so that its size stays proportional to the number of cache files.
+  sys::fs::file_status Status;
+  if (sys::fs::status(FD, Status))
+    return;
+  uint64_t End = Status.getSize();
+  if ((End - Line.size()) / IndexCompactionCheckInterval ==
+      End / IndexCompactionCheckInterval)
+    return;
+  StringRef CacheDir = sys::path::parent_path(EntryPath);
+  unsigned NumLines = 0;
+  StringMap<CacheFileInfo> Index = readCacheIndex(CacheDir, &NumLines);
+  if (NumLines > MaxIndexLinesPerFile * Index.size())
+    writeCacheIndex(CacheDir, {}, StringSet<>());
+}
+
 /// Prune the cache of files that haven't been accessed in a long time.
 bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy) {
   using namespace std::chrono;
@@ -119,7 +281,7 @@ bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy) {
       std::min(Policy.PercentageOfAvailableSpace, 100u);
 
   if (Policy.Expiration == seconds(0) &&
-      Policy.PercentageOfAvailableSpace == 0) {
+      Policy.PercentageOfAvailableSpace == 0 && Policy.MaxSizeBytes == 0) {
     DEBUG(dbgs() << "No pruning settings set, exit early\n");
     // Nothing will be pruned, early exit
     return false;
@@ -139,7 +301,7 @@ bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy) {
       return false;
     }
   } else {
-    if (Policy.Interval == seconds(0)) {
+    if (Policy.Interval != seconds(0)) {
       // Check whether the time stamp is older than our pruning interval.
       // If not, do nothing.
       const auto TimeStampModTime = FileStatus.getLastModificationTime();
@@ -157,23 +319,16 @@ bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy) {
     writeTimestampFile(TimestampFile);
   }
 
-  bool ShouldComputeSize = (Policy.PercentageOfAvailableSpace > 0);
+  bool ShouldComputeSize =
+      Policy.PercentageOfAvailableSpace > 0 || Policy.MaxSizeBytes > 0;
 
-  // Keep track of space
-  std::set<std::pair<uint64_t, std::string>> FileSizes;
+  // The files that stay in the cache, with their size and last access time.
+  std::vector<CacheFileInfo> Files;
+  StringSet<> Removed;
   uint64_t TotalSize = 0;
-  // Helper to add a path to the set of files to consider for size-based
-  // pruning, sorted by size.
-  auto AddToFileListForSizePruning =
-      [&](StringRef Path) {
-        if (!ShouldComputeSize)
-          return;
-        TotalSize += FileStatus.getSize();
-        FileSizes.insert(
-            std::make_pair(FileStatus.getSize(), std::string(Path)));
-      };
-
-  // Walk the entire directory cache, looking for unused files.
+
+  // Walk the entire directory cache, looking for cache files.
+  std::vector<std::string> Paths;
   std::error_code EC;
   SmallString<128> CachePathNative;
   sys::path::native(Path, CachePathNative);
@@ -181,58 +336,85 @@ bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy) {
   for (sys::fs::directory_iterator File(CachePathNative, EC), FileEnd;
        File != FileEnd && !EC; File.increment(EC)) {
     // Ignore any files not beginning with the string "llvmcache-". This
-    // includes the timestamp file as well as any files created by the user.
-    // This acts as a safeguard against data loss if the user specifies the
-    // wrong directory as their cache directory.
-    if (!sys::path::filename(File->path()).startswith("llvmcache-"))
+    // includes the timestamp and index files as well as any files created by
+    // the user. This acts as a safeguard against data loss if the user
+    // specifies the wrong directory as their cache directory.
+    StringRef FileName = sys::path::filename(File->path());
+    if (!FileName.startswith("llvmcache-"))
       continue;
+    Paths.push_back(File->path());
+  }
 
-    // Look at this file. If we can't stat it, there's nothing interesting
-    // there.
-    if (sys::fs::status(File->path(), FileStatus)) {
-      DEBUG(dbgs() << "Ignore " << File->path() << " (can't stat)\n");
-      continue;
+  // Take the size and access time of each file from the index if it has them.
+  // Otherwise look at the file. The index is read after the walk, so that it
+  // has the accesses recorded during the walk.
+  StringMap<CacheFileInfo> Index = readCacheIndex(Path);
+  for (std::string &FilePath : Paths) {
+    CacheFileInfo Info;
+    auto IndexEntry = Index.find(sys::path::filename(FilePath));
+    if (IndexEntry != Index.end()) {
+      Info.Time = IndexEntry->second.Time;
+      Info.Size = IndexEntry->second.Size;
+    } else {
+      // If we can't stat it, there's nothing interesting there.
+      if (sys::fs::status(FilePath, FileStatus)) {
+        DEBUG(dbgs() << "Ignore " << FilePath << " (can't stat)\n");
+        continue;
+      }
+      Info.Time = FileStatus.getLastAccessedTime();
+      Info.Size = FileStatus.getSize();
     }
+    Info.Path = std::move(FilePath);
 
     // If the file hasn't been used recently enough, delete it
-    const auto FileAccessTime = FileStatus.getLastAccessedTime();
-    auto FileAge = CurrentTime - FileAccessTime;
-    if (FileAge > Policy.Expiration) {
-      DEBUG(dbgs() << "Remove " << File->path() << " ("
+    auto FileAge = CurrentTime - Info.Time;
+    if (Policy.Expiration != seconds(0) && FileAge > Policy.Expiration) {
+      DEBUG(dbgs() << "Remove " << Info.Path << " ("
                    << duration_cast<seconds>(FileAge).count() << "s old)\n");
-      sys::fs::remove(File->path());
+      sys::fs::remove(Info.Path);
+      Removed.insert(sys::path::filename(Info.Path));
       continue;
     }
 
-    // Leave it here for now, but add it to the list of size-based pruning.
-    AddToFileListForSizePruning(File->path());
+    // Leave it here for now, but consider it for size-based pruning.
+    TotalSize += Info.Size;
+    Files.push_back(std::move(Info));
   }
 
   // Prune for size now if needed
   if (ShouldComputeSize) {
-    auto ErrOrSpaceInfo = sys::fs::disk_space(Path);
-    if (!ErrOrSpaceInfo) {
-      report_fatal_error("Can't get available size");
+    uint64_t SizeLimit = Policy.MaxSizeBytes ? Policy.MaxSizeBytes : UINT64_MAX;
+    if (Policy.PercentageOfAvailableSpace > 0) {
+      auto ErrOrSpaceInfo = sys::fs::disk_space(Path);
+      if (!ErrOrSpaceInfo) {
+        report_fatal_error("Can't get available size");
+      }
+      sys::fs::space_info SpaceInfo = ErrOrSpaceInfo.get();
+      auto AvailableSpace = TotalSize + SpaceInfo.free;
+      SizeLimit = std::min<uint64_t>(
+          SizeLimit, AvailableSpace / 100 * Policy.PercentageOfAvailableSpace);
     }
-    sys::fs::space_info SpaceInfo = ErrOrSpaceInfo.get();
-    auto AvailableSpace = TotalSize + SpaceInfo.free;
-    auto FileAndSize = FileSizes.rbegin();
-    DEBUG(dbgs() << "Occupancy: " << ((100 * TotalSize) / AvailableSpace)
-                 << "% target is: " << Policy.PercentageOfAvailableSpace
-                 << "\n");
-    // Remove the oldest accessed files first, till we get below the threshold
-    while (((100 * TotalSize) / AvailableSpace) >
-               Policy.PercentageOfAvailableSpace &&
-           FileAndSize != FileSizes.rend()) {
+    DEBUG(dbgs() << "Occupancy: " << TotalSize << " bytes, target is: "
+                 << SizeLimit << " bytes\n");
+    // Remove the least recently used files first, till we get below the limit.
+    std::stable_sort(Files.begin(), Files.end(),
+                     [](const CacheFileInfo &A, const CacheFileInfo &B) {
+                       return A.Time < B.Time;
+                     });
+    auto FirstKept = Files.begin();
+    for (; TotalSize > SizeLimit && FirstKept != Files.end(); ++FirstKept) {
       // Remove the file.
-      sys::fs::remove(FileAndSize->second);
+      sys::fs::remove(FirstKept->Path);
+      Removed.insert(sys::path::filename(FirstKept->Path));
       // Update size
-      TotalSize -= FileAndSize->first;
-      DEBUG(dbgs() << " - Remove " << FileAndSize->second << " (size "
-                   << FileAndSize->first << "), new occupancy is " << TotalSize
-                   << "%\n");
-      ++FileAndSize;
+      TotalSize -= FirstKept->Size;
+      DEBUG(dbgs() << " - Remove " << FirstKept->Path << " (size "
+                   << FirstKept->Size << "), new occupancy is " << TotalSize
+                   << " bytes\n");
     }
+    Files.erase(Files.begin(), FirstKept);
   }
+
+  writeCacheIndex(Path, std::move(Files), Removed);
   return true;
 }
@@ -0,0 +1,72 @@
+//===- llvm/Support/Parallel.cpp - Parallel algorithms --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Parallel.h"
+#include "llvm/Config/llvm-config.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace llvm;
+using namespace llvm::parallel;
+
+/// Requested number of threads, 0 standing for the hardware concurrency.
+static std::atomic<unsigned> RequestedThreadCount(0);
+
+unsigned parallel::getThreadCount() {
+#if LLVM_ENABLE_THREADS
+  // Resolve the default once, the algorithms query this on every call.
+  static unsigned ThreadCount = [] {
+    unsigned Count = RequestedThreadCount;
+    if (!Count)
+      Count = std::thread::hardware_concurrency();
+    return std::max(1u, Count);
+  }();
+  return ThreadCount;
+#else
+  return 1;
+#endif
+}
+
+void parallel::setThreadCount(unsigned ThreadCount) {
+  RequestedThreadCount = ThreadCount;
+}
+
+/// The pool all the parallel algorithms run on, created on first use.
+static ThreadPool &getExecutor() {
+  static ThreadPool Executor(getThreadCount());
+  return Executor;
+}
+
+void TaskGroup::spawn(std::function<void()> F) {
+  if (getThreadCount() == 1) {
+    F();
+    return;
+  }
+  auto Future = getExecutor().async(std::move(F));
+  std::lock_guard<std::mutex> LockGuard(Lock);
+  Futures.push_back(std::move(Future));
+}
+
+void TaskGroup::sync() {
+  // Tasks of the group may spawn more tasks while we wait, so pick the
+  // futures one at a time until there are none left. The executor runs other
+  // tasks while waiting if we are one of its threads.
+  while (true) {
+    std::shared_future<ThreadPool::VoidTy> Future;
+    {
+      std::lock_guard<std::mutex> LockGuard(Lock);
+      if (Futures.empty())
+        return;
+      Future = std::move(Futures.back());
+      Futures.pop_back();
+    }
+    getExecutor().wait(Future);
+  }
+}
@@ -13,89 +13,172 @@
 
 #include "llvm/Support/ThreadPool.h"
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <chrono>
+
 using namespace llvm;
 
 #if LLVM_ENABLE_THREADS
 
+/// The pool the current thread is a worker of, if any, and its index in it.
+static LLVM_THREAD_LOCAL ThreadPool *CurrentPool = nullptr;
+static LLVM_THREAD_LOCAL unsigned CurrentWorker = 0;
+
 // Default to std::thread::hardware_concurrency
 ThreadPool::ThreadPool() : ThreadPool(std::thread::hardware_concurrency()) {}
 
 ThreadPool::ThreadPool(unsigned ThreadCount)
-    : ActiveThreads(0), EnableFlag(true) {
+    : PendingTasks(0), OutstandingTasks(0), IdleThreads(0), EnableFlag(true) {
+  // All the deques have to exist before any worker may try to steal from them.
+  WorkerQueues.reserve(ThreadCount);
+  for (unsigned ThreadID = 0; ThreadID < ThreadCount; ++ThreadID)
+    WorkerQueues.push_back(llvm::make_unique<WorkerQueue>());
+
   // Create ThreadCount threads that will loop forever, wait on QueueCondition
   // for tasks to be queued or the Pool to be destroyed.
   Threads.reserve(ThreadCount);
-  for (unsigned ThreadID = 0; ThreadID < ThreadCount; ++ThreadID) {
-    Threads.emplace_back([&] {
-      while (true) {
-        PackagedTaskTy Task;
-        {
-          std::unique_lock<std::mutex> LockGuard(QueueLock);
-          // Wait for tasks to be pushed in the queue
-          QueueCondition.wait(LockGuard,
-                              [&] { return !EnableFlag || !Tasks.empty(); });
-          // Exit condition
-          if (!EnableFlag && Tasks.empty())
-            return;
-          // Yeah, we have a task, grab it and release the lock on the queue
-
-          // We first need to signal that we are active before popping the queue
-          // in order for wait() to properly detect that even if the queue is
-          // empty, there is still a task in flight.
-          {
-            ++ActiveThreads;
-            std::unique_lock<std::mutex> LockGuard(CompletionLock);
-          }
-          Task = std::move(Tasks.front());
-          Tasks.pop();
-        }
-        // Run the task we just grabbed
+  for (unsigned ThreadID = 0; ThreadID < ThreadCount; ++ThreadID)
+    Threads.emplace_back([this, ThreadID] { workerLoop(ThreadID); });
+}
+
+void ThreadPool::workerLoop(unsigned Index) {
+  CurrentPool = this;
+  CurrentWorker = Index;
+  while (true) {
+    PackagedTaskTy Task;
+    if (popTask(Index, Task)) {
+      runTask(Task);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> LockGuard(QueueLock);
+    // Announce that we are about to sleep before checking PendingTasks: a
+    // submitter increments PendingTasks before reading IdleThreads, so at
+    // least one of the two sides sees the other and no wakeup is lost.
+    ++IdleThreads;
+    // Wait for tasks to be pushed in any of the queues
+    QueueCondition.wait(LockGuard,
+                        [&] { return !EnableFlag || PendingTasks; });
+    --IdleThreads;
+    // Exit condition
+    if (!EnableFlag && !PendingTasks)
+      return;
+  }
+}
+
+bool ThreadPool::popTask(unsigned Index, PackagedTaskTy &Task) {
+  // Our own deque first, newest task first for locality.
+  {
+    WorkerQueue &Queue = *WorkerQueues[Index];
+    std::unique_lock<std::mutex> LockGuard(Queue.Lock);
+    if (!Queue.Tasks.empty()) {
+      Task = std::move(Queue.Tasks.back());
+      Queue.Tasks.pop_back();
+      --PendingTasks;
+      return true;
+    }
+  }
+
+  // Then the tasks submitted from outside the pool, in submission order.
+  {
+    std::unique_lock<std::mutex> LockGuard(InjectionLock);
+    if (!Tasks.empty()) {
+      Task = std::move(Tasks.front());
+      Tasks.pop_front();
+      --PendingTasks;
+      return true;
+    }
+  }
+
+  // Finally steal the oldest task of one of the other workers.
+  unsigned NumQueues = WorkerQueues.size();
+  for (unsigned I = 1; I < NumQueues; ++I) {
+    WorkerQueue &Victim = *WorkerQueues[(Index + I) % NumQueues];
+    std::unique_lock<std::mutex> LockGuard(Victim.Lock);
+    if (!Victim.Tasks.empty()) {
+      Task = std::move(Victim.Tasks.front());
+      Victim.Tasks.pop_front();
+      --PendingTasks;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::runTask(PackagedTaskTy &Task) {
 #ifndef _MSC_VER
-        Task();
+  Task();
 #else
-        Task(/* unused */ false);
+  Task(/* unused */ false);
 #endif
 
-        {
-          // Adjust `ActiveThreads`, in case someone waits on ThreadPool::wait()
-          std::unique_lock<std::mutex> LockGuard(CompletionLock);
-          --ActiveThreads;
-        }
-
-        // Notify task completion, in case someone waits on ThreadPool::wait()
-        CompletionCondition.notify_all();
-      }
-    });
+  // Notify task completion, in case someone waits on ThreadPool::wait()
+  if (--OutstandingTasks == 0) {
+    std::unique_lock<std::mutex> LockGuard(CompletionLock);
+    CompletionCondition.notify_all();
   }
 }
 
 void ThreadPool::wait() {
-  // Wait for all threads to complete and the queue to be empty
+  assert(CurrentPool != this &&
+         "ThreadPool::wait() called from one of the pool's own tasks");
+  // Wait for all the submitted tasks to complete
   std::unique_lock<std::mutex> LockGuard(CompletionLock);
-  // The order of the checks for ActiveThreads and Tasks.empty() matters because
-  // any active threads might be modifying the Tasks queue, and this would be a
-  // race.
-  CompletionCondition.wait(LockGuard,
-                           [&] { return !ActiveThreads && Tasks.empty(); });
+  CompletionCondition.wait(LockGuard, [&] { return !OutstandingTasks; });
+}
+
+void ThreadPool::wait(const std::shared_future<VoidTy> &Future) {
+  if (CurrentPool != this) {
+    Future.wait();
+    return;
+  }
+  // We are one of the workers: blocking here could starve the pool if the
+  // task we wait for is still queued, so help running tasks in the meantime.
+  while (Future.wait_for(std::chrono::seconds(0)) !=
+         std::future_status::ready) {
+    PackagedTaskTy Task;
+    if (popTask(CurrentWorker, Task)) {
+      runTask(Task);
+      continue;
+    }
+    // Nothing is queued, so the task is running on another worker. Block on
+    // it, but not for long, as it may spawn subtasks that we could help with.
+    Future.wait_for(std::chrono::milliseconds(1));
+  }
 }
 
 std::shared_future<ThreadPool::VoidTy> ThreadPool::asyncImpl(TaskTy Task) {
   /// Wrap the Task in a packaged_task to return a future object.
   PackagedTaskTy PackagedTask(std::move(Task));
   auto Future = PackagedTask.get_future();
-  {
-    // Lock the queue and push the new task
-    std::unique_lock<std::mutex> LockGuard(QueueLock);
 
-    // Don't allow enqueueing after disabling the pool
-    assert(EnableFlag && "Queuing a thread during ThreadPool destruction");
+  // Don't allow enqueueing after disabling the pool
+  assert(EnableFlag && "Queuing a thread during ThreadPool destruction");
+
+  // Account for the task before it becomes visible to the workers, wait()
+  // must not observe an empty pool while it is in flight, and popTask() must
+  // not decrement PendingTasks before it was incremented.
+  ++OutstandingTasks;
+  ++PendingTasks;
+  if (CurrentPool == this) {
+    // Spawned from one of our tasks: keep it local to this worker.
+    WorkerQueue &Queue = *WorkerQueues[CurrentWorker];
+    std::unique_lock<std::mutex> LockGuard(Queue.Lock);
+    Queue.Tasks.push_back(std::move(PackagedTask));
+  } else {
+    std::unique_lock<std::mutex> LockGuard(InjectionLock);
+    Tasks.push_back(std::move(PackagedTask));
+  }
 
-    Tasks.push(std::move(PackagedTask));
+  // Only bother the sleeping workers if there are some.
+  if (IdleThreads) {
+    std::unique_lock<std::mutex> LockGuard(QueueLock);
+    QueueCondition.notify_one();
   }
-  QueueCondition.notify_one();
   return Future.share();
 }
 
@@ -116,7 +199,7 @@ ThreadPool::ThreadPool() : ThreadPool(0) {}
 
 // No threads are launched, issue a warning if ThreadCount is not 0
 ThreadPool::ThreadPool(unsigned ThreadCount)
-    : ActiveThreads(0) {
+    : PendingTasks(0), OutstandingTasks(0), IdleThreads(0) {
   if (ThreadCount) {
     errs() << "Warning: request a ThreadPool with " << ThreadCount
            << " threads, but LLVM_ENABLE_THREADS has been turned off\n";
@@ -127,7 +210,7 @@ void ThreadPool::wait() {
   // Sequential implementation running the tasks
   while (!Tasks.empty()) {
     auto Task = std::move(Tasks.front());
-    Tasks.pop();
+    Tasks.pop_front();
 #ifndef _MSC_VER
         Task();
 #else
@@ -136,6 +219,11 @@ void ThreadPool::wait() {
   }
 }
 
+void ThreadPool::wait(const std::shared_future<VoidTy> &Future) {
+  // The future is deferred: this runs the task in the current thread.
+  Future.wait();
+}
+
 std::shared_future<ThreadPool::VoidTy> ThreadPool::asyncImpl(TaskTy Task) {
 #ifndef _MSC_VER
   // Get a Future with launch::deferred execution using std::async
@@ -147,7 +235,7 @@ std::shared_future<ThreadPool::VoidTy> ThreadPool::asyncImpl(TaskTy Task) {
   auto Future = std::async(std::launch::deferred, std::move(Task), false).share();
   PackagedTaskTy PackagedTask([Future](bool) -> bool { Future.get(); return false; });
 #endif
-  Tasks.push(std::move(PackagedTask));
+  Tasks.push_back(std::move(PackagedTask));
   return Future;
 }
 
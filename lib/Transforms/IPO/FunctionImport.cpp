@@ -13,12 +13,15 @@
 
 #include "llvm/Transforms/IPO/FunctionImport.h"
 
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/IR/AutoUpgrade.h"
 #include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/FlatSummaryIndex.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
@@ -28,6 +31,11 @@
 #include "llvm/Object/ModuleSummaryIndexObjectFile.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SHA1.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Transforms/IPO/Internalize.h"
 #include "llvm/Transforms/Utils/FunctionImportUtils.h"
@@ -40,6 +48,8 @@ STATISTIC(NumImportedFunctions, "Number of functions imported");
 STATISTIC(NumImportedModules, "Number of modules imported from");
 STATISTIC(NumDeadSymbols, "Number of dead stripped symbols in index");
 STATISTIC(NumLiveSymbols, "Number of live symbols in index");
+STATISTIC(NumImportListsReused,
+          "Number of import lists reused from the previous link");
 
 /// Limit on instruction count of imported functions.
 static cl::opt<unsigned> ImportInstrLimit(
@@ -105,6 +115,10 @@ static std::unique_ptr<Module> loadFile(const std::string &FileName,
 
 namespace {
 
+typedef FlatSummaryIndex::ModuleIndex ModuleIndex;
+typedef FlatSummaryIndex::ValueIndex ValueIndex;
+typedef FlatSummaryIndex::SummaryIndex SummaryIndex;
+
 /// Given a list of possible callee implementation for a call site, select one
 /// that fits the \p Threshold.
 ///
@@ -115,98 +129,107 @@ namespace {
 ///   number of source modules parsed/linked.
 /// - One that has PGO data attached.
 /// - [insert you fancy metric here]
-static const GlobalValueSummary *
-selectCallee(const ModuleSummaryIndex &Index,
-             const GlobalValueSummaryList &CalleeSummaryList,
-             unsigned Threshold, StringRef CallerModulePath) {
-  auto It = llvm::find_if(
-      CalleeSummaryList,
-      [&](const std::unique_ptr<GlobalValueSummary> &SummaryPtr) {
-        auto *GVSummary = SummaryPtr.get();
-        if (GlobalValue::isInterposableLinkage(GVSummary->linkage()))
-          // There is no point in importing these, we can't inline them
-          return false;
-        if (auto *AS = dyn_cast<AliasSummary>(GVSummary)) {
-          GVSummary = &AS->getAliasee();
-          // Alias can't point to "available_externally". However when we import
-          // linkOnceODR the linkage does not change. So we import the alias
-          // and aliasee only in this case.
-          // FIXME: we should import alias as available_externally *function*,
-          // the destination module does need to know it is an alias.
-          if (!GlobalValue::isLinkOnceODRLinkage(GVSummary->linkage()))
-            return false;
-        }
+static SummaryIndex selectCallee(const FlatSummaryIndex &Index,
+                                 ValueIndex Callee, unsigned Threshold,
+                                 ModuleIndex CallerModule) {
+  auto CalleeSummaryList = Index.summaries(Callee);
+  auto It = llvm::find_if(CalleeSummaryList, [&](SummaryIndex S) {
+    if (GlobalValue::isInterposableLinkage(Index.getLinkage(S)))
+      // There is no point in importing these, we can't inline them
+      return false;
+    if (Index.getKind(S) == GlobalValueSummary::AliasKind) {
+      S = Index.getAliasee(S);
+      // Alias can't point to "available_externally". However when we import
+      // linkOnceODR the linkage does not change. So we import the alias
+      // and aliasee only in this case.
+      // FIXME: we should import alias as available_externally *function*,
+      // the destination module does need to know it is an alias.
+      if (S == FlatSummaryIndex::NotFound ||
+          !GlobalValue::isLinkOnceODRLinkage(Index.getLinkage(S)))
+        return false;
+    }
 
-        auto *Summary = cast<FunctionSummary>(GVSummary);
-
-        // If this is a local function, make sure we import the copy
-        // in the caller's module. The only time a local function can
-        // share an entry in the index is if there is a local with the same name
-        // in another module that had the same source file name (in a different
-        // directory), where each was compiled in their own directory so there
-        // was not distinguishing path.
-        // However, do the import from another module if there is only one
-        // entry in the list - in that case this must be a reference due
-        // to indirect call profile data, since a function pointer can point to
-        // a local in another module.
-        if (GlobalValue::isLocalLinkage(Summary->linkage()) &&
-            CalleeSummaryList.size() > 1 &&
-            Summary->modulePath() != CallerModulePath)
-          return false;
-
-        if (Summary->instCount() > Threshold)
-          return false;
-
-        if (Summary->notEligibleToImport())
-          return false;
-
-        return true;
-      });
+    if (Index.getKind(S) != GlobalValueSummary::FunctionKind)
+      return false;
+
+    // If this is a local function, make sure we import the copy
+    // in the caller's module. The only time a local function can
+    // share an entry in the index is if there is a local with the same name
+    // in another module that had the same source file name (in a different
+    // directory), where each was compiled in their own directory so there
+    // was not distinguishing path.
+    // However, do the import from another module if there is only one
+    // entry in the list - in that case this must be a reference due
+    // to indirect call profile data, since a function pointer can point to
+    // a local in another module.
+    if (GlobalValue::isLocalLinkage(Index.getLinkage(S)) &&
+        CalleeSummaryList.end() - CalleeSummaryList.begin() > 1 &&
+        Index.getModule(S) != CallerModule)
+      return false;
+
+    if (Index.instCount(S) > Threshold)
+      return false;
+
+    if (Index.notEligibleToImport(S))
+      return false;
+
+    return true;
+  });
   if (It == CalleeSummaryList.end())
-    return nullptr;
+    return FlatSummaryIndex::NotFound;
 
-  return cast<GlobalValueSummary>(It->get());
+  return *It;
 }
 
-/// Return the summary for the function \p GUID that fits the \p Threshold, or
-/// null if there's no match.
-static const GlobalValueSummary *selectCallee(GlobalValue::GUID GUID,
-                                              unsigned Threshold,
-                                              const ModuleSummaryIndex &Index,
-                                              StringRef CallerModulePath) {
-  auto CalleeSummaryList = Index.findGlobalValueSummaryList(GUID);
-  if (CalleeSummaryList == Index.end())
-    return nullptr; // This function does not have a summary
-  return selectCallee(Index, CalleeSummaryList->second, Threshold,
-                      CallerModulePath);
-}
+using EdgeInfo = std::tuple<SummaryIndex /* FunctionSummary */,
+                            unsigned /* Threshold */, GlobalValue::GUID>;
 
-using EdgeInfo = std::tuple<const FunctionSummary *, unsigned /* Threshold */,
-                            GlobalValue::GUID>;
+/// Return true if \p Module defines \p V. When only \p FunctionsOnly, the
+/// definitions of other kinds of values are ignored.
+static bool isDefinedIn(const FlatSummaryIndex &Index, ModuleIndex Module,
+                        ValueIndex V, bool FunctionsOnly) {
+  if (Module == FlatSummaryIndex::NotFound)
+    return false;
+  SummaryIndex S = Index.findDefinedSummary(Module, V);
+  if (S == FlatSummaryIndex::NotFound)
+    return false;
+  return !FunctionsOnly ||
+         Index.getKind(S) == GlobalValueSummary::FunctionKind;
+}
 
 /// Compute the list of functions to import for a given caller. Mark these
 /// imported functions and the symbols they reference in their source module as
-/// exported from their source module.
+/// exported from their source module. The values whose summaries are looked at
+/// are added to \p Consulted.
 static void computeImportForFunction(
-    const FunctionSummary &Summary, const ModuleSummaryIndex &Index,
-    const unsigned Threshold, const GVSummaryMapTy &DefinedGVSummaries,
+    SummaryIndex Summary, const FlatSummaryIndex &Index,
+    const unsigned Threshold, ModuleIndex DestModule, bool FunctionsOnly,
     SmallVectorImpl<EdgeInfo> &Worklist,
     FunctionImporter::ImportMapTy &ImportList,
-    StringMap<FunctionImporter::ExportSetTy> *ExportLists = nullptr) {
-  for (auto &Edge : Summary.calls()) {
-    auto GUID = Edge.first.getGUID();
+    StringMap<FunctionImporter::ExportSetTy> *ExportLists = nullptr,
+    std::vector<ValueIndex> *Consulted = nullptr) {
+  for (auto &Edge : Index.calls(Summary)) {
+    ValueIndex Callee = Edge.callee();
+    auto GUID = Index.getGUID(Callee);
     DEBUG(dbgs() << " edge -> " << GUID << " Threshold:" << Threshold << "\n");
+    if (Consulted)
+      Consulted->push_back(Callee);
 
-    if (Index.findGlobalValueSummaryList(GUID) == Index.end()) {
+    if (!Index.isInIndex(Callee)) {
       // For SamplePGO, the indirect call targets for local functions will
       // have its original name annotated in profile. We try to find the
       // corresponding PGOFuncName as the GUID.
       GUID = Index.getGUIDFromOriginalID(GUID);
       if (GUID == 0)
         continue;
+      Callee = Index.findValue(GUID);
+      if (Callee == FlatSummaryIndex::NotFound)
+        continue;
+      if (Consulted)
+        Consulted->push_back(Callee);
     }
 
-    if (DefinedGVSummaries.count(GUID)) {
+    if (isDefinedIn(Index, DestModule, Callee, FunctionsOnly)) {
       DEBUG(dbgs() << "ignored! Target already in destination module.\n");
       continue;
     }
@@ -219,27 +242,24 @@ static void computeImportForFunction(
       return 1.0;
     };
 
-    const auto NewThreshold =
-        Threshold * GetBonusMultiplier(Edge.second.Hotness);
+    const auto NewThreshold = Threshold * GetBonusMultiplier(Edge.hotness());
 
-    auto *CalleeSummary =
-        selectCallee(GUID, NewThreshold, Index, Summary.modulePath());
-    if (!CalleeSummary) {
+    auto CalleeSummary = selectCallee(Index, Callee, NewThreshold,
+                                      Index.getModule(Summary));
+    if (CalleeSummary == FlatSummaryIndex::NotFound) {
       DEBUG(dbgs() << "ignored! No qualifying callee with summary found.\n");
       continue;
     }
     // "Resolve" the summary, traversing alias,
-    const FunctionSummary *ResolvedCalleeSummary;
-    if (isa<AliasSummary>(CalleeSummary)) {
-      ResolvedCalleeSummary = cast<FunctionSummary>(
-          &cast<AliasSummary>(CalleeSummary)->getAliasee());
-      assert(
-          GlobalValue::isLinkOnceODRLinkage(ResolvedCalleeSummary->linkage()) &&
-          "Unexpected alias to a non-linkonceODR in import list");
-    } else
-      ResolvedCalleeSummary = cast<FunctionSummary>(CalleeSummary);
+    SummaryIndex ResolvedCalleeSummary = CalleeSummary;
+    if (Index.getKind(CalleeSummary) == GlobalValueSummary::AliasKind) {
+      ResolvedCalleeSummary = Index.getAliasee(CalleeSummary);
+      assert(GlobalValue::isLinkOnceODRLinkage(
+                 Index.getLinkage(ResolvedCalleeSummary)) &&
+             "Unexpected alias to a non-linkonceODR in import list");
+    }
 
-    assert(ResolvedCalleeSummary->instCount() <= NewThreshold &&
+    assert(Index.instCount(ResolvedCalleeSummary) <= NewThreshold &&
            "selectCallee() didn't honor the threshold");
 
     auto GetAdjustedThreshold = [](unsigned Threshold, bool IsHotCallsite) {
@@ -251,10 +271,10 @@ static void computeImportForFunction(
       return Threshold * ImportInstrFactor;
     };
 
-    bool IsHotCallsite = Edge.second.Hotness == CalleeInfo::HotnessType::Hot;
+    bool IsHotCallsite = Edge.hotness() == CalleeInfo::HotnessType::Hot;
     const auto AdjThreshold = GetAdjustedThreshold(Threshold, IsHotCallsite);
 
-    auto ExportModulePath = ResolvedCalleeSummary->modulePath();
+    auto ExportModulePath = Index.getModulePathOf(ResolvedCalleeSummary);
     auto &ProcessedThreshold = ImportList[ExportModulePath][GUID];
     /// Since the traversal of the call graph is DFS, we can revisit a function
     /// a second time with a higher threshold. In this case, it is added back to
@@ -279,14 +299,10 @@ static void computeImportForFunction(
         // For efficiency, we unconditionally add all the referenced GUIDs
         // to the ExportList for this module, and will prune out any not
         // defined in the module later in a single pass.
-        for (auto &Edge : ResolvedCalleeSummary->calls()) {
-          auto CalleeGUID = Edge.first.getGUID();
-          ExportList.insert(CalleeGUID);
-        }
-        for (auto &Ref : ResolvedCalleeSummary->refs()) {
-          auto GUID = Ref.getGUID();
-          ExportList.insert(GUID);
-        }
+        for (auto &Edge : Index.calls(ResolvedCalleeSummary))
+          ExportList.insert(Index.getGUID(Edge.callee()));
+        for (ValueIndex Ref : Index.refs(ResolvedCalleeSummary))
+          ExportList.insert(Index.getGUID(Ref));
       }
     }
 
@@ -295,73 +311,336 @@ static void computeImportForFunction(
   }
 }
 
-/// Given the list of globals defined in a module, compute the list of imports
-/// as well as the list of "exports", i.e. the list of symbols referenced from
-/// another module (that may require promotion).
+/// Given a module, compute the list of imports as well as the list of
+/// "exports", i.e. the list of symbols referenced from another module (that
+/// may require promotion). When \p FunctionsOnly, only the functions that the
+/// module defines are considered.
 static void ComputeImportForModule(
-    const GVSummaryMapTy &DefinedGVSummaries, const ModuleSummaryIndex &Index,
+    ModuleIndex Module, bool FunctionsOnly, const FlatSummaryIndex &Index,
     FunctionImporter::ImportMapTy &ImportList,
     StringMap<FunctionImporter::ExportSetTy> *ExportLists = nullptr,
-    const DenseSet<GlobalValue::GUID> *DeadSymbols = nullptr) {
+    const DenseSet<GlobalValue::GUID> *DeadSymbols = nullptr,
+    std::vector<ValueIndex> *Consulted = nullptr) {
   // Worklist contains the list of function imported in this module, for which
   // we will analyse the callees and may import further down the callgraph.
   SmallVector<EdgeInfo, 128> Worklist;
 
   // Populate the worklist with the import for the functions in the current
   // module
-  for (auto &GVSummary : DefinedGVSummaries) {
-    if (DeadSymbols && DeadSymbols->count(GVSummary.first)) {
-      DEBUG(dbgs() << "Ignores Dead GUID: " << GVSummary.first << "\n");
+  for (SummaryIndex Summary : Index.getDefinedSummaries(Module)) {
+    auto GUID = Index.getGUID(Index.getValue(Summary));
+    if (FunctionsOnly &&
+        Index.getKind(Summary) != GlobalValueSummary::FunctionKind)
+      continue;
+    if (DeadSymbols && DeadSymbols->count(GUID)) {
+      DEBUG(dbgs() << "Ignores Dead GUID: " << GUID << "\n");
       continue;
     }
-    auto *Summary = GVSummary.second;
-    if (auto *AS = dyn_cast<AliasSummary>(Summary))
-      Summary = &AS->getAliasee();
-    auto *FuncSummary = dyn_cast<FunctionSummary>(Summary);
-    if (!FuncSummary)
+    if (Index.getKind(Summary) == GlobalValueSummary::AliasKind)
+      Summary = Index.getAliasee(Summary);
+    if (Summary == FlatSummaryIndex::NotFound ||
+        Index.getKind(Summary) != GlobalValueSummary::FunctionKind)
       // Skip import for global variables
       continue;
-    DEBUG(dbgs() << "Initalize import for " << GVSummary.first << "\n");
-    computeImportForFunction(*FuncSummary, Index, ImportInstrLimit,
-                             DefinedGVSummaries, Worklist, ImportList,
-                             ExportLists);
+    DEBUG(dbgs() << "Initalize import for " << GUID << "\n");
+    computeImportForFunction(Summary, Index, ImportInstrLimit, Module,
+                             FunctionsOnly, Worklist, ImportList, ExportLists,
+                             Consulted);
   }
 
   // Process the newly imported functions and add callees to the worklist.
   while (!Worklist.empty()) {
     auto FuncInfo = Worklist.pop_back_val();
-    auto *Summary = std::get<0>(FuncInfo);
+    auto Summary = std::get<0>(FuncInfo);
     auto Threshold = std::get<1>(FuncInfo);
     auto GUID = std::get<2>(FuncInfo);
 
     // Check if we later added this summary with a higher threshold.
     // If so, skip this entry.
-    auto ExportModulePath = Summary->modulePath();
+    auto ExportModulePath = Index.getModulePathOf(Summary);
     auto &LatestProcessedThreshold = ImportList[ExportModulePath][GUID];
     if (LatestProcessedThreshold > Threshold)
       continue;
 
-    computeImportForFunction(*Summary, Index, Threshold, DefinedGVSummaries,
-                             Worklist, ImportList, ExportLists);
+    computeImportForFunction(Summary, Index, Threshold, Module, FunctionsOnly,
+                             Worklist, ImportList, ExportLists, Consulted);
   }
 }
 
+/// Hash the options that affect the import lists.
+static std::string hashImportOptions() {
+  SHA1 Hasher;
+  auto AddUnsigned = [&](unsigned I) {
+    uint8_t Data[4];
+    support::endian::write32le(Data, I);
+    Hasher.update(ArrayRef<uint8_t>(Data));
+  };
+  auto AddFloat = [&](float F) {
+    uint32_t I;
+    static_assert(sizeof(I) == sizeof(F), "unexpected float size");
+    memcpy(&I, &F, sizeof(F));
+    AddUnsigned(I);
+  };
+  AddUnsigned(ImportInstrLimit);
+  AddFloat(ImportInstrFactor);
+  AddFloat(ImportHotInstrFactor);
+  AddFloat(ImportHotMultiplier);
+  AddFloat(ImportColdMultiplier);
+  return Hasher.result();
+}
+
+/// Hash everything the import list of \p Module depends on, given the GUIDs
+/// whose summaries its computation looked at. Return an empty string if a
+/// module involved has no hash, as changes to it can't be detected.
+static std::string
+hashImportInputs(const FlatSummaryIndex &Index, ModuleIndex Module,
+                 ArrayRef<GlobalValue::GUID> Consulted,
+                 const DenseSet<GlobalValue::GUID> *DeadSymbols) {
+  SHA1 Hasher;
+  auto AddU64 = [&](uint64_t I) {
+    uint8_t Data[8];
+    support::endian::write64le(Data, I);
+    Hasher.update(ArrayRef<uint8_t>(Data));
+  };
+  auto AddModule = [&](ModuleIndex M) {
+    ModuleHash Hash = Index.getModuleHash(M);
+    if (llvm::all_of(Hash, [](uint32_t V) { return V == 0; }))
+      return false;
+    for (uint32_t V : Hash)
+      AddU64(V);
+    StringRef Path = Index.getModulePath(M);
+    AddU64(Path.size());
+    Hasher.update(Path);
+    return true;
+  };
+
+  if (!AddModule(Module))
+    return std::string();
+  // Dead definitions are not imported for.
+  for (SummaryIndex S : Index.getDefinedSummaries(Module)) {
+    auto GUID = Index.getGUID(Index.getValue(S));
+    if (DeadSymbols && DeadSymbols->count(GUID))
+      AddU64(GUID);
+  }
+  // A consulted GUID is identified by the modules that define it, or by the
+  // value its original name maps to if it has no summary.
+  for (GlobalValue::GUID GUID : Consulted) {
+    AddU64(GUID);
+    ValueIndex V = Index.findValue(GUID);
+    if (V == FlatSummaryIndex::NotFound || !Index.isInIndex(V)) {
+      AddU64(Index.getGUIDFromOriginalID(GUID));
+      continue;
+    }
+    for (SummaryIndex S : Index.summaries(V))
+      if (!AddModule(Index.getModule(S)))
+        return std::string();
+  }
+  return Hasher.result();
+}
+
 } // anonymous namespace
 
+namespace {
+
+/// Reads the little-endian fields of an import list cache file, remembering
+/// whether it ran past the end.
+struct CacheFileReader {
+  StringRef Data;
+  bool Malformed = false;
+
+  explicit CacheFileReader(StringRef Data) : Data(Data) {}
+
+  StringRef readBytes(size_t Size) {
+    if (Malformed || Data.size() < Size) {
+      Malformed = true;
+      return StringRef();
+    }
+    StringRef Bytes = Data.take_front(Size);
+    Data = Data.drop_front(Size);
+    return Bytes;
+  }
+  uint32_t readU32() {
+    StringRef Bytes = readBytes(4);
+    return Malformed ? 0 : support::endian::read32le(Bytes.data());
+  }
+  uint64_t readU64() {
+    StringRef Bytes = readBytes(8);
+    return Malformed ? 0 : support::endian::read64le(Bytes.data());
+  }
+  StringRef readString() { return readBytes(readU32()); }
+};
+
+} // anonymous namespace
+
+static const uint32_t ImportListCacheMagic = 0x4c494c54; // 'TLIL'
+static const uint32_t ImportListCacheVersion = 1;
+
+ImportListCache::ImportListCache(std::string Path) : Path(std::move(Path)) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+      MemoryBuffer::getFile(this->Path);
+  if (!MBOrErr)
+    return;
+  CacheFileReader R((*MBOrErr)->getBuffer());
+  if (R.readU32() != ImportListCacheMagic ||
+      R.readU32() != ImportListCacheVersion ||
+      R.readBytes(20) != hashImportOptions())
+    return;
+  for (uint32_t I = 0, N = R.readU32(); I != N && !R.Malformed; ++I) {
+    StringRef ModulePath = R.readString();
+    Entry &E = Previous[ModulePath];
+    E.InputHash = R.readBytes(20);
+    for (uint32_t J = 0, JE = R.readU32(); J != JE && !R.Malformed; ++J)
+      E.Consulted.push_back(R.readU64());
+    for (uint32_t J = 0, JE = R.readU32(); J != JE && !R.Malformed; ++J) {
+      auto &FunctionsToImport = E.ImportList[R.readString()];
+      for (uint32_t K = 0, KE = R.readU32(); K != KE && !R.Malformed; ++K) {
+        GlobalValue::GUID GUID = R.readU64();
+        FunctionsToImport[GUID] = R.readU32();
+      }
+    }
+    for (uint32_t J = 0, JE = R.readU32(); J != JE && !R.Malformed; ++J) {
+      auto &ExportList = E.Exports[R.readString()];
+      for (uint32_t K = 0, KE = R.readU32(); K != KE && !R.Malformed; ++K)
+        ExportList.insert(R.readU64());
+    }
+  }
+  if (R.Malformed)
+    Previous.clear();
+}
+
+const ImportListCache::Entry *
+ImportListCache::lookup(StringRef ModulePath) const {
+  auto It = Previous.find(ModulePath);
+  return It == Previous.end() ? nullptr : &It->second;
+}
+
+void ImportListCache::insert(StringRef ModulePath, Entry E) {
+  Current[ModulePath] = std::move(E);
+}
+
+/// Return the keys of \p Map, sorted so that the file contents don't depend
+/// on the hash table layout.
+template <typename T> static std::vector<StringRef> sortedKeys(const T &Map) {
+  std::vector<StringRef> Keys;
+  for (auto &Entry : Map)
+    Keys.push_back(Entry.first());
+  std::sort(Keys.begin(), Keys.end());
+  return Keys;
+}
+
+std::error_code ImportListCache::save() const {
+  if (Current.empty())
+    return std::error_code();
+
+  // Write to a temporary file and rename it, so that concurrent links never
+  // see a partial file.
+  int TempFD;
+  SmallString<128> TempPath;
+  if (std::error_code EC =
+          sys::fs::createUniqueFile(Path + ".tmp%%%%%%", TempFD, TempPath))
+    return EC;
+  {
+    raw_fd_ostream OS(TempFD, /* ShouldClose */ true);
+    support::endian::Writer<support::little> W(OS);
+    auto WriteString = [&](StringRef S) {
+      W.write(uint32_t(S.size()));
+      OS << S;
+    };
+    W.write(ImportListCacheMagic);
+    W.write(ImportListCacheVersion);
+    OS << hashImportOptions();
+    W.write(uint32_t(Current.size()));
+    for (StringRef ModulePath : sortedKeys(Current)) {
+      const Entry &E = Current.find(ModulePath)->second;
+      WriteString(ModulePath);
+      OS << E.InputHash;
+      W.write(uint32_t(E.Consulted.size()));
+      for (GlobalValue::GUID GUID : E.Consulted)
+        W.write(uint64_t(GUID));
+      W.write(uint32_t(E.ImportList.size()));
+      for (StringRef Source : sortedKeys(E.ImportList)) {
+        const auto &FunctionsToImport = E.ImportList.find(Source)->second;
+        WriteString(Source);
+        W.write(uint32_t(FunctionsToImport.size()));
+        for (auto &Function : FunctionsToImport) {
+          W.write(uint64_t(Function.first));
+          W.write(uint32_t(Function.second));
+        }
+      }
+      W.write(uint32_t(E.Exports.size()));
+      for (StringRef Exporter : sortedKeys(E.Exports)) {
+        const auto &ExportList = E.Exports.find(Exporter)->second;
+        std::vector<GlobalValue::GUID> GUIDs(ExportList.begin(),
+                                             ExportList.end());
+        std::sort(GUIDs.begin(), GUIDs.end());
+        WriteString(Exporter);
+        W.write(uint32_t(GUIDs.size()));
+        for (GlobalValue::GUID GUID : GUIDs)
+          W.write(uint64_t(GUID));
+      }
+    }
+  }
+  if (std::error_code EC = sys::fs::rename(TempPath, Path)) {
+    sys::fs::remove(TempPath);
+    return EC;
+  }
+  return std::error_code();
+}
+
 /// Compute all the import and export for every module using the Index.
 void llvm::ComputeCrossModuleImport(
-    const ModuleSummaryIndex &Index,
-    const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
+    const FlatSummaryIndex &Index,
     StringMap<FunctionImporter::ImportMapTy> &ImportLists,
     StringMap<FunctionImporter::ExportSetTy> &ExportLists,
-    const DenseSet<GlobalValue::GUID> *DeadSymbols) {
+    const DenseSet<GlobalValue::GUID> *DeadSymbols, ImportListCache *Cache) {
   // For each module that has function defined, compute the import/export lists.
-  for (auto &DefinedGVSummaries : ModuleToDefinedGVSummaries) {
-    auto &ImportList = ImportLists[DefinedGVSummaries.first()];
-    DEBUG(dbgs() << "Computing import for Module '"
-                 << DefinedGVSummaries.first() << "'\n");
-    ComputeImportForModule(DefinedGVSummaries.second, Index, ImportList,
-                           &ExportLists, DeadSymbols);
+  for (ModuleIndex Module = 0, E = Index.getNumModules(); Module != E;
+       ++Module) {
+    if (Index.getDefinedSummaries(Module).empty())
+      continue;
+    StringRef ModulePath = Index.getModulePath(Module);
+    auto &ImportList = ImportLists[ModulePath];
+    if (!Cache) {
+      DEBUG(dbgs() << "Computing import for Module '" << ModulePath << "'\n");
+      ComputeImportForModule(Module, /*FunctionsOnly=*/false, Index, ImportList,
+                             &ExportLists, DeadSymbols);
+      continue;
+    }
+
+    // Reuse the import list of the previous link if nothing it depends on
+    // changed. The exports it caused are kept separately, so that they can be
+    // replayed as well.
+    ImportListCache::Entry Entry;
+    if (const ImportListCache::Entry *Previous = Cache->lookup(ModulePath)) {
+      std::string InputHash =
+          hashImportInputs(Index, Module, Previous->Consulted, DeadSymbols);
+      if (!InputHash.empty() && InputHash == Previous->InputHash) {
+        DEBUG(dbgs() << "Reusing import for Module '" << ModulePath << "'\n");
+        ++NumImportListsReused;
+        Entry = *Previous;
+      }
+    }
+    if (Entry.InputHash.empty()) {
+      DEBUG(dbgs() << "Computing import for Module '" << ModulePath << "'\n");
+      std::vector<ValueIndex> Consulted;
+      ComputeImportForModule(Module, /*FunctionsOnly=*/false, Index,
+                             Entry.ImportList, &Entry.Exports, DeadSymbols,
+                             &Consulted);
+      for (ValueIndex V : Consulted)
+        Entry.Consulted.push_back(Index.getGUID(V));
+      std::sort(Entry.Consulted.begin(), Entry.Consulted.end());
+      Entry.Consulted.erase(
+          std::unique(Entry.Consulted.begin(), Entry.Consulted.end()),
+          Entry.Consulted.end());
+      Entry.InputHash =
+          hashImportInputs(Index, Module, Entry.Consulted, DeadSymbols);
+    }
+    ImportList = Entry.ImportList;
+    for (auto &Exports : Entry.Exports)
+      ExportLists[Exports.first()].insert(Exports.second.begin(),
+                                          Exports.second.end());
+    if (!Entry.InputHash.empty())
+      Cache->insert(ModulePath, std::move(Entry));
   }
 
   // When computing imports we added all GUIDs referenced by anything
@@ -369,11 +648,19 @@ void llvm::ComputeCrossModuleImport(
   // of any not defined in that module. This is more efficient than checking
   // while computing imports because some of the summary lists may be long
   // due to linkonce (comdat) copies.
+  StringMap<ModuleIndex> ModuleIndices;
+  for (ModuleIndex Module = 0, E = Index.getNumModules(); Module != E;
+       ++Module)
+    ModuleIndices[Index.getModulePath(Module)] = Module;
   for (auto &ELI : ExportLists) {
-    const auto &DefinedGVSummaries =
-        ModuleToDefinedGVSummaries.lookup(ELI.first());
+    auto ModuleIt = ModuleIndices.find(ELI.first());
+    ModuleIndex Module = ModuleIt == ModuleIndices.end()
+                             ? FlatSummaryIndex::NotFound
+                             : ModuleIt->second;
     for (auto EI = ELI.second.begin(); EI != ELI.second.end();) {
-      if (!DefinedGVSummaries.count(*EI))
+      ValueIndex V = Index.findValue(*EI);
+      if (V == FlatSummaryIndex::NotFound ||
+          !isDefinedIn(Index, Module, V, /*FunctionsOnly=*/false))
         EI = ELI.second.erase(EI);
       else
         ++EI;
@@ -398,19 +685,87 @@ void llvm::ComputeCrossModuleImport(
 #endif
 }
 
+/// Return the GUIDs of the values whose summaries the import into
+/// \p ModulePath can look at: the ones the module defines, and those reachable
+/// from them through call edges and aliases.
+static DenseSet<GlobalValue::GUID>
+collectImportCandidates(StringRef ModulePath, const ModuleSummaryIndex &Index) {
+  DenseSet<GlobalValue::GUID> Candidates;
+  SmallVector<const GlobalValueSummaryList *, 128> Worklist;
+  auto Visit = [&](GlobalValue::GUID GUID) {
+    auto It = Index.findGlobalValueSummaryList(GUID);
+    if (It == Index.end()) {
+      // The call may be to a local function known by its original name.
+      GUID = Index.getGUIDFromOriginalID(GUID);
+      if (!GUID)
+        return;
+      It = Index.findGlobalValueSummaryList(GUID);
+      if (It == Index.end())
+        return;
+    }
+    if (Candidates.insert(GUID).second)
+      Worklist.push_back(&It->second);
+  };
+
+  // An aliasee is only known by its summary: find the GUIDs of all of them.
+  DenseMap<const GlobalValueSummary *, GlobalValue::GUID> AliaseeGUIDs;
+  for (auto &GlobalList : Index)
+    for (auto &Summary : GlobalList.second) {
+      if (!Summary)
+        continue;
+      if (Summary->modulePath() == ModulePath &&
+          Candidates.insert(GlobalList.first).second)
+        Worklist.push_back(&GlobalList.second);
+      if (auto *AS = dyn_cast<AliasSummary>(Summary.get()))
+        AliaseeGUIDs[&AS->getAliasee()] = 0;
+    }
+  if (!AliaseeGUIDs.empty())
+    for (auto &GlobalList : Index)
+      for (auto &Summary : GlobalList.second) {
+        auto It = AliaseeGUIDs.find(Summary.get());
+        if (It != AliaseeGUIDs.end())
+          It->second = GlobalList.first;
+      }
+
+  while (!Worklist.empty()) {
+    for (auto &Summary : *Worklist.pop_back_val()) {
+      if (!Summary)
+        continue;
+      if (auto *FS = dyn_cast<FunctionSummary>(Summary.get()))
+        for (auto &Call : FS->calls())
+          Visit(Call.first.isGUID() ? Call.first.getGUID()
+                                    : Call.first.getValue()->getGUID());
+      else if (auto *AS = dyn_cast<AliasSummary>(Summary.get()))
+        Visit(AliaseeGUIDs.lookup(&AS->getAliasee()));
+    }
+  }
+  return Candidates;
+}
+
 /// Compute all the imports for the given module in the Index.
 void llvm::ComputeCrossModuleImportForModule(
     StringRef ModulePath, const ModuleSummaryIndex &Index,
     FunctionImporter::ImportMapTy &ImportList) {
+  // Only flatten the part of the combined index the import can reach.
+  DenseSet<GlobalValue::GUID> Candidates =
+      collectImportCandidates(ModulePath, Index);
+  ComputeCrossModuleImportForModule(
+      ModulePath, FlatSummaryIndex(Index, &Candidates), ImportList);
+}
 
-  // Collect the list of functions this module defines.
-  // GUID -> Summary
-  GVSummaryMapTy FunctionSummaryMap;
-  Index.collectDefinedFunctionsForModule(ModulePath, FunctionSummaryMap);
-
-  // Compute the import list for this module.
+void llvm::ComputeCrossModuleImportForModule(
+    StringRef ModulePath, const FlatSummaryIndex &Index,
+    FunctionImporter::ImportMapTy &ImportList) {
+  ModuleIndex Module = 0;
+  for (ModuleIndex E = Index.getNumModules(); Module != E; ++Module)
+    if (Index.getModulePath(Module) == ModulePath)
+      break;
+  if (Module == Index.getNumModules())
+    return;
+
+  // Compute the import list for the functions this module defines.
   DEBUG(dbgs() << "Computing import for Module '" << ModulePath << "'\n");
-  ComputeImportForModule(FunctionSummaryMap, Index, ImportList);
+  ComputeImportForModule(Module, /*FunctionsOnly=*/true, Index, ImportList);
 
 #ifndef NDEBUG
   DEBUG(dbgs() << "* Module " << ModulePath << " imports from "
@@ -426,80 +781,92 @@ void llvm::ComputeCrossModuleImportForModule(
 DenseSet<GlobalValue::GUID> llvm::computeDeadSymbols(
     const ModuleSummaryIndex &Index,
     const DenseSet<GlobalValue::GUID> &GUIDPreservedSymbols) {
+  if (!ComputeDead || GUIDPreservedSymbols.empty())
+    return DenseSet<GlobalValue::GUID>();
+  return computeDeadSymbols(FlatSummaryIndex(Index), GUIDPreservedSymbols);
+}
+
+DenseSet<GlobalValue::GUID> llvm::computeDeadSymbols(
+    const FlatSummaryIndex &Index,
+    const DenseSet<GlobalValue::GUID> &GUIDPreservedSymbols) {
   if (!ComputeDead)
     return DenseSet<GlobalValue::GUID>();
   if (GUIDPreservedSymbols.empty())
     // Don't do anything when nothing is live, this is friendly with tests.
     return DenseSet<GlobalValue::GUID>();
-  DenseSet<GlobalValue::GUID> LiveSymbols = GUIDPreservedSymbols;
-  SmallVector<GlobalValue::GUID, 128> Worklist;
-  Worklist.reserve(LiveSymbols.size() * 2);
-  for (auto GUID : LiveSymbols) {
+  // Values of the index are tracked by index, symbols that aren't in it by
+  // GUID.
+  BitVector LiveValues(Index.getNumValues());
+  DenseSet<GlobalValue::GUID> LiveSymbols;
+  SmallVector<ValueIndex, 128> Worklist;
+  Worklist.reserve(GUIDPreservedSymbols.size() * 2);
+  auto MarkLive = [&](ValueIndex V) {
+    if (LiveValues.test(V))
+      return false;
+    LiveValues.set(V);
+    Worklist.push_back(V);
+    return true;
+  };
+  auto MarkGUIDLive = [&](GlobalValue::GUID GUID) {
+    ValueIndex V = Index.findValue(GUID);
+    if (V == FlatSummaryIndex::NotFound)
+      return LiveSymbols.insert(GUID).second;
+    return MarkLive(V);
+  };
+  for (auto GUID : GUIDPreservedSymbols) {
     DEBUG(dbgs() << "Live root: " << GUID << "\n");
-    Worklist.push_back(GUID);
+    MarkGUIDLive(GUID);
   }
   // Add values flagged in the index as live roots to the worklist.
-  for (const auto &Entry : Index) {
+  for (ValueIndex V = 0, E = Index.getNumValues(); V != E; ++V) {
     bool IsLiveRoot = llvm::any_of(
-        Entry.second,
-        [&](const std::unique_ptr<llvm::GlobalValueSummary> &Summary) {
-          return Summary->liveRoot();
-        });
+        Index.summaries(V), [&](SummaryIndex S) { return Index.liveRoot(S); });
     if (!IsLiveRoot)
       continue;
-    DEBUG(dbgs() << "Live root (summary): " << Entry.first << "\n");
-    Worklist.push_back(Entry.first);
+    DEBUG(dbgs() << "Live root (summary): " << Index.getGUID(V) << "\n");
+    Worklist.push_back(V);
   }
 
   while (!Worklist.empty()) {
-    auto GUID = Worklist.pop_back_val();
-    auto It = Index.findGlobalValueSummaryList(GUID);
-    if (It == Index.end()) {
-      DEBUG(dbgs() << "Not in index: " << GUID << "\n");
+    auto V = Worklist.pop_back_val();
+    if (!Index.isInIndex(V)) {
+      DEBUG(dbgs() << "Not in index: " << Index.getGUID(V) << "\n");
       continue;
     }
 
     // FIXME: we should only make the prevailing copy live here
-    for (auto &Summary : It->second) {
-      for (auto Ref : Summary->refs()) {
-        auto RefGUID = Ref.getGUID();
-        if (LiveSymbols.insert(RefGUID).second) {
-          DEBUG(dbgs() << "Marking live (ref): " << RefGUID << "\n");
-          Worklist.push_back(RefGUID);
-        }
+    for (SummaryIndex Summary : Index.summaries(V)) {
+      for (ValueIndex Ref : Index.refs(Summary)) {
+        if (MarkLive(Ref))
+          DEBUG(dbgs() << "Marking live (ref): " << Index.getGUID(Ref) << "\n");
       }
-      if (auto *FS = dyn_cast<FunctionSummary>(Summary.get())) {
-        for (auto Call : FS->calls()) {
-          auto CallGUID = Call.first.getGUID();
-          if (LiveSymbols.insert(CallGUID).second) {
-            DEBUG(dbgs() << "Marking live (call): " << CallGUID << "\n");
-            Worklist.push_back(CallGUID);
-          }
-        }
+      for (auto &Call : Index.calls(Summary)) {
+        if (MarkLive(Call.callee()))
+          DEBUG(dbgs() << "Marking live (call): "
+                       << Index.getGUID(Call.callee()) << "\n");
       }
-      if (auto *AS = dyn_cast<AliasSummary>(Summary.get())) {
-        auto AliaseeGUID = AS->getAliasee().getOriginalName();
-        if (LiveSymbols.insert(AliaseeGUID).second) {
+      if (Index.getKind(Summary) == GlobalValueSummary::AliasKind) {
+        SummaryIndex Aliasee = Index.getAliasee(Summary);
+        if (Aliasee == FlatSummaryIndex::NotFound)
+          continue;
+        auto AliaseeGUID = Index.getOriginalName(Aliasee);
+        if (MarkGUIDLive(AliaseeGUID))
           DEBUG(dbgs() << "Marking live (alias): " << AliaseeGUID << "\n");
-          Worklist.push_back(AliaseeGUID);
-        }
       }
     }
   }
   DenseSet<GlobalValue::GUID> DeadSymbols;
-  DeadSymbols.reserve(
-      std::min(Index.size(), Index.size() - LiveSymbols.size()));
-  for (auto &Entry : Index) {
-    auto GUID = Entry.first;
-    if (!LiveSymbols.count(GUID)) {
-      DEBUG(dbgs() << "Marking dead: " << GUID << "\n");
-      DeadSymbols.insert(GUID);
+  unsigned NumLive = LiveValues.count() + LiveSymbols.size();
+  for (ValueIndex V = 0, E = Index.getNumValues(); V != E; ++V) {
+    if (Index.isInIndex(V) && !LiveValues.test(V)) {
+      DEBUG(dbgs() << "Marking dead: " << Index.getGUID(V) << "\n");
+      DeadSymbols.insert(Index.getGUID(V));
     }
   }
-  DEBUG(dbgs() << LiveSymbols.size() << " symbols Live, and "
-               << DeadSymbols.size() << " symbols Dead \n");
+  DEBUG(dbgs() << NumLive << " symbols Live, and " << DeadSymbols.size()
+               << " symbols Dead \n");
   NumDeadSymbols += DeadSymbols.size();
-  NumLiveSymbols += LiveSymbols.size();
+  NumLiveSymbols += NumLive;
   return DeadSymbols;
 }
 
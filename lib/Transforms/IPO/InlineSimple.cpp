@@ -62,7 +62,7 @@ public:
       return ACT->getAssumptionCache(F);
     };
     return llvm::getInlineCost(CS, Params, TTI, GetAssumptionCache,
-                               /*GetBFI=*/None, PSI);
+                               /*GetBFI=*/None, PSI, &CostCache);
   }
 
   bool runOnSCC(CallGraphSCC &SCC) override;
@@ -433,6 +433,7 @@ inlineCallsImpl(CallGraphSCC &SCC, CallGraph &CG,
                 ProfileSummaryInfo *PSI, TargetLibraryInfo &TLI,
                 bool InsertLifetime,
                 function_ref<InlineCost(CallSite CS)> GetInlineCost,
+                InlineCostCache &CostCache,
                 function_ref<AAResults &(Function &)> AARGetter,
                 ImportedFunctionsInliningStatistics &ImportedFunctionsStats) {
   SmallPtrSet<Function *, 8> SCCFunctions;
@@ -529,6 +530,7 @@ inlineCallsImpl(CallGraphSCC &SCC, CallGraph &CG,
         // Update the call graph by deleting the edge from Callee to Caller.
         CG[Caller]->removeCallEdgeFor(CS);
         CS.getInstruction()->eraseFromParent();
+        CostCache.invalidate(*Caller);
         ++NumCallsDeleted;
       } else {
         // We can only inline direct calls to non-declarations.
@@ -569,6 +571,7 @@ inlineCallsImpl(CallGraphSCC &SCC, CallGraph &CG,
               << NV("Caller", Caller));
           continue;
         }
+        CostCache.invalidate(*Caller);
         ++NumInlined;
 
         // Report the inline decision.
@@ -602,6 +605,7 @@ inlineCallsImpl(CallGraphSCC &SCC, CallGraph &CG,
         DEBUG(dbgs() << "    -> Deleting dead function: " << Callee->getName()
                      << "\n");
         CallGraphNode *CalleeNode = CG[Callee];
+        CostCache.invalidate(*Callee);
 
         // Remove any call graph edges from the callee to its callees.
         CalleeNode->removeAllCalledFunctions();
@@ -639,9 +643,13 @@ bool LegacyInlinerBase::inlineCalls(CallGraphSCC &SCC) {
   auto GetAssumptionCache = [&](Function &F) -> AssumptionCache & {
     return ACT->getAssumptionCache(F);
   };
-  return inlineCallsImpl(SCC, CG, GetAssumptionCache, PSI, TLI, InsertLifetime,
-                         [this](CallSite CS) { return getInlineCost(CS); },
-                         LegacyAARGetter(*this), ImportedFunctionsStats);
+  bool Changed = inlineCallsImpl(
+      SCC, CG, GetAssumptionCache, PSI, TLI, InsertLifetime,
+      [this](CallSite CS) { return getInlineCost(CS); }, CostCache,
+      LegacyAARGetter(*this), ImportedFunctionsStats);
+  // The functions of this SCC are about to be changed by other passes.
+  CostCache.clear();
+  return Changed;
 }
 
 /// Remove now-dead linkonce functions at the end of
@@ -807,6 +815,10 @@ PreservedAnalyses InlinerPass::run(LazyCallGraph::SCC &InitialC,
   // defer deleting these to make it easier to handle the call graph updates.
   SmallVector<Function *, 4> DeadFunctions;
 
+  // The cost analyses of the calls seen so far, kept up to date as we inline
+  // into their callees.
+  InlineCostCache CostCache;
+
   // Loop forward over all of the calls. Note that we cannot cache the size as
   // inlining can introduce new calls that need to be processed.
   for (int i = 0; i < (int)Calls.size(); ++i) {
@@ -845,7 +857,7 @@ PreservedAnalyses InlinerPass::run(LazyCallGraph::SCC &InitialC,
       Function &Callee = *CS.getCalledFunction();
       auto &CalleeTTI = FAM.getResult<TargetIRAnalysis>(Callee);
       return getInlineCost(CS, Params, CalleeTTI, GetAssumptionCache, {GetBFI},
-                           PSI);
+                           PSI, &CostCache);
     };
 
     // Get the remarks emission analysis for the caller.
@@ -878,6 +890,7 @@ PreservedAnalyses InlinerPass::run(LazyCallGraph::SCC &InitialC,
 
       if (!InlineFunction(CS, IFI))
         continue;
+      CostCache.invalidate(F);
       DidInline = true;
       InlinedCallees.insert(&Callee);
 
@@ -914,6 +927,7 @@ PreservedAnalyses InlinerPass::run(LazyCallGraph::SCC &InitialC,
           // Note that after this point, it is an error to do anything other
           // than use the callee's address or delete it.
           Callee.dropAllReferences();
+          CostCache.invalidate(Callee);
           assert(find(DeadFunctions, &Callee) == DeadFunctions.end() &&
                  "Cannot put cause a function to become dead twice!");
           DeadFunctions.push_back(&Callee);
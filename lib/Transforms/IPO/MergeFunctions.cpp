@@ -121,6 +121,7 @@ STATISTIC(NumFunctionsMerged, "Number of functions merged");
 STATISTIC(NumThunksWritten, "Number of thunks generated");
 STATISTIC(NumAliasesWritten, "Number of aliases generated");
 STATISTIC(NumDoubleWeak, "Number of new functions created");
+STATISTIC(NumComparisons, "Number of full function comparisons");
 
 static cl::opt<unsigned> NumFunctionsForSanityCheck(
     "mergefunc-sanity",
@@ -197,6 +198,7 @@ private:
       // Order first by hashes, then full function comparison.
       if (LHS.getHash() != RHS.getHash())
         return LHS.getHash() < RHS.getHash();
+      ++NumComparisons;
       FunctionComparator FCmp(LHS.getFunc(), RHS.getFunc(), GlobalNumbers);
       return FCmp.compare() == -1;
     }
@@ -874,22 +874,68 @@ public:
   // No finishing is required, because the entire hash value is used.
   uint64_t getHash() { return Hash; }
 };
+
+// Accumulate the parts of a type that cmpTypes() compares without recursing
+// into contained types. Pointers in address space 0 are hashed as the integer
+// type cmpTypes() maps them to.
+void addTypeHash(HashAccumulator64 &H, Type *Ty, const DataLayout &DL) {
+  PointerType *PTy = dyn_cast<PointerType>(Ty);
+  if (PTy && PTy->getAddressSpace() == 0) {
+    H.add(Type::IntegerTyID);
+    H.add(DL.getPointerSizeInBits(0));
+    return;
+  }
+
+  H.add(Ty->getTypeID());
+  switch (Ty->getTypeID()) {
+  default:
+    break;
+  case Type::IntegerTyID:
+    H.add(cast<IntegerType>(Ty)->getBitWidth());
+    break;
+  case Type::PointerTyID:
+    H.add(PTy->getAddressSpace());
+    break;
+  case Type::StructTyID:
+    H.add(cast<StructType>(Ty)->getNumElements());
+    H.add(cast<StructType>(Ty)->isPacked());
+    break;
+  case Type::ArrayTyID:
+  case Type::VectorTyID:
+    H.add(cast<SequentialType>(Ty)->getNumElements());
+    break;
+  case Type::FunctionTyID:
+    H.add(cast<FunctionType>(Ty)->getNumParams());
+    H.add(cast<FunctionType>(Ty)->isVarArg());
+    break;
+  }
+}
 } // end anonymous namespace
 
-// A function hash is calculated by considering only the number of arguments and
-// whether a function is varargs, the order of basic blocks (given by the
-// successors of each basic block in depth first order), and the order of
-// opcodes of each instruction within each of these basic blocks. This mirrors
-// the strategy compare() uses to compare functions by walking the BBs in depth
-// first order and comparing each instruction in sequence. Because this hash
-// does not look at the operands, it is insensitive to things such as the
-// target of calls and the constants used in the function, which makes it useful
-// when possibly merging functions which are the same modulo constants and call
+// A function hash is calculated by considering only the signature of the
+// function, the order of basic blocks (given by the successors of each basic
+// block in depth first order), and the order of operations within each of
+// these basic blocks. This mirrors the strategy compare() uses to compare
+// functions by walking the BBs in depth first order and comparing each
+// instruction in sequence. Of each operation, only the parts that
+// cmpOperations() requires to be equal are hashed: the opcode and, except for
+// GEPs, which are compared by offset, the number and types of the operands,
+// the result type and the optional flags. Because this hash does not look at
+// the operands themselves, it is insensitive to things such as the target of
+// calls and the constants used in the function, which makes it useful when
+// possibly merging functions which are the same modulo constants and call
 // targets.
 FunctionComparator::FunctionHash FunctionComparator::functionHash(Function &F) {
+  const DataLayout &DL = F.getParent()->getDataLayout();
   HashAccumulator64 H;
   H.add(F.isVarArg());
   H.add(F.arg_size());
+  H.add(F.getCallingConv());
+  H.add(F.hasGC());
+  H.add(F.hasSection());
+  addTypeHash(H, F.getReturnType(), DL);
+  for (Type *ParamTy : F.getFunctionType()->params())
+    addTypeHash(H, ParamTy, DL);
 
   SmallVector<const BasicBlock *, 8> BBs;
   SmallSet<const BasicBlock *, 16> VisitedBBs;
@@ -905,6 +951,13 @@ FunctionComparator::FunctionHash FunctionComparator::functionHash(Function &F) {
     H.add(45798);
     for (auto &Inst : *BB) {
       H.add(Inst.getOpcode());
+      if (isa<GetElementPtrInst>(Inst))
+        continue;
+      H.add(Inst.getNumOperands());
+      H.add(Inst.getRawSubclassOptionalData());
+      addTypeHash(H, Inst.getType(), DL);
+      for (const Use &Op : Inst.operands())
+        addTypeHash(H, Op->getType(), DL);
     }
     const TerminatorInst *Term = BB->getTerminator();
     for (unsigned i = 0, e = Term->getNumSuccessors(); i != e; ++i) {
@@ -915,5 +968,3 @@ FunctionComparator::FunctionHash FunctionComparator::functionHash(Function &F) {
   }
   return H.getHash();
 }
-
-
@@ -20,11 +20,13 @@
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/GlobalAlias.h"
 #include "llvm/IR/GlobalObject.h"
 #include "llvm/IR/GlobalValue.h"
+#include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/MD5.h"
@@ -203,6 +205,71 @@ static void externalize(GlobalValue *GV) {
     GV->setName("__llvmsplit_unnamed");
 }
 
+// Turns the definitions of M for which ShouldKeepDefinition returns false into
+// external declarations, the way CloneModule does for the definitions it is
+// told not to clone.
+static void dropDefinitionsOutsidePartition(
+    Module &M, function_ref<bool(const GlobalValue *)> ShouldKeepDefinition) {
+  // Decide on everything before touching the module: the predicate may look
+  // at the clusters of globals we are about to rewrite.
+  SmallVector<GlobalVariable *, 16> DroppedVars;
+  SmallVector<Function *, 16> DroppedFunctions;
+  SmallVector<GlobalAlias *, 4> DroppedAliases;
+  for (GlobalVariable &GV : M.globals())
+    if (!GV.isDeclaration() && !ShouldKeepDefinition(&GV))
+      DroppedVars.push_back(&GV);
+  for (Function &F : M)
+    if (!F.isDeclaration() && !ShouldKeepDefinition(&F))
+      DroppedFunctions.push_back(&F);
+  for (GlobalAlias &GA : M.aliases())
+    if (!ShouldKeepDefinition(&GA))
+      DroppedAliases.push_back(&GA);
+
+  for (GlobalVariable *GV : DroppedVars) {
+    GV->setInitializer(nullptr);
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+    GV->setComdat(nullptr);
+    GV->clearMetadata();
+  }
+
+  for (Function *F : DroppedFunctions) {
+    // This also drops the personality function and the metadata attachments.
+    F->deleteBody();
+    F->setComdat(nullptr);
+  }
+
+  for (GlobalAlias *GA : DroppedAliases) {
+    // An alias cannot act as an external reference, so we need to create
+    // either a function or a global variable depending on the value type.
+    GlobalValue *Decl;
+    if (GA->getValueType()->isFunctionTy())
+      Decl = Function::Create(cast<FunctionType>(GA->getValueType()),
+                              GlobalValue::ExternalLinkage, "", &M);
+    else
+      Decl = new GlobalVariable(
+          M, GA->getValueType(), false, GlobalValue::ExternalLinkage,
+          (Constant *)nullptr, "", (GlobalVariable *)nullptr,
+          GA->getThreadLocalMode(), GA->getType()->getAddressSpace());
+    Decl->takeName(GA);
+    GA->replaceAllUsesWith(
+        ConstantExpr::getPointerBitCastOrAddrSpaceCast(Decl, GA->getType()));
+    GA->eraseFromParent();
+  }
+
+  // CloneModule only creates the comdats of the definitions it clones, drop
+  // the ones that have no member left.
+  SmallPtrSet<const Comdat *, 16> UsedComdats;
+  for (GlobalObject &GO : M.global_objects())
+    if (const Comdat *C = GO.getComdat())
+      UsedComdats.insert(C);
+  SmallVector<StringRef, 16> DeadComdats;
+  for (auto &Entry : M.getComdatSymbolTable())
+    if (!UsedComdats.count(&Entry.getValue()))
+      DeadComdats.push_back(Entry.getKey());
+  for (StringRef Name : DeadComdats)
+    M.getComdatSymbolTable().erase(Name);
+}
+
 // Returns whether GV should be in partition (0-based) I of N.
 static bool isInPartition(const GlobalValue *GV, unsigned I, unsigned N) {
   if (auto *GIS = dyn_cast<GlobalIndirectSymbol>(GV))
@@ -245,17 +312,24 @@ void llvm::SplitModule(
   ClusterIDMapType ClusterIDMap;
   findPartitions(M.get(), ClusterIDMap, N);
 
-  // FIXME: We should be able to reuse M as the last partition instead of
-  // cloning it.
   for (unsigned I = 0; I < N; ++I) {
-    ValueToValueMapTy VMap;
-    std::unique_ptr<Module> MPart(
-        CloneModule(M.get(), VMap, [&](const GlobalValue *GV) {
-          if (ClusterIDMap.count(GV))
-            return (ClusterIDMap[GV] == I);
-          else
-            return isInPartition(GV, I, N);
-        }));
+    auto ShouldKeepDefinition = [&](const GlobalValue *GV) {
+      if (ClusterIDMap.count(GV))
+        return (ClusterIDMap[GV] == I);
+      else
+        return isInPartition(GV, I, N);
+    };
+
+    std::unique_ptr<Module> MPart;
+    if (I + 1 < N) {
+      ValueToValueMapTy VMap;
+      MPart = CloneModule(M.get(), VMap, ShouldKeepDefinition);
+    } else {
+      // Nothing needs M anymore: turn it into the last partition in place
+      // rather than paying for one more copy of the whole module.
+      dropDefinitionsOutsidePartition(*M, ShouldKeepDefinition);
+      MPart = std::move(M);
+    }
     if (I != 0)
       MPart->setModuleInlineAsm("");
     ModuleCallback(std::move(MPart));
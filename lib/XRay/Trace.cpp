@@ -15,6 +15,8 @@
 #include "llvm/Support/DataExtractor.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Process.h"
 #include "llvm/XRay/YAMLXRayRecord.h"
 
 using namespace llvm;
@@ -54,22 +56,9 @@ Error readBinaryFormatHeader(StringRef Data, XRayFileHeader &FileHeader) {
   return Error::success();
 }
 
-Error loadNaiveFormatLog(StringRef Data, XRayFileHeader &FileHeader,
-                         std::vector<XRayRecord> &Records) {
-  // Check that there is at least a header
-  if (Data.size() < 32)
-    return make_error<StringError>(
-        "Not enough bytes for an XRay log.",
-        std::make_error_code(std::errc::invalid_argument));
-
-  if (Data.size() - 32 == 0 || Data.size() % 32 != 0)
-    return make_error<StringError>(
-        "Invalid-sized XRay data.",
-        std::make_error_code(std::errc::invalid_argument));
-
-  if (auto E = readBinaryFormatHeader(Data, FileHeader))
-    return E;
-
+/// Decodes the naive format record at the start of \p S, which must hold at
+/// least 32 bytes, and appends it to \p Records.
+Error readNaiveRecord(StringRef S, std::vector<XRayRecord> &Records) {
   // Each record after the header will be 32 bytes, in the following format:
   //
   //   (2)   uint16 : record type
@@ -79,30 +68,28 @@ Error loadNaiveFormatLog(StringRef Data, XRayFileHeader &FileHeader,
   //   (8)   uint64 : tsc
   //   (4)   uint32 : thread id
   //   (12)  -      : padding
-  for (auto S = Data.drop_front(32); !S.empty(); S = S.drop_front(32)) {
-    DataExtractor RecordExtractor(S, true, 8);
-    uint32_t OffsetPtr = 0;
-    Records.emplace_back();
-    auto &Record = Records.back();
-    Record.RecordType = RecordExtractor.getU16(&OffsetPtr);
-    Record.CPU = RecordExtractor.getU8(&OffsetPtr);
-    auto Type = RecordExtractor.getU8(&OffsetPtr);
-    switch (Type) {
-    case 0:
-      Record.Type = RecordTypes::ENTER;
-      break;
-    case 1:
-      Record.Type = RecordTypes::EXIT;
-      break;
-    default:
-      return make_error<StringError>(
-          Twine("Unknown record type '") + Twine(int{Type}) + "'",
-          std::make_error_code(std::errc::executable_format_error));
-    }
-    Record.FuncId = RecordExtractor.getSigned(&OffsetPtr, sizeof(int32_t));
-    Record.TSC = RecordExtractor.getU64(&OffsetPtr);
-    Record.TId = RecordExtractor.getU32(&OffsetPtr);
+  DataExtractor RecordExtractor(S, true, 8);
+  uint32_t OffsetPtr = 0;
+  Records.emplace_back();
+  auto &Record = Records.back();
+  Record.RecordType = RecordExtractor.getU16(&OffsetPtr);
+  Record.CPU = RecordExtractor.getU8(&OffsetPtr);
+  auto Type = RecordExtractor.getU8(&OffsetPtr);
+  switch (Type) {
+  case 0:
+    Record.Type = RecordTypes::ENTER;
+    break;
+  case 1:
+    Record.Type = RecordTypes::EXIT;
+    break;
+  default:
+    return make_error<StringError>(
+        Twine("Unknown record type '") + Twine(int{Type}) + "'",
+        std::make_error_code(std::errc::executable_format_error));
   }
+  Record.FuncId = RecordExtractor.getSigned(&OffsetPtr, sizeof(int32_t));
+  Record.TSC = RecordExtractor.getU64(&OffsetPtr);
+  Record.TId = RecordExtractor.getU32(&OffsetPtr);
   return Error::success();
 }
 
@@ -111,7 +98,7 @@ Error loadNaiveFormatLog(StringRef Data, XRayFileHeader &FileHeader,
 /// read through the sequence of entries. This allows the reader to denormalize
 /// the CPUId and Thread Id onto each Function Record and transform delta
 /// encoded TSC values into absolute encodings on each record.
-struct FDRState {
+struct llvm::xray::FDRState {
   uint16_t CPUId;
   uint16_t ThreadId;
   uint64_t BaseTSC;
@@ -324,7 +311,8 @@ Error processFDRFunctionRecord(FDRState &State, uint8_t RecordFirstByte,
   return Error::success();
 }
 
-/// Reads a log in FDR mode for version 1 of this binary format. FDR mode is
+/// Decodes the FDR mode record at the start of \p S, for version 1 of this
+/// binary format, and sets \p RecordSize to its size. FDR mode is
 /// defined as part of the compiler-rt project in xray_fdr_logging.h, and such
 /// a log consists of the familiar 32 bit XRayHeader, followed by sequences of
 /// of interspersed 16 byte Metadata Records and 8 byte Function Records.
@@ -350,67 +338,28 @@ Error processFDRFunctionRecord(FDRState &State, uint8_t RecordFirstByte,
 /// FunctionSequence: NewCPUId | TSCWrap | FunctionRecord
 /// TSCWrap: 16 byte metadata record with a full 64 bit TSC reading.
 /// FunctionRecord: 8 byte record with FunctionId, entry/exit, and TSC delta.
-Error loadFDRLog(StringRef Data, XRayFileHeader &FileHeader,
-                 std::vector<XRayRecord> &Records) {
-  if (Data.size() < 32)
-    return make_error<StringError>(
-        "Not enough bytes for an XRay log.",
-        std::make_error_code(std::errc::invalid_argument));
-
-  // For an FDR log, there are records sized 16 and 8 bytes.
-  // There actually may be no records if no non-trivial functions are
-  // instrumented.
-  if (Data.size() % 8 != 0)
-    return make_error<StringError>(
-        "Invalid-sized XRay data.",
-        std::make_error_code(std::errc::invalid_argument));
-
-  if (auto E = readBinaryFormatHeader(Data, FileHeader))
-    return E;
-
-  uint64_t BufferSize = 0;
-  {
-    StringRef ExtraDataRef(FileHeader.FreeFormData, 16);
-    DataExtractor ExtraDataExtractor(ExtraDataRef, true, 8);
-    uint32_t ExtraDataOffset = 0;
-    BufferSize = ExtraDataExtractor.getU64(&ExtraDataOffset);
-  }
-  FDRState State{0,          0, 0, FDRState::Token::NEW_BUFFER_RECORD_OR_EOF,
-                 BufferSize, 0};
-  // RecordSize will tell the loop how far to seek ahead based on the record
-  // type that we have just read.
-  size_t RecordSize = 0;
-  for (auto S = Data.drop_front(32); !S.empty(); S = S.drop_front(RecordSize)) {
-    DataExtractor RecordExtractor(S, true, 8);
-    uint32_t OffsetPtr = 0;
-    if (State.Expects == FDRState::Token::SCAN_TO_END_OF_THREAD_BUF) {
-      RecordSize = State.CurrentBufferSize - State.CurrentBufferConsumed;
-      if (S.size() < State.CurrentBufferSize - State.CurrentBufferConsumed) {
-        return make_error<StringError>(
-            Twine("Incomplete thread buffer. Expected ") +
-                Twine(State.CurrentBufferSize - State.CurrentBufferConsumed) +
-                " remaining bytes but found " + Twine(S.size()),
-            make_error_code(std::errc::invalid_argument));
-      }
-      State.CurrentBufferConsumed = 0;
-      State.Expects = FDRState::Token::NEW_BUFFER_RECORD_OR_EOF;
-      continue;
-    }
-    uint8_t BitField = RecordExtractor.getU8(&OffsetPtr);
-    bool isMetadataRecord = BitField & 0x01uL;
-    if (isMetadataRecord) {
-      RecordSize = 16;
-      if (auto E = processFDRMetadataRecord(State, BitField, RecordExtractor))
-        return E;
-      State.CurrentBufferConsumed += RecordSize;
-    } else { // Process Function Record
-      RecordSize = 8;
-      if (auto E = processFDRFunctionRecord(State, BitField, RecordExtractor,
-                                            Records))
-        return E;
-      State.CurrentBufferConsumed += RecordSize;
-    }
+Error readFDRRecord(FDRState &State, StringRef S, size_t &RecordSize,
+                    std::vector<XRayRecord> &Records) {
+  DataExtractor RecordExtractor(S, true, 8);
+  uint32_t OffsetPtr = 0;
+  uint8_t BitField = RecordExtractor.getU8(&OffsetPtr);
+  bool isMetadataRecord = BitField & 0x01uL;
+  if (isMetadataRecord) {
+    RecordSize = 16;
+    if (auto E = processFDRMetadataRecord(State, BitField, RecordExtractor))
+      return E;
+  } else { // Process Function Record
+    RecordSize = 8;
+    if (auto E = processFDRFunctionRecord(State, BitField, RecordExtractor,
+                                          Records))
+      return E;
   }
+  State.CurrentBufferConsumed += RecordSize;
+  return Error::success();
+}
+
+/// Checks that an FDR mode log doesn't end in the middle of a thread buffer.
+Error checkFDRLogEnd(const FDRState &State) {
   // There are two conditions
   if (State.Expects != FDRState::Token::NEW_BUFFER_RECORD_OR_EOF &&
       !(State.Expects == FDRState::Token::SCAN_TO_END_OF_THREAD_BUF &&
@@ -421,7 +370,6 @@ Error loadFDRLog(StringRef Data, XRayFileHeader &FileHeader,
             ". Remaining expected bytes in thread buffer total " +
             Twine(State.CurrentBufferSize - State.CurrentBufferConsumed),
         std::make_error_code(std::errc::executable_format_error));
-
   return Error::success();
 }
 
@@ -454,33 +402,143 @@ Error loadYAMLLog(StringRef Data, XRayFileHeader &FileHeader,
   return Error::success();
 }
 
-Expected<Trace> llvm::xray::loadTraceFile(StringRef Filename, bool Sort) {
+constexpr uint64_t TraceStream::DefaultWindowSize;
+constexpr size_t TraceStream::BatchSize;
+
+TraceStream::TraceStream(StringRef Filename, int FD, uint64_t WindowSize)
+    : Filename(Filename), FD(FD), WindowSize(WindowSize) {}
+
+TraceStream::~TraceStream() {
+  Window.reset();
+  sys::Process::SafelyCloseFileDescriptor(FD);
+}
+
+Error TraceStream::mapWindow(uint64_t Size) {
+  uint64_t End = std::min(FileSize, Offset + Size);
+  if (Window && Offset >= WindowOffset && End <= WindowOffset + Window->size())
+    return Error::success();
+
+  // Windows start on a mapping boundary, which is why they are a lot larger
+  // than any record.
+  uint64_t Start =
+      alignDown(Offset, sys::fs::mapped_file_region::alignment());
+  uint64_t Length =
+      std::min(FileSize - Start, std::max(WindowSize, End - Start));
+  std::error_code EC;
+  Window.reset();
+  Window = llvm::make_unique<sys::fs::mapped_file_region>(
+      FD, sys::fs::mapped_file_region::mapmode::readonly, Length, Start, EC);
+  if (EC) {
+    Window.reset();
+    return make_error<StringError>(
+        Twine("Cannot read log from '") + Filename + "'", EC);
+  }
+  WindowOffset = Start;
+  return Error::success();
+}
+
+StringRef TraceStream::getMappedData() const {
+  uint64_t Skip = Offset - WindowOffset;
+  return StringRef(Window->const_data() + Skip, Window->size() - Skip);
+}
+
+Error TraceStream::readBatch() {
+  Batch.clear();
+  BatchIndex = 0;
+  // YAML logs are loaded in a single batch when the stream is opened.
+  if (Kind == Format::YAML)
+    return Error::success();
+
+  while (Batch.size() < BatchSize && Offset < FileSize) {
+    size_t RecordSize = 0;
+    if (Kind == Format::NAIVE) {
+      RecordSize = 32;
+      if (auto E = mapWindow(RecordSize))
+        return E;
+      if (auto E = readNaiveRecord(getMappedData(), Batch))
+        return E;
+    } else if (State->Expects == FDRState::Token::SCAN_TO_END_OF_THREAD_BUF) {
+      // The rest of the thread buffer is garbage, skip it without mapping it.
+      RecordSize = State->CurrentBufferSize - State->CurrentBufferConsumed;
+      if (FileSize - Offset < RecordSize)
+        return make_error<StringError>(
+            Twine("Incomplete thread buffer. Expected ") + Twine(RecordSize) +
+                " remaining bytes but found " + Twine(FileSize - Offset),
+            make_error_code(std::errc::invalid_argument));
+      State->CurrentBufferConsumed = 0;
+      State->Expects = FDRState::Token::NEW_BUFFER_RECORD_OR_EOF;
+    } else {
+      if (auto E = mapWindow(16))
+        return E;
+      if (auto E = readFDRRecord(*State, getMappedData(), RecordSize, Batch))
+        return E;
+    }
+    Offset = std::min(FileSize, Offset + RecordSize);
+  }
+
+  if (Kind == Format::FDR && Offset == FileSize)
+    return checkFDRLogEnd(*State);
+  return Error::success();
+}
+
+TraceStream::record_iterator &TraceStream::record_iterator::operator++() {
+  assert(E && "Can't increment iterator with no Error attached");
+  if (++Stream->BatchIndex < Stream->Batch.size())
+    return *this;
+
+  ErrorAsOutParameter ErrAsOutParam(E);
+  if (auto Err = Stream->readBatch()) {
+    *E = std::move(Err);
+    Stream = nullptr;
+    E = nullptr;
+  } else if (Stream->Batch.empty()) {
+    Stream = nullptr;
+  }
+  return *this;
+}
+
+iterator_range<TraceStream::record_iterator> TraceStream::records(Error &Err) {
+  assert(!Started && "A TraceStream can only be iterated over once");
+  Started = true;
+
+  ErrorAsOutParameter ErrAsOutParam(&Err);
+  if (Kind != Format::YAML) {
+    if (auto E = readBatch()) {
+      Err = std::move(E);
+      return make_range(record_iterator(), record_iterator());
+    }
+  }
+  if (Batch.empty())
+    return make_range(record_iterator(), record_iterator());
+  return make_range(record_iterator(this, &Err), record_iterator());
+}
+
+Expected<std::unique_ptr<TraceStream>>
+llvm::xray::openTraceFile(StringRef Filename, uint64_t WindowSize) {
   int Fd;
   if (auto EC = sys::fs::openFileForRead(Filename, Fd)) {
     return make_error<StringError>(
         Twine("Cannot read log from '") + Filename + "'", EC);
   }
+  // The stream owns the file descriptor from now on.
+  std::unique_ptr<TraceStream> S(new TraceStream(Filename, Fd, WindowSize));
 
   // Attempt to get the filesize.
-  uint64_t FileSize;
-  if (auto EC = sys::fs::file_size(Filename, FileSize)) {
+  if (auto EC = sys::fs::file_size(Filename, S->FileSize)) {
     return make_error<StringError>(
         Twine("Cannot read log from '") + Filename + "'", EC);
   }
+  uint64_t FileSize = S->FileSize;
   if (FileSize < 4) {
     return make_error<StringError>(
         Twine("File '") + Filename + "' too small for XRay.",
         std::make_error_code(std::errc::executable_format_error));
   }
 
-  // Attempt to mmap the file.
-  std::error_code EC;
-  sys::fs::mapped_file_region MappedFile(
-      Fd, sys::fs::mapped_file_region::mapmode::readonly, FileSize, 0, EC);
-  if (EC) {
-    return make_error<StringError>(
-        Twine("Cannot read log from '") + Filename + "'", EC);
-  }
+  // Map the beginning of the file to read its header.
+  if (auto E = S->mapWindow(32))
+    return std::move(E);
+  StringRef Header = S->getMappedData().take_front(32);
 
   // Attempt to detect the file type using file magic. We have a slight bias
   // towards the binary format, and we do this by making sure that the first 4
@@ -495,30 +553,90 @@ Expected<Trace> llvm::xray::loadTraceFile(StringRef Filename, bool Sort) {
   //
   // Only if we can't load either the binary or the YAML format will we yield an
   // error.
-  StringRef Magic(MappedFile.data(), 4);
-  DataExtractor HeaderExtractor(Magic, true, 8);
+  DataExtractor HeaderExtractor(Header.take_front(4), true, 8);
   uint32_t OffsetPtr = 0;
   uint16_t Version = HeaderExtractor.getU16(&OffsetPtr);
   uint16_t Type = HeaderExtractor.getU16(&OffsetPtr);
 
   enum BinaryFormatType { NAIVE_FORMAT = 0, FLIGHT_DATA_RECORDER_FORMAT = 1 };
 
-  Trace T;
   if (Version == 1 && Type == NAIVE_FORMAT) {
-    if (auto E =
-            loadNaiveFormatLog(StringRef(MappedFile.data(), MappedFile.size()),
-                               T.FileHeader, T.Records))
+    S->Kind = TraceStream::Format::NAIVE;
+    // Check that there is at least a header
+    if (FileSize < 32)
+      return make_error<StringError>(
+          "Not enough bytes for an XRay log.",
+          std::make_error_code(std::errc::invalid_argument));
+
+    if (FileSize - 32 == 0 || FileSize % 32 != 0)
+      return make_error<StringError>(
+          "Invalid-sized XRay data.",
+          std::make_error_code(std::errc::invalid_argument));
+
+    if (auto E = readBinaryFormatHeader(Header, S->FileHeader))
       return std::move(E);
   } else if (Version == 1 && Type == FLIGHT_DATA_RECORDER_FORMAT) {
-    if (auto E = loadFDRLog(StringRef(MappedFile.data(), MappedFile.size()),
-                            T.FileHeader, T.Records))
+    S->Kind = TraceStream::Format::FDR;
+    if (FileSize < 32)
+      return make_error<StringError>(
+          "Not enough bytes for an XRay log.",
+          std::make_error_code(std::errc::invalid_argument));
+
+    // For an FDR log, there are records sized 16 and 8 bytes.
+    // There actually may be no records if no non-trivial functions are
+    // instrumented.
+    if (FileSize % 8 != 0)
+      return make_error<StringError>(
+          "Invalid-sized XRay data.",
+          std::make_error_code(std::errc::invalid_argument));
+
+    if (auto E = readBinaryFormatHeader(Header, S->FileHeader))
       return std::move(E);
+
+    uint64_t BufferSize = 0;
+    {
+      StringRef ExtraDataRef(S->FileHeader.FreeFormData, 16);
+      DataExtractor ExtraDataExtractor(ExtraDataRef, true, 8);
+      uint32_t ExtraDataOffset = 0;
+      BufferSize = ExtraDataExtractor.getU64(&ExtraDataOffset);
+    }
+    S->State.reset(new FDRState{0, 0, 0,
+                                FDRState::Token::NEW_BUFFER_RECORD_OR_EOF,
+                                BufferSize, 0});
   } else {
+    S->Kind = TraceStream::Format::YAML;
+    std::error_code EC;
+    sys::fs::mapped_file_region MappedFile(
+        Fd, sys::fs::mapped_file_region::mapmode::readonly, FileSize, 0, EC);
+    if (EC) {
+      return make_error<StringError>(
+          Twine("Cannot read log from '") + Filename + "'", EC);
+    }
     if (auto E = loadYAMLLog(StringRef(MappedFile.data(), MappedFile.size()),
-                             T.FileHeader, T.Records))
+                             S->FileHeader, S->Batch))
       return std::move(E);
+    S->Offset = FileSize;
+    return std::move(S);
   }
 
+  S->Offset = 32;
+  return std::move(S);
+}
+
+Expected<Trace> llvm::xray::loadTraceFile(StringRef Filename, bool Sort) {
+  auto StreamOrErr = openTraceFile(Filename);
+  if (!StreamOrErr)
+    return StreamOrErr.takeError();
+  auto &S = **StreamOrErr;
+
+  Trace T;
+  T.FileHeader = S.getFileHeader();
+  Error Err = Error::success();
+  for (const auto &R : S.records(Err))
+    T.Records.push_back(R);
+  if (Err)
+    return std::move(Err);
+
   if (Sort)
     std::sort(T.Records.begin(), T.Records.end(),
               [&](const XRayRecord &L, const XRayRecord &R) {
@@ -0,0 +1,40 @@
+; RUN: opt < %s -basicaa -aa-eval -print-all-alias-modref-info -stats -disable-output 2>&1 | FileCheck %s
+; RUN: opt < %s -basicaa -aa-eval -print-all-alias-modref-info -stats -disable-output -basicaa-cache-decomposed-geps=false 2>&1 | FileCheck %s --check-prefix=NOCACHE
+; REQUIRES: asserts
+
+; Without the cache, both pointers of every query are decomposed again. With
+; it, each pointer is only decomposed the first time it is queried, and the
+; results are the same.
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; CHECK: NoAlias: i32* %a0, i32* %a1
+; CHECK: NoAlias: i32* %a0, i32* %a2
+; CHECK: NoAlias: i32* %a1, i32* %a2
+; CHECK: NoAlias: i32* %a0, i32* %a3
+; CHECK: NoAlias: i32* %a1, i32* %a3
+; CHECK: NoAlias: i32* %a2, i32* %a3
+; The six queries and the four that they make recursively are each looked up
+; in the alias cache once.
+; CHECK: 10 basicaa - Number of alias queries checked in the cache
+; CHECK: 15 basicaa - Number of GEP decompositions found in the cache
+; CHECK: 20 basicaa - Number of GEP decompositions requested
+; CHECK: 5 basicaa - Number of times a GEP is decomposed
+
+; NOCACHE: NoAlias: i32* %a2, i32* %a3
+; NOCACHE-NOT: found in the cache
+; NOCACHE: 20 basicaa - Number of GEP decompositions requested
+; NOCACHE: 20 basicaa - Number of times a GEP is decomposed
+
+define void @f(i32* %p, i64 %i) {
+  %j = add i64 %i, 1
+  %a0 = getelementptr inbounds i32, i32* %p, i64 %i
+  %a1 = getelementptr inbounds i32, i32* %p, i64 %j
+  %a2 = getelementptr inbounds i32, i32* %a1, i64 1
+  %a3 = getelementptr inbounds i32, i32* %a2, i64 1
+  store i32 0, i32* %a0
+  store i32 1, i32* %a1
+  store i32 2, i32* %a2
+  store i32 3, i32* %a3
+  ret void
+}
@@ -0,0 +1,56 @@
+; Check that LVI still answers queries when its cache is kept under a budget,
+; and that a query gives up once its worklist gets deeper than allowed.
+; RUN: opt -S -correlated-propagation -stats < %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=CHECK --check-prefix=UNBOUNDED
+; RUN: opt -S -correlated-propagation -lvi-cache-budget=2 -stats < %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=CHECK --check-prefix=BUDGET
+; RUN: opt -S -correlated-propagation -lvi-max-stack-depth=1 -stats < %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=DEPTH
+; REQUIRES: asserts
+
+declare void @use(i1)
+
+; CHECK-LABEL: @test(
+; CHECK: call void @use(i1 true)
+; CHECK: call void @use(i1 true)
+; CHECK: call void @use(i1 true)
+; DEPTH-LABEL: @test(
+; DEPTH: call void @use(i1 %x20)
+; DEPTH: call void @use(i1 %y20)
+; DEPTH: call void @use(i1 %x30)
+define void @test(i32 %x, i32 %y) {
+entry:
+  %cx = icmp ult i32 %x, 10
+  br i1 %cx, label %bb1, label %exit
+
+bb1:
+  %cy = icmp ult i32 %y, 10
+  br i1 %cy, label %bb2, label %exit
+
+bb2:
+  br label %bb3
+
+bb3:
+  %x20 = icmp ult i32 %x, 20
+  call void @use(i1 %x20)
+  br label %bb4
+
+bb4:
+  %y20 = icmp ult i32 %y, 20
+  call void @use(i1 %y20)
+  br label %bb5
+
+bb5:
+  %x30 = icmp ult i32 %x, 30
+  call void @use(i1 %x30)
+  ret void
+
+exit:
+  ret void
+}
+
+; UNBOUNDED-NOT: evicted from the cache
+; BUDGET: 4 lazy-value-info {{.*}} Number of blocks evicted from the cache
+; BUDGET: 2 lazy-value-info {{.*}} Number of times the cache exceeded its budget
+; BUDGET: 7 lazy-value-info {{.*}} Number of lattice values evicted from the cache
+; DEPTH: 3 lazy-value-info {{.*}} Number of queries that gave up and returned overdefined
@@ -0,0 +1,41 @@
+; RUN: llvm-as -o %t %s
+; RUN: llvm-bcanalyzer -dump %t | FileCheck --check-prefix=BCA %s
+
+; BCA: </MODULE_BLOCK>
+; BCA-NEXT: <SYMTAB_BLOCK
+; BCA-NEXT: <BLOB
+; BCA-NEXT: </SYMTAB_BLOCK>
+; BCA-NEXT: <STRTAB_BLOCK
+; BCA-NEXT: <BLOB
+; BCA-NEXT: </STRTAB_BLOCK>
+
+; The stored table is used as is, and a table from another producer is
+; rebuilt from the module; both list the same symbols.
+; RUN: llvm-lto2 dump-symtab %t | FileCheck --check-prefix=SYMTAB %s
+; RUN: env LLVM_OVERRIDE_PRODUCER=other llvm-lto2 dump-symtab %t | \
+; RUN:   FileCheck --check-prefix=SYMTAB %s
+
+; SYMTAB: target triple: x86_64-unknown-linux-gnu
+; SYMTAB-NEXT: source filename: {{.*}}irsymtab.ll
+; SYMTAB-NEXT: D------X foo
+; SYMTAB-NEXT: DU-----X bar
+
+; A binary concatenation has the table of its first input only, which does not
+; cover the second module, so the table is rebuilt.
+; RUN: llvm-cat -b -o %t2 %t %t
+; RUN: llvm-lto2 dump-symtab %t2 | FileCheck --check-prefix=CAT %s
+
+; CAT: D------X foo
+; CAT-NEXT: DU-----X bar
+; CAT: D------X foo
+; CAT-NEXT: DU-----X bar
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define void @foo() {
+  call void @bar()
+  ret void
+}
+
+declare void @bar()
@@ -0,0 +1,73 @@
+; Function bodies decoded on several threads must be read into the same module
+; as when they are decoded serially.
+; RUN: llvm-as < %s -o %t.bc
+; RUN: llvm-dis %t.bc -o %t.serial.ll
+; RUN: llvm-dis -bitcode-reader-threads=4 %t.bc -o %t.parallel.ll
+; RUN: diff %t.serial.ll %t.parallel.ll
+; RUN: FileCheck %s < %t.parallel.ll
+
+; Old bitcode without function offsets in the VST.
+; RUN: llvm-dis %S/old-aliases.ll.bc -o %t.old.serial.ll
+; RUN: llvm-dis -bitcode-reader-threads=4 %S/old-aliases.ll.bc -o %t.old.parallel.ll
+; RUN: diff %t.old.serial.ll %t.old.parallel.ll
+
+@g = global i32 0
+
+; A blockaddress forward reference materializes @indirect out of order.
+; CHECK: define i8* @addr()
+; CHECK-NEXT: ret i8* blockaddress(@indirect, %target)
+define i8* @addr() {
+  ret i8* blockaddress(@indirect, %target)
+}
+
+; CHECK: define i32 @add(i32 %a, i32 %b)
+; CHECK: %sum = add i32 %a, %b
+define i32 @add(i32 %a, i32 %b) {
+  %sum = add i32 %a, %b
+  %x = add i32 %sum, %a
+  ret i32 %x
+}
+
+; CHECK: define void @indirect(i8* %p)
+; CHECK: indirectbr i8* %p, [label %target]
+define void @indirect(i8* %p) {
+  indirectbr i8* %p, [label %target]
+target:
+  ret void
+}
+
+; CHECK: define i32 @load() !dbg ![[SP:[0-9]+]]
+; CHECK: load i32, i32* @g, !tbaa ![[TBAA:[0-9]+]]
+define i32 @load() !dbg !4 {
+  %v = load i32, i32* @g, !tbaa !8
+  store i32 %v, i32* @g, !md !{!"func", i32 5}
+  ret i32 %v
+}
+
+; CHECK: define i32 @call()
+; CHECK: call i32 @add(i32 1, i32 2)
+; CHECK: call i32 @load()
+define i32 @call() {
+  %a = call i32 @add(i32 1, i32 2)
+  %b = call i32 @load()
+  %c = add i32 %a, %b
+  ret i32 %c
+}
+
+; CHECK: !{{[0-9]+}} = !{!"func", i32 5}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "t.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Debug Info Version", i32 3}
+!4 = distinct !DISubprogram(name: "load", scope: !1, file: !1, line: 1, type: !5, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: false, unit: !0, variables: !2)
+!5 = !DISubroutineType(types: !6)
+!6 = !{!7}
+!7 = !DIBasicType(name: "int", size: 32, encoding: DW_ATE_signed)
+!8 = !{!9, !9, i64 0}
+!9 = !{!"int", !10, i64 0}
+!10 = !{!"omnipotent char", !11, i64 0}
+!11 = !{!"Simple C/C++ TBAA"}
@@ -0,0 +1,46 @@
+; Check that the per-module summary block is located through the SUMMARYOFFSET
+; record, which precedes the function blocks.
+; RUN: opt -module-summary %s -o %t.o
+; RUN: llvm-bcanalyzer -dump %t.o | FileCheck %s --check-prefix=BC
+; RUN: llvm-lto -thinlto-index-stats %t.o | FileCheck %s --check-prefix=STATS
+; RUN: llvm-lto -thinlto -o %t2 %t.o
+; RUN: llvm-bcanalyzer -dump %t2.thinlto.bc | FileCheck %s --check-prefix=COMBINED
+
+; Modules without a summary don't get the record.
+; RUN: llvm-as %s -o %t3.o
+; RUN: llvm-bcanalyzer -dump %t3.o | FileCheck %s --check-prefix=NOSUMMARY
+
+; BC: <MODULE_BLOCK
+; BC: <VSTOFFSET
+; BC-NEXT: <SUMMARYOFFSET
+; BC: <FUNCTION_BLOCK
+; BC: <FUNCTION_BLOCK
+; BC: <GLOBALVAL_SUMMARY_BLOCK
+; BC: <VALUE_SYMTAB
+
+; STATS: Index {{.*}} contains 3 nodes (2 functions, 0 alias, 1 globals) and 3 edges (2 refs and 1 calls)
+
+; COMBINED: <GLOBALVAL_SUMMARY_BLOCK
+; COMBINED-NEXT: <VERSION
+; COMBINED-NEXT: <COMBINED
+; COMBINED-NEXT: <COMBINED_GLOBALVAR_INIT_REFS
+; COMBINED-NEXT: <COMBINED
+; COMBINED-NEXT: </GLOBALVAL_SUMMARY_BLOCK>
+
+; NOSUMMARY-NOT: <SUMMARYOFFSET
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@g = global i32 0
+
+define i32 @foo() {
+  %v = load i32, i32* @g
+  ret i32 %v
+}
+
+define i32 @main() {
+  store i32 1, i32* @g
+  %r = call i32 @foo()
+  ret i32 %r
+}
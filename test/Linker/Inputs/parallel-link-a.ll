@@ -0,0 +1,12 @@
+@llvm.global_ctors = appending global [1 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 65535, void ()* @ctor_a, i8* null }]
+
+@w = weak global i32 1
+@x = global i32 10
+
+define linkonce_odr i32 @f() {
+  ret i32 1
+}
+
+define void @ctor_a() {
+  ret void
+}
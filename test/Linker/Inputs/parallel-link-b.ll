@@ -0,0 +1,14 @@
+@llvm.global_ctors = appending global [1 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 65535, void ()* @ctor_b, i8* null }]
+
+@w = weak global i32 2
+@y = global i32* @x
+
+@x = external global i32
+
+define linkonce_odr i32 @f() section "b" {
+  ret i32 2
+}
+
+define void @ctor_b() {
+  ret void
+}
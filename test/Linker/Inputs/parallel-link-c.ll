@@ -0,0 +1,7 @@
+@llvm.global_ctors = appending global [1 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 65535, void ()* @ctor_c, i8* null }]
+
+@w = weak global i32 3
+
+define void @ctor_c() {
+  ret void
+}
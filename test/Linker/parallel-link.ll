@@ -0,0 +1,33 @@
+; RUN: llvm-as %s -o %t0.bc
+; RUN: llvm-as %p/Inputs/parallel-link-a.ll -o %t1.bc
+; RUN: llvm-as %p/Inputs/parallel-link-b.ll -o %t2.bc
+; RUN: llvm-as %p/Inputs/parallel-link-c.ll -o %t3.bc
+; RUN: llvm-link -S %t0.bc %t1.bc %t2.bc %t3.bc | FileCheck %s
+; RUN: llvm-link -S -j=2 %t0.bc %t1.bc %t2.bc %t3.bc | FileCheck %s
+; RUN: llvm-link -S -j=3 %t0.bc %t1.bc %t2.bc %t3.bc | FileCheck %s
+; RUN: llvm-link -S -j=8 %t0.bc %t1.bc %t2.bc %t3.bc | FileCheck %s
+
+; Linking the inputs in parallel gives the same result as linking them in
+; order: the first definitions of @w and @f win, and the constructors are
+; appended in the order of the inputs. Only the order of the functions may
+; differ.
+
+; CHECK: @llvm.global_ctors = appending global [4 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 65535, void ()* @ctor_0, i8* null }, { i32, void ()*, i8* } { i32 65535, void ()* @ctor_a, i8* null }, { i32, void ()*, i8* } { i32 65535, void ()* @ctor_b, i8* null }, { i32, void ()*, i8* } { i32 65535, void ()* @ctor_c, i8* null }]
+; CHECK-DAG: @w = weak global i32 1
+; CHECK-DAG: @x = global i32 10
+; CHECK-DAG: @y = global i32* @x
+; CHECK-DAG: define i32 @main()
+; CHECK-DAG: define linkonce_odr i32 @f() {
+
+@llvm.global_ctors = appending global [1 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 65535, void ()* @ctor_0, i8* null }]
+
+declare i32 @f()
+
+define i32 @main() {
+  %r = call i32 @f()
+  ret i32 %r
+}
+
+define void @ctor_0() {
+  ret void
+}
@@ -0,0 +1,26 @@
+; The archive map of bitcode members comes from the IR symbol table stored in
+; the member, and is the same if that table is rebuilt.
+; RUN: llvm-as %s -o=%t1
+; RUN: rm -f %t2 %t3
+; RUN: llvm-ar rcs %t2 %t1
+; RUN: llvm-nm -M %t2 | FileCheck %s
+; RUN: env LLVM_OVERRIDE_PRODUCER=other llvm-ar rcs %t3 %t1
+; RUN: cmp %t2 %t3
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; CHECK: Archive map
+; CHECK-NEXT: foo in archive-irsymtab.ll
+; CHECK-NEXT: data in archive-irsymtab.ll
+; CHECK-NOT: in archive-irsymtab.ll
+
+@data = global i32 0
+@internal = internal global i32 0
+
+define void @foo() {
+  call void @bar()
+  ret void
+}
+
+declare void @bar()
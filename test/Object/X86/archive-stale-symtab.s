@@ -0,0 +1,26 @@
+# A symbol table that no longer matches its members, such as one that was
+# left behind when a member was replaced by another tool, is rebuilt from the
+# members. It is only reused as is when -reuse-symtab asks for it.
+
+# RUN: rm -rf %t && mkdir -p %t/old %t/new
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t/old/m.o
+# RUN: sed -e s/foo/bar/ %s | llvm-mc -filetype=obj -triple=x86_64-pc-linux -o %t/new/m.o
+# RUN: sed -e s/foo/baz/ %s | llvm-mc -filetype=obj -triple=x86_64-pc-linux -o %t/other.o
+# RUN: llvm-ar rcs %t/stale.a %t/old/m.o
+# RUN: %python -c "import sys; a, old, new = [open(f, 'rb').read() for f in sys.argv[1:]]; assert len(old) == len(new) and a.count(old) == 1; open(sys.argv[1], 'wb').write(a.replace(old, new))" %t/stale.a %t/old/m.o %t/new/m.o
+# RUN: cp %t/stale.a %t/reuse.a
+# RUN: llvm-ar -reuse-symtab r %t/reuse.a %t/other.o
+# RUN: llvm-nm -M %t/reuse.a | FileCheck --check-prefix=REUSE %s
+# RUN: llvm-ar r %t/stale.a %t/other.o
+# RUN: llvm-nm -M %t/stale.a | FileCheck --check-prefix=REBUILD %s
+
+# REUSE: Archive map
+# REUSE-NEXT: foo in m.o
+# REUSE-NEXT: baz in other.o
+
+# REBUILD: Archive map
+# REBUILD-NEXT: bar in m.o
+# REBUILD-NEXT: baz in other.o
+
+.globl foo
+foo:
@@ -0,0 +1,39 @@
+; Members that are kept from the old archive reuse its symbol table entries.
+; The result must match an archive written from scratch.
+; RUN: llvm-as %s -o %t.bc
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: sed -e s/foo/bar/ -e s/var/other/ %s | llvm-as -o %t2.bc
+; RUN: rm -f %t.a %t.ref.a
+; RUN: llvm-ar -num-threads=2 rcs %t.a %t.bc %t.o
+; RUN: llvm-ar -num-threads=2 rs %t.a %t2.bc
+; RUN: llvm-ar rcs %t.ref.a %t.bc %t.o %t2.bc
+; RUN: cmp %t.a %t.ref.a
+; RUN: llvm-nm -M %t.a | FileCheck %s
+
+; CHECK: Archive map
+; CHECK-NEXT: foo in archive-update-symtab.ll.tmp.bc
+; CHECK-NEXT: var in archive-update-symtab.ll.tmp.bc
+; CHECK-NEXT: foo in archive-update-symtab.ll.tmp.o
+; CHECK-NEXT: var in archive-update-symtab.ll.tmp.o
+; CHECK-NEXT: bar in archive-update-symtab.ll.tmp2.bc
+; CHECK-NEXT: other in archive-update-symtab.ll.tmp2.bc
+
+; Deleting a member keeps the entries of the others.
+; RUN: llvm-ar d %t.a %t.o
+; RUN: llvm-nm -M %t.a | FileCheck --check-prefix=DELETE %s
+
+; DELETE: Archive map
+; DELETE-NEXT: foo in archive-update-symtab.ll.tmp.bc
+; DELETE-NEXT: var in archive-update-symtab.ll.tmp.bc
+; DELETE-NEXT: bar in archive-update-symtab.ll.tmp2.bc
+; DELETE-NEXT: other in archive-update-symtab.ll.tmp2.bc
+; DELETE-NOT: tmp.o
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@var = global i32 0
+
+define void @foo() {
+  ret void
+}
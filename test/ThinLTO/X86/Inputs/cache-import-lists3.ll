@@ -0,0 +1,11 @@
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define void @f3() {
+  call void @g3()
+  ret void
+}
+
+define void @g3() {
+  ret void
+}
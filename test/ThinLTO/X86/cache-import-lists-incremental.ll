@@ -0,0 +1,39 @@
+; REQUIRES: asserts
+; RUN: opt -module-hash -module-summary %s -o %t.bc
+; RUN: opt -module-hash -module-summary %S/Inputs/cache-import-lists1.ll -o %t1.bc
+; RUN: opt -module-hash -module-summary %S/Inputs/cache-import-lists2.ll -o %t2.bc
+; RUN: opt -module-hash -module-summary %S/Inputs/cache-import-lists3.ll -o %t3.bc
+; RUN: opt -module-hash -module-summary -O1 %S/Inputs/cache-import-lists3.ll -o %t3-changed.bc
+
+; Tests that the import lists are kept in the cache directory, and that a
+; module's import list is reused by later links unless the module or the
+; summaries its import computation looked at changed.
+
+; RUN: rm -rf %t.cache && mkdir %t.cache
+; RUN: llvm-lto -thinlto-action=run -exported-symbol=main -stats %t.bc %t1.bc %t2.bc %t3.bc -thinlto-cache-dir %t.cache 2>&1 | FileCheck %s --check-prefix=FIRST
+; RUN: ls %t.cache/llvmcache-imports
+; FIRST-NOT: import lists reused
+
+; RUN: llvm-lto -thinlto-action=run -exported-symbol=main -stats %t.bc %t1.bc %t2.bc %t3.bc -thinlto-cache-dir %t.cache 2>&1 | FileCheck %s --check-prefix=SAME
+; SAME: 4 function-import - Number of import lists reused from the previous link
+
+; Only the module that changed needs its import list recomputed.
+; RUN: llvm-lto -thinlto-action=run -exported-symbol=main -stats %t.bc %t1.bc %t2.bc %t3-changed.bc -thinlto-cache-dir %t.cache 2>&1 | FileCheck %s --check-prefix=CHANGED
+; CHANGED: 3 function-import - Number of import lists reused from the previous link
+
+; Removing t2 invalidates the import lists of main, which calls f2, and of t1,
+; whose callee linkonce_odr was also defined in t2.
+; RUN: llvm-lto -thinlto-action=run -exported-symbol=main -stats %t.bc %t1.bc %t3-changed.bc -thinlto-cache-dir %t.cache 2>&1 | FileCheck %s --check-prefix=REMOVED
+; REMOVED: 1 function-import - Number of import lists reused from the previous link
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define void @main() {
+  call void @f1()
+  call void @f2()
+  ret void
+}
+
+declare void @f1()
+declare void @f2()
@@ -0,0 +1,30 @@
+; REQUIRES: asserts
+; RUN: opt -module-hash -module-summary %s -o %t.bc
+; RUN: opt -module-hash -module-summary %p/Inputs/cache.ll -o %t2.bc
+
+; The first link misses in the cache and records the new entries in the index.
+; RUN: rm -Rf %t.cache && mkdir %t.cache
+; RUN: llvm-lto -thinlto-action=run -exported-symbol=globalfunc %t2.bc %t.bc \
+; RUN:   -thinlto-cache-dir %t.cache -stats 2>&1 | FileCheck %s --check-prefix=MISS
+; MISS: 2 thinlto {{.*}} Number of modules missing from the cache
+; RUN: cat %t.cache/llvmcache.index | count 3
+
+; The second link hits.
+; RUN: llvm-lto -thinlto-action=run -exported-symbol=globalfunc %t2.bc %t.bc \
+; RUN:   -thinlto-cache-dir %t.cache -stats 2>&1 | FileCheck %s --check-prefix=HIT
+; HIT: 2 thinlto {{.*}} Number of modules loaded from the cache
+
+; Once the pruning interval has expired, a one byte budget removes every entry.
+; RUN: touch -t 197001011200 %t.cache/llvmcache.timestamp
+; RUN: llvm-lto -thinlto-action=run -exported-symbol=globalfunc %t2.bc %t.bc \
+; RUN:   -thinlto-cache-dir %t.cache -thinlto-cache-max-size-bytes=1
+; RUN: ls %t.cache | count 1
+; RUN: ls %t.cache/llvmcache.timestamp
+
+target datalayout = "e-m:o-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-apple-macosx10.11.0"
+
+define void @globalfunc() #0 {
+entry:
+  ret void
+}
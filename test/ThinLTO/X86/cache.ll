@@ -28,11 +28,13 @@
 ; RUN: rm -Rf %t.cache && mkdir %t.cache
 ; RUN: touch -t 197001011200 %t.cache/llvmcache-foo %t.cache/foo
 ; RUN: llvm-lto -thinlto-action=run -exported-symbol=globalfunc %t2.bc  %t.bc -thinlto-cache-dir %t.cache
-; RUN: ls %t.cache | count 4
+; RUN: ls %t.cache | count 6
 ; RUN: ls %t.cache/llvmcache.timestamp
+; RUN: ls %t.cache/llvmcache.index
+; RUN: ls %t.cache/llvmcache-imports
 ; RUN: ls %t.cache/foo
 ; RUN: not ls %t.cache/llvmcache-foo
-; RUN: ls %t.cache/llvmcache-* | count 2
+; RUN: ls %t.cache/llvmcache-* | count 3
 
 ; Verify that enabling caching is working with llvm-lto2
 ; RUN: rm -Rf %t.cache
@@ -40,7 +42,8 @@
 ; RUN:  -r=%t2.bc,_main,plx \
 ; RUN:  -r=%t2.bc,_globalfunc,lx \
 ; RUN:  -r=%t.bc,_globalfunc,plx
-; RUN: ls %t.cache | count 2
+; RUN: ls %t.cache | count 3
+; RUN: ls %t.cache/llvmcache.index
 ; RUN: ls %t.cache/llvmcache-* | count 2
 
 target datalayout = "e-m:o-i64:64-f80:128-n8:16:32:64-S128"
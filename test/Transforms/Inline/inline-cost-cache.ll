@@ -0,0 +1,46 @@
+; The callee body is only simulated once for all the calls that pass it the
+; same kind of arguments, with the same decision for each of them.
+; RUN: opt < %s -inline -inline-threshold=0 -stats -S 2>&1 | FileCheck %s
+; RUN: opt < %s -passes=inline -inline-threshold=0 -stats -S 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+define i32 @helper(i32* %p, i32 %n) {
+  %v = load i32, i32* %p
+  %c = icmp eq i32* %p, null
+  br i1 %c, label %null, label %nonnull
+
+null:
+  ret i32 0
+
+nonnull:
+  %a = add i32 %v, %n
+  %b = mul i32 %a, %n
+  %d = sdiv i32 %b, %v
+  %e = xor i32 %d, %a
+  %f = mul i32 %e, %b
+  %m = sub i32 %f, %n
+  store i32 %m, i32* %p
+  ret i32 %m
+}
+
+; CHECK-LABEL: define i32 @caller(
+; CHECK: call i32 @helper(i32* %p, i32 %n)
+; CHECK: call i32 @helper(i32* %p, i32 %n)
+; CHECK: call i32 @helper(i32* %q, i32 %n)
+; CHECK: call i32 @helper(i32* %p, i32 %r1)
+; CHECK: call i32 @helper(i32* %p, i32 1)
+define i32 @caller(i32* %p, i32* %q, i32 %n) {
+  %r1 = call i32 @helper(i32* %p, i32 %n)
+  %r2 = call i32 @helper(i32* %p, i32 %n)
+  %r3 = call i32 @helper(i32* %q, i32 %n)
+  %r4 = call i32 @helper(i32* %p, i32 %r1)
+  ; A constant argument is analyzed on its own.
+  %r6 = call i32 @helper(i32* %p, i32 1)
+  %s1 = add i32 %r2, %r3
+  %s2 = add i32 %s1, %r4
+  %s3 = add i32 %s2, %r6
+  ret i32 %s3
+}
+
+; CHECK-DAG: 5 inline-cost - Number of call sites analyzed
+; CHECK-DAG: 3 inline-cost - Number of callee simulations avoided by the inline cost cache
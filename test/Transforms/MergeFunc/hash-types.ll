@@ -0,0 +1,41 @@
+; Functions with the same sequence of opcodes but different types get
+; different hashes, so only the functions that merge are compared.
+; RUN: opt -mergefunc -stats -S < %s 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; CHECK-LABEL: define i32 @add32(
+; CHECK-LABEL: define i64 @add64(
+; CHECK-LABEL: define i16 @add16(
+; CHECK-LABEL: define i32 @add32_again(
+; CHECK-NEXT: tail call i32 @add32(
+
+define i32 @add32(i32 %a, i32 %b) {
+  %x = add i32 %a, %b
+  %y = mul i32 %x, %b
+  %z = xor i32 %y, %a
+  ret i32 %z
+}
+
+define i64 @add64(i64 %a, i64 %b) {
+  %x = add i64 %a, %b
+  %y = mul i64 %x, %b
+  %z = xor i64 %y, %a
+  ret i64 %z
+}
+
+define i16 @add16(i16 %a, i16 %b) {
+  %x = add nsw i16 %a, %b
+  %y = mul i16 %x, %b
+  %z = xor i16 %y, %a
+  ret i16 %z
+}
+
+define i32 @add32_again(i32 %a, i32 %b) {
+  %x = add i32 %a, %b
+  %y = mul i32 %x, %b
+  %z = xor i32 %y, %a
+  ret i32 %z
+}
+
+; CHECK: 2 mergefunc - Number of full function comparisons
+; CHECK: 1 mergefunc - Number of functions merged
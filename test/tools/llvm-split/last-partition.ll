@@ -0,0 +1,60 @@
+; The last partition is the input module with the definitions of the other
+; partitions turned into declarations, and their comdats removed.
+; RUN: llvm-split -j3 -o %t %s
+; RUN: llvm-dis -o - %t0 | FileCheck --check-prefix=CHECK0 %s
+; RUN: llvm-dis -o - %t1 | FileCheck --check-prefix=CHECK1 %s
+; RUN: llvm-dis -o - %t2 | FileCheck --check-prefix=CHECK2 %s
+
+; CHECK0: $c1 = comdat any
+; CHECK0: $c2 = comdat any
+; CHECK0-NOT: comdat any
+; CHECK1-NOT: comdat any
+; CHECK2-NOT: $c1 = comdat any
+; CHECK2-NOT: $c2 = comdat any
+; CHECK2: $c3 = comdat any
+$c1 = comdat any
+$c2 = comdat any
+$c3 = comdat any
+
+; CHECK0: @g1 = global i32 1, comdat($c1)
+; CHECK1: @g1 = external global i32
+; CHECK2: @g1 = external global i32
+@g1 = global i32 1, comdat($c1)
+
+; CHECK0: @g2 = external global i32
+; CHECK1: @g2 = external global i32
+; CHECK2: @g2 = global i32 2
+@g2 = global i32 2
+
+; CHECK0: @a1 = alias i32, i32* @g1
+; CHECK1: @a1 = external global i32
+; CHECK2: @a1 = external global i32
+@a1 = alias i32, i32* @g1
+
+; CHECK0: define void @f1() comdat($c1) personality
+; CHECK1: declare void @f1()
+; CHECK2: declare void @f1()
+define void @f1() comdat($c1) personality i8* bitcast (void ()* @f2 to i8*) {
+  ret void
+}
+
+; CHECK0: define void @f2() comdat($c2)
+; CHECK1: declare void @f2()
+; CHECK2: declare void @f2()
+define void @f2() comdat($c2) {
+  ret void
+}
+
+; CHECK0: declare void @f3()
+; CHECK1: declare void @f3()
+; CHECK2: define void @f3() comdat($c3)
+define void @f3() comdat($c3) {
+  ret void
+}
+
+; CHECK0: declare void @f5()
+; CHECK1: define void @f5()
+; CHECK2: declare void @f5()
+define void @f5() {
+  ret void
+}
@@ -167,9 +167,10 @@ BinaryHolder::MapArchiveAndGetMemberBuffers(
   return GetArchiveMemberBuffers(Filename, Timestamp);
 }
 
-ErrorOr<const object::ObjectFile &>
-BinaryHolder::getObjfileForArch(const Triple &T) {
-  for (const auto &Obj : CurrentObjectFiles) {
+static ErrorOr<const object::ObjectFile &>
+getObjfileForArch(ArrayRef<std::unique_ptr<object::ObjectFile>> Objects,
+                  const Triple &T) {
+  for (const auto &Obj : Objects) {
     if (const auto *MachO = dyn_cast<object::MachOObjectFile>(Obj.get())) {
       if (MachO->getArchTriple().str() == T.str())
         return *MachO;
@@ -180,6 +181,16 @@ BinaryHolder::getObjfileForArch(const Triple &T) {
   return make_error_code(object::object_error::arch_not_found);
 }
 
+ErrorOr<const object::ObjectFile &>
+BinaryHolder::getObjfileForArch(const Triple &T) {
+  return dsymutil::getObjfileForArch(CurrentObjectFiles, T);
+}
+
+ErrorOr<const object::ObjectFile &>
+BinaryHolder::OwningObjectFiles::Get(const Triple &T) const {
+  return dsymutil::getObjfileForArch(Objects, T);
+}
+
 ErrorOr<std::vector<const object::ObjectFile *>>
 BinaryHolder::GetObjectFiles(StringRef Filename,
                              sys::TimePoint<std::chrono::seconds> Timestamp) {
@@ -202,5 +213,29 @@ BinaryHolder::GetObjectFiles(StringRef Filename,
 
   return std::move(Objects);
 }
+
+ErrorOr<BinaryHolder::OwningObjectFiles> BinaryHolder::GetOwningObjectFiles(
+    StringRef Filename, sys::TimePoint<std::chrono::seconds> Timestamp) {
+  auto ErrOrMemBufferRefs = GetMemoryBuffersForFile(Filename, Timestamp);
+  if (auto Err = ErrOrMemBufferRefs.getError())
+    return Err;
+
+  OwningObjectFiles Result;
+  Result.Backing = CurrentMemoryBuffer;
+  for (auto MemBuf : *ErrOrMemBufferRefs) {
+    // The slices of a fat binary are named after CurrentFatBinaryName, which
+    // changes with the next mapping. The backing buffer has the same name.
+    if (CurrentFatBinary &&
+        MemBuf.getBufferIdentifier().data() == CurrentFatBinaryName.data())
+      MemBuf = MemoryBufferRef(MemBuf.getBuffer(),
+                               Result.Backing->getBufferIdentifier());
+    auto ErrOrObjectFile = object::ObjectFile::createObjectFile(MemBuf);
+    if (!ErrOrObjectFile)
+      return errorToErrorCode(ErrOrObjectFile.takeError());
+    Result.Objects.push_back(std::move(*ErrOrObjectFile));
+  }
+
+  return std::move(Result);
+}
 }
 }
@@ -36,10 +36,22 @@ namespace dsymutil {
 /// archive file (Which is always the case in debug maps).
 /// Currently it only owns one memory buffer at any given time,
 /// meaning that a mapping request will invalidate the previous memory
-/// mapping.
+/// mapping, unless the mapping was handed out by GetOwningObjectFiles().
 class BinaryHolder {
+public:
+  /// ObjectFiles that don't depend on the state of the holder they were
+  /// created by, along with the memory mapping they point into.
+  struct OwningObjectFiles {
+    std::shared_ptr<MemoryBuffer> Backing;
+    std::vector<std::unique_ptr<object::ObjectFile>> Objects;
+
+    /// Get the object file with architecture \p T.
+    ErrorOr<const object::ObjectFile &> Get(const Triple &T) const;
+  };
+
+private:
   std::vector<std::unique_ptr<object::Archive>> CurrentArchives;
-  std::unique_ptr<MemoryBuffer> CurrentMemoryBuffer;
+  std::shared_ptr<MemoryBuffer> CurrentMemoryBuffer;
   std::vector<std::unique_ptr<object::ObjectFile>> CurrentObjectFiles;
   std::unique_ptr<object::MachOUniversalBinary> CurrentFatBinary;
   std::string CurrentFatBinaryName;
@@ -97,6 +109,16 @@ public:
                  sys::TimePoint<std::chrono::seconds> Timestamp =
                      sys::TimePoint<std::chrono::seconds>());
 
+  /// Like GetObjectFiles(), but the returned ObjectFiles are owned by the
+  /// caller, and keep the mapping they point into alive. They thus stay
+  /// valid when the holder moves on to another file, which lets several
+  /// threads share one holder (under a lock, only held for this call) and
+  /// still map every archive once.
+  ErrorOr<OwningObjectFiles>
+  GetOwningObjectFiles(StringRef Filename,
+                       sys::TimePoint<std::chrono::seconds> Timestamp =
+                           sys::TimePoint<std::chrono::seconds>());
+
   /// Wraps GetObjectFiles() to return a derived ObjectFile type.
   template <typename ObjectFileType>
   ErrorOr<std::vector<const ObjectFileType *>>
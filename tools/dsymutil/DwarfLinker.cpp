@@ -36,9 +36,12 @@
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
 #include <memory>
+#include <mutex>
 #include <string>
 #include <tuple>
 
@@ -1424,6 +1427,29 @@ private:
                                                  const DebugMap &Map);
   /// @}
 
+  /// \defgroup Preloading Loading of debug objects ahead of linking.
+  ///
+  /// @{
+  /// \brief A debug map object that was read from disk and whose debug
+  /// info was parsed, but that has not been linked yet.
+  struct PreloadedObject {
+    /// The object files read for the object, for all architectures.
+    BinaryHolder::OwningObjectFiles ObjFiles;
+    ErrorOr<const object::ObjectFile &> ObjFile = std::error_code();
+    std::unique_ptr<DWARFContextInMemory> DwarfContext;
+  };
+
+  /// \brief Read \p Obj through \p Holder and extract the DIEs of all its
+  /// compile units. This doesn't touch any linker state, and can thus run
+  /// concurrently with the link of other objects. \p HolderLock is only held
+  /// while \p Holder maps the object. Diagnostics about a missing object are
+  /// left to the caller.
+  std::unique_ptr<PreloadedObject> preloadObject(BinaryHolder &Holder,
+                                                 std::mutex &HolderLock,
+                                                 const DebugMapObject &Obj,
+                                                 const DebugMap &Map) const;
+  /// @}
+
   std::string OutputFilename;
   LinkOptions Options;
   BinaryHolder BinHolder;
@@ -3244,21 +3270,58 @@ bool DwarfLinker::registerModuleReference(
   return true;
 }
 
-ErrorOr<const object::ObjectFile &>
-DwarfLinker::loadObject(BinaryHolder &BinaryHolder, DebugMapObject &Obj,
-                        const DebugMap &Map) {
+/// \brief Get the object file for \p Obj and the triple of \p Map out of
+/// \p BinaryHolder.
+static ErrorOr<const object::ObjectFile &>
+getObjectFile(BinaryHolder &BinaryHolder, const DebugMapObject &Obj,
+              const DebugMap &Map) {
   auto ErrOrObjs =
       BinaryHolder.GetObjectFiles(Obj.getObjectFilename(), Obj.getTimestamp());
-  if (std::error_code EC = ErrOrObjs.getError()) {
-    reportWarning(Twine(Obj.getObjectFilename()) + ": " + EC.message());
+  if (std::error_code EC = ErrOrObjs.getError())
     return EC;
-  }
-  auto ErrOrObj = BinaryHolder.Get(Map.getTriple());
+  return BinaryHolder.Get(Map.getTriple());
+}
+
+ErrorOr<const object::ObjectFile &>
+DwarfLinker::loadObject(BinaryHolder &BinaryHolder, DebugMapObject &Obj,
+                        const DebugMap &Map) {
+  auto ErrOrObj = getObjectFile(BinaryHolder, Obj, Map);
   if (std::error_code EC = ErrOrObj.getError())
     reportWarning(Twine(Obj.getObjectFilename()) + ": " + EC.message());
   return ErrOrObj;
 }
 
+std::unique_ptr<DwarfLinker::PreloadedObject>
+DwarfLinker::preloadObject(BinaryHolder &Holder, std::mutex &HolderLock,
+                           const DebugMapObject &Obj,
+                           const DebugMap &Map) const {
+  auto Result = llvm::make_unique<PreloadedObject>();
+  {
+    // The holder keeps the last archive mapped, so that the objects of an
+    // archive, which are contiguous in the debug map, are read from a single
+    // mapping.
+    std::lock_guard<std::mutex> Lock(HolderLock);
+    auto ErrOrObjFiles =
+        Holder.GetOwningObjectFiles(Obj.getObjectFilename(), Obj.getTimestamp());
+    if (std::error_code EC = ErrOrObjFiles.getError()) {
+      Result->ObjFile = EC;
+      return Result;
+    }
+    Result->ObjFiles = std::move(*ErrOrObjFiles);
+  }
+  Result->ObjFile = Result->ObjFiles.Get(Map.getTriple());
+  if (!Result->ObjFile)
+    return Result;
+
+  Result->DwarfContext =
+      llvm::make_unique<DWARFContextInMemory>(*Result->ObjFile);
+  // Extracting the DIEs is where most of the time goes. Do it now so that
+  // the link itself only walks already parsed units.
+  for (const auto &CU : Result->DwarfContext->compile_units())
+    CU->getUnitDIE(false);
+  return Result;
+}
+
 void DwarfLinker::loadClangModule(StringRef Filename, StringRef ModulePath,
                                   StringRef ModuleName, uint64_t DwoId,
                                   DebugMap &ModuleMap, unsigned Indent) {
@@ -3406,25 +3469,77 @@ bool DwarfLinker::link(const DebugMap &Map) {
   UnitID = 0;
   DebugMap ModuleMap(Map.getTriple(), Map.getBinaryPath());
 
-  for (const auto &Obj : Map.objects()) {
-    CurrentDebugObject = Obj.get();
+  // Reading the object files and parsing their debug info doesn't depend
+  // on the linker state, so when we have threads to spare this is done
+  // ahead of time for a bounded window of objects. Everything else, and in
+  // particular the ODR uniquing and the emission, still happens on this
+  // thread in debug map order, which keeps the output deterministic.
+  //
+  // The emission isn't moved to a thread of its own: it is interleaved with
+  // the cloning (the line tables, ranges and locations of a unit are emitted
+  // as soon as it is cloned, and the offsets of the next unit depend on
+  // them), and it reads the per-object state (cloned DIEs in DIEAlloc, the
+  // units and the input DWARFContext) that endDebugObject() frees before the
+  // next object is cloned. Overlapping the two would need that state to be
+  // kept for two objects at once and every Streamer call to move to the
+  // emission thread, as MC isn't thread safe.
+  unsigned NumThreads = Options.Threads;
+  if (!NumThreads)
+    NumThreads = llvm::heavyweight_hardware_concurrency();
+  // Keep the verbose output in order.
+  if (Options.Verbose)
+    NumThreads = 1;
+
+  std::vector<DebugMapObject *> Objects;
+  for (const auto &Obj : Map.objects())
+    Objects.push_back(Obj.get());
+
+  std::unique_ptr<ThreadPool> Pool;
+  std::mutex BinHolderLock;
+  std::vector<std::unique_ptr<PreloadedObject>> Preloaded(Objects.size());
+  std::vector<std::shared_future<ThreadPool::VoidTy>> PreloadDone(
+      Objects.size());
+  size_t NumScheduled = 0;
+  if (NumThreads > 1)
+    Pool = llvm::make_unique<ThreadPool>(NumThreads);
+
+  for (size_t I = 0, E = Objects.size(); I != E; ++I) {
+    DebugMapObject *Obj = Objects[I];
+    CurrentDebugObject = Obj;
 
     if (Options.Verbose)
       outs() << "DEBUG MAP OBJECT: " << Obj->getObjectFilename() << "\n";
-    auto ErrOrObj = loadObject(BinHolder, *Obj, Map);
-    if (!ErrOrObj)
+
+    std::unique_ptr<PreloadedObject> Loaded;
+    if (Pool) {
+      for (size_t Limit = std::min(E, I + 2 * NumThreads);
+           NumScheduled < Limit; ++NumScheduled)
+        PreloadDone[NumScheduled] = Pool->async([&, NumScheduled] {
+          Preloaded[NumScheduled] =
+              preloadObject(BinHolder, BinHolderLock, *Objects[NumScheduled],
+                            Map);
+        });
+      Pool->wait(PreloadDone[I]);
+      Loaded = std::move(Preloaded[I]);
+    } else {
+      Loaded = preloadObject(BinHolder, BinHolderLock, *Obj, Map);
+    }
+
+    if (std::error_code EC = Loaded->ObjFile.getError()) {
+      reportWarning(Twine(Obj->getObjectFilename()) + ": " + EC.message());
       continue;
+    }
 
     // Look for relocations that correspond to debug map entries.
     RelocationManager RelocMgr(*this);
-    if (!RelocMgr.findValidRelocsInDebugInfo(*ErrOrObj, *Obj)) {
+    if (!RelocMgr.findValidRelocsInDebugInfo(*Loaded->ObjFile, *Obj)) {
       if (Options.Verbose)
         outs() << "No valid relocations found. Skipping.\n";
       continue;
     }
 
     // Setup access to the debug info.
-    DWARFContextInMemory DwarfContext(*ErrOrObj);
+    DWARFContextInMemory &DwarfContext = *Loaded->DwarfContext;
     startDebugObject(DwarfContext, *Obj);
 
     // In a first phase, just read in the debug info and load all clang modules.
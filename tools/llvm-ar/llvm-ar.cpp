@@ -29,6 +29,7 @@
 #include "llvm/Support/LineIterator.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
@@ -84,6 +85,15 @@ static cl::list<std::string>
                cl::desc("[relpos] [count] <archive-file> [members]..."));
 
 static cl::opt<bool> MRI("M", cl::desc(""));
+static cl::opt<unsigned> NumThreads(
+    "num-threads", cl::init(0),
+    cl::desc("Number of threads used to read the symbols of the members "
+             "(default = hardware concurrency)"));
+static cl::opt<bool> ReuseSymtab(
+    "reuse-symtab", cl::init(false),
+    cl::desc("Take the symbols of the members kept from the old archive from "
+             "its symbol table instead of reading them again. Only use this "
+             "if the table is known to be up to date"));
 static cl::opt<std::string> Plugin("plugin", cl::desc("plugin (ignored for compatibility"));
 
 namespace {
@@ -685,7 +695,8 @@ performWriteOperation(ArchiveOperation Operation,
 
   std::pair<StringRef, std::error_code> Result =
       writeArchive(ArchiveName, NewMembersP ? *NewMembersP : NewMembers, Symtab,
-                   Kind, Deterministic, Thin, std::move(OldArchiveBuf));
+                   Kind, Deterministic, Thin, std::move(OldArchiveBuf),
+                   ReuseSymtab);
   failIfError(Result.second, Result.first);
 }
 
@@ -869,6 +880,7 @@ int main(int argc, char **argv) {
     "LLVM Archiver (llvm-ar)\n\n"
     "  This program archives bitcode files into single libraries\n"
   );
+  parallel::setThreadCount(NumThreads);
 
   if (Stem.find("ranlib") != StringRef::npos)
     return ranlib_main();
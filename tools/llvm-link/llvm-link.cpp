@@ -13,8 +13,10 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/IR/AutoUpgrade.h"
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/LLVMContext.h"
@@ -32,11 +34,13 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/SystemUtils.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Transforms/IPO/FunctionImport.h"
 #include "llvm/Transforms/IPO/Internalize.h"
 #include "llvm/Transforms/Utils/FunctionImportUtils.h"
 
+#include <atomic>
 #include <memory>
 #include <utility>
 using namespace llvm;
@@ -90,6 +94,12 @@ static cl::opt<bool>
 static cl::opt<bool>
     OutputAssembly("S", cl::desc("Write output as LLVM assembly"), cl::Hidden);
 
+static cl::opt<unsigned> NumThreads(
+    "num-threads", cl::init(1),
+    cl::desc("Number of threads to link the input files on"));
+static cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
+                             cl::aliasopt(NumThreads));
+
 static cl::opt<bool>
 Verbose("v", cl::desc("Print information about actions taken"));
 
@@ -113,14 +123,16 @@ static cl::opt<bool> PreserveAssemblyUseListOrder(
 static ExitOnError ExitOnErr;
 
 // Read the specified bitcode file in and return it. This routine searches the
-// link path for the specified file to try to find it...
+// link path for the specified file to try to find it... Errors are printed to
+// ErrOS.
 //
 static std::unique_ptr<Module> loadFile(const char *argv0,
                                         const std::string &FN,
                                         LLVMContext &Context,
-                                        bool MaterializeMetadata = true) {
+                                        bool MaterializeMetadata = true,
+                                        raw_ostream &ErrOS = errs()) {
   SMDiagnostic Err;
-  if (Verbose) errs() << "Loading '" << FN << "'\n";
+  if (Verbose) ErrOS << "Loading '" << FN << "'\n";
   std::unique_ptr<Module> Result;
   if (DisableLazyLoad)
     Result = parseIRFile(FN, Err, Context);
@@ -128,12 +140,15 @@ static std::unique_ptr<Module> loadFile(const char *argv0,
     Result = getLazyIRFileModule(FN, Err, Context, !MaterializeMetadata);
 
   if (!Result) {
-    Err.print(argv0, errs());
+    Err.print(argv0, ErrOS);
     return nullptr;
   }
 
   if (MaterializeMetadata) {
-    ExitOnErr(Result->materializeMetadata());
+    if (Error E = Result->materializeMetadata()) {
+      logAllUnhandledErrors(std::move(E), ErrOS, std::string(argv0) + ": ");
+      return nullptr;
+    }
     UpgradeDebugInfo(*Result);
   }
 
@@ -182,25 +197,28 @@ Module &ModuleLazyLoaderCache::operator()(const char *argv0,
 }
 } // anonymous namespace
 
+/// Print the diagnostic \p DI to the raw_ostream \p C, or to errs() if it is
+/// null.
 static void diagnosticHandler(const DiagnosticInfo &DI, void *C) {
+  raw_ostream &OS = C ? *static_cast<raw_ostream *>(C) : errs();
   unsigned Severity = DI.getSeverity();
   switch (Severity) {
   case DS_Error:
-    errs() << "ERROR: ";
+    OS << "ERROR: ";
     break;
   case DS_Warning:
     if (SuppressWarnings)
       return;
-    errs() << "WARNING: ";
+    OS << "WARNING: ";
     break;
   case DS_Remark:
   case DS_Note:
     llvm_unreachable("Only expecting warnings and errors");
   }
 
-  DiagnosticPrinterRawOStream DP(errs());
+  DiagnosticPrinterRawOStream DP(OS);
   DI.print(DP);
-  errs() << '\n';
+  OS << '\n';
 }
 
 /// Import any functions requested via the -import option.
@@ -268,33 +286,78 @@ static bool importFunctions(const char *argv0, Module &DestModule) {
   return true;
 }
 
+/// The name of the global that keeps linkonce definitions in partial links.
+static const char KeepGlobalName[] = "__llvm_link_keep";
+
+/// Make linking \p Src into \p Dest keep the linkonce and available_externally
+/// definitions of \p Src that \p Dest doesn't have, by referencing them from
+/// an appending global.
+///
+/// The linker only keeps these definitions when the destination references
+/// them. A partial link must keep them, as the inputs linked after it may.
+static void keepLinkOnceDefinitions(Module &Src, const Module &Dest) {
+  std::vector<Constant *> Kept;
+  Type *Int8PtrTy = Type::getInt8PtrTy(Src.getContext());
+  for (GlobalValue &GV : Src.global_values())
+    if ((GV.hasLinkOnceLinkage() || GV.hasAvailableExternallyLinkage()) &&
+        !Dest.getNamedValue(GV.getName()))
+      Kept.push_back(
+          ConstantExpr::getPointerBitCastOrAddrSpaceCast(&GV, Int8PtrTy));
+  if (Kept.empty())
+    return;
+  ArrayType *ATy = ArrayType::get(Int8PtrTy, Kept.size());
+  new GlobalVariable(Src, ATy, false, GlobalValue::AppendingLinkage,
+                     ConstantArray::get(ATy, Kept), KeepGlobalName);
+}
+
+/// Remove the global added by keepLinkOnceDefinitions() once all the inputs
+/// are linked.
+static void dropKeepGlobal(Module &M) {
+  GlobalVariable *Keep = M.getNamedGlobal(KeepGlobalName);
+  if (!Keep)
+    return;
+  Keep->eraseFromParent();
+  for (GlobalValue &GV : M.global_values())
+    GV.removeDeadConstantUsers();
+}
+
+/// Link \p Files into the module of \p L. If \p Partial is set, the files are
+/// only a part of the inputs, linked into \p Partial. Errors are printed to
+/// \p ErrOS.
 static bool linkFiles(const char *argv0, LLVMContext &Context, Linker &L,
-                      const cl::list<std::string> &Files,
-                      unsigned Flags) {
+                      ArrayRef<std::string> Files, unsigned Flags,
+                      Module *Partial = nullptr, raw_ostream &ErrOS = errs()) {
   // Filter out flags that don't apply to the first file we load.
   unsigned ApplicableFlags = Flags & Linker::Flags::OverrideFromSrc;
   // Similar to some flags, internalization doesn't apply to the first file.
   bool InternalizeLinkedSymbols = false;
   for (const auto &File : Files) {
-    std::unique_ptr<Module> M = loadFile(argv0, File, Context);
+    std::unique_ptr<Module> M =
+        loadFile(argv0, File, Context, /* MaterializeMetadata */ true, ErrOS);
     if (!M.get()) {
-      errs() << argv0 << ": error loading file '" << File << "'\n";
+      ErrOS << argv0 << ": error loading file '" << File << "'\n";
       return false;
     }
 
     // Note that when ODR merging types cannot verify input files in here When
     // doing that debug metadata in the src module might already be pointing to
     // the destination.
-    if (DisableDITypeMap && verifyModule(*M, &errs())) {
-      errs() << argv0 << ": " << File << ": error: input module is broken!\n";
+    if (DisableDITypeMap && verifyModule(*M, &ErrOS)) {
+      ErrOS << argv0 << ": " << File << ": error: input module is broken!\n";
       return false;
     }
 
     // If a module summary index is supplied, load it so linkInModule can treat
     // local functions/variables as exported and promote if necessary.
     if (!SummaryIndex.empty()) {
-      std::unique_ptr<ModuleSummaryIndex> Index =
-          ExitOnErr(llvm::getModuleSummaryIndexForFile(SummaryIndex));
+      Expected<std::unique_ptr<ModuleSummaryIndex>> IndexOrErr =
+          llvm::getModuleSummaryIndexForFile(SummaryIndex);
+      if (!IndexOrErr) {
+        logAllUnhandledErrors(IndexOrErr.takeError(), ErrOS,
+                              std::string(argv0) + ": ");
+        return false;
+      }
+      std::unique_ptr<ModuleSummaryIndex> Index = std::move(*IndexOrErr);
 
       // Conservatively mark all internal values as promoted, since this tool
       // does not do the ThinLink that would normally determine what values to
@@ -312,7 +375,10 @@ static bool linkFiles(const char *argv0, LLVMContext &Context, Linker &L,
     }
 
     if (Verbose)
-      errs() << "Linking in '" << File << "'\n";
+      ErrOS << "Linking in '" << File << "'\n";
+
+    if (Partial)
+      keepLinkOnceDefinitions(*M, *Partial);
 
     bool Err = false;
     if (InternalizeLinkedSymbols) {
@@ -339,6 +405,159 @@ static bool linkFiles(const char *argv0, LLVMContext &Context, Linker &L,
   return true;
 }
 
+typedef SmallVector<char, 0> BitcodeBuffer;
+
+/// Set up \p Context for linking. Diagnostics go to \p DiagOS if it is set,
+/// to errs() otherwise.
+static void setUpContext(LLVMContext &Context, raw_ostream *DiagOS = nullptr) {
+  Context.setDiagnosticHandler(diagnosticHandler, DiagOS, true);
+  if (!DisableDITypeMap)
+    Context.enableDebugTypeODRUniquing();
+}
+
+static Expected<std::unique_ptr<Module>>
+parsePartialLink(const BitcodeBuffer &Buffer, LLVMContext &Context) {
+  MemoryBufferRef Ref(StringRef(Buffer.data(), Buffer.size()),
+                      "<partial link>");
+  return parseBitcodeFile(Ref, Context);
+}
+
+static Error makeLinkError(const Twine &Msg) {
+  return make_error<StringError>(Msg, inconvertibleErrorCode());
+}
+
+/// Link \p Files into a new module in a context of its own, and write the
+/// result to \p Result as bitcode. Diagnostics are printed to \p ErrOS.
+static Error linkFilesToBitcode(const char *argv0, ArrayRef<std::string> Files,
+                                unsigned Flags, BitcodeBuffer &Result,
+                                raw_ostream &ErrOS) {
+  LLVMContext Context;
+  setUpContext(Context, &ErrOS);
+  Module Partial("llvm-link", Context);
+  Linker L(Partial);
+  if (!linkFiles(argv0, Context, L, Files, Flags, &Partial, ErrOS))
+    return makeLinkError("failed to link files '" + Files.front() +
+                         "' to '" + Files.back() + "'");
+  raw_svector_ostream OS(Result);
+  WriteBitcodeToFile(&Partial, OS, PreserveBitcodeUseListOrder);
+  return Error::success();
+}
+
+/// Link the partial result \p Right into \p Left, in a context of their own.
+/// Diagnostics are printed to \p ErrOS.
+static Error mergePartialLinks(BitcodeBuffer &Left, BitcodeBuffer &Right,
+                               unsigned Flags, raw_ostream &ErrOS) {
+  LLVMContext Context;
+  setUpContext(Context, &ErrOS);
+  Expected<std::unique_ptr<Module>> Dest = parsePartialLink(Left, Context);
+  if (!Dest)
+    return Dest.takeError();
+  Expected<std::unique_ptr<Module>> Src = parsePartialLink(Right, Context);
+  if (!Src)
+    return Src.takeError();
+  Linker L(**Dest);
+  if (L.linkInModule(std::move(*Src), Flags))
+    return makeLinkError("failed to merge partial links");
+  Left.clear();
+  BitcodeBuffer().swap(Right);
+  raw_svector_ostream OS(Left);
+  WriteBitcodeToFile(Dest->get(), OS, PreserveBitcodeUseListOrder);
+  return Error::success();
+}
+
+namespace {
+/// The output of a task of linkFilesInParallel(), printed by the main thread
+/// once the task is done.
+struct TaskOutput {
+  std::string Diagnostics;
+  std::string ErrorMessage;
+};
+}
+
+/// Run \p Task, collecting its diagnostics and error into \p Out. Set \p Failed
+/// if it returns an error.
+static void runLinkTask(function_ref<Error(raw_ostream &)> Task,
+                        TaskOutput &Out, std::atomic<bool> &Failed) {
+  raw_string_ostream OS(Out.Diagnostics);
+  if (Error E = Task(OS)) {
+    Out.ErrorMessage = toString(std::move(E));
+    Failed = true;
+  }
+}
+
+/// Print the outputs of the tasks of a linkFilesInParallel() round in order,
+/// and clear them.
+static void printTaskOutputs(const char *argv0,
+                             std::vector<TaskOutput> &Outputs) {
+  for (TaskOutput &Out : Outputs) {
+    errs() << Out.Diagnostics;
+    if (!Out.ErrorMessage.empty())
+      errs() << argv0 << ": " << Out.ErrorMessage << "\n";
+    Out = TaskOutput();
+  }
+}
+
+/// Link \p Files like linkFiles(), on NumThreads threads.
+///
+/// Each thread links a contiguous range of the files into a module in its own
+/// context, as a context can only be used by one thread. Adjacent partial
+/// results are then merged pairwise, in parallel, until one is left, which is
+/// linked into \p L. Partial results move between contexts as bitcode. As the
+/// ranges are merged in order, the files are linked in the same order as by
+/// linkFiles(), so the same definitions win. Unlike with linkFiles(), a
+/// linkonce definition that only a later file references is kept.
+///
+/// The tasks never print or exit: their diagnostics and errors are collected
+/// and printed by this thread after each round.
+static bool linkFilesInParallel(const char *argv0, LLVMContext &Context,
+                                Linker &L, ArrayRef<std::string> Files,
+                                unsigned Flags) {
+  unsigned NumRanges = std::min<size_t>(NumThreads, Files.size());
+  std::vector<BitcodeBuffer> Partials(NumRanges);
+  std::vector<TaskOutput> Outputs(NumRanges);
+  std::atomic<bool> Failed(false);
+  ThreadPool Pool(NumRanges);
+
+  size_t Begin = 0;
+  for (unsigned I = 0; I != NumRanges; ++I) {
+    size_t End = Begin + (Files.size() - Begin) / (NumRanges - I);
+    ArrayRef<std::string> Range = Files.slice(Begin, End - Begin);
+    Pool.async([&, I, Range]() {
+      runLinkTask(
+          [&](raw_ostream &OS) {
+            return linkFilesToBitcode(argv0, Range, Flags, Partials[I], OS);
+          },
+          Outputs[I], Failed);
+    });
+    Begin = End;
+  }
+  Pool.wait();
+  printTaskOutputs(argv0, Outputs);
+
+  // Merge (Partials[I], Partials[I + Step]) pairs, doubling Step each round.
+  for (size_t Step = 1; Step < NumRanges && !Failed; Step *= 2) {
+    for (size_t I = 0; I + Step < NumRanges; I += 2 * Step)
+      Pool.async([&, I, Step]() {
+        runLinkTask(
+            [&](raw_ostream &OS) {
+              return mergePartialLinks(Partials[I], Partials[I + Step], Flags,
+                                       OS);
+            },
+            Outputs[I], Failed);
+      });
+    Pool.wait();
+    printTaskOutputs(argv0, Outputs);
+  }
+  if (Failed)
+    return false;
+
+  if (Verbose)
+    errs() << "Linking in the partial links\n";
+  std::unique_ptr<Module> M = ExitOnErr(parsePartialLink(Partials[0], Context));
+  dropKeepGlobal(*M);
+  return !L.linkInModule(std::move(M), Flags & Linker::Flags::OverrideFromSrc);
+}
+
 int main(int argc, char **argv) {
   // Print a stack trace if we signal out.
   sys::PrintStackTraceOnErrorSignal(argv[0]);
@@ -346,14 +565,11 @@ int main(int argc, char **argv) {
 
   ExitOnErr.setBanner(std::string(argv[0]) + ": ");
 
-  LLVMContext Context;
-  Context.setDiagnosticHandler(diagnosticHandler, nullptr, true);
-
   llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
   cl::ParseCommandLineOptions(argc, argv, "llvm linker\n");
 
-  if (!DisableDITypeMap)
-    Context.enableDebugTypeODRUniquing();
+  LLVMContext Context;
+  setUpContext(Context);
 
   auto Composite = make_unique<Module>("llvm-link", Context);
   Linker L(*Composite);
@@ -362,8 +578,14 @@ int main(int argc, char **argv) {
   if (OnlyNeeded)
     Flags |= Linker::Flags::LinkOnlyNeeded;
 
-  // First add all the regular input files
-  if (!linkFiles(argv[0], Context, L, InputFilenames, Flags))
+  // First add all the regular input files. Linking only needed symbols and
+  // internalizing depend on what was linked before, so they need the
+  // sequential link.
+  if (NumThreads > 1 && !OnlyNeeded && !Internalize &&
+      InputFilenames.size() > 1) {
+    if (!linkFilesInParallel(argv[0], Context, L, InputFilenames, Flags))
+      return 1;
+  } else if (!linkFiles(argv[0], Context, L, InputFilenames, Flags))
     return 1;
 
   // Next the -override ones.
@@ -30,6 +30,7 @@
 #include <cstdio>
 #include <cstring>
 #include <string>
+#include <vector>
 
 using namespace llvm;
 using namespace symbolize;
@@ -85,9 +86,31 @@ static cl::opt<int> ClPrintSourceContextLines(
     "print-source-context-lines", cl::init(0),
     cl::desc("Print N number of source file context"));
 
+static cl::opt<std::string>
+    ClCacheDir("cache-dir", cl::init(""),
+               cl::desc("Directory used to cache symbolization results "
+                        "across runs"));
+
 static cl::opt<bool> ClVerbose("verbose", cl::init(false),
                                cl::desc("Print verbose line info"));
 
+static cl::opt<bool>
+    ClBatch("batch", cl::init(false),
+            cl::desc("Read all of the input before symbolizing it, resolving "
+                     "the addresses of different modules in parallel"));
+
+static cl::opt<unsigned>
+    ClNumThreads("num-threads", cl::init(0),
+                 cl::desc("Number of threads to use with -batch "
+                          "(default: autodetect)"));
+static cl::alias ClNumThreadsA("j", cl::desc("Alias for -num-threads"),
+                               cl::aliasopt(ClNumThreads));
+
+static cl::opt<unsigned> ClMaxParsedUnits(
+    "max-parsed-units", cl::init(0),
+    cl::desc("Maximum number of DWARF units per module whose DIEs are kept "
+             "parsed (default: no limit)"));
+
 template<typename T>
 static bool error(Expected<T> &ResOrErr) {
   if (ResOrErr)
@@ -152,6 +175,9 @@ int main(int argc, char **argv) {
   LLVMSymbolizer::Options Opts(ClPrintFunctions, ClUseSymbolTable, ClDemangle,
                                ClUseRelativeAddress, ClDefaultArch);
 
+  Opts.CacheDir = ClCacheDir;
+  Opts.MaxParsedUnits = ClMaxParsedUnits;
+
   for (const auto &hint : ClDsymHint) {
     if (sys::path::extension(hint) == ".dSYM") {
       Opts.DsymHints.push_back(hint);
@@ -168,6 +194,69 @@ int main(int argc, char **argv) {
   const int kMaxInputStringLength = 1024;
   char InputString[kMaxInputStringLength];
 
+  auto PrintAddress = [](uint64_t ModuleOffset) {
+    if (ClPrintAddress) {
+      outs() << "0x";
+      outs().write_hex(ModuleOffset);
+      StringRef Delimiter = (ClPrettyPrint == true) ? ": " : "\n";
+      outs() << Delimiter;
+    }
+  };
+
+  if (ClBatch) {
+    // Parse all of the input, resolve the code addresses in one batch and
+    // print the results in input order.
+    struct Command {
+      std::string Input;
+      std::string ModuleName;
+      bool Parsed;
+      bool IsData;
+      uint64_t ModuleOffset;
+      size_t BatchIndex;
+    };
+    std::vector<Command> Commands;
+    std::vector<LLVMSymbolizer::BatchRequest> Requests;
+    while (fgets(InputString, sizeof(InputString), stdin)) {
+      Command C;
+      C.Input = InputString;
+      C.Parsed = parseCommand(StringRef(InputString), C.IsData, C.ModuleName,
+                              C.ModuleOffset);
+      C.BatchIndex = Requests.size();
+      if (C.Parsed && !C.IsData)
+        Requests.emplace_back(C.ModuleName, C.ModuleOffset);
+      Commands.push_back(std::move(C));
+    }
+
+    std::vector<Expected<DIInliningInfo>> InlinedResults;
+    std::vector<Expected<DILineInfo>> Results;
+    if (ClPrintInlining)
+      InlinedResults =
+          Symbolizer.symbolizeInlinedCodeBatch(Requests, ClNumThreads);
+    else
+      Results = Symbolizer.symbolizeCodeBatch(Requests, ClNumThreads);
+
+    for (Command &C : Commands) {
+      if (!C.Parsed) {
+        outs() << C.Input;
+        continue;
+      }
+      PrintAddress(C.ModuleOffset);
+      if (C.IsData) {
+        auto ResOrErr = Symbolizer.symbolizeData(C.ModuleName, C.ModuleOffset);
+        Printer << (error(ResOrErr) ? DIGlobal() : ResOrErr.get());
+      } else if (ClPrintInlining) {
+        auto &ResOrErr = InlinedResults[C.BatchIndex];
+        Printer << (error(ResOrErr) ? DIInliningInfo() : ResOrErr.get());
+      } else {
+        auto &ResOrErr = Results[C.BatchIndex];
+        Printer << (error(ResOrErr) ? DILineInfo() : ResOrErr.get());
+      }
+      outs() << "\n";
+    }
+    outs().flush();
+    return 0;
+  }
+
   while (true) {
     if (!fgets(InputString, sizeof(InputString), stdin))
       break;
@@ -181,12 +270,7 @@ int main(int argc, char **argv) {
       continue;
     }
 
-    if (ClPrintAddress) {
-      outs() << "0x";
-      outs().write_hex(ModuleOffset);
-      StringRef Delimiter = (ClPrettyPrint == true) ? ": " : "\n";
-      outs() << Delimiter;
-    }
+    PrintAddress(ModuleOffset);
     if (IsData) {
       auto ResOrErr = Symbolizer.symbolizeData(ModuleName, ModuleOffset);
       Printer << (error(ResOrErr) ? DIGlobal() : ResOrErr.get());
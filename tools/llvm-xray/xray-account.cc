@@ -433,16 +433,17 @@ static CommandRegistration Unused(&Account, []() -> Error {
   llvm::xray::FuncIdConversionHelper FuncIdHelper(AccountInstrMap, Symbolizer,
                                                   FunctionAddresses);
   xray::LatencyAccountant FCA(FuncIdHelper, AccountDeduceSiblingCalls);
-  auto TraceOrErr = loadTraceFile(AccountInput);
-  if (!TraceOrErr)
+  auto StreamOrErr = openTraceFile(AccountInput);
+  if (!StreamOrErr)
     return joinErrors(
         make_error<StringError>(
             Twine("Failed loading input file '") + AccountInput + "'",
             std::make_error_code(std::errc::executable_format_error)),
-        TraceOrErr.takeError());
+        StreamOrErr.takeError());
 
-  auto &T = *TraceOrErr;
-  for (const auto &Record : T) {
+  auto &T = **StreamOrErr;
+  Error Err = Error::success();
+  for (const auto &Record : T.records(Err)) {
     if (FCA.accountRecord(Record))
       continue;
     for (const auto &ThreadStack : FCA.getPerThreadFunctionStack()) {
@@ -452,12 +453,22 @@ static CommandRegistration Unused(&Account, []() -> Error {
         errs() << "#" << Level-- << "\t"
                << FuncIdHelper.SymbolOrNumber(Entry.first) << '\n';
     }
-    if (!AccountKeepGoing)
+    if (!AccountKeepGoing) {
+      // Decoding errors end the iteration, so there is none to report here.
+      consumeError(std::move(Err));
       return make_error<StringError>(
           Twine("Failed accounting function calls in file '") + AccountInput +
               "'.",
           std::make_error_code(std::errc::executable_format_error));
+    }
   }
+  if (Err)
+    return joinErrors(
+        make_error<StringError>(
+            Twine("Failed loading input file '") + AccountInput + "'",
+            std::make_error_code(std::errc::executable_format_error)),
+        std::move(Err));
+
   switch (AccountOutputFormat) {
   case AccountOutputFormats::TEXT:
     FCA.exportStatsAsText(OS, T.getFileHeader());
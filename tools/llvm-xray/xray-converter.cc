@@ -68,7 +68,9 @@ static cl::alias ConvertInstrMap2("m", cl::aliasopt(ConvertInstrMap),
                                   cl::sub(Convert));
 static cl::opt<bool> ConvertSortInput(
     "sort",
-    cl::desc("determines whether to sort input log records by timestamp"),
+    cl::desc("determines whether to sort input log records by timestamp; "
+             "sorting loads the whole log, while unsorted records are "
+             "converted as they are read"),
     cl::sub(Convert), cl::init(true));
 static cl::alias ConvertSortInput2("s", cl::aliasopt(ConvertSortInput),
                                    cl::desc("Alias for -sort"),
@@ -76,27 +78,48 @@ static cl::alias ConvertSortInput2("s", cl::aliasopt(ConvertSortInput),
 
 using llvm::yaml::Output;
 
-void TraceConverter::exportAsYAML(const Trace &Records, raw_ostream &OS) {
-  YAMLXRayTrace Trace;
-  const auto &FH = Records.getFileHeader();
-  Trace.Header = {FH.Version, FH.Type, FH.ConstantTSC, FH.NonstopTSC,
-                  FH.CycleFrequency};
-  Trace.Records.reserve(Records.size());
+template <typename RecordRange>
+void TraceConverter::writeYAML(const XRayFileHeader &FH, RecordRange Records,
+                               raw_ostream &OS) {
+  YAMLXRayFileHeader Header = {FH.Version, FH.Type, FH.ConstantTSC,
+                               FH.NonstopTSC, FH.CycleFrequency};
+
+  // This emits the same document as `Out << YAMLXRayTrace`, but converts and
+  // writes the records one at a time instead of collecting them first.
+  Output Out(OS, nullptr, 0);
+  yaml::EmptyContext Ctx;
+  void *RecordsInfo;
+  bool UseDefault;
+  Out.beginDocuments();
+  Out.preflightDocument(0);
+  Out.beginMapping();
+  Out.mapRequired("header", Header);
+  Out.preflightKey("records", true, false, UseDefault, RecordsInfo);
+  Out.beginSequence();
+  unsigned Index = 0;
   for (const auto &R : Records) {
-    Trace.Records.push_back({R.RecordType, R.CPU, R.Type, R.FuncId,
+    YAMLXRayRecord Record = {R.RecordType, R.CPU, R.Type, R.FuncId,
                              Symbolize ? FuncIdHelper.SymbolOrNumber(R.FuncId)
                                        : llvm::to_string(R.FuncId),
-                             R.TSC, R.TId});
+                             R.TSC, R.TId};
+    void *RecordInfo;
+    Out.preflightElement(Index++, RecordInfo);
+    yaml::yamlize(Out, Record, true, Ctx);
+    Out.postflightElement(RecordInfo);
   }
-  Output Out(OS, nullptr, 0);
-  Out << Trace;
+  Out.endSequence();
+  Out.postflightKey(RecordsInfo);
+  Out.endMapping();
+  Out.postflightDocument();
+  Out.endDocuments();
 }
 
-void TraceConverter::exportAsRAWv1(const Trace &Records, raw_ostream &OS) {
+template <typename RecordRange>
+void TraceConverter::writeRAWv1(const XRayFileHeader &FH, RecordRange Records,
+                                raw_ostream &OS) {
   // First write out the file header, in the correct endian-appropriate format
   // (XRay assumes currently little endian).
   support::endian::Writer<support::endianness::little> Writer(OS);
-  const auto &FH = Records.getFileHeader();
   Writer.write(FH.Version);
   Writer.write(FH.Type);
   uint32_t Bitfield{0};
@@ -138,6 +161,28 @@ void TraceConverter::exportAsRAWv1(const Trace &Records, raw_ostream &OS) {
   }
 }
 
+void TraceConverter::exportAsYAML(const Trace &Records, raw_ostream &OS) {
+  writeYAML(Records.getFileHeader(), make_range(Records.begin(), Records.end()),
+            OS);
+}
+
+void TraceConverter::exportAsRAWv1(const Trace &Records, raw_ostream &OS) {
+  writeRAWv1(Records.getFileHeader(),
+             make_range(Records.begin(), Records.end()), OS);
+}
+
+Error TraceConverter::exportAsYAML(TraceStream &Records, raw_ostream &OS) {
+  Error Err = Error::success();
+  writeYAML(Records.getFileHeader(), Records.records(Err), OS);
+  return Err;
+}
+
+Error TraceConverter::exportAsRAWv1(TraceStream &Records, raw_ostream &OS) {
+  Error Err = Error::success();
+  writeRAWv1(Records.getFileHeader(), Records.records(Err), OS);
+  return Err;
+}
+
 namespace llvm {
 namespace xray {
 
@@ -171,23 +216,47 @@ static CommandRegistration Unused(&Convert, []() -> Error {
     return make_error<StringError>(
         Twine("Cannot open file '") + ConvertOutput + "' for writing.", EC);
 
-  auto TraceOrErr = loadTraceFile(ConvertInput, ConvertSortInput);
-  if (!TraceOrErr)
+  // Sorting needs all the records at once, otherwise they are converted as
+  // they are read.
+  if (ConvertSortInput) {
+    auto TraceOrErr = loadTraceFile(ConvertInput, true);
+    if (!TraceOrErr)
+      return joinErrors(
+          make_error<StringError>(
+              Twine("Failed loading input file '") + ConvertInput + "'.",
+              std::make_error_code(std::errc::executable_format_error)),
+          TraceOrErr.takeError());
+
+    auto &T = *TraceOrErr;
+    switch (ConvertOutputFormat) {
+    case ConvertFormats::YAML:
+      TC.exportAsYAML(T, OS);
+      break;
+    case ConvertFormats::BINARY:
+      TC.exportAsRAWv1(T, OS);
+      break;
+    }
+    return Error::success();
+  }
+
+  auto StreamOrErr = openTraceFile(ConvertInput);
+  if (!StreamOrErr)
     return joinErrors(
         make_error<StringError>(
             Twine("Failed loading input file '") + ConvertInput + "'.",
             std::make_error_code(std::errc::executable_format_error)),
-        TraceOrErr.takeError());
-
-  auto &T = *TraceOrErr;
-  switch (ConvertOutputFormat) {
-  case ConvertFormats::YAML:
-    TC.exportAsYAML(T, OS);
-    break;
-  case ConvertFormats::BINARY:
-    TC.exportAsRAWv1(T, OS);
-    break;
-  }
+        StreamOrErr.takeError());
+
+  auto &S = **StreamOrErr;
+  Error Err = ConvertOutputFormat == ConvertFormats::YAML
+                  ? TC.exportAsYAML(S, OS)
+                  : TC.exportAsRAWv1(S, OS);
+  if (Err)
+    return joinErrors(
+        make_error<StringError>(
+            Twine("Failed loading input file '") + ConvertInput + "'.",
+            std::make_error_code(std::errc::executable_format_error)),
+        std::move(Err));
   return Error::success();
 });
 
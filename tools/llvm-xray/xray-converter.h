@@ -31,6 +31,19 @@ public:
 
   void exportAsYAML(const Trace &Records, raw_ostream &OS);
   void exportAsRAWv1(const Trace &Records, raw_ostream &OS);
+
+  /// Streaming versions of the above, which only need the records of one
+  /// batch in memory at a time.
+  Error exportAsYAML(TraceStream &Records, raw_ostream &OS);
+  Error exportAsRAWv1(TraceStream &Records, raw_ostream &OS);
+
+private:
+  template <typename RecordRange>
+  void writeYAML(const XRayFileHeader &FH, RecordRange Records,
+                 raw_ostream &OS);
+  template <typename RecordRange>
+  void writeRAWv1(const XRayFileHeader &FH, RecordRange Records,
+                  raw_ostream &OS);
 };
 
 } // namespace xray
@@ -42,6 +42,16 @@ static cl::alias GraphKeepGoing2("k", cl::aliasopt(GraphKeepGoing),
                                  cl::desc("Alias for -keep-going"),
                                  cl::sub(GraphC));
 
+static cl::opt<bool> GraphSortInput(
+    "sort",
+    cl::desc("determines whether to sort input log records by timestamp; "
+             "sorting loads the whole log, while unsorted records are "
+             "streamed and must be ordered per thread"),
+    cl::sub(GraphC), cl::init(true));
+static cl::alias GraphSortInput2("s", cl::aliasopt(GraphSortInput),
+                                 cl::desc("Alias for -sort"),
+                                 cl::sub(GraphC));
+
 static cl::opt<std::string>
     GraphOutput("output", cl::value_desc("Output file"), cl::init("-"),
                 cl::desc("output file; use '-' for stdout"), cl::sub(GraphC));
@@ -200,12 +210,11 @@ static void updateStat(GraphRenderer::TimeStat &S, int64_t L) {
 Error GraphRenderer::accountRecord(const XRayRecord &Record) {
   using std::make_error_code;
   using std::errc;
-  if (CurrentMaxTSC == 0)
-    CurrentMaxTSC = Record.TSC;
-
-  if (Record.TSC < CurrentMaxTSC)
+  auto &MaxTSC = PerThreadMaxTSC[Record.TId];
+  if (Record.TSC < MaxTSC)
     return make_error<StringError>("Records not in order",
                                    make_error_code(errc::invalid_argument));
+  MaxTSC = Record.TSC;
 
   auto &ThreadStack = PerThreadFunctionStack[Record.TId];
   switch (Record.Type) {
@@ -455,6 +464,37 @@ void GraphRenderer::exportGraphAsDOT(raw_ostream &OS, const XRayFileHeader &H,
   OS << "}\n";
 }
 
+// Accounts the records in the graph, printing the function call stacks when a
+// record doesn't fit in them.
+template <typename RecordRange>
+static Error accountRecords(GraphRenderer &GR,
+                            const FuncIdConversionHelper &FuncIdHelper,
+                            RecordRange &&Records) {
+  for (const auto &Record : Records) {
+    auto E = GR.accountRecord(Record);
+    if (!E)
+      continue;
+
+    for (const auto &ThreadStack : GR.getPerThreadFunctionStack()) {
+      errs() << "Thread ID: " << ThreadStack.first << "\n";
+      auto Level = ThreadStack.second.size();
+      for (const auto &Entry : llvm::reverse(ThreadStack.second))
+        errs() << "#" << Level-- << "\t"
+               << FuncIdHelper.SymbolOrNumber(Entry.FuncId) << '\n';
+    }
+
+    if (!GraphKeepGoing)
+      return joinErrors(make_error<StringError>(
+                            "Error encountered generating the call graph.",
+                            std::make_error_code(std::errc::invalid_argument)),
+                        std::move(E));
+
+    handleAllErrors(std::move(E),
+                    [&](const ErrorInfoBase &E) { E.log(errs()); });
+  }
+  return Error::success();
+}
+
 // Here we register and implement the llvm-xray graph subcommand.
 // The bulk of this code reads in the options, opens the required files, uses
 // those files to create a context for analysing the xray trace, then there is a
@@ -489,41 +529,50 @@ static CommandRegistration Unused(&GraphC, []() -> Error {
     return make_error<StringError>(
         Twine("Cannot open file '") + GraphOutput + "' for writing.", EC);
 
-  auto TraceOrErr = loadTraceFile(GraphInput, true);
-  if (!TraceOrErr)
+  // Here we generate the call graph from entries we find in the trace.
+  // Sorting needs all the records at once, otherwise they are streamed in file
+  // order, which only has to be sorted within each thread.
+  if (GraphSortInput) {
+    auto TraceOrErr = loadTraceFile(GraphInput, true);
+    if (!TraceOrErr)
+      return joinErrors(
+          make_error<StringError>(
+              Twine("Failed loading input file '") + GraphInput + "'",
+              make_error_code(llvm::errc::invalid_argument)),
+          TraceOrErr.takeError());
+
+    auto &Trace = *TraceOrErr;
+    if (auto E = accountRecords(GR, FuncIdHelper, Trace))
+      return E;
+    GR.exportGraphAsDOT(OS, Trace.getFileHeader(), GraphEdgeLabel,
+                        GraphEdgeColorType, GraphVertexLabel,
+                        GraphVertexColorType);
+    return Error::success();
+  }
+
+  auto StreamOrErr = openTraceFile(GraphInput);
+  if (!StreamOrErr)
     return joinErrors(
         make_error<StringError>(Twine("Failed loading input file '") +
                                     GraphInput + "'",
                                 make_error_code(llvm::errc::invalid_argument)),
-        TraceOrErr.takeError());
-
-  auto &Trace = *TraceOrErr;
-  const auto &Header = Trace.getFileHeader();
-
-  // Here we generate the call graph from entries we find in the trace.
-  for (const auto &Record : Trace) {
-    auto E = GR.accountRecord(Record);
-    if (!E)
-      continue;
-
-    for (const auto &ThreadStack : GR.getPerThreadFunctionStack()) {
-      errs() << "Thread ID: " << ThreadStack.first << "\n";
-      auto Level = ThreadStack.second.size();
-      for (const auto &Entry : llvm::reverse(ThreadStack.second))
-        errs() << "#" << Level-- << "\t"
-               << FuncIdHelper.SymbolOrNumber(Entry.FuncId) << '\n';
-    }
-
-    if (!GraphKeepGoing)
-      return joinErrors(make_error<StringError>(
-                            "Error encountered generating the call graph.",
-                            std::make_error_code(std::errc::invalid_argument)),
-                        std::move(E));
-
-    handleAllErrors(std::move(E),
-                    [&](const ErrorInfoBase &E) { E.log(errs()); });
+        StreamOrErr.takeError());
+
+  auto &Trace = **StreamOrErr;
+  Error Err = Error::success();
+  if (auto E = accountRecords(GR, FuncIdHelper, Trace.records(Err))) {
+    // The iteration stopped before the end, so there is no decoding error.
+    consumeError(std::move(Err));
+    return E;
   }
-  GR.exportGraphAsDOT(OS, Header, GraphEdgeLabel, GraphEdgeColorType,
-                      GraphVertexLabel, GraphVertexColorType);
+  if (Err)
+    return joinErrors(
+        make_error<StringError>(Twine("Failed loading input file '") +
+                                    GraphInput + "'",
+                                make_error_code(llvm::errc::invalid_argument)),
+        std::move(Err));
+  GR.exportGraphAsDOT(OS, Trace.getFileHeader(), GraphEdgeLabel,
+                      GraphEdgeColorType, GraphVertexLabel,
+                      GraphVertexColorType);
   return Error::success();
 });
@@ -100,7 +100,10 @@ public:
   /// Usefull object for getting human readable Symbol Names.
   const FuncIdConversionHelper &FuncIdHelper;
   bool DeduceSiblingCalls = false;
-  TimestampT CurrentMaxTSC = 0;
+
+  /// The latest timestamp seen for each thread. Records only have to be
+  /// sorted within a thread.
+  DenseMap<llvm::sys::ProcessInfo::ProcessId, TimestampT> PerThreadMaxTSC;
 
   /// A private function to help implement the statistic generation functions;
   template <typename U>
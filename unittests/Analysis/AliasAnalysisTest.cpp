@@ -204,6 +204,40 @@ TEST_F(AliasAnalysisTest, getModRefInfo) {
   EXPECT_EQ(AA.getModRefInfo(AtomicRMW), MRI_ModRef);
 }
 
+TEST_F(AliasAnalysisTest, DecomposedGEPCacheUpdatesOnRAUW) {
+  SMDiagnostic Err;
+  std::unique_ptr<Module> PM =
+      parseAssemblyString("define void @f(i32* %p, i64 %i) {\n"
+                          "entry:\n"
+                          "  %j = add i64 %i, 1\n"
+                          "  %a = getelementptr i32, i32* %p, i64 %i\n"
+                          "  %b = getelementptr i32, i32* %p, i64 %j\n"
+                          "  ret void\n"
+                          "}\n",
+                          Err, C);
+  ASSERT_TRUE(PM);
+  Function *F = PM->getFunction("f");
+  Instruction *J = nullptr, *A = nullptr, *B = nullptr;
+  for (Instruction &I : instructions(F)) {
+    if (I.getName() == "j")
+      J = &I;
+    else if (I.getName() == "a")
+      A = &I;
+    else if (I.getName() == "b")
+      B = &I;
+  }
+  ASSERT_TRUE(J && A && B);
+
+  auto &AA = getAAResults(*F);
+  EXPECT_EQ(AA.alias(A, 4, B, 4), NoAlias);
+
+  // The decomposition of %b, which BasicAA keeps from the query above, must
+  // not survive the index it was computed from.
+  J->replaceAllUsesWith(F->arg_begin() + 1);
+  J->eraseFromParent();
+  EXPECT_EQ(AA.alias(A, 4, B, 4), MustAlias);
+}
+
 class AAPassInfraTest : public testing::Test {
 protected:
   LLVMContext C;
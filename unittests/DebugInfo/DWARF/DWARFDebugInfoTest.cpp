@@ -1661,4 +1661,77 @@ TEST(DWARFDebugInfo, TestImplicitConstAbbrevs) {
   EXPECT_EQ(DIEs.find(Val2)->second, AbbrevPtrVal2);
 }
 
+TEST(DWARFDebugInfo, TestSubprogramForAddress) {
+  // Test that address lookups find the first subprogram, in DIE order, that
+  // covers an address, and that they keep working when a bounded number of
+  // units is kept parsed.
+  uint16_t Version = 4;
+
+  const uint8_t AddrSize = sizeof(void *);
+  initLLVMIfNeeded();
+  Triple Triple = getHostTripleForAddrSize(AddrSize);
+  auto ExpectedDG = dwarfgen::Generator::create(Triple, Version);
+  if (HandleExpectedError(ExpectedDG))
+    return;
+  dwarfgen::Generator *DG = ExpectedDG.get().get();
+
+  auto AddSubprogram = [](dwarfgen::DIE Parent, StringRef Name,
+                          uint64_t LowPC, uint64_t HighPC) {
+    auto SP = Parent.addChild(DW_TAG_subprogram);
+    SP.addAttribute(DW_AT_name, DW_FORM_strp, Name);
+    SP.addAttribute(DW_AT_low_pc, DW_FORM_addr, LowPC);
+    SP.addAttribute(DW_AT_high_pc, DW_FORM_data4, HighPC - LowPC);
+    return SP;
+  };
+  {
+    auto CUDie = DG->addCompileUnit().getUnitDIE();
+    auto Outer = AddSubprogram(CUDie, "outer", 0x1000, 0x2000);
+    AddSubprogram(Outer, "nested", 0x1800, 0x1900);
+    AddSubprogram(CUDie, "after", 0x2000, 0x2100);
+  }
+  {
+    auto CUDie = DG->addCompileUnit().getUnitDIE();
+    AddSubprogram(CUDie, "other", 0x4000, 0x4100);
+  }
+
+  MemoryBufferRef FileBuffer(DG->generate(), "dwarf");
+  auto Obj = object::ObjectFile::createObjectFile(FileBuffer);
+  EXPECT_TRUE((bool)Obj);
+  DWARFContextInMemory DwarfContext(*Obj.get());
+  EXPECT_EQ(DwarfContext.getNumCompileUnits(), 2u);
+
+  DILineInfoSpecifier Spec(DILineInfoSpecifier::FileLineInfoKind::None,
+                           DINameKind::ShortName);
+  auto NameAt = [&](uint64_t Address) {
+    return DwarfContext.getLineInfoForAddress(Address, Spec).FunctionName;
+  };
+
+  for (unsigned MaxUnits : {0u, 1u}) {
+    DwarfContext.setMaxParsedUnitsForAddressQueries(MaxUnits);
+    EXPECT_EQ(NameAt(0x1000), "outer");
+    // The lookup finds "outer" first and then descends into its children.
+    EXPECT_EQ(NameAt(0x1850), "nested");
+    EXPECT_EQ(NameAt(0x1fff), "outer");
+    EXPECT_EQ(NameAt(0x2000), "after");
+    EXPECT_EQ(NameAt(0x4080), "other");
+    EXPECT_EQ(NameAt(0x1900), "outer");
+    EXPECT_EQ(NameAt(0x4000), "other");
+    EXPECT_EQ(NameAt(0x2100), "<invalid>");
+    EXPECT_EQ(NameAt(0x0fff), "<invalid>");
+  }
+
+  // Only the unit DIE is left in the units that fall off the parsed units.
+  DWARFCompileUnit *CU0 = DwarfContext.getCompileUnitAtIndex(0);
+  DWARFCompileUnit *CU1 = DwarfContext.getCompileUnitAtIndex(1);
+  DwarfContext.setMaxParsedUnitsForAddressQueries(1);
+  EXPECT_EQ(NameAt(0x1850), "nested");
+  EXPECT_EQ(CU0->getNumParsedDIEs(), 6u);
+  EXPECT_EQ(NameAt(0x4000), "other");
+  EXPECT_EQ(CU0->getNumParsedDIEs(), 1u);
+  EXPECT_EQ(CU1->getNumParsedDIEs(), 3u);
+  EXPECT_EQ(NameAt(0x2000), "after");
+  EXPECT_EQ(CU0->getNumParsedDIEs(), 6u);
+  EXPECT_EQ(CU1->getNumParsedDIEs(), 1u);
+}
+
 } // end anonymous namespace
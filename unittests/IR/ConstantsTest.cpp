@@ -8,15 +8,18 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/AsmParser/Parser.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm-c/Core.h"
 #include "gtest/gtest.h"
+#include <thread>
 
 namespace llvm {
 namespace {
@@ -476,5 +479,59 @@ TEST(ConstantsTest, BitcastToGEP) {
             Instruction::BitCast);
 }
 
+#if LLVM_ENABLE_THREADS
+TEST(ConstantsTest, ThreadSafeUniquing) {
+  LLVMContext Context;
+  Context.setThreadSafeUniquing(true);
+  EXPECT_TRUE(Context.hasThreadSafeUniquing());
+
+  const unsigned NumThreads = 4;
+  const unsigned NumValues = 256;
+  struct Entities {
+    std::vector<Constant *> Constants;
+    std::vector<Type *> Types;
+    std::vector<Metadata *> Nodes;
+  };
+  std::vector<Entities> PerThread(NumThreads);
+
+  // Every thread creates the same entities, in a different order.
+  std::vector<std::thread> Threads;
+  for (unsigned T = 0; T < NumThreads; ++T)
+    Threads.emplace_back([&, T] {
+      Entities &E = PerThread[T];
+      for (unsigned I = 0; I < NumValues; ++I) {
+        unsigned V = (I * (T + 1)) % NumValues;
+        Type *IntTy = IntegerType::get(Context, 8 + V);
+        Constant *C = ConstantInt::get(IntTy, V);
+        E.Constants.push_back(C);
+        Type *PtrTy = PointerType::get(IntTy, V % 3);
+        E.Constants.push_back(ConstantExpr::getIntToPtr(C, PtrTy));
+        E.Types.push_back(PtrTy);
+        E.Types.push_back(FunctionType::get(IntTy, {IntTy, IntTy}, false));
+        E.Nodes.push_back(MDTuple::get(
+            Context, {MDString::get(Context, std::to_string(V)),
+                      ConstantAsMetadata::get(C)}));
+      }
+    });
+  for (auto &Thread : Threads)
+    Thread.join();
+
+  // Map everything back to the first thread's order before comparing.
+  for (unsigned T = 1; T < NumThreads; ++T) {
+    for (unsigned I = 0; I < NumValues; ++I) {
+      unsigned V = (I * (T + 1)) % NumValues;
+      // Find the index thread 0 used for V, it went through the values in
+      // order.
+      EXPECT_EQ(PerThread[0].Constants[2 * V], PerThread[T].Constants[2 * I]);
+      EXPECT_EQ(PerThread[0].Constants[2 * V + 1],
+                PerThread[T].Constants[2 * I + 1]);
+      EXPECT_EQ(PerThread[0].Types[2 * V], PerThread[T].Types[2 * I]);
+      EXPECT_EQ(PerThread[0].Types[2 * V + 1], PerThread[T].Types[2 * I + 1]);
+      EXPECT_EQ(PerThread[0].Nodes[V], PerThread[T].Nodes[I]);
+    }
+  }
+}
+#endif
+
 }  // end anonymous namespace
 }  // end namespace llvm
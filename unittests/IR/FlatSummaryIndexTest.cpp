@@ -0,0 +1,144 @@
+//===- unittests/IR/FlatSummaryIndexTest.cpp - FlatSummaryIndex tests -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/FlatSummaryIndex.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+typedef GlobalValueSummary::GVFlags GVFlags;
+
+std::unique_ptr<FunctionSummary>
+makeFunction(GlobalValue::LinkageTypes Linkage, unsigned NumInsts,
+             std::vector<ValueInfo> Refs,
+             std::vector<FunctionSummary::EdgeTy> Calls) {
+  return llvm::make_unique<FunctionSummary>(
+      GVFlags(Linkage, false, false), NumInsts, std::move(Refs),
+      std::move(Calls), std::vector<GlobalValue::GUID>(),
+      std::vector<FunctionSummary::VFuncId>(),
+      std::vector<FunctionSummary::VFuncId>(),
+      std::vector<FunctionSummary::ConstVCall>(),
+      std::vector<FunctionSummary::ConstVCall>());
+}
+
+// foo (10) in a.o calls bar (20) and references 30, which has no summary.
+// bar is defined in b.o and as a local in a.o, and baz (40) in b.o is an
+// alias to bar.
+void buildIndex(ModuleSummaryIndex &Index) {
+  StringRef A = Index.addModulePath("a.o", 1, ModuleHash{{1, 2, 3, 4, 5}})
+                    ->first();
+  StringRef B = Index.addModulePath("b.o", 2)->first();
+
+  auto Foo = makeFunction(
+      GlobalValue::ExternalLinkage, 7, {ValueInfo(30)},
+      {{ValueInfo(20), CalleeInfo(CalleeInfo::HotnessType::Hot)}});
+  Foo->setModulePath(A);
+  Foo->setOriginalName(99);
+  Index.addGlobalValueSummary(10, std::move(Foo));
+
+  auto Bar = makeFunction(GlobalValue::ExternalLinkage, 3, {}, {});
+  Bar->setModulePath(B);
+  GlobalValueSummary *BarSummary = Bar.get();
+  Index.addGlobalValueSummary(20, std::move(Bar));
+  auto LocalBar = makeFunction(GlobalValue::InternalLinkage, 2, {}, {});
+  LocalBar->setModulePath(A);
+  Index.addGlobalValueSummary(20, std::move(LocalBar));
+
+  auto Baz = llvm::make_unique<AliasSummary>(
+      GVFlags(GlobalValue::ExternalLinkage, true, true),
+      std::vector<ValueInfo>());
+  Baz->setModulePath(B);
+  Baz->setAliasee(BarSummary);
+  Index.addGlobalValueSummary(40, std::move(Baz));
+}
+
+void checkIndex(const FlatSummaryIndex &Flat) {
+  ASSERT_EQ(2u, Flat.getNumModules());
+  EXPECT_EQ("a.o", Flat.getModulePath(0));
+  EXPECT_EQ("b.o", Flat.getModulePath(1));
+  EXPECT_EQ(1u, Flat.getModuleId(0));
+  EXPECT_EQ(5u, Flat.getModuleHash(0)[4]);
+
+  ASSERT_EQ(4u, Flat.getNumValues());
+  EXPECT_EQ(30u, Flat.getGUID(2));
+  EXPECT_TRUE(Flat.isInIndex(1));
+  EXPECT_FALSE(Flat.isInIndex(2));
+  EXPECT_EQ(3u, Flat.findValue(40));
+  EXPECT_EQ(FlatSummaryIndex::NotFound, Flat.findValue(50));
+  EXPECT_EQ(10u, Flat.getGUIDFromOriginalID(99));
+  EXPECT_EQ(0u, Flat.getGUIDFromOriginalID(98));
+
+  ASSERT_EQ(4u, Flat.getNumSummaries());
+  EXPECT_EQ(1u, Flat.summaries(0).end() - Flat.summaries(0).begin());
+  EXPECT_EQ(2u, Flat.summaries(1).end() - Flat.summaries(1).begin());
+  EXPECT_TRUE(Flat.summaries(2).begin() == Flat.summaries(2).end());
+
+  // foo
+  EXPECT_EQ(GlobalValueSummary::FunctionKind, Flat.getKind(0));
+  EXPECT_EQ("a.o", Flat.getModulePathOf(0));
+  EXPECT_EQ(7u, Flat.instCount(0));
+  EXPECT_EQ(99u, Flat.getOriginalName(0));
+  ASSERT_EQ(1u, Flat.calls(0).size());
+  EXPECT_EQ(1u, Flat.calls(0)[0].callee());
+  EXPECT_EQ(CalleeInfo::HotnessType::Hot, Flat.calls(0)[0].hotness());
+  ASSERT_EQ(1u, Flat.refs(0).size());
+  EXPECT_EQ(2u, Flat.refs(0)[0]);
+
+  // bar, in the order of the summary list.
+  EXPECT_EQ("b.o", Flat.getModulePathOf(1));
+  EXPECT_EQ(GlobalValue::InternalLinkage, Flat.getLinkage(2));
+  EXPECT_TRUE(Flat.calls(1).empty());
+
+  // baz
+  EXPECT_EQ(GlobalValueSummary::AliasKind, Flat.getKind(3));
+  EXPECT_EQ(1u, Flat.getAliasee(3));
+  EXPECT_TRUE(Flat.notEligibleToImport(3));
+  EXPECT_TRUE(Flat.liveRoot(3));
+  EXPECT_FALSE(Flat.liveRoot(0));
+
+  ASSERT_EQ(2u, Flat.getDefinedSummaries(0).size());
+  EXPECT_EQ(0u, Flat.getDefinedSummaries(0)[0]);
+  EXPECT_EQ(2u, Flat.getDefinedSummaries(0)[1]);
+  EXPECT_EQ(2u, Flat.getDefinedSummaries(1).size());
+  EXPECT_EQ(2u, Flat.findDefinedSummary(0, 1));
+  EXPECT_EQ(FlatSummaryIndex::NotFound, Flat.findDefinedSummary(1, 0));
+}
+
+TEST(FlatSummaryIndexTest, Flatten) {
+  ModuleSummaryIndex Index;
+  buildIndex(Index);
+  FlatSummaryIndex Flat(Index);
+  checkIndex(Flat);
+}
+
+TEST(FlatSummaryIndexTest, OnlyValues) {
+  ModuleSummaryIndex Index;
+  buildIndex(Index);
+  DenseSet<GlobalValue::GUID> Values;
+  Values.insert(10);
+  FlatSummaryIndex Flat(Index, &Values);
+
+  // bar and 30 are referenced by foo, but only foo has summaries.
+  ASSERT_EQ(2u, Flat.getNumModules());
+  ASSERT_EQ(3u, Flat.getNumValues());
+  EXPECT_EQ(FlatSummaryIndex::NotFound, Flat.findValue(40));
+  EXPECT_TRUE(Flat.isInIndex(1));
+  EXPECT_FALSE(Flat.isInIndex(2));
+  EXPECT_TRUE(Flat.summaries(1).begin() == Flat.summaries(1).end());
+  ASSERT_EQ(1u, Flat.getNumSummaries());
+  EXPECT_EQ(0u, Flat.getValue(0));
+  EXPECT_EQ(1u, Flat.calls(0)[0].callee());
+  EXPECT_EQ(10u, Flat.getGUIDFromOriginalID(99));
+  ASSERT_EQ(1u, Flat.getDefinedSummaries(0).size());
+  EXPECT_TRUE(Flat.getDefinedSummaries(1).empty());
+}
+
+} // end anonymous namespace
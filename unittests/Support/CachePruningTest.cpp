@@ -9,6 +9,9 @@
 
 #include "llvm/Support/CachePruning.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -19,6 +22,7 @@ TEST(CachePruningPolicyParser, Empty) {
   EXPECT_EQ(std::chrono::seconds(1200), P->Interval);
   EXPECT_EQ(std::chrono::hours(7 * 24), P->Expiration);
   EXPECT_EQ(75u, P->PercentageOfAvailableSpace);
+  EXPECT_EQ(0u, P->MaxSizeBytes);
 }
 
 TEST(CachePruningPolicyParser, Interval) {
@@ -45,6 +49,22 @@ TEST(CachePruningPolicyParser, PercentageOfAvailableSpace) {
   EXPECT_EQ(100u, P->PercentageOfAvailableSpace);
 }
 
+TEST(CachePruningPolicyParser, MaxSizeBytes) {
+  auto P = parseCachePruningPolicy("cache_size_bytes=1");
+  ASSERT_TRUE(bool(P));
+  EXPECT_EQ(75u, P->PercentageOfAvailableSpace);
+  EXPECT_EQ(1u, P->MaxSizeBytes);
+  P = parseCachePruningPolicy("cache_size_bytes=2k");
+  ASSERT_TRUE(bool(P));
+  EXPECT_EQ(2u * 1024u, P->MaxSizeBytes);
+  P = parseCachePruningPolicy("cache_size_bytes=3m");
+  ASSERT_TRUE(bool(P));
+  EXPECT_EQ(3u * 1024u * 1024u, P->MaxSizeBytes);
+  P = parseCachePruningPolicy("cache_size_bytes=4g");
+  ASSERT_TRUE(bool(P));
+  EXPECT_EQ(4ull * 1024ull * 1024ull * 1024ull, P->MaxSizeBytes);
+}
+
 TEST(CachePruningPolicyParser, Multiple) {
   auto P = parseCachePruningPolicy("prune_after=1s:cache_size=50%");
   ASSERT_TRUE(bool(P));
@@ -66,6 +86,123 @@ TEST(CachePruningPolicyParser, Errors) {
             toString(parseCachePruningPolicy("cache_size=foo%").takeError()));
   EXPECT_EQ("'101' must be between 0 and 100",
             toString(parseCachePruningPolicy("cache_size=101%").takeError()));
+  EXPECT_EQ("'foo' not an integer",
+            toString(parseCachePruningPolicy("cache_size_bytes=foo").takeError()));
+  EXPECT_EQ("'foo' not an integer",
+            toString(parseCachePruningPolicy("cache_size_bytes=foom").takeError()));
+  EXPECT_EQ("'99999999999999999g' too large",
+            toString(parseCachePruningPolicy(
+                         "cache_size_bytes=99999999999999999g").takeError()));
   EXPECT_EQ("Unknown key: 'foo'",
             toString(parseCachePruningPolicy("foo=bar").takeError()));
 }
+
+TEST(CachePruning, LeastRecentlyUsed) {
+  SmallString<128> CacheDir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("cache-pruning", CacheDir));
+  auto Entry = [&](StringRef Name) {
+    SmallString<128> Path(CacheDir);
+    sys::path::append(Path, Name);
+    return Path;
+  };
+  auto WriteEntry = [&](StringRef Name) {
+    std::error_code EC;
+    raw_fd_ostream OS(Entry(Name), EC, sys::fs::F_None);
+    ASSERT_FALSE(EC);
+    OS << std::string(100, 'x');
+  };
+
+  // Entries a and c are in the index. b is not, and its access time is now, so
+  // a is the least recently used entry and is the only one to be removed.
+  auto Now = std::chrono::system_clock::now();
+  WriteEntry("llvmcache-a");
+  WriteEntry("llvmcache-b");
+  WriteEntry("llvmcache-c");
+  WriteEntry("not-a-cache-file");
+  recordCacheAccess(Entry("llvmcache-c"), 100, Now - std::chrono::hours(2));
+  recordCacheAccess(Entry("llvmcache-a"), 100, Now - std::chrono::hours(3));
+  recordCacheAccess(Entry("llvmcache-c"), 100, Now - std::chrono::hours(1));
+
+  CachePruningPolicy Policy;
+  Policy.Interval = std::chrono::seconds(0);
+  Policy.PercentageOfAvailableSpace = 0;
+  Policy.MaxSizeBytes = 250;
+  EXPECT_TRUE(pruneCache(CacheDir, Policy));
+  EXPECT_FALSE(sys::fs::exists(Entry("llvmcache-a")));
+  EXPECT_TRUE(sys::fs::exists(Entry("llvmcache-b")));
+  EXPECT_TRUE(sys::fs::exists(Entry("llvmcache-c")));
+  EXPECT_TRUE(sys::fs::exists(Entry("not-a-cache-file")));
+
+  // The index now has b with its access time, so it is removed before c once c
+  // is used again.
+  recordCacheAccess(Entry("llvmcache-c"), 100, Now + std::chrono::minutes(1));
+  Policy.MaxSizeBytes = 150;
+  EXPECT_TRUE(pruneCache(CacheDir, Policy));
+  EXPECT_FALSE(sys::fs::exists(Entry("llvmcache-b")));
+  EXPECT_TRUE(sys::fs::exists(Entry("llvmcache-c")));
+
+  // Entries older than the expiration are removed regardless of the size.
+  WriteEntry("llvmcache-d");
+  recordCacheAccess(Entry("llvmcache-d"), 100, Now - std::chrono::hours(2));
+  Policy.Expiration = std::chrono::hours(1);
+  Policy.MaxSizeBytes = 0;
+  EXPECT_TRUE(pruneCache(CacheDir, Policy));
+  EXPECT_FALSE(sys::fs::exists(Entry("llvmcache-d")));
+  EXPECT_TRUE(sys::fs::exists(Entry("llvmcache-c")));
+
+  sys::fs::remove_directories(CacheDir);
+}
+
+TEST(CachePruning, IndexSizeOfLatestAccess) {
+  SmallString<128> CacheDir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("cache-pruning", CacheDir));
+  auto Entry = [&](StringRef Name) {
+    SmallString<128> Path(CacheDir);
+    sys::path::append(Path, Name);
+    return Path;
+  };
+  auto WriteEntry = [&](StringRef Name) {
+    std::error_code EC;
+    raw_fd_ostream OS(Entry(Name), EC, sys::fs::F_None);
+    ASSERT_FALSE(EC);
+    OS << std::string(100, 'x');
+  };
+
+  // The last line for a was written by a process that used it before the one
+  // that wrote the first line, so a is 100 bytes large and the cache fits.
+  auto Now = std::chrono::system_clock::now();
+  WriteEntry("llvmcache-a");
+  WriteEntry("llvmcache-b");
+  recordCacheAccess(Entry("llvmcache-a"), 100, Now - std::chrono::hours(1));
+  recordCacheAccess(Entry("llvmcache-a"), 1000, Now - std::chrono::hours(3));
+  recordCacheAccess(Entry("llvmcache-b"), 100, Now - std::chrono::hours(2));
+
+  CachePruningPolicy Policy;
+  Policy.Interval = std::chrono::seconds(0);
+  Policy.PercentageOfAvailableSpace = 0;
+  Policy.MaxSizeBytes = 200;
+  EXPECT_TRUE(pruneCache(CacheDir, Policy));
+  EXPECT_TRUE(sys::fs::exists(Entry("llvmcache-a")));
+  EXPECT_TRUE(sys::fs::exists(Entry("llvmcache-b")));
+
+  sys::fs::remove_directories(CacheDir);
+}
+
+TEST(CachePruning, IndexCompaction) {
+  SmallString<128> CacheDir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("cache-pruning", CacheDir));
+  SmallString<128> Entry(CacheDir), Index(CacheDir);
+  sys::path::append(Entry, "llvmcache-a");
+  sys::path::append(Index, "llvmcache.index");
+
+  // Without pruning, the index is still compacted once it is mostly made of
+  // stale lines: 5000 lines for the same file would take about 130KB.
+  auto Now = std::chrono::system_clock::now();
+  for (unsigned I = 0; I < 5000; ++I)
+    recordCacheAccess(Entry, 100, Now + std::chrono::seconds(I));
+  uint64_t IndexSize;
+  ASSERT_FALSE(sys::fs::file_size(Index, IndexSize));
+  EXPECT_LT(IndexSize, 64u * 1024);
+
+  sys::fs::remove_directories(CacheDir);
+}
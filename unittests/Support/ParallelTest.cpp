@@ -0,0 +1,107 @@
+//===- llvm/unittest/Support/ParallelTest.cpp - Parallel algorithm tests --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Parallel.h"
+#include "gtest/gtest.h"
+
+#include <array>
+#include <atomic>
+#include <random>
+
+using namespace llvm;
+
+namespace {
+
+class ParallelTest : public testing::Test {
+protected:
+  // Exercise the parallel code paths even on single core hosts. Only the
+  // first call matters, the executor is shared by all the tests.
+  void SetUp() override { parallel::setThreadCount(4); }
+};
+
+TEST_F(ParallelTest, ParallelSort) {
+  std::array<uint32_t, 65536> Array;
+  std::mt19937 Randomizer;
+  for (auto &I : Array)
+    I = Randomizer();
+
+  parallel_sort(std::begin(Array), std::end(Array));
+  ASSERT_TRUE(std::is_sorted(std::begin(Array), std::end(Array)));
+
+  parallel_sort(std::begin(Array), std::end(Array), std::greater<uint32_t>());
+  ASSERT_TRUE(std::is_sorted(std::begin(Array), std::end(Array),
+                             std::greater<uint32_t>()));
+}
+
+TEST_F(ParallelTest, ParallelFor) {
+  std::vector<uint32_t> Range(2053);
+  parallel_for(0u, 2049u, [&Range](uint32_t I) { ++Range[I]; });
+  for (uint32_t I = 0; I < 2049; ++I)
+    ASSERT_EQ(1u, Range[I]);
+  for (uint32_t I = 2049; I < 2053; ++I)
+    ASSERT_EQ(0u, Range[I]);
+
+  // Explicit grain sizes, including one larger than the input.
+  parallel_for(0u, 2053u, [&Range](uint32_t I) { ++Range[I]; }, 7);
+  parallel_for(0u, 2053u, [&Range](uint32_t I) { ++Range[I]; }, 4096);
+  ASSERT_EQ(3u, Range[0]);
+  ASSERT_EQ(2u, Range[2052]);
+}
+
+TEST_F(ParallelTest, ParallelForEach) {
+  std::vector<std::atomic<int>> Counts(1000);
+  std::vector<int> Input;
+  for (int I = 0; I < 10000; ++I)
+    Input.push_back(I % 1000);
+  for (auto &C : Counts)
+    C = 0;
+
+  parallel_for_each(Input.begin(), Input.end(), [&Counts](int I) {
+    ++Counts[I];
+  });
+  for (auto &C : Counts)
+    ASSERT_EQ(10, C);
+}
+
+TEST_F(ParallelTest, TransformReduce) {
+  std::vector<uint32_t> Input(10000);
+  for (uint32_t I = 0; I < Input.size(); ++I)
+    Input[I] = I;
+
+  uint64_t Sum = parallel_transform_reduce(
+      Input.begin(), Input.end(), uint64_t(0), std::plus<uint64_t>(),
+      [](uint32_t I) { return uint64_t(I) * 2; });
+  EXPECT_EQ(uint64_t(9999) * 10000, Sum);
+
+  // The partial results are combined in order, even for a non commutative
+  // reduction.
+  std::string Concat = parallel_transform_reduce(
+      Input.begin(), Input.begin() + 200, std::string(),
+      [](std::string A, const std::string &B) { return A + B; },
+      [](uint32_t I) { return std::string(1, 'a' + I % 26); }, 3);
+  std::string Expected;
+  for (uint32_t I = 0; I < 200; ++I)
+    Expected += 'a' + I % 26;
+  EXPECT_EQ(Expected, Concat);
+
+  // Empty input.
+  EXPECT_EQ(42, parallel_transform_reduce(Input.begin(), Input.begin(), 42,
+                                          std::plus<int>(),
+                                          [](uint32_t I) { return 1; }));
+}
+
+TEST_F(ParallelTest, NestedTaskGroups) {
+  std::atomic<unsigned> Count(0);
+  parallel_for(0u, 64u, [&Count](unsigned) {
+    parallel_for(0u, 64u, [&Count](unsigned) { ++Count; }, 1);
+  }, 1);
+  EXPECT_EQ(64u * 64u, Count);
+}
+
+} // end anonymous namespace
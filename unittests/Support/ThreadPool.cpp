@@ -164,3 +164,40 @@ TEST_F(ThreadPoolTest, PoolDestruction) {
   }
   ASSERT_EQ(5, checked_in);
 }
+
+TEST_F(ThreadPoolTest, NestedTasks) {
+  CHECK_UNSUPPORTED();
+  // Test that tasks can spawn subtasks and wait on them, even when there are
+  // more waiting tasks than threads in the pool.
+  std::atomic_int checked_in{0};
+  ThreadPool Pool(2);
+  for (size_t i = 0; i < 8; ++i) {
+    Pool.async([&Pool, &checked_in] {
+      std::vector<std::shared_future<ThreadPool::VoidTy>> Futures;
+      for (size_t j = 0; j < 4; ++j)
+        Futures.push_back(Pool.async([&checked_in] { ++checked_in; }));
+      for (auto &Future : Futures)
+        Pool.wait(Future);
+      ++checked_in;
+    });
+  }
+  Pool.wait();
+  ASSERT_EQ(40, checked_in);
+}
+
+TEST_F(ThreadPoolTest, WaitOnFuture) {
+  CHECK_UNSUPPORTED();
+  // Test that waiting on a future from outside the pool blocks until the task
+  // completes.
+  ThreadPool Pool(2);
+  std::atomic_int i{0};
+  auto Future = Pool.async([this, &i] {
+    waitForMainThread();
+    ++i;
+  });
+  ASSERT_EQ(0, i.load());
+  setMainThreadReady();
+  Pool.wait(Future);
+  ASSERT_EQ(1, i.load());
+  Pool.wait();
+}
@@ -0,0 +1,168 @@
+//===- llvm/unittest/XRay/TraceTest.cpp - XRay Trace unit tests -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/XRay/Trace.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace xray;
+
+namespace {
+
+typedef support::endian::Writer<support::endianness::little> WriterT;
+
+// Removes the trace file at the end of a test.
+struct TempTrace {
+  SmallString<128> Path;
+  int FD = -1;
+
+  TempTrace() {
+    std::error_code EC =
+        sys::fs::createTemporaryFile("TraceTest", "xray", FD, Path);
+    EXPECT_FALSE(EC);
+  }
+  ~TempTrace() { sys::fs::remove(Path); }
+};
+
+void writeHeader(WriterT &W, uint16_t Type, uint64_t FreeFormData) {
+  W.write(uint16_t{1});
+  W.write(Type);
+  W.write(uint32_t{3});
+  W.write(uint64_t{1000});
+  W.write(FreeFormData);
+  W.write(uint64_t{0});
+}
+
+// Writes a 16 byte metadata record of the given kind, with its payload.
+void writeMetadata(WriterT &W, uint8_t Kind, uint16_t U16, uint64_t U64) {
+  W.write(uint8_t(Kind << 1 | 1));
+  W.write(U16);
+  W.write(U64);
+  W.write(uint8_t{0});
+  W.write(uint32_t{0});
+}
+
+// The traces are streamed through the smallest window that can be mapped, and
+// are a bit larger than it, to check that records are decoded correctly across
+// window boundaries.
+uint64_t getWindowSize() { return sys::fs::mapped_file_region::alignment(); }
+uint64_t getNumNaiveRecords() { return getWindowSize() / 32 * 5 / 4; }
+const uint64_t FDRBufferSize = 256;
+const uint64_t FDRRecordsPerBuffer = 10;
+uint64_t getNumFDRBuffers() { return getWindowSize() / FDRBufferSize * 5 / 4; }
+
+TEST(TraceTest, StreamNaiveLog) {
+  TempTrace T;
+  {
+    raw_fd_ostream OS(T.FD, true);
+    WriterT W(OS);
+    writeHeader(W, 0, 0);
+    for (uint64_t I = 0; I < getNumNaiveRecords(); ++I) {
+      W.write(uint16_t{0});
+      W.write(uint8_t(I % 8));
+      W.write(uint8_t(I % 2));
+      W.write(int32_t(I));
+      W.write(uint64_t(1000 + I));
+      W.write(uint32_t(I % 3));
+      W.write(uint32_t{0});
+      W.write(uint64_t{0});
+    }
+  }
+
+  auto StreamOrErr = openTraceFile(T.Path, getWindowSize());
+  ASSERT_TRUE(!!StreamOrErr);
+  auto &S = **StreamOrErr;
+  EXPECT_EQ(1000u, S.getFileHeader().CycleFrequency);
+
+  uint64_t I = 0;
+  Error Err = Error::success();
+  for (const auto &R : S.records(Err)) {
+    ASSERT_EQ(int32_t(I), R.FuncId);
+    EXPECT_EQ(1000 + I, R.TSC);
+    EXPECT_EQ(uint16_t(I % 8), R.CPU);
+    EXPECT_EQ(uint32_t(I % 3), R.TId);
+    EXPECT_EQ(I % 2 ? RecordTypes::EXIT : RecordTypes::ENTER, R.Type);
+    ++I;
+  }
+  EXPECT_FALSE(!!Err);
+  EXPECT_EQ(getNumNaiveRecords(), I);
+
+  auto TraceOrErr = loadTraceFile(T.Path);
+  ASSERT_TRUE(!!TraceOrErr);
+  EXPECT_EQ(getNumNaiveRecords(), TraceOrErr->size());
+}
+
+TEST(TraceTest, StreamFDRLog) {
+  TempTrace T;
+  {
+    raw_fd_ostream OS(T.FD, true);
+    WriterT W(OS);
+    writeHeader(W, 1, FDRBufferSize);
+    for (uint64_t B = 0; B < getNumFDRBuffers(); ++B) {
+      writeMetadata(W, 0, uint16_t(B % 4), 0); // NewBuffer
+      writeMetadata(W, 4, 0, 0);               // WallTimeMarker
+      writeMetadata(W, 2, 1, B * 10000);       // NewCPUId
+      for (uint64_t I = 0; I < FDRRecordsPerBuffer; ++I) {
+        W.write(uint32_t(I << 4 | (I % 2) << 1));
+        W.write(uint32_t{2});
+      }
+      writeMetadata(W, 1, 0, 0); // EndOfBuffer
+      // The rest of the thread buffer is garbage.
+      uint64_t Used = 4 * 16 + FDRRecordsPerBuffer * 8;
+      for (uint64_t I = Used; I < FDRBufferSize; I += 8)
+        W.write(uint64_t(~0ull));
+    }
+  }
+
+  auto StreamOrErr = openTraceFile(T.Path, getWindowSize());
+  ASSERT_TRUE(!!StreamOrErr);
+  auto &S = **StreamOrErr;
+
+  uint64_t N = 0;
+  Error Err = Error::success();
+  for (const auto &R : S.records(Err)) {
+    uint64_t B = N / FDRRecordsPerBuffer, I = N % FDRRecordsPerBuffer;
+    ASSERT_EQ(int32_t(I), R.FuncId);
+    EXPECT_EQ(B * 10000 + (I + 1) * 2, R.TSC);
+    EXPECT_EQ(uint32_t(B % 4), R.TId);
+    EXPECT_EQ(1u, R.CPU);
+    ++N;
+  }
+  EXPECT_FALSE(!!Err);
+  EXPECT_EQ(getNumFDRBuffers() * FDRRecordsPerBuffer, N);
+}
+
+TEST(TraceTest, StreamTruncatedFDRLog) {
+  TempTrace T;
+  {
+    raw_fd_ostream OS(T.FD, true);
+    WriterT W(OS);
+    writeHeader(W, 1, FDRBufferSize);
+    writeMetadata(W, 0, 1, 0);
+    writeMetadata(W, 4, 0, 0);
+    writeMetadata(W, 2, 1, 0);
+    W.write(uint32_t{1 << 4});
+    W.write(uint32_t{2});
+    writeMetadata(W, 1, 0, 0);
+  }
+
+  auto StreamOrErr = openTraceFile(T.Path, getWindowSize());
+  ASSERT_TRUE(!!StreamOrErr);
+  Error Err = Error::success();
+  for (const auto &R : (*StreamOrErr)->records(Err))
+    (void)R;
+  EXPECT_TRUE(!!Err);
+  consumeError(std::move(Err));
+}
+
+} // namespace
@@ -0,0 +1,215 @@
+//===- IRSymtabBench - Benchmark reading the symbols of bitcode archives --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program writes synthetic archives of bitcode members, with and without
+// the IR symbol table that the bitcode writer stores in each file, and outputs
+// how long it takes to write the archive symbol table and to enumerate the
+// symbols of every member, both through IRObjectFile and through the irsymtab.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Object/Archive.h"
+#include "llvm/Object/ArchiveWriter.h"
+#include "llvm/Object/IRObjectFile.h"
+#include "llvm/Object/IRSymtab.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+using namespace llvm::object;
+
+static cl::opt<unsigned> NumMembers("members",
+                                    cl::desc("Number of archive members"),
+                                    cl::init(10000));
+
+static cl::opt<unsigned>
+    NumFunctions("functions", cl::desc("Number of functions per member"),
+                 cl::init(20));
+
+static cl::opt<std::string>
+    Input(cl::Positional,
+          cl::desc("<input> (benchmark this archive instead of synthetic ones)"));
+
+static void report(const Timer &T, StringRef Name, StringRef What,
+                   uint64_t Members, uint64_t Symbols) {
+  double Seconds = T.getTotalTime().getWallTime();
+  outs() << format("%-12s %-10s %8llu members %10llu symbols %10.3f s\n",
+                   Name.str().c_str(), What.str().c_str(),
+                   (unsigned long long)Members, (unsigned long long)Symbols,
+                   Seconds);
+}
+
+static void benchmark(TimerGroup &Group, StringRef Name, StringRef Path) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufOrErr = MemoryBuffer::getFile(Path);
+  if (!BufOrErr) {
+    errs() << "irsymtab-bench: " << Path << ": "
+           << BufOrErr.getError().message() << '\n';
+    return;
+  }
+  Expected<std::unique_ptr<Archive>> ArchiveOrErr =
+      Archive::create((*BufOrErr)->getMemBufferRef());
+  if (!ArchiveOrErr) {
+    logAllUnhandledErrors(ArchiveOrErr.takeError(), errs(), "irsymtab-bench: ");
+    return;
+  }
+
+  std::vector<MemoryBufferRef> Members;
+  Error Err = Error::success();
+  for (const Archive::Child &C : (*ArchiveOrErr)->children(Err)) {
+    Expected<MemoryBufferRef> MemberOrErr = C.getMemoryBufferRef();
+    if (!MemberOrErr) {
+      logAllUnhandledErrors(MemberOrErr.takeError(), errs(),
+                            "irsymtab-bench: ");
+      continue;
+    }
+    Members.push_back(*MemberOrErr);
+  }
+  if (Err)
+    logAllUnhandledErrors(std::move(Err), errs(), "irsymtab-bench: ");
+
+  Timer Parsing((Name + ".irobject").str(), (Name + ": IRObjectFile").str(),
+                Group);
+  uint64_t ParsedSymbols = 0;
+  Parsing.startTimer();
+  for (MemoryBufferRef M : Members) {
+    LLVMContext Context;
+    Expected<std::unique_ptr<IRObjectFile>> ObjOrErr =
+        IRObjectFile::create(M, Context);
+    if (!ObjOrErr) {
+      consumeError(ObjOrErr.takeError());
+      continue;
+    }
+    for (const BasicSymbolRef &S : (*ObjOrErr)->symbols()) {
+      (void)S;
+      ++ParsedSymbols;
+    }
+  }
+  Parsing.stopTimer();
+  report(Parsing, Name, "irobject", Members.size(), ParsedSymbols);
+
+  Timer Reading((Name + ".irsymtab").str(), (Name + ": irsymtab").str(),
+                Group);
+  uint64_t ReadSymbols = 0;
+  Reading.startTimer();
+  for (MemoryBufferRef M : Members) {
+    Expected<BitcodeFileContents> BFCOrErr = getBitcodeFileContents(M);
+    if (!BFCOrErr) {
+      consumeError(BFCOrErr.takeError());
+      continue;
+    }
+    Expected<irsymtab::FileContents> FCOrErr = irsymtab::readBitcode(*BFCOrErr);
+    if (!FCOrErr) {
+      consumeError(FCOrErr.takeError());
+      continue;
+    }
+    irsymtab::Reader R = FCOrErr->getReader();
+    for (const irsymtab::Symbol &S : R.symbols()) {
+      (void)S;
+      ++ReadSymbols;
+    }
+  }
+  Reading.stopTimer();
+  report(Reading, Name, "irsymtab", Members.size(), ReadSymbols);
+
+  if (ParsedSymbols != ReadSymbols)
+    errs() << "irsymtab-bench: " << Name << ": readers disagree\n";
+}
+
+static std::unique_ptr<Module> makeModule(LLVMContext &Context, unsigned I) {
+  std::string IR;
+  raw_string_ostream OS(IR);
+  OS << "target datalayout = \"e-m:e-i64:64-f80:128-n8:16:32:64-S128\"\n"
+     << "target triple = \"x86_64-unknown-linux-gnu\"\n"
+     << "@g" << I << " = global i32 0\n"
+     << "declare void @external" << I << "()\n";
+  for (unsigned F = 0; F < NumFunctions; ++F)
+    OS << "define void @f" << I << "_" << F << "() {\n"
+       << "  store i32 " << F << ", i32* @g" << I << "\n"
+       << "  call void @external" << I << "()\n"
+       << "  ret void\n"
+       << "}\n";
+  OS.flush();
+
+  SMDiagnostic Diag;
+  std::unique_ptr<Module> M = parseAssemblyString(IR, Diag, Context);
+  if (!M)
+    Diag.print("irsymtab-bench", errs());
+  return M;
+}
+
+static bool benchmarkSynthetic(TimerGroup &Group, StringRef Name,
+                               bool WriteSymtab) {
+  LLVMContext Context;
+  std::vector<SmallVector<char, 0>> Buffers(NumMembers);
+  std::vector<std::string> Names(NumMembers);
+  std::vector<NewArchiveMember> Members;
+  for (unsigned I = 0; I < NumMembers; ++I) {
+    std::unique_ptr<Module> M = makeModule(Context, I);
+    if (!M)
+      return false;
+    BitcodeWriter Writer(Buffers[I]);
+    Writer.writeModule(M.get());
+    if (WriteSymtab)
+      Writer.writeSymtab();
+    Names[I] = "m" + std::to_string(I) + ".o";
+    Members.push_back(NewArchiveMember(MemoryBufferRef(
+        StringRef(Buffers[I].data(), Buffers[I].size()), Names[I])));
+  }
+
+  SmallString<128> Path;
+  if (std::error_code EC =
+          sys::fs::createTemporaryFile("irsymtab-bench", "a", Path)) {
+    errs() << "irsymtab-bench: cannot create temporary file: " << EC.message()
+           << '\n';
+    return false;
+  }
+
+  Timer Writing((Name + ".ar").str(), (Name + ": writeArchive").str(), Group);
+  Writing.startTimer();
+  std::pair<StringRef, std::error_code> Result =
+      writeArchive(Path, Members, /*WriteSymtab=*/true, Archive::K_GNU,
+                   /*Deterministic=*/true, /*Thin=*/false);
+  Writing.stopTimer();
+  if (Result.second) {
+    errs() << "irsymtab-bench: cannot write archive: "
+           << Result.second.message() << '\n';
+    sys::fs::remove(Path);
+    return false;
+  }
+  report(Writing, Name, "ar", Members.size(), 0);
+
+  benchmark(Group, Name, Path);
+  sys::fs::remove(Path);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "IR symbol table benchmark\n");
+  TimerGroup Group("irsymtab", "IR symbol table benchmark");
+
+  if (Input.getNumOccurrences()) {
+    benchmark(Group, "Input", Input);
+    return 0;
+  }
+
+  if (!benchmarkSynthetic(Group, "Symtab", /*WriteSymtab=*/true) ||
+      !benchmarkSynthetic(Group, "NoSymtab", /*WriteSymtab=*/false))
+    return 1;
+  return 0;
+}
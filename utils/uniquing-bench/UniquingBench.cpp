@@ -0,0 +1,94 @@
+//===- UniquingBench - Benchmark the LLVMContext uniquing tables ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program creates and looks up constants, constant expressions, types and
+// metadata nodes from a single thread, with and without
+// LLVMContext::setThreadSafeUniquing, and outputs how long each run takes, so
+// that the cost of the locks for single-threaded clients can be measured.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace llvm;
+
+static cl::opt<unsigned> NumEntities("entities",
+                                     cl::desc("Number of distinct entities"),
+                                     cl::init(20000));
+
+static cl::opt<unsigned>
+    NumRounds("rounds",
+              cl::desc("Number of times each entity is looked up per run"),
+              cl::init(20));
+
+static cl::opt<unsigned> NumRuns("runs",
+                                 cl::desc("Number of runs, the fastest of "
+                                          "which is reported"),
+                                 cl::init(10));
+
+/// Get every entity NumRounds times from a fresh context, so that the first
+/// round creates them and the others find them in the uniquing tables.
+static void uniqueEntities(bool ThreadSafe) {
+  LLVMContext Context;
+  Context.setThreadSafeUniquing(ThreadSafe);
+  Type *DoubleTy = Type::getDoubleTy(Context);
+  for (unsigned Round = 0; Round != NumRounds; ++Round) {
+    for (unsigned I = 0; I != NumEntities; ++I) {
+      IntegerType *Ty = IntegerType::get(Context, 8 + I % 64);
+      PointerType *PtrTy = PointerType::get(Ty, 0);
+      Constant *C = ConstantInt::get(Ty, I);
+      ConstantExpr::getIntToPtr(C, PtrTy);
+      ConstantPointerNull::get(PtrTy);
+      UndefValue::get(Ty);
+      ConstantFP::get(DoubleTy, double(I));
+      Metadata *Ops[] = {MDString::get(Context, utostr(I)),
+                         ConstantAsMetadata::get(C)};
+      MDTuple::get(Context, Ops);
+    }
+  }
+}
+
+static double benchmark(TimerGroup &Group, bool ThreadSafe) {
+  StringRef Name = ThreadSafe ? "locked" : "unlocked";
+  double Best = 0;
+  for (unsigned Run = 0; Run != NumRuns; ++Run) {
+    Timer T(Name, ThreadSafe ? "thread-safe uniquing" : "default uniquing",
+            Group);
+    T.startTimer();
+    uniqueEntities(ThreadSafe);
+    T.stopTimer();
+    double Seconds = T.getTotalTime().getWallTime();
+    Best = Run ? std::min(Best, Seconds) : Seconds;
+  }
+  outs() << format("%-10s %8u entities %4u rounds %10.3f s\n",
+                   Name.str().c_str(), unsigned(NumEntities),
+                   unsigned(NumRounds), Best);
+  return Best;
+}
+
+int main(int argc, char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "LLVMContext uniquing benchmark\n");
+  TimerGroup Group("uniquing", "LLVMContext uniquing benchmark");
+  // Warm up the allocator before timing anything.
+  uniqueEntities(false);
+  double Unlocked = benchmark(Group, false);
+  double Locked = benchmark(Group, true);
+  if (Unlocked > 0)
+    outs() << format("overhead %+.1f%%\n", (Locked / Unlocked - 1) * 100);
+  return 0;
+}
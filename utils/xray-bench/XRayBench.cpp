@@ -0,0 +1,92 @@
+//===- XRayBench - Benchmark the XRay trace readers -----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program reads XRay traces both with loadTraceFile and with a
+// TraceStream, and outputs the run time and throughput of each reader. Naive
+// traces of any size can be made from YAML ones with
+// "llvm-xray convert -output-format=raw".
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/XRay/Trace.h"
+
+using namespace llvm;
+using namespace llvm::xray;
+
+static cl::list<std::string> Inputs(cl::Positional, cl::OneOrMore,
+                                    cl::desc("<input traces>"));
+
+static void benchmark(TimerGroup &Group, StringRef Name, StringRef Path) {
+  uint64_t FileSize = 0;
+  sys::fs::file_size(Path, FileSize);
+
+  auto Report = [&](const Timer &T, StringRef What, uint64_t Count) {
+    double Seconds = T.getTotalTime().getWallTime();
+    outs() << format("%-12s %-8s %10llu records %10.1f MB/s\n",
+                     Name.str().c_str(), What.str().c_str(),
+                     (unsigned long long)Count,
+                     Seconds ? FileSize / Seconds / (1024 * 1024) : 0.0);
+  };
+
+  Timer Loading((Name + ".load").str(), (Name + ": loadTraceFile").str(),
+                Group);
+  uint64_t Count = 0;
+  int64_t Checksum = 0;
+  Loading.startTimer();
+  {
+    auto TraceOrErr = loadTraceFile(Path);
+    if (!TraceOrErr) {
+      logAllUnhandledErrors(TraceOrErr.takeError(), errs(), "xray-bench: ");
+      return;
+    }
+    for (const auto &R : *TraceOrErr)
+      Checksum += R.FuncId;
+    Count = TraceOrErr->size();
+  }
+  Loading.stopTimer();
+  Report(Loading, "load", Count);
+
+  Timer Streaming((Name + ".stream").str(), (Name + ": TraceStream").str(),
+                  Group);
+  Count = 0;
+  Streaming.startTimer();
+  {
+    auto StreamOrErr = openTraceFile(Path);
+    if (!StreamOrErr) {
+      logAllUnhandledErrors(StreamOrErr.takeError(), errs(), "xray-bench: ");
+      return;
+    }
+    Error Err = Error::success();
+    for (const auto &R : (*StreamOrErr)->records(Err)) {
+      Checksum -= R.FuncId;
+      ++Count;
+    }
+    if (Err)
+      logAllUnhandledErrors(std::move(Err), errs(), "xray-bench: ");
+  }
+  Streaming.stopTimer();
+  Report(Streaming, "stream", Count);
+
+  if (Checksum)
+    errs() << "xray-bench: " << Name << ": readers disagree\n";
+}
+
+int main(int argc, char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "XRay trace reader benchmark\n");
+  TimerGroup Group("xray", "XRay trace reader benchmark");
+  for (const std::string &Input : Inputs)
+    benchmark(Group, sys::path::filename(Input), Input);
+  return 0;
+}